@@ -0,0 +1,21 @@
+/*
+ * Mechgah, a precise NES emulator.
+ * Developped by Nicolas Chabanis, Nicolas Hily, Baptiste Mehat and
+ * Dylan Gageot, student at INSA Rennes.
+ *
+ * Speed measurement of the emulator core, without display nor SDL.
+ */
+
+#include "src/bench.h"
+
+int main(int argc, char **argv) {
+	/* Instanciate Bench structure */
+	Bench bench;
+
+	/* Init bench */
+	if (Bench_Init(&bench, argc, argv) == EXIT_FAILURE)
+		return EXIT_FAILURE;
+
+	/* Measure every ROM */
+	return Bench_Execute(&bench);
+}
@@ -0,0 +1,21 @@
+/*
+ * Mechgah, a precise NES emulator.
+ * Developped by Nicolas Chabanis, Nicolas Hily, Baptiste Mehat and
+ * Dylan Gageot, student at INSA Rennes.
+ *
+ * Headless batch runner, without display nor SDL.
+ */
+
+#include "src/runner.h"
+
+int main(int argc, char **argv) {
+	/* Instanciate Runner structure */
+	Runner runner;
+
+	/* Init runner */
+	if (Runner_Init(&runner, argc, argv) == EXIT_FAILURE)
+		return EXIT_FAILURE;
+
+	/* Execute every frame */
+	return Runner_Execute(&runner);
+}
@@ -9,12 +9,32 @@
 
 uint8_t App_Init(App *self, int argc, char **argv) {
 	int opt;
+	long rewindSeconds = APP_REWIND_SECONDS, rewindBudget = APP_REWIND_BUDGET;
+	char *statsFileName = NULL;
+	Stats stats;
 	opterr = 0; /* In order to return '?' if there is an error */
 	self->scale = 2; /* Default scaling factor is 2 */
+	self->rewind = NULL;
+	self->stats = NULL;
+	self->timeline = NULL;
+	self->timelineFileName = NULL;
 
 	/* Process given option */
-	while((opt = getopt(argc, argv, "s:")) != -1){
+	while((opt = getopt(argc, argv, "s:r:m:S:T:")) != -1){
 		switch(opt){
+			case 'r':
+			case 'm':
+				if(isdigit(*optarg)){
+					if (opt == 'r')
+						rewindSeconds = strtol(optarg, NULL, 10);
+					else
+						rewindBudget = strtol(optarg, NULL, 10);
+				} else {
+					fprintf (stderr, "%s is not a valid value for -%c.\n",
+							 optarg, opt);
+					return EXIT_FAILURE;
+				}
+				break;
 			case 's':
 				if(isdigit(*optarg)){
 					self->scale = strtol(optarg, NULL, 10);
@@ -24,8 +44,15 @@ uint8_t App_Init(App *self, int argc, char **argv) {
 					return EXIT_FAILURE;
 				}
 				break;
+			case 'S':
+				statsFileName = optarg;
+				break;
+			case 'T':
+				self->timelineFileName = optarg;
+				break;
 			case '?':
-				if (optopt == 's')
+				if ((optopt == 's') || (optopt == 'r') || (optopt == 'm') ||
+						(optopt == 'S') || (optopt == 'T'))
 					fprintf (stderr, "Option -%c requires an argument.\n", 
 							 optopt);
 				else if (isprint(optopt))
@@ -63,6 +90,50 @@ uint8_t App_Init(App *self, int argc, char **argv) {
 	if (self->nes == NULL)
 		return EXIT_FAILURE;
 
+	/* Rewind ring, 60 frames per second */
+	if (rewindSeconds > 0) {
+		self->rewind = Rewind_Create(rewindBudget * 1024,
+				rewindSeconds * 60);
+		if (self->rewind == NULL) {
+			fprintf(stderr, "Error: can't create rewind ring of %ld KiB\n",
+					rewindBudget);
+			NES_Destroy(self->nes);
+			return EXIT_FAILURE;
+		}
+	}
+
+	/* Counters of every frame */
+	if (statsFileName != NULL) {
+		if (NES_GetStats(self->nes, &stats) == EXIT_FAILURE) {
+			fprintf(stderr, "Error: counters need a build with NES_STATS\n");
+			Rewind_Destroy(self->rewind);
+			NES_Destroy(self->nes);
+			return EXIT_FAILURE;
+		}
+		self->stats = fopen(statsFileName, "w");
+		if (self->stats == NULL) {
+			fprintf(stderr, "Error: can't open %s\n", statsFileName);
+			Rewind_Destroy(self->rewind);
+			NES_Destroy(self->nes);
+			return EXIT_FAILURE;
+		}
+		self->statsFormat = Stats_Format(statsFileName);
+		Stats_PrintHeader(self->stats, self->statsFormat);
+	}
+
+	/* Phases of every frame, scanlines and vertical blanks of PPU */
+	if (self->timelineFileName != NULL) {
+		self->timeline = Timeline_Create(TIMELINE_EVENT_CNT);
+		if (self->timeline == NULL) {
+			if (self->stats != NULL)
+				fclose(self->stats);
+			Rewind_Destroy(self->rewind);
+			NES_Destroy(self->nes);
+			return EXIT_FAILURE;
+		}
+		PPU_SetTimeline(self->nes->ppu, self->timeline);
+	}
+
 	/* SDL initialization */
 	if (SDL_Init(SDL_INIT_VIDEO) == -1) {
 		fprintf(stderr, "Error: Can't initialize SDL (%s)\n", SDL_GetError());
@@ -79,6 +150,8 @@ uint8_t App_Init(App *self, int argc, char **argv) {
 uint8_t App_Execute(App *self) {
 	int continuer = 1, returnValue = EXIT_SUCCESS;
 	uint16_t keysPressed;
+	uint8_t rewinding;
+	Stats stats;
     SDL_Event event;
 	SDL_Surface *surface = NULL, *scaled = NULL;
 	SDL_Rect srcdest; srcdest.x = 0; srcdest.y = 0;
@@ -86,14 +159,35 @@ uint8_t App_Execute(App *self) {
 	self->nextFlip = SDL_GetTicks() + TICK_INTERVAL;
     while (continuer)
     {
+		Timeline_Begin(self->timeline, TIMELINE_APP, "frame");
 
+		Timeline_Begin(self->timeline, TIMELINE_APP, "handleKeys");
 		continuer = handleKeys(self->keysConfig, &keysPressed, &event);
-
-		if (NES_NextFrame(self->nes, keysPressed) == EXIT_FAILURE) {
-			returnValue = EXIT_FAILURE;
-			continuer = 0;
+		Timeline_End(self->timeline, TIMELINE_APP, "handleKeys");
+
+		/* Go back one frame and run it again to draw it, without recording.
+		 * Picture isn't part of state: the frame is run with live keys only
+		 * to be drawn, then popped state is restored, so that emulation
+		 * resumes from a state of history once the key is released */
+		rewinding = (self->rewind != NULL) &&
+			SDL_GetKeyState(NULL)[APP_REWIND_KEY];
+		Timeline_Begin(self->timeline, TIMELINE_APP, "NES_NextFrame");
+		if (!rewinding ||
+				(Rewind_Pop(self->rewind, self->nes) == EXIT_SUCCESS)) {
+			if (NES_NextFrame(self->nes, keysPressed) == EXIT_FAILURE) {
+				returnValue = EXIT_FAILURE;
+				continuer = 0;
+			} else if (!rewinding)
+				Rewind_Push(self->rewind, self->nes);
+			else
+				NES_LoadState(self->nes, self->rewind->state);
+			if ((self->stats != NULL) &&
+					(NES_GetStats(self->nes, &stats) == EXIT_SUCCESS))
+				Stats_Print(&stats, self->stats, self->statsFormat);
 		}
+		Timeline_End(self->timeline, TIMELINE_APP, "NES_NextFrame");
 
+		Timeline_Begin(self->timeline, TIMELINE_APP, "SDL_CreateRGBSurfaceFrom");
 		surface = SDL_CreateRGBSurfaceFrom((void*) NES_Render(self->nes),
 					256,
 					240,
@@ -103,18 +197,38 @@ uint8_t App_Execute(App *self) {
 					0x0000FF00,             // green mask
 					0x000000FF,             // blue mask
 				    0x00000000);            // alpha mask (none)
+		Timeline_End(self->timeline, TIMELINE_APP, "SDL_CreateRGBSurfaceFrom");
+		Timeline_Begin(self->timeline, TIMELINE_APP, "rotozoomSurface");
 		scaled = rotozoomSurface(surface, 0, self->scale, SMOOTHING_OFF);
+		Timeline_End(self->timeline, TIMELINE_APP, "rotozoomSurface");
+		Timeline_Begin(self->timeline, TIMELINE_APP, "blit");
 		SDL_FillRect(self->screen, NULL, 0x000000);
 		SDL_BlitSurface(scaled, NULL, self->screen, &srcdest);
+		Timeline_End(self->timeline, TIMELINE_APP, "blit");
+		Timeline_Begin(self->timeline, TIMELINE_APP, "SDL_Delay");
 		SDL_Delay(App_TimeLeft(self));
+		Timeline_End(self->timeline, TIMELINE_APP, "SDL_Delay");
         self->nextFlip += TICK_INTERVAL;
+		Timeline_Begin(self->timeline, TIMELINE_APP, "SDL_Flip");
 	 	SDL_Flip(self->screen);
+		Timeline_End(self->timeline, TIMELINE_APP, "SDL_Flip");
 		SDL_FreeSurface(scaled);
+
+		Timeline_End(self->timeline, TIMELINE_APP, "frame");
     }
 
 	SDL_FreeSurface(self->screen);
 	SDL_Quit();
+	Rewind_Destroy(self->rewind);
 	NES_Destroy(self->nes);
+	if (self->stats != NULL)
+		fclose(self->stats);
+	/* Events are written once emulation is over */
+	if ((self->timeline != NULL) &&
+			(Timeline_Write(self->timeline, self->timelineFileName) ==
+			 EXIT_FAILURE))
+		returnValue = EXIT_FAILURE;
+	Timeline_Destroy(self->timeline);
 	return returnValue;
 }
 
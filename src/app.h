@@ -11,15 +11,39 @@
 
 #include <SDL/SDL.h>
 #include "nes/nes.h"
+#include "nes/rewind/rewind.h"
+#include "nes/timeline/timeline.h"
 
 #define TICK_INTERVAL 16
 
+/**
+ * \brief Key to hold in order to rewind
+ */
+#define APP_REWIND_KEY			SDLK_BACKSPACE
+
+/**
+ * \brief Default number of seconds that can be rewound
+ */
+#define APP_REWIND_SECONDS		30
+
+/**
+ * \brief Default memory budget of rewind ring in KiB
+ */
+#define APP_REWIND_BUDGET		1024
+
 /**
  * \brief Hold application data
  */
 typedef struct {
 	/* Emulator */
 	NES *nes;						/*!< Instance of NES emulator	*/
+	Rewind *rewind;					/*!< Last frames, NULL if none	*/
+	FILE *stats;					/*!< Counters of every frame,
+									     NULL if none				*/
+	uint8_t statsFormat;			/*!< StatsFormat of counters	*/
+	Timeline *timeline;				/*!< Phases of every frame,
+									     NULL if none				*/
+	char *timelineFileName;			/*!< File written on exit		*/
 	/* SDL */
 	SDL_Surface *screen;			/*!< Main screen surface		*/
 	uint16_t keysConfig[16];		/*!< Key configuration			*/
@@ -0,0 +1,260 @@
+#include "bench.h"
+#include "runner.h"
+#include "nes/const.h"
+#include "common/macro.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <ctype.h>
+#include <time.h>
+
+/* ROMs run when none is given */
+static char *benchDefault[] = {
+	"src/unit-test/roms/nestest.nes",
+	"src/unit-test/roms/background.nes",
+	"src/unit-test/roms/allpads.nes",
+	"src/unit-test/roms/oamdma.nes",
+};
+
+/* CPU core selected at build time */
+#if defined(CPU_DYNAREC)
+#define BENCH_CORE	"dynarec"
+#elif defined(CPU_THREADED)
+#define BENCH_CORE	"threaded"
+#else
+#define BENCH_CORE	"interpreter"
+#endif
+
+uint8_t Bench_Init(Bench *self, int argc, char **argv) {
+	char **fileNames = benchDefault;
+	uint32_t i;
+	int opt;
+	opterr = 0; /* In order to return '?' if there is an error */
+	self->frameCount = BENCH_FRAME_CNT;
+	self->warmupCount = BENCH_WARMUP_CNT;
+	self->repeatCount = BENCH_REPEAT_CNT;
+	self->json = 0;
+	self->result = NULL;
+	self->romCount = sizeof(benchDefault) / sizeof(char*);
+
+	/* Process given option */
+	while ((opt = getopt(argc, argv, "f:w:r:J")) != -1) {
+		switch (opt) {
+			case 'f':
+			case 'w':
+			case 'r':
+				/* Warm-up may be skipped */
+				if (!isdigit(*optarg) || ((opt != 'w') &&
+							(strtol(optarg, NULL, 10) < 1))) {
+					fprintf(stderr, "%s is not a valid value for -%c.\n",
+							optarg, opt);
+					return EXIT_FAILURE;
+				}
+				if (opt == 'f')
+					self->frameCount = strtol(optarg, NULL, 10);
+				else if (opt == 'w')
+					self->warmupCount = strtol(optarg, NULL, 10);
+				else
+					self->repeatCount = strtol(optarg, NULL, 10);
+				break;
+			case 'J':
+				self->json = 1;
+				break;
+			case '?':
+				if (strchr("fwr", optopt) != NULL)
+					fprintf(stderr, "Option -%c requires an argument.\n",
+							optopt);
+				else if (isprint(optopt))
+					fprintf(stderr, "Unknown option `-%c'.\n", optopt);
+				else
+					fprintf(stderr, "Unknown option character `\\x%x'.\n",
+							optopt);
+				return EXIT_FAILURE;
+			default:
+				return EXIT_FAILURE;
+		}
+	}
+
+	if (optind < argc) {
+		fileNames = argv + optind;
+		self->romCount = argc - optind;
+	}
+
+	/* One result per ROM, each holding its repetitions */
+	self->result = (BenchResult*) calloc(self->romCount, sizeof(BenchResult));
+	if (self->result == NULL) {
+		ERROR_MSG("can't allocate memory for bench results");
+		return EXIT_FAILURE;
+	}
+	for (i = 0; i < self->romCount; i++) {
+		self->result[i].filename = fileNames[i];
+		self->result[i].seconds = (double*) calloc(self->repeatCount,
+				sizeof(double));
+		if (self->result[i].seconds == NULL) {
+			ERROR_MSG("can't allocate memory for bench results");
+			Bench_Destroy(self);
+			return EXIT_FAILURE;
+		}
+	}
+
+	return EXIT_SUCCESS;
+}
+
+static int Bench_Compare(const void *a, const void *b) {
+	double x = *(const double*) a, y = *(const double*) b;
+	return (x > y) - (x < y);
+}
+
+double Bench_Median(double *values, uint32_t count) {
+	if (count == 0)
+		return 0.0;
+	qsort(values, count, sizeof(double), Bench_Compare);
+	if (count % 2)
+		return values[count / 2];
+	return (values[count / 2 - 1] + values[count / 2]) / 2;
+}
+
+uint8_t Bench_Run(Bench *self, BenchResult *result) {
+	struct timespec start, end;
+	double *sorted = NULL;
+	uint64_t hash, cycles;
+	uint32_t repeat, frame;
+	NES *nes = NULL;
+
+	for (repeat = 0; repeat < self->repeatCount; repeat++) {
+		nes = NES_Create(result->filename);
+		if (nes == NULL)
+			return EXIT_FAILURE;
+
+		/* Caches are filled by warm-up, not timed */
+		for (frame = 0; frame < self->warmupCount; frame++) {
+			if (NES_NextFrame(nes, 0) == EXIT_FAILURE) {
+				NES_Destroy(nes);
+				return EXIT_FAILURE;
+			}
+		}
+
+		cycles = nes->clockCount;
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		for (frame = 0; frame < self->frameCount; frame++) {
+			if (NES_NextFrame(nes, 0) == EXIT_FAILURE) {
+				NES_Destroy(nes);
+				return EXIT_FAILURE;
+			}
+		}
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		result->seconds[repeat] = (end.tv_sec - start.tv_sec) +
+			(end.tv_nsec - start.tv_nsec) / 1e9;
+		cycles = nes->clockCount - cycles;
+
+		/* Every repetition must execute the same thing */
+		hash = Runner_Hash(NES_RenderIndex(nes),
+				NES_SCREEN_WIDTH * NES_SCREEN_HEIGTH);
+		NES_Destroy(nes);
+		if ((repeat > 0) && ((hash != result->hash) ||
+					(cycles != result->cycles))) {
+			fprintf(stderr, "Error: %s is not reproducible\n",
+					result->filename);
+			return EXIT_FAILURE;
+		}
+		result->hash = hash;
+		result->cycles = cycles;
+	}
+
+	/* Keep repetitions in their order for report */
+	sorted = (double*) malloc(self->repeatCount * sizeof(double));
+	if (sorted == NULL) {
+		ERROR_MSG("can't allocate memory for bench results");
+		return EXIT_FAILURE;
+	}
+	memcpy(sorted, result->seconds, self->repeatCount * sizeof(double));
+	result->median = Bench_Median(sorted, self->repeatCount);
+	free(sorted);
+	return EXIT_SUCCESS;
+}
+
+/* Print a JSON string, escaping what has to be */
+static void Bench_PrintString(FILE *file, const char *str) {
+	fputc('"', file);
+	for (; *str != '\0'; str++) {
+		if ((*str == '"') || (*str == '\\'))
+			fprintf(file, "\\%c", *str);
+		else if ((unsigned char) *str < 0x20)
+			fprintf(file, "\\u%04x", *str);
+		else
+			fputc(*str, file);
+	}
+	fputc('"', file);
+}
+
+void Bench_Report(Bench *self, FILE *file) {
+	BenchResult *result;
+	double fps, nsCycle, nsDot;
+	uint32_t i, j;
+
+	if (self->json) {
+		fprintf(file, "{\n\t\"core\": \"%s\",\n\t\"frames\": %u,\n"
+				"\t\"warmup\": %u,\n\t\"repeat\": %u,\n\t\"roms\": [",
+				BENCH_CORE, self->frameCount, self->warmupCount,
+				self->repeatCount);
+	} else {
+		fprintf(file, "core: %s, %u frames, %u warm-up, median of %u\n",
+				BENCH_CORE, self->frameCount, self->warmupCount,
+				self->repeatCount);
+	}
+
+	for (i = 0; i < self->romCount; i++) {
+		result = &self->result[i];
+		fps = (result->median > 0) ? self->frameCount / result->median : 0.0;
+		nsCycle = (result->cycles > 0) ?
+			result->median * 1e9 / result->cycles : 0.0;
+		/* Derived, not measured: the PPU runs exactly 3 dots per CPU cycle */
+		nsDot = nsCycle / 3;
+		if (!self->json) {
+			fprintf(file, "%s: %.1f fps, %.2f ns/cycle, %.2f ns/dot, "
+					"hash %016llx\n", result->filename, fps, nsCycle, nsDot,
+					(unsigned long long) result->hash);
+			continue;
+		}
+		fprintf(file, "%s\n\t\t{\n\t\t\t\"rom\": ", (i > 0) ? "," : "");
+		Bench_PrintString(file, result->filename);
+		fprintf(file, ",\n\t\t\t\"fps\": %.3f,\n\t\t\t\"ns_per_cycle\": %.4f,"
+				"\n\t\t\t\"ns_per_dot\": %.4f,\n\t\t\t\"cycles\": %llu,"
+				"\n\t\t\t\"hash\": \"%016llx\",\n\t\t\t\"seconds\": [",
+				fps, nsCycle, nsDot, (unsigned long long) result->cycles,
+				(unsigned long long) result->hash);
+		for (j = 0; j < self->repeatCount; j++)
+			fprintf(file, "%s%.6f", (j > 0) ? ", " : "", result->seconds[j]);
+		fprintf(file, "]\n\t\t}");
+	}
+
+	if (self->json)
+		fprintf(file, "\n\t]\n}\n");
+}
+
+uint8_t Bench_Execute(Bench *self) {
+	uint8_t returnValue = EXIT_SUCCESS;
+	uint32_t i;
+
+	for (i = 0; i < self->romCount; i++) {
+		if (Bench_Run(self, &self->result[i]) == EXIT_FAILURE) {
+			returnValue = EXIT_FAILURE;
+			break;
+		}
+	}
+	if (returnValue == EXIT_SUCCESS)
+		Bench_Report(self, stdout);
+
+	Bench_Destroy(self);
+	return returnValue;
+}
+
+void Bench_Destroy(Bench *self) {
+	uint32_t i;
+	if (self->result != NULL) {
+		for (i = 0; i < self->romCount; i++)
+			free(self->result[i].seconds);
+	}
+	free(self->result);
+	self->result = NULL;
+}
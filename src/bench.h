@@ -0,0 +1,118 @@
+/**
+ * \file bench.h
+ * \brief header file of Bench, reproducible speed measurement of the core
+ * \author Dylan Gageot
+ * \version 1.0
+ * \date 2019-06-28
+ *
+ * Each ROM is run in a fresh instance, without any key pressed, so that
+ * every repetition executes exactly the same frames. Warm-up frames are
+ * executed first and not timed. The median of repetitions is reported, with
+ * host time per emulated CPU cycle and per PPU dot. The latter is derived
+ * from the former, as the PPU runs exactly 3 dots per CPU cycle. A hash of
+ * the last picture is checked to be the same across repetitions.
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdio.h>
+#include "nes/nes.h"
+
+/**
+ * \brief Default number of timed frames
+ */
+#define BENCH_FRAME_CNT		600
+
+/**
+ * \brief Default number of frames executed before timing
+ */
+#define BENCH_WARMUP_CNT	60
+
+/**
+ * \brief Default number of repetitions
+ */
+#define BENCH_REPEAT_CNT	5
+
+/**
+ * \brief Measures of a ROM
+ */
+typedef struct {
+	char *filename;					/*!< ROM file						*/
+	double *seconds;				/*!< Time of each repetition		*/
+	double median;					/*!< Median time					*/
+	uint64_t cycles;				/*!< CPU cycles of timed frames		*/
+	uint64_t hash;					/*!< Hash of last picture			*/
+} BenchResult;
+
+/**
+ * \brief Hold bench data
+ */
+typedef struct {
+	uint32_t frameCount;			/*!< Number of timed frames			*/
+	uint32_t warmupCount;			/*!< Number of warm-up frames		*/
+	uint32_t repeatCount;			/*!< Number of repetitions			*/
+	uint8_t json;					/*!< Report in JSON					*/
+	BenchResult *result;			/*!< Measures, one per ROM			*/
+	uint32_t romCount;				/*!< Number of ROMs					*/
+} Bench;
+
+/**
+ * \brief Retrieve information from given launch option
+ *
+ * ROMs bundled with unit tests are used when none is given.
+ *
+ * \param self instance of Bench
+ * \param argc value of argc
+ * \param argv address of argv
+ *
+ * \return EXIT_SUCCESS if succeed, EXIT_FAILURE otherwise
+ */
+uint8_t Bench_Init(Bench *self, int argc, char **argv);
+
+/**
+ * \brief Median of values, sorting them
+ *
+ * \param values array of values
+ * \param count number of values
+ *
+ * \return median, mean of both middle values if count is even
+ */
+double Bench_Median(double *values, uint32_t count);
+
+/**
+ * \brief Measure a ROM, every repetition in a new instance
+ *
+ * \param self instance of Bench
+ * \param result measures of the ROM to fill
+ *
+ * \return EXIT_SUCCESS if succeed, EXIT_FAILURE if ROM can't be run or if
+ * repetitions don't give the same picture
+ */
+uint8_t Bench_Run(Bench *self, BenchResult *result);
+
+/**
+ * \brief Print measures of every ROM, as text or JSON
+ *
+ * \param self instance of Bench
+ * \param file stream to print to
+ */
+void Bench_Report(Bench *self, FILE *file);
+
+/**
+ * \brief Measure every ROM and print report to stdout
+ *
+ * \param self instance of Bench
+ *
+ * \return EXIT_SUCCESS if succeed, EXIT_FAILURE otherwise
+ */
+uint8_t Bench_Execute(Bench *self);
+
+/**
+ * \brief Free resources of Bench
+ *
+ * \param self instance of Bench
+ */
+void Bench_Destroy(Bench *self);
+
+#endif /* BENCH_H */
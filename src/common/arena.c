@@ -0,0 +1,34 @@
+#include "arena.h"
+#include <stdlib.h>
+#include <string.h>
+
+uint8_t Arena_Init(Arena *self, void *memory, size_t size) {
+	if ((self == NULL) || (memory == NULL) ||
+		(((uintptr_t) memory) & (ARENA_ALIGN - 1)))
+		return EXIT_FAILURE;
+
+	self->base = (uint8_t*) memory;
+	self->size = size;
+	self->used = 0;
+	return EXIT_SUCCESS;
+}
+
+void* Arena_Alloc(Arena *self, size_t size) {
+	void *ptr;
+	if (self == NULL)
+		return calloc(1, size);
+
+	/* Next chunk starts on a cache line */
+	if (ARENA_SIZE(size) > self->size - self->used)
+		return NULL;
+	ptr = self->base + self->used;
+	self->used += ARENA_SIZE(size);
+	memset(ptr, 0, size);
+	return ptr;
+}
+
+void Arena_Free(Arena *self, void *ptr) {
+	/* Arena chunks go away with their block */
+	if (self == NULL)
+		free(ptr);
+}
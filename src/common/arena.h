@@ -0,0 +1,68 @@
+/**
+ * \file arena.h
+ * \brief header file of Arena module
+ * \author Dylan Gageot
+ * \version 1.0
+ * \date 2019-06-26
+ *
+ * Hand out cache-line aligned chunks of a block provided by caller, one after
+ * the other. Chunks are never freed one by one: the whole block is given back
+ * by its owner. A NULL arena stands for the heap, so that modules can use the
+ * same code whether they live in an arena or not.
+ */
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * \brief Alignment of every chunk, and of block given to Arena_Init
+ */
+#define ARENA_ALIGN		64
+
+/**
+ * \brief Space taken in arena by a chunk of given size
+ */
+#define ARENA_SIZE(size)	(((size) + ARENA_ALIGN - 1) & ~((size_t) ARENA_ALIGN - 1))
+
+/**
+ * \brief Block split into chunks
+ */
+typedef struct {
+	uint8_t *base;		/*!< First byte of block		*/
+	size_t size;		/*!< Size of block				*/
+	size_t used;		/*!< Bytes already handed out	*/
+} Arena;
+
+/**
+ * \brief Use memory given by caller as an arena
+ *
+ * \param self instance of Arena
+ * \param memory block, aligned on ARENA_ALIGN
+ * \param size size of block
+ *
+ * \return EXIT_SUCCESS if block can be used, EXIT_FAILURE otherwise
+ */
+uint8_t Arena_Init(Arena *self, void *memory, size_t size);
+
+/**
+ * \brief Get a zeroed chunk of memory
+ *
+ * \param self instance of Arena, NULL to allocate on heap
+ * \param size size of chunk
+ *
+ * \return pointer to chunk, NULL if arena is full
+ */
+void* Arena_Alloc(Arena *self, size_t size);
+
+/**
+ * \brief Give a chunk back, only heap chunks are actually freed
+ *
+ * \param self instance of Arena the chunk comes from, NULL for heap
+ * \param ptr chunk to free
+ */
+void Arena_Free(Arena *self, void *ptr);
+
+#endif /* ARENA_H */
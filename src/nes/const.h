@@ -65,7 +65,11 @@
 #define SIZE_PALETTE				0x0010
 #define SIZE_TILE_LAYER				8
 #define SIZE_TILE					16
+#define SIZE_TILE_DECODED			64
+#define TILE_CNT					512
 #define	PRERENDER_SCANLINE			-1
+#define	SCANLINE_CNT				263
+#define	CYCLE_CNT					341
 #define SIZE_TILE_PIXEL				8
 #define	TILE_X_CNT					(NES_SCREEN_WIDTH/SIZE_TILE_PIXEL)	
 #define	TILE_Y_CNT					(NES_SCREEN_HEIGTH/SIZE_TILE_PIXEL)
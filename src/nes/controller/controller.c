@@ -27,11 +27,16 @@
 */
 
 Controller* Controller_Create(Mapper *mapper){
-  Controller * self = (Controller*)malloc(sizeof(Controller));
+  return Controller_CreateIn(NULL, mapper);
+}
+
+Controller* Controller_CreateIn(Arena *arena, Mapper *mapper){
+  Controller * self = (Controller*)Arena_Alloc(arena, sizeof(Controller));
   if(self != NULL && self != NULL){
+    self->arena = arena;
     self->mapper = mapper;
-    self->joy1 = Joypad_Create(1);
-    self->joy2 = Joypad_Create(2);
+    self->joy1 = Joypad_CreateIn(arena, 1);
+    self->joy2 = Joypad_CreateIn(arena, 2);
     /* Reset variables */
     self->lastState = -1;
     self->keysPressed = 0;
@@ -42,30 +47,37 @@ Controller* Controller_Create(Mapper *mapper){
   return self;
 }
 
-void Controller_Execute(Controller *self, uint16_t keysPressed){
-  uint8_t ackJoy1 = Mapper_Ack(self->mapper, 0x4016);
-  uint8_t ackJoy2 = Mapper_Ack(self->mapper, 0x4017);
-  if(ackJoy1 & AC_WR){ /* if $4016 was written to */
-    if( (self->JOY1 & 0x01) == 0){
-      if(self->lastState == 1){ /* if game asks to poll keys */
-        self->keysPressed = keysPressed;
-        self->JOY1 &= ~(0x01);
-        self->JOY1 |= Joypad_Latch(self->joy1, self->keysPressed);
-        self->JOY2 &= ~(0x01);
-        self->JOY2 |= Joypad_Latch(self->joy2, self->keysPressed);
-      }
-    }else{
-      self->lastState = 1;
+void Controller_SetKeys(Controller *self, uint16_t keysPressed){
+  /* Latched when the game strobes $4016 */
+  self->keysPressed = keysPressed;
+}
+
+void Controller_Write(void *controller, uint16_t address, uint8_t value){
+  Controller * self = (Controller*)controller;
+  (void) address; /* only $4016 strobes joypads */
+  if( (value & 0x01) == 0){
+    if(self->lastState == 1){ /* if game asks to poll keys */
+      self->JOY1 &= ~(0x01);
+      self->JOY1 |= Joypad_Latch(self->joy1, self->keysPressed);
+      self->JOY2 &= ~(0x01);
+      self->JOY2 |= Joypad_Latch(self->joy2, self->keysPressed);
     }
+  }else{
+    self->lastState = 1;
   }
-  if(Joypad_getPolling(self->joy1) && (ackJoy1 & AC_RD)){ // if joy1 is being polled
-    self->JOY1 &= ~(0x01);
-    self->JOY1 |= Joypad_Shift(self->joy1);
-  }
-  if(Joypad_getPolling(self->joy2) && (ackJoy2 & AC_RD)){ // if joy2 is being polled
-    self->JOY2 &= ~(0x01);
-    self->JOY2 |= Joypad_Shift(self->joy2);
+}
+
+uint8_t Controller_Read(void *controller, uint16_t address){
+  Controller * self = (Controller*)controller;
+  /* $4016 for joy1, $4017 for joy2 */
+  Joypad * joy = (address & 0x01) ? self->joy2 : self->joy1;
+  uint8_t * reg = (address & 0x01) ? &self->JOY2 : &self->JOY1;
+  uint8_t value = *reg;
+  if(Joypad_getPolling(joy)){ /* next read gives next key */
+    *reg &= ~(0x01);
+    *reg |= Joypad_Shift(joy);
   }
+  return value;
 }
 
 void Controller_Destroy(Controller *self){
@@ -74,5 +86,9 @@ void Controller_Destroy(Controller *self){
   }
   Joypad_Destroy(self->joy1);
   Joypad_Destroy(self->joy2);
-  free(self);
+  Arena_Free(self->arena, self);
+}
+
+size_t Controller_RequiredSize(void){
+  return ARENA_SIZE(sizeof(Controller)) + 2 * ARENA_SIZE(sizeof(Joypad));
 }
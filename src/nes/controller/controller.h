@@ -24,6 +24,7 @@ typedef struct{
   Mapper *mapper;
   Joypad *joy1;
   Joypad *joy2;
+  Arena *arena; /* Arena holding the controller, NULL for heap */
 } Controller;
 
 /**
@@ -34,11 +35,42 @@ typedef struct{
 Controller* Controller_Create(Mapper *mapper);
 
 /**
- * \brief Executes the controller system
+ * \brief Allocates memory for controller and its joypads in an arena
+ * \param arena to allocate from, NULL for heap
+ * \param pointer to the used mapper
+ * \return instance of Controller allocated
+*/
+Controller* Controller_CreateIn(Arena *arena, Mapper *mapper);
+
+/**
+ * \brief Arena space needed by Controller_CreateIn
+ * \return size in bytes
+*/
+size_t Controller_RequiredSize(void);
+
+/**
+ * \brief Gives the keys pressed, latched when the game strobes $4016
  * \param The instance of the controller
  * \param The state of the current pressed keys (2*8 keys)
 */
-void Controller_Execute(Controller *self, uint16_t keysPressed);
+void Controller_SetKeys(Controller *self, uint16_t keysPressed);
+
+/**
+ * \brief Write handler of $4016 (see IOReg_SetHandler), strobes the joypads
+ * \param controller instance of the Controller
+ * \param address address written
+ * \param value value written
+*/
+void Controller_Write(void *controller, uint16_t address, uint8_t value);
+
+/**
+ * \brief Read handler of $4016 and $4017 (see IOReg_SetHandler), gives the
+ * current key and shifts to the next one
+ * \param controller instance of the Controller
+ * \param address address read
+ * \return value read
+*/
+uint8_t Controller_Read(void *controller, uint16_t address);
 
 /**
  * \brief Frees the controller instance's memory
@@ -5,8 +5,13 @@
 #include "../../common/macro.h"
 
 Joypad* Joypad_Create(int id){
-  Joypad * self = (Joypad*)malloc(sizeof(Joypad));
+  return Joypad_CreateIn(NULL, id);
+}
+
+Joypad* Joypad_CreateIn(Arena *arena, int id){
+  Joypad * self = (Joypad*)Arena_Alloc(arena, sizeof(Joypad));
   if(self != NULL || id > 2 || id < 1){
+    self->arena = arena;
     self->id = id;
     self->polling = 0;
     self->shiftState = 1;
@@ -53,5 +58,5 @@ uint8_t Joypad_Shift(Joypad *self){
    if(self == NULL){
      return;
    }
-   free(self);
+   Arena_Free(self->arena, self);
  }
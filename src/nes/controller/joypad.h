@@ -10,6 +10,7 @@
  #define JOYPAD_H
 
 #include <stdint.h>
+#include "../../common/arena.h"
 
  /**
   * \brief Holds necessary variables for one joypad
@@ -19,6 +20,7 @@
    int polling; /* 1=game is polling keys */
    int shiftState; /* Holds the number of stateRegister's shifts */
    uint8_t stateRegister; /* Represent the 74LS165 8-bit shift register in the joypad */
+   Arena *arena; /* Arena holding the joypad, NULL for heap */
  } Joypad;
 
  /**
@@ -28,6 +30,14 @@
  */
 Joypad* Joypad_Create(int id);
 
+ /**
+  * \brief Allocates memory for joypad in an arena
+  * \param arena to allocate from, NULL for heap
+  * \param which joypad to create
+  * \return instance of Joypad allocated
+ */
+Joypad* Joypad_CreateIn(Arena *arena, int id);
+
 /**
  * \brief Latches the current pressed keys into the stateRegister
  * and writes the value of A on $401x[0] (x=6 for joy1, 7 for joy2)
@@ -1,14 +1,22 @@
 #include "cpu.h"
 #include "instruction.h"
+#include "icache.h"
+#include "threaded.h"
+#include "dynarec.h"
 #include <unistd.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include "../../common/macro.h"
+#include "../const.h"
 
 
 CPU* CPU_Create(Mapper *mapper){
+	return CPU_CreateIn(NULL, mapper);
+}
+
+CPU* CPU_CreateIn(Arena *arena, Mapper *mapper){
 
-	CPU* self = (CPU*) malloc(sizeof(CPU));
+	CPU* self = (CPU*) Arena_Alloc(arena, sizeof(CPU));
 
 	/*	If allocation failed, return NULL */
 	if (self == NULL) {
@@ -18,6 +26,19 @@ CPU* CPU_Create(Mapper *mapper){
 
 	/* mapper used by the NES */
 	self->mapper = mapper;
+	self->arena = arena;
+
+	/* Cache of decoded instructions, CPU still works without it */
+	self->icache = ICache_Create();
+
+	/* Dynamic recompiler, NULL if not built or not supported */
+#ifdef CPU_DYNAREC
+	self->dynarec = Dynarec_Create(mapper);
+#else
+	self->dynarec = NULL;
+#endif
+	self->trace = NULL;
+	self->profile = NULL;
 
 	return self;
 }
@@ -32,17 +53,75 @@ uint8_t CPU_Init(CPU* self) {
 	self->X = 0;
 	self->Y = 0;
 	self->SP = 0x00;
-	self->P = 0;
+	CPU_SetP(self, 0);
 	self->cntDMA = -1;
 	self->OAMDMA = 0;
 	/* 16-bit program counter */
 	self->PC = 0x0000;
-	/* Remove debug log */
-	remove("cpu.log");
+	/* Forget previously decoded code */
+	ICache_Flush(self->icache);
+	Dynarec_Flush(self->dynarec);
 
 	return EXIT_SUCCESS;
 }
 
+uint8_t CPU_GetP(CPU* self) {
+	/* Flags that are never lazy */
+	uint8_t value = self->P & ~(P_SIGN | P_OVERFLOW | P_ZERO | P_CARRY);
+
+	value |= self->resN & P_SIGN;
+	value |= CPU_LAZY_V(self);
+	value |= (self->resZ == 0) ? P_ZERO : 0;
+	value |= self->C;
+	return value;
+}
+
+void CPU_SetP(CPU* self, uint8_t value) {
+	self->P = value;
+	self->C = value & P_CARRY;
+	self->resN = value;
+	self->resZ = ~value & P_ZERO;
+	/* 0x00 ^ 0x80 on both sides gives the overflow bit */
+	self->vOp1 = 0;
+	self->vOp2 = 0;
+	self->vRes = (value & P_OVERFLOW) << 1;
+}
+
+void CPU_SetTrace(CPU* self, Trace* trace) {
+	self->trace = trace;
+}
+
+void CPU_SetProfile(CPU* self, Profile* profile) {
+	self->profile = profile;
+}
+
+void CPU_Trace(CPU* self, uint16_t pc, uint8_t opcode, uint8_t *arg,
+		uint8_t nbArg, uint64_t clockCycle) {
+	TraceRecord *record = Trace_Next(self->trace);
+	record->cycle = clockCycle;
+	record->pc = pc;
+	record->opcode = opcode;
+	/* Only arguments given are read */
+	record->arg[0] = (nbArg > 0) ? arg[0] : 0;
+	record->arg[1] = (nbArg > 1) ? arg[1] : 0;
+	record->nbArg = nbArg;
+	record->a = self->A;
+	record->x = self->X;
+	record->y = self->Y;
+	record->p = CPU_GetP(self);
+	record->sp = self->SP;
+	Trace_Commit(self->trace);
+}
+
+void CPU_WriteOAMDMA(void* cpu, uint16_t address, uint8_t value) {
+	CPU *self = (CPU*) cpu;
+	(void) address;
+	(void) value;
+	/* Transfer starts with next instruction (see Instruction_DMA) */
+	self->cntDMA = DMA_PENDING;
+	STATS_ADD(Mapper_Stats(self->mapper), dma, 1);
+}
+
 uint8_t CPU_InterruptManager(CPU* self, uint8_t* context){
 
 	uint8_t cycleCount = 0;
@@ -77,7 +156,7 @@ uint8_t CPU_InterruptManager(CPU* self, uint8_t* context){
 		_PUSH(self, &tmp); 
 
 		/* push P on stack */
-		tmp = self->P & ~(1UL << 4); /* Clear B flag on stack */
+		tmp = CPU_GetP(self) & ~(1UL << 4); /* Clear B flag on stack */
 		_PUSH(self, &tmp); 
 	}
 	else { /* if IRQ occured but they are disabled */
@@ -116,7 +195,86 @@ uint8_t CPU_InterruptManager(CPU* self, uint8_t* context){
 	return cycleCount;
 }
 
-uint8_t CPU_Execute(CPU* self, uint8_t* context, uint32_t *clockCycle) {
+/* Execute next instruction with the core selected at build time */
+static inline uint8_t CPU_Step(CPU* self, uint8_t* context,
+		uint64_t *clockCycle) {
+#ifdef CPU_THREADED
+	return Threaded_Execute(self, context, clockCycle);
+#else
+	return CPU_Interpret(self, context, clockCycle);
+#endif
+}
+
+/* Execute next instruction and record its cycles to profile */
+static uint8_t CPU_Profile(CPU* self, uint8_t* context, uint64_t *clockCycle) {
+	uint64_t start = *clockCycle;
+	uint8_t reset = *context & 1, cycles, opcode, dma, status;
+	uint16_t pc;
+
+	/* Interrupt is taken first, so that what is executed next is known */
+	if (*context) {
+		cycles = CPU_InterruptManager(self, context);
+		if (cycles) {
+			*clockCycle += cycles;
+			Profile_Interrupt(self->profile, self->PC, cycles, reset);
+			start = *clockCycle;
+		}
+	}
+
+	/* DMA step, if any, is executed instead of instruction */
+	pc = self->PC;
+	opcode = *Mapper_GetRd(self->mapper, pc);
+	dma = (self->cntDMA != -1) && (self->cntDMA != 256);
+	status = CPU_Step(self, context, clockCycle);
+	if (status == EXIT_SUCCESS)
+		Profile_Record(self->profile, pc, opcode, dma, *clockCycle - start,
+				self->PC);
+	return status;
+}
+
+uint8_t CPU_Execute(CPU* self, uint8_t* context, uint64_t *clockCycle) {
+	if (self->profile != NULL)
+		return CPU_Profile(self, context, clockCycle);
+	return CPU_Step(self, context, clockCycle);
+}
+
+/* Execute next block, translated if possible */
+static inline uint8_t CPU_Block(CPU* self, uint8_t* context,
+		uint64_t *clockCycle, uint32_t budget) {
+	if ((self->dynarec != NULL) && (self->trace == NULL) &&
+			(self->profile == NULL))
+		return Dynarec_Execute(self->dynarec, self, context, clockCycle, budget);
+	return CPU_Execute(self, context, clockCycle);
+}
+
+#ifdef NES_STATS
+/* Execute next block and count it as a translated block or an instruction,
+ * DMA steps are not counted */
+static uint8_t CPU_Count(CPU* self, uint8_t* context, uint64_t *clockCycle,
+		uint32_t budget, Stats *stats) {
+	uint32_t blocks = (self->dynarec != NULL) ? self->dynarec->nbExecuted : 0;
+	uint8_t dma = (self->cntDMA != -1) && (self->cntDMA != 256);
+	uint8_t status = CPU_Block(self, context, clockCycle, budget);
+
+	if ((self->dynarec != NULL) && (self->dynarec->nbExecuted != blocks))
+		stats->blocks++;
+	else if (!dma)
+		stats->instructions++;
+	return status;
+}
+#endif
+
+uint8_t CPU_ExecuteBlock(CPU* self, uint8_t* context, uint64_t *clockCycle,
+		uint32_t budget) {
+#ifdef NES_STATS
+	Stats *stats = Mapper_Stats(self->mapper);
+	if (stats != NULL)
+		return CPU_Count(self, context, clockCycle, budget, stats);
+#endif
+	return CPU_Block(self, context, clockCycle, budget);
+}
+
+uint8_t CPU_Interpret(CPU* self, uint8_t* context, uint64_t *clockCycle) {
 	/* Instruction that will be initialize for execution */
 	Instruction inst;
 
@@ -125,20 +283,14 @@ uint8_t CPU_Execute(CPU* self, uint8_t* context, uint32_t *clockCycle) {
 
 	/* If no DMA operation is on-going, execute program */
 	if (Instruction_DMA(&inst, self, clockCycle) == DMA_OFF) {
-		/* Fetch instruction information from opcode and arg */
-		if (Instruction_Fetch(&inst, self) == EXIT_FAILURE)
-			return EXIT_FAILURE;
-
-		/* Resolve addressing mode from instruction information */
-		if (Instruction_Resolve(&inst, self) == EXIT_FAILURE) 
+		/* Fetch and resolve instruction, from cache when possible */
+		if (ICache_Fetch(self->icache, &inst, self) == EXIT_FAILURE)
 			return EXIT_FAILURE;
 	}
 
-#ifdef DEBUG_CPU
-	/* Log execution information
-	 * This operation will drastically impact execution time */
-	Instruction_PrintLog(&inst, self, *clockCycle); 
-#endif
+	/* Record execution information */
+	if (self->trace != NULL)
+		Instruction_Trace(&inst, self, *clockCycle);
 
 	/* If no instruction is coded for this opcode, exit */
 	if (inst.opcode.inst == NULL) {
@@ -155,7 +307,11 @@ uint8_t CPU_Execute(CPU* self, uint8_t* context, uint32_t *clockCycle) {
 void CPU_Destroy(CPU* self){
 	if (self == NULL)
 		return;
+	/* Free instruction cache */
+	ICache_Destroy(self->icache);
+	/* Free translated blocks */
+	Dynarec_Destroy(self->dynarec);
 	/* Free CPU */
-	free(self);
+	Arena_Free(self->arena, self);
 	return;
 }
@@ -15,6 +15,18 @@
 
 
 #include "../mapper/mapper.h"
+#include "../trace/trace.h"
+#include "../profile/profile.h"
+
+typedef struct ICache ICache;
+typedef struct Dynarec Dynarec;
+
+/**
+ * \brief Overflow flag of a CPU (0x40 if set, 0 otherwise): signs of both
+ * operands are equal and differ from the sign of the result
+ */
+#define CPU_LAZY_V(cpu)	\
+	((((cpu)->vOp1 ^ (cpu)->vRes) & ((cpu)->vOp2 ^ (cpu)->vRes) & 0x80) >> 1)
 
 /**
  * \brief Hold CPU's register and memory
@@ -27,10 +39,28 @@ typedef struct {
 	uint8_t X;								/*!< X index				*/
 	uint8_t Y;								/*!< Y index				*/
 	uint8_t SP;								/*!< Stack Pointer			*/
-	uint8_t P;								/*!< Status					*/
+	uint8_t P;								/*!< Status, N V Z C are
+											     lazy (see CPU_GetP)	*/
+	/* Lazy flags, materialized by CPU_GetP */
+	uint8_t C;								/*!< Carry (0 or 1)			*/
+	uint8_t resN;							/*!< N is bit 7 of it		*/
+	uint8_t resZ;							/*!< Z is set if it is 0	*/
+	uint8_t vOp1;							/*!< Operands and result of	*/
+	uint8_t vOp2;							/*!< last addition giving V	*/
+	uint8_t vRes;							/*!< (see CPU_LAZY_V)		*/
 	uint16_t PC;							/*!< Program counter		*/
 	int16_t cntDMA;							/*!< DMA counter			*/
+	uint8_t bus;							/*!< Operand read from or
+											     written to mapper
+											     callbacks (IO)			*/
 	Mapper* mapper;							/*!< Mapper to get data from*/
+	ICache* icache;							/*!< Decoded instructions	*/
+	Dynarec* dynarec;						/*!< Translated blocks		*/
+	Trace* trace;							/*!< Execution trace, NULL
+											     if not traced			*/
+	Profile* profile;						/*!< Hot spots, NULL if not
+											     profiled				*/
+	Arena* arena;							/*!< Arena holding CPU		*/
 } CPU;
 
 /**
@@ -42,6 +72,19 @@ typedef struct {
  */
 CPU* CPU_Create(Mapper* mapper);
 
+/**
+ * \brief Allocate memory for CPU structure in an arena
+ *
+ * Decoded instructions and translated blocks grow on demand: they are
+ * allocated on heap, even for a CPU living in an arena.
+ *
+ * \param arena arena to allocate from, NULL for heap
+ * \param mapper address of Mapper pointer from NES struct
+ *
+ * \return instance of CPU allocated
+ */
+CPU* CPU_CreateIn(Arena* arena, Mapper* mapper);
+
 /**
  * \brief Initialize all CPU registers (A, X, Y, SP, P and PC)
  *
@@ -52,6 +95,69 @@ CPU* CPU_Create(Mapper* mapper);
 
 uint8_t CPU_Init(CPU* self);
 
+/**
+ * \brief Get status register with every flag up to date
+ *
+ * \param self instance of CPU
+ *
+ * \return value of P
+ */
+uint8_t CPU_GetP(CPU* self);
+
+/**
+ * \brief Set status register, lazy flags included
+ *
+ * \param self instance of CPU
+ * \param value new value of P
+ */
+void CPU_SetP(CPU* self, uint8_t value);
+
+/**
+ * \brief Write handler of OAMDMA (see IOReg_SetHandler), requests a DMA
+ *
+ * \param cpu instance of CPU
+ * \param address address written
+ * \param value page to copy to OAM
+ */
+void CPU_WriteOAMDMA(void* cpu, uint16_t address, uint8_t value);
+
+/**
+ * \brief Start or stop tracing execution, may be called between any two
+ * instructions
+ *
+ * Translated blocks are not used while tracing, so that every instruction
+ * is recorded.
+ *
+ * \param self instance of CPU
+ * \param trace trace to record to, NULL to stop tracing
+ */
+void CPU_SetTrace(CPU* self, Trace* trace);
+
+/**
+ * \brief Start or stop profiling execution, may be called between any two
+ * instructions
+ *
+ * Translated blocks are not used while profiling, so that every instruction
+ * is recorded.
+ *
+ * \param self instance of CPU
+ * \param profile profile to record to, NULL to stop profiling
+ */
+void CPU_SetProfile(CPU* self, Profile* profile);
+
+/**
+ * \brief Record state of CPU before an instruction or a DMA step to its trace
+ *
+ * \param self instance of CPU, traced
+ * \param pc address of opcode
+ * \param opcode opcode
+ * \param arg arguments of opcode (address read if DMA step)
+ * \param nbArg number of arguments, TRACE_DMA if DMA step
+ * \param clockCycle clock cycle
+ */
+void CPU_Trace(CPU* self, uint16_t pc, uint8_t opcode, uint8_t *arg,
+		uint8_t nbArg, uint64_t clockCycle);
+
 /**
  * \brief Handle the NMI, IRQ and BRK interrupts
  *
@@ -75,7 +181,36 @@ uint8_t CPU_InterruptManager(CPU* self, uint8_t* context);
  *
  * \return number of clock cycle used to execute the instruction
  */
-uint8_t CPU_Execute(CPU* self, uint8_t* context, uint32_t *clockCycle);
+uint8_t CPU_Execute(CPU* self, uint8_t* context, uint64_t *clockCycle);
+
+/**
+ * \brief Execute the next instruction with the reference interpreter
+ *
+ * CPU_Execute uses it unless built with CPU_THREADED.
+ *
+ * \param self instance of CPU
+ * \param context variable containing interrupt flags
+ * \param clockCycle pointer to clock cycle variable
+ *
+ * \return number of clock cycle used to execute the instruction
+ */
+uint8_t CPU_Interpret(CPU* self, uint8_t* context, uint64_t *clockCycle);
+
+/**
+ * \brief Execute the next block of instructions when built with CPU_DYNAREC,
+ * the next instruction otherwise
+ *
+ * When built with NES_STATS, what is executed is counted in Stats of mapper.
+ *
+ * \param self instance of CPU
+ * \param context variable containing interrupt flags
+ * \param clockCycle pointer to clock cycle variable
+ * \param budget number of cycles before the PPU may raise an interrupt
+ *
+ * \return EXIT_SUCCESS if succeed, EXIT_FAILURE otherwise
+ */
+uint8_t CPU_ExecuteBlock(CPU* self, uint8_t* context, uint64_t *clockCycle,
+		uint32_t budget);
 
 /**
  * \brief Free CPU's instance
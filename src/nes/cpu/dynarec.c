@@ -0,0 +1,919 @@
+#include "dynarec.h"
+#include "instruction.h"
+#include "threaded.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stddef.h>
+#include "../../common/macro.h"
+#include "../const.h"
+
+/* Host code can only be generated for x86-64 with mmap */
+#if defined(__x86_64__) && (defined(__unix__) || defined(__APPLE__))
+#define DYNAREC_HOST
+#include <sys/mman.h>
+#endif
+
+/* Signature of translated block, return number of cycles consumed */
+typedef uint32_t (*DynarecCode)(CPU*, uint8_t*, const uint8_t*, uint8_t**,
+		uint8_t**);
+
+#ifdef DYNAREC_HOST
+
+/* Free space needed in code buffer before translating a block */
+#define DYNAREC_BLOCK_SIZE	(16 * 1024)
+
+/* x86-64 registers */
+enum {
+	RAX = 0, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+	R8, R9, R10, R11, R12, R13, R14, R15
+};
+
+/* Registers used while a block is running */
+#define H_CYC	RAX		/* Cycles consumed, returned value	*/
+#define H_CPU	RDI		/* CPU structure					*/
+#define H_RAM	RSI		/* CPU RAM							*/
+#define H_NZ	RDX		/* N and Z flags LUT				*/
+#define H_A		R9		/* Accumulator						*/
+#define H_X		R10		/* X index							*/
+#define H_Y		R11		/* Y index							*/
+#define H_P		R12		/* Status							*/
+#define H_RD	R13		/* Read page table					*/
+#define H_WR	R14		/* Write page table					*/
+/* RCX (address), RBX (page pointer, carry), R8 (page index) and
+ * R15 (value, page crossed, overflow) are scratch registers */
+
+/* x86 condition codes */
+enum {
+	CC_O = 0, CC_NO, CC_C, CC_NC, CC_Z, CC_NZ, CC_BE, CC_A
+};
+
+/* x86 opcodes, "op r8, r/m8" form (ALU group index is opcode >> 3) */
+#define X_ADD8		0x02
+#define X_OR8		0x0A
+#define X_ADC8		0x12
+#define X_SBB8		0x1A
+#define X_AND8		0x22
+#define X_SUB8		0x2A
+#define X_XOR8		0x32
+#define X_CMP8		0x3A
+#define X_MOV8		0x8A
+#define X_STORE8	0x88
+#define X_MOVZX8	0x0FB6
+#define X_MOVZX16	0x0FB7
+
+/* x86 shift group index */
+#define X_RCL		2
+#define X_RCR		3
+#define X_SHL		4
+#define X_SHR		5
+
+/* Memory access done by an operand */
+enum {
+	ACC_RD = 0, ACC_WR, ACC_RMW
+};
+
+/* Operand of a 6502 instruction once resolved on host */
+enum {
+	OPD_IMM = 0, OPD_REG, OPD_MEM
+};
+
+typedef struct {
+	uint8_t kind;		/* OPD_IMM, OPD_REG or OPD_MEM			*/
+	uint8_t base;		/* Register or base register			*/
+	int8_t index;		/* Index register, -1 if none			*/
+	uint8_t scale;		/* Index scale (log2)					*/
+	int32_t disp;		/* Displacement or immediate value		*/
+} Operand;
+
+typedef struct {
+	uint8_t *p;							/* Write cursor					*/
+	uint8_t *exitRel[DYNAREC_BLOCK_INST * 3];	/* Jumps to side exits	*/
+	uint16_t exitPC[DYNAREC_BLOCK_INST * 3];	/* PC of side exits		*/
+	uint16_t nbExit;
+	uint8_t *endRel[2];					/* Jumps to epilogue			*/
+	uint8_t nbEnd;
+} Emitter;
+
+/* Code emission */
+
+static void X_Byte(Emitter *e, uint8_t v) {
+	*(e->p++) = v;
+}
+
+static void X_Word(Emitter *e, uint16_t v) {
+	X_Byte(e, v & 0xFF);
+	X_Byte(e, v >> 8);
+}
+
+static void X_Dword(Emitter *e, uint32_t v) {
+	memcpy(e->p, &v, 4);
+	e->p += 4;
+}
+
+static void X_Qword(Emitter *e, uint64_t v) {
+	memcpy(e->p, &v, 8);
+	e->p += 8;
+}
+
+static void X_Rex(Emitter *e, uint8_t w, uint8_t reg, uint8_t index,
+		uint8_t base) {
+	/* Always emitted so that byte registers are never AH-BH */
+	X_Byte(e, 0x40 | (w << 3) | ((reg >> 3) << 2) | ((index >> 3) << 1) |
+			(base >> 3));
+}
+
+static void X_Opcode(Emitter *e, uint16_t op) {
+	if (op > 0xFF)
+		X_Byte(e, op >> 8);
+	X_Byte(e, op & 0xFF);
+}
+
+static void X_RR(Emitter *e, uint8_t w, uint16_t op, uint8_t reg,
+		uint8_t rm) {
+	X_Rex(e, w, reg, 0, rm);
+	X_Opcode(e, op);
+	X_Byte(e, 0xC0 | ((reg & 7) << 3) | (rm & 7));
+}
+
+static void X_Opd(Emitter *e, uint8_t w, uint16_t op, uint8_t reg,
+		const Operand *m) {
+	if (m->kind == OPD_REG) {
+		X_RR(e, w, op, reg, m->base);
+		return;
+	}
+	X_Rex(e, w, reg, (m->index < 0) ? 0 : m->index, m->base);
+	X_Opcode(e, op);
+	if ((m->index < 0) && ((m->base & 7) != RSP)) {
+		X_Byte(e, 0x80 | ((reg & 7) << 3) | (m->base & 7));
+	} else {
+		X_Byte(e, 0x84 | ((reg & 7) << 3));
+		X_Byte(e, (m->scale << 6) |
+				((((m->index < 0) ? RSP : m->index) & 7) << 3) | (m->base & 7));
+	}
+	X_Dword(e, m->disp);
+}
+
+static Operand O_Reg(uint8_t reg) {
+	Operand m = {OPD_REG, reg, -1, 0, 0};
+	return m;
+}
+
+static Operand O_Imm(uint8_t value) {
+	Operand m = {OPD_IMM, 0, -1, 0, value};
+	return m;
+}
+
+static Operand O_Mem(uint8_t base, int8_t index, uint8_t scale, int32_t disp) {
+	Operand m = {OPD_MEM, base, index, scale, disp};
+	return m;
+}
+
+/* op r8, operand (ALU group or MOV) */
+static void X_Alu8(Emitter *e, uint8_t op, uint8_t reg, const Operand *m) {
+	if (m->kind == OPD_IMM) {
+		if (op == X_MOV8) {
+			X_Rex(e, 0, 0, 0, reg);
+			X_Byte(e, 0xB0 | (reg & 7));
+		} else
+			X_RR(e, 0, 0x80, op >> 3, reg);
+		X_Byte(e, m->disp);
+	} else
+		X_Opd(e, 0, op, reg, m);
+}
+
+/* op r8, imm8 */
+static void X_Imm8(Emitter *e, uint8_t op, uint8_t reg, uint8_t value) {
+	Operand m = O_Imm(value);
+	X_Alu8(e, op, reg, &m);
+}
+
+/* ALU group r32, imm32 */
+static void X_Imm32(Emitter *e, uint8_t op, uint8_t reg, uint32_t value) {
+	X_RR(e, 0, 0x81, op >> 3, reg);
+	X_Dword(e, value);
+}
+
+static void X_Shift8(Emitter *e, uint8_t op, uint8_t reg) {
+	X_RR(e, 0, 0xD0, op, reg);
+}
+
+static void X_Shift32(Emitter *e, uint8_t op, uint8_t reg, uint8_t count) {
+	X_RR(e, 0, 0xC1, op, reg);
+	X_Byte(e, count);
+}
+
+static void X_SetCC(Emitter *e, uint8_t cc, uint8_t reg) {
+	X_RR(e, 0, 0x0F90 | cc, 0, reg);
+}
+
+static uint8_t* X_Jcc(Emitter *e, uint8_t cc) {
+	uint8_t *rel;
+	X_Byte(e, 0x0F);
+	X_Byte(e, 0x80 | cc);
+	rel = e->p;
+	X_Dword(e, 0);
+	return rel;
+}
+
+static uint8_t* X_Jmp(Emitter *e) {
+	uint8_t *rel;
+	X_Byte(e, 0xE9);
+	rel = e->p;
+	X_Dword(e, 0);
+	return rel;
+}
+
+static void X_Patch(uint8_t *rel, uint8_t *target) {
+	int32_t offset = (int32_t) (target - (rel + 4));
+	memcpy(rel, &offset, 4);
+}
+
+/* Block helpers */
+
+static void D_Exit(Emitter *e, uint8_t cc, uint16_t pc) {
+	/* Leave block before instruction at pc */
+	e->exitRel[e->nbExit] = X_Jcc(e, cc);
+	e->exitPC[e->nbExit++] = pc;
+}
+
+static void D_SetPC(Emitter *e, uint16_t pc) {
+	Operand m = O_Mem(H_CPU, -1, 0, offsetof(CPU, PC));
+	X_Byte(e, 0x66);
+	X_Opd(e, 0, 0xC7, 0, &m);
+	X_Word(e, pc);
+}
+
+static void D_Cycle(Emitter *e, uint8_t cycle) {
+	X_RR(e, 0, 0x83, 0, H_CYC);
+	X_Byte(e, cycle);
+}
+
+static void D_FlagNZ(Emitter *e, uint8_t reg) {
+	/* P = (P & ~(N | Z)) | nz[reg] */
+	Operand m = O_Mem(H_NZ, R8, 0, 0);
+	X_RR(e, 0, X_MOVZX8, R8, reg);
+	X_Imm8(e, X_AND8, H_P, (uint8_t) ~(P_SIGN | P_ZERO));
+	X_Opd(e, 0, X_OR8, H_P, &m);
+}
+
+static void D_FlagC(Emitter *e) {
+	/* Carry was saved in BL */
+	X_Imm8(e, X_AND8, H_P, (uint8_t) ~P_CARRY);
+	X_RR(e, 0, X_OR8, H_P, RBX);
+}
+
+static void D_FlagV(Emitter *e) {
+	/* Overflow was saved in R15B */
+	X_RR(e, 0, 0xC0, X_SHL, R15);
+	X_Byte(e, 6);
+	X_Imm8(e, X_AND8, H_P, (uint8_t) ~P_OVERFLOW);
+	X_RR(e, 0, X_OR8, H_P, R15);
+}
+
+static void D_LoadCarry(Emitter *e) {
+	/* bt r12d, 0 */
+	X_RR(e, 0, 0x0FBA, 4, H_P);
+	X_Byte(e, 0);
+}
+
+static Operand D_Stack(Emitter *e) {
+	/* movzx ecx, byte [cpu->SP] */
+	Operand sp = O_Mem(H_CPU, -1, 0, offsetof(CPU, SP));
+	X_Opd(e, 0, X_MOVZX8, RCX, &sp);
+	return O_Mem(H_RAM, RCX, 0, ADDR_STACK);
+}
+
+static void D_Push(Emitter *e, uint8_t reg) {
+	Operand sp = O_Mem(H_CPU, -1, 0, offsetof(CPU, SP));
+	Operand m = D_Stack(e);
+	X_Opd(e, 0, X_STORE8, reg, &m);
+	X_Opd(e, 0, 0xFE, 1, &sp);
+}
+
+static void D_PushImm(Emitter *e, uint8_t value) {
+	Operand sp = O_Mem(H_CPU, -1, 0, offsetof(CPU, SP));
+	Operand m = D_Stack(e);
+	X_Opd(e, 0, 0xC6, 0, &m);
+	X_Byte(e, value);
+	X_Opd(e, 0, 0xFE, 1, &sp);
+}
+
+static void D_Pull(Emitter *e, uint8_t reg) {
+	Operand sp = O_Mem(H_CPU, -1, 0, offsetof(CPU, SP));
+	Operand m;
+	X_Opd(e, 0, 0xFE, 0, &sp);
+	m = D_Stack(e);
+	X_Opd(e, 0, X_MOVZX8, reg, &m);
+}
+
+/* ECX holds a CPU address: find host pointer from page tables, leave block
+ * if there is no plain memory behind (IO registers) or if ROM is written */
+static Operand D_Lookup(Emitter *e, uint8_t access, uint16_t pc) {
+	Operand rd = O_Mem(H_RD, R8, 3, 0);
+	Operand wr = O_Mem(H_WR, R8, 3, 0);
+	X_RR(e, 0, 0x8B, R8, RCX);
+	X_Shift32(e, X_SHR, R8, 8);
+	X_Opd(e, 1, 0x8B, RBX, &rd);
+	X_RR(e, 1, 0x85, RBX, RBX);
+	D_Exit(e, CC_Z, pc);
+	if (access != ACC_RD) {
+		X_Imm32(e, X_CMP8, RCX, DYNAREC_BASE);
+		D_Exit(e, CC_NC, pc);
+		X_Opd(e, 1, 0x83, 7, &wr);
+		X_Byte(e, 0);
+		D_Exit(e, CC_Z, pc);
+	}
+	X_RR(e, 0, X_MOVZX8, RCX, RCX);
+	return O_Mem(RBX, RCX, 0, 0);
+}
+
+/* Emit code computing operand of an instruction, R15B holds page crossed
+ * flag for indexed modes */
+static Operand D_Operand(Mapper *mapper, Emitter *e, uint8_t mode,
+		uint8_t *opc, uint8_t access, uint16_t pc) {
+	uint16_t address = (opc[2] << 8) | opc[1];
+	Operand m;
+
+	switch (mode) {
+		case ACC :
+			return O_Reg(H_A);
+		case IMM :
+			return O_Imm(opc[1]);
+		case ZER :
+			return O_Mem(H_RAM, -1, 0, opc[1]);
+		case ZEX :
+		case ZEY :
+			X_RR(e, 0, X_MOVZX8, RCX, (mode == ZEX) ? H_X : H_Y);
+			X_Imm8(e, X_ADD8, RCX, opc[1]);
+			return O_Mem(H_RAM, RCX, 0, 0);
+		case ABS :
+			/* Address is known, so is the memory behind */
+			if (address < 0x2000)
+				return O_Mem(H_RAM, -1, 0, address & 0x07FF);
+			X_Rex(e, 1, 0, 0, RBX);
+			X_Byte(e, 0xB8 | RBX);
+			X_Qword(e, (uint64_t) (uintptr_t)
+					(mapper->pageRd[address >> 8] + (address & 0x00FF)));
+			return O_Mem(RBX, -1, 0, 0);
+		case ABX :
+		case ABY :
+			X_RR(e, 0, X_MOVZX8, RCX, (mode == ABX) ? H_X : H_Y);
+			X_Imm32(e, X_ADD8, RCX, address);
+			X_Imm32(e, X_CMP8, RCX, address | 0x00FF);
+			X_SetCC(e, CC_A, R15);
+			X_RR(e, 0, X_MOVZX16, RCX, RCX);
+			return D_Lookup(e, access, pc);
+		case INX :
+			X_RR(e, 0, X_MOVZX8, RCX, H_X);
+			X_Imm8(e, X_ADD8, RCX, opc[1]);
+			m = O_Mem(H_RAM, RCX, 0, 0);
+			X_Opd(e, 0, X_MOVZX8, RBX, &m);
+			X_RR(e, 0, 0xFE, 0, RCX);
+			X_Opd(e, 0, X_MOVZX8, RCX, &m);
+			X_Shift32(e, X_SHL, RCX, 8);
+			X_RR(e, 0, 0x0B, RCX, RBX);
+			return D_Lookup(e, access, pc);
+		case INY :
+			m = O_Mem(H_RAM, -1, 0, opc[1]);
+			X_Opd(e, 0, X_MOVZX8, RCX, &m);
+			m = O_Mem(H_RAM, -1, 0, (opc[1] + 1) & 0xFF);
+			X_Opd(e, 0, X_MOVZX8, RBX, &m);
+			X_Shift32(e, X_SHL, RBX, 8);
+			X_RR(e, 0, 0x0B, RCX, RBX);
+			X_RR(e, 0, 0x8B, R15, RCX);
+			X_RR(e, 0, X_MOVZX8, RBX, H_Y);
+			X_RR(e, 0, 0x03, RCX, RBX);
+			X_RR(e, 0, 0x33, R15, RCX);
+			X_Shift32(e, X_SHR, R15, 8);
+			X_SetCC(e, CC_NZ, R15);
+			X_RR(e, 0, X_MOVZX16, RCX, RCX);
+			return D_Lookup(e, access, pc);
+	}
+
+	return O_Imm(0);
+}
+
+/* Check that operand of an instruction can be accessed from a block */
+static uint8_t D_CanAccess(Mapper *mapper, uint8_t mode, uint8_t *opc,
+		uint8_t access) {
+	uint16_t address = (opc[2] << 8) | opc[1];
+
+	switch (mode) {
+		case IMM :
+			return access == ACC_RD;
+		case ACC :
+			return access == ACC_RMW;
+		case ZER :
+		case ZEX :
+		case ABX :
+			return 1;
+		case ZEY :
+		case ABY :
+		case INX :
+		case INY :
+			return access != ACC_RMW;
+		case ABS :
+			/* IO registers need the mapper, ROM writes need invalidation */
+			if (mapper->pageRd[address >> 8] == NULL)
+				return 0;
+			if (access == ACC_RD)
+				return 1;
+			return (address < DYNAREC_BASE) &&
+				(mapper->pageWr[address >> 8] != NULL);
+	}
+	return 0;
+}
+
+/* Instruction families */
+static uint8_t D_Family(Opcode info) {
+	if ((info.inst == _LDA) || (info.inst == _LDX) || (info.inst == _LDY) ||
+			(info.inst == _ADC) || (info.inst == _SBC) ||
+			(info.inst == _AND) || (info.inst == _ORA) ||
+			(info.inst == _EOR) || (info.inst == _CMP) ||
+			(info.inst == _CPX) || (info.inst == _CPY) || (info.inst == _BIT))
+		return ACC_RD;
+	if ((info.inst == _STA) || (info.inst == _STX) || (info.inst == _STY))
+		return ACC_WR;
+	return ACC_RMW;
+}
+
+static uint8_t D_HasPenalty(Opcode info) {
+	/* Instructions that take one more cycle when a page is crossed */
+	return (info.inst == _ADC) || (info.inst == _AND) || (info.inst == _CMP) ||
+		(info.inst == _EOR) || (info.inst == _LDA) || (info.inst == _LDX) ||
+		(info.inst == _LDY) || (info.inst == _ORA) || (info.inst == _SBC);
+}
+
+static uint8_t D_Register(Opcode info) {
+	if ((info.inst == _LDX) || (info.inst == _STX) || (info.inst == _CPX))
+		return H_X;
+	if ((info.inst == _LDY) || (info.inst == _STY) || (info.inst == _CPY))
+		return H_Y;
+	return H_A;
+}
+
+/* Result of instruction translation */
+enum {
+	TR_NONE = 0,	/* Not translated, nothing emitted	*/
+	TR_NEXT,		/* Translated, block continues		*/
+	TR_END			/* Translated, PC set by instruction	*/
+};
+
+static uint8_t D_Branch(Emitter *e, uint16_t pc, uint8_t *opc, uint8_t mask,
+		uint8_t ifSet) {
+	uint16_t next = pc + 2;
+	uint16_t target = next + (int8_t) opc[1];
+	uint8_t *notTaken;
+
+	/* test r12b, mask */
+	X_RR(e, 0, 0xF6, 0, H_P);
+	X_Byte(e, mask);
+	notTaken = X_Jcc(e, ifSet ? CC_Z : CC_NZ);
+	/* Taken: +1 cycle, +2 if another page is reached */
+	D_Cycle(e, 2 + (((next ^ target) & 0xFF00) ? 2 : 1));
+	D_SetPC(e, target);
+	e->endRel[e->nbEnd++] = X_Jmp(e);
+	/* Not taken */
+	X_Patch(notTaken, e->p);
+	D_Cycle(e, 2);
+	D_SetPC(e, next);
+	return TR_END;
+}
+
+static uint8_t D_Implied(Emitter *e, Opcode info) {
+	Operand sp = O_Mem(H_CPU, -1, 0, offsetof(CPU, SP));
+
+	if (info.inst == _INX) {
+		X_RR(e, 0, 0xFE, 0, H_X);
+		D_FlagNZ(e, H_X);
+	} else if (info.inst == _INY) {
+		X_RR(e, 0, 0xFE, 0, H_Y);
+		D_FlagNZ(e, H_Y);
+	} else if (info.inst == _DEX) {
+		X_RR(e, 0, 0xFE, 1, H_X);
+		D_FlagNZ(e, H_X);
+	} else if (info.inst == _DEY) {
+		X_RR(e, 0, 0xFE, 1, H_Y);
+		D_FlagNZ(e, H_Y);
+	} else if (info.inst == _TAX) {
+		X_RR(e, 0, X_MOV8, H_X, H_A);
+		D_FlagNZ(e, H_X);
+	} else if (info.inst == _TAY) {
+		X_RR(e, 0, X_MOV8, H_Y, H_A);
+		D_FlagNZ(e, H_Y);
+	} else if (info.inst == _TXA) {
+		X_RR(e, 0, X_MOV8, H_A, H_X);
+		D_FlagNZ(e, H_A);
+	} else if (info.inst == _TYA) {
+		X_RR(e, 0, X_MOV8, H_A, H_Y);
+		D_FlagNZ(e, H_A);
+	} else if (info.inst == _TSX) {
+		X_Opd(e, 0, X_MOV8, H_X, &sp);
+		D_FlagNZ(e, H_X);
+	} else if (info.inst == _TXS) {
+		X_Opd(e, 0, X_STORE8, H_X, &sp);
+	} else if (info.inst == _CLC) {
+		X_Imm8(e, X_AND8, H_P, (uint8_t) ~P_CARRY);
+	} else if (info.inst == _SEC) {
+		X_Imm8(e, X_OR8, H_P, P_CARRY);
+	} else if (info.inst == _CLI) {
+		X_Imm8(e, X_AND8, H_P, (uint8_t) ~P_INTERRUPT);
+	} else if (info.inst == _SEI) {
+		X_Imm8(e, X_OR8, H_P, P_INTERRUPT);
+	} else if (info.inst == _CLD) {
+		X_Imm8(e, X_AND8, H_P, (uint8_t) ~P_DECIMAL);
+	} else if (info.inst == _SED) {
+		X_Imm8(e, X_OR8, H_P, P_DECIMAL);
+	} else if (info.inst == _CLV) {
+		X_Imm8(e, X_AND8, H_P, (uint8_t) ~P_OVERFLOW);
+	} else if (info.inst == _NOP) {
+		/* Nothing to do */
+	} else if (info.inst == _PHA) {
+		D_Push(e, H_A);
+	} else if (info.inst == _PHP) {
+		X_RR(e, 0, X_MOV8, R15, H_P);
+		X_Imm8(e, X_OR8, R15, 0x30);
+		D_Push(e, R15);
+	} else if (info.inst == _PLA) {
+		D_Pull(e, H_A);
+		D_FlagNZ(e, H_A);
+	} else if (info.inst == _PLP) {
+		D_Pull(e, H_P);
+		X_Imm8(e, X_OR8, H_P, 0x20);
+		X_Imm8(e, X_AND8, H_P, (uint8_t) ~P_BRK);
+	} else if (info.inst == _RTS) {
+		Operand pcReg = O_Mem(H_CPU, -1, 0, offsetof(CPU, PC));
+		D_Pull(e, RBX);
+		D_Pull(e, RCX);
+		X_Shift32(e, X_SHL, RCX, 8);
+		X_RR(e, 0, 0x0B, RCX, RBX);
+		X_RR(e, 0, 0xFF, 0, RCX);
+		X_Byte(e, 0x66);
+		X_Opd(e, 0, 0x89, RCX, &pcReg);
+		D_Cycle(e, info.cycle);
+		return TR_END;
+	} else {
+		/* BRK and RTI are left to threaded core */
+		return TR_NONE;
+	}
+
+	D_Cycle(e, info.cycle);
+	return TR_NEXT;
+}
+
+static uint8_t D_Instruction(Mapper *mapper, Emitter *e, uint16_t pc,
+		uint8_t *opc, Opcode info) {
+	uint8_t mode = info.addressingMode, access, reg;
+	uint16_t address = (opc[2] << 8) | opc[1];
+	Operand m;
+
+	/* Control flow */
+	if (mode == REL) {
+		if (info.inst == _BPL) return D_Branch(e, pc, opc, P_SIGN, 0);
+		if (info.inst == _BMI) return D_Branch(e, pc, opc, P_SIGN, 1);
+		if (info.inst == _BVC) return D_Branch(e, pc, opc, P_OVERFLOW, 0);
+		if (info.inst == _BVS) return D_Branch(e, pc, opc, P_OVERFLOW, 1);
+		if (info.inst == _BCC) return D_Branch(e, pc, opc, P_CARRY, 0);
+		if (info.inst == _BCS) return D_Branch(e, pc, opc, P_CARRY, 1);
+		if (info.inst == _BNE) return D_Branch(e, pc, opc, P_ZERO, 0);
+		return D_Branch(e, pc, opc, P_ZERO, 1);
+	}
+	if ((info.inst == _JMP) || (info.inst == _JSR)) {
+		/* Indirect jump and jump in IO registers are left to threaded core */
+		if ((mode != ABS) || (mapper->pageRd[address >> 8] == NULL))
+			return TR_NONE;
+		if (info.inst == _JSR) {
+			D_PushImm(e, (pc + 2) >> 8);
+			D_PushImm(e, (pc + 2) & 0xFF);
+		}
+		D_SetPC(e, address);
+		D_Cycle(e, info.cycle);
+		return TR_END;
+	}
+	if ((mode == IMP) && (info.inst != _ASL) && (info.inst != _LSR) &&
+			(info.inst != _ROL) && (info.inst != _ROR))
+		return D_Implied(e, info);
+
+	/* Instructions working on memory */
+	access = D_Family(info);
+	if (!D_CanAccess(mapper, mode, opc, access))
+		return TR_NONE;
+	reg = D_Register(info);
+	m = D_Operand(mapper, e, mode, opc, access, pc);
+
+	/* Page crossed: one more cycle */
+	if (D_HasPenalty(info) &&
+			((mode == ABX) || (mode == ABY) || (mode == INY))) {
+		X_RR(e, 0, X_MOVZX8, R15, R15);
+		X_RR(e, 0, 0x03, H_CYC, R15);
+	}
+
+	if ((info.inst == _LDA) || (info.inst == _LDX) || (info.inst == _LDY)) {
+		X_Alu8(e, X_MOV8, reg, &m);
+		D_FlagNZ(e, reg);
+	} else if ((info.inst == _STA) || (info.inst == _STX) ||
+			(info.inst == _STY)) {
+		X_Opd(e, 0, X_STORE8, reg, &m);
+	} else if ((info.inst == _AND) || (info.inst == _ORA) ||
+			(info.inst == _EOR)) {
+		X_Alu8(e, (info.inst == _AND) ? X_AND8 :
+				((info.inst == _ORA) ? X_OR8 : X_XOR8), H_A, &m);
+		D_FlagNZ(e, H_A);
+	} else if ((info.inst == _ADC) || (info.inst == _SBC)) {
+		D_LoadCarry(e);
+		if (info.inst == _SBC)
+			X_Byte(e, 0xF5);
+		X_Alu8(e, (info.inst == _ADC) ? X_ADC8 : X_SBB8, H_A, &m);
+		/* 6502 carry is x86 "no borrow" for subtraction */
+		X_SetCC(e, (info.inst == _ADC) ? CC_C : CC_NC, RBX);
+		X_SetCC(e, CC_O, R15);
+		D_FlagNZ(e, H_A);
+		D_FlagC(e);
+		D_FlagV(e);
+	} else if ((info.inst == _CMP) || (info.inst == _CPX) ||
+			(info.inst == _CPY)) {
+		X_RR(e, 0, X_MOV8, R15, reg);
+		X_Alu8(e, X_SUB8, R15, &m);
+		X_SetCC(e, CC_NC, RBX);
+		D_FlagNZ(e, R15);
+		D_FlagC(e);
+	} else if (info.inst == _BIT) {
+		X_Alu8(e, X_MOV8, R15, &m);
+		X_Imm8(e, X_AND8, H_P, (uint8_t) ~(P_SIGN | P_OVERFLOW | P_ZERO));
+		X_RR(e, 0, X_MOV8, R8, R15);
+		X_Imm8(e, X_AND8, R8, P_SIGN | P_OVERFLOW);
+		X_RR(e, 0, X_OR8, H_P, R8);
+		X_RR(e, 0, 0x84, H_A, R15);
+		X_SetCC(e, CC_Z, R8);
+		X_Shift8(e, X_SHL, R8);
+		X_RR(e, 0, X_OR8, H_P, R8);
+	} else {
+		/* Read-modify-write, done on R15B unless accumulator is used */
+		uint8_t value = (mode == ACC) ? H_A : R15;
+		if (mode != ACC)
+			X_Alu8(e, X_MOV8, R15, &m);
+		if ((info.inst == _INC) || (info.inst == _DEC)) {
+			X_RR(e, 0, 0xFE, (info.inst == _INC) ? 0 : 1, value);
+		} else {
+			if ((info.inst == _ROL) || (info.inst == _ROR))
+				D_LoadCarry(e);
+			if (info.inst == _ASL)
+				X_Shift8(e, X_SHL, value);
+			else if (info.inst == _LSR)
+				X_Shift8(e, X_SHR, value);
+			else if (info.inst == _ROL)
+				X_Shift8(e, X_RCL, value);
+			else
+				X_Shift8(e, X_RCR, value);
+		}
+		/* Store first: RBX may hold the page pointer */
+		if (mode != ACC)
+			X_Opd(e, 0, X_STORE8, R15, &m);
+		if ((info.inst != _INC) && (info.inst != _DEC))
+			X_SetCC(e, CC_C, RBX);
+		D_FlagNZ(e, value);
+		if ((info.inst != _INC) && (info.inst != _DEC))
+			D_FlagC(e);
+	}
+
+	D_Cycle(e, info.cycle);
+	return TR_NEXT;
+}
+
+static void Dynarec_Translate(Dynarec *self, Mapper *mapper, uint16_t start,
+		DynarecBlock *block) {
+	static const uint8_t saved[] = {RBX, R12, R13, R14, R15};
+	static const uint8_t regOffset[] = {
+		offsetof(CPU, A), offsetof(CPU, X), offsetof(CPU, Y), offsetof(CPU, P)
+	};
+	Emitter e;
+	Operand m;
+	uint8_t *code, *epilogue, *opc, result = TR_NEXT, nbArg, maxCycle = 0;
+	uint32_t pc = start;
+	uint16_t total = 0, nbInst = 0, i;
+
+	/* Make room for a full block */
+	if (self->used + DYNAREC_BLOCK_SIZE > DYNAREC_CODE_SIZE)
+		Dynarec_Flush(self);
+
+	code = self->code + self->used;
+	e.p = code;
+	e.nbExit = 0;
+	e.nbEnd = 0;
+
+	/* Prologue: save registers, load 6502 registers */
+	for (i = 0; i < sizeof(saved); i++) {
+		if (saved[i] >= R8)
+			X_Byte(&e, 0x41);
+		X_Byte(&e, 0x50 | (saved[i] & 7));
+	}
+	X_RR(&e, 1, 0x8B, H_RD, RCX);
+	X_RR(&e, 1, 0x8B, H_WR, R8);
+	for (i = 0; i < 4; i++) {
+		m = O_Mem(H_CPU, -1, 0, regOffset[i]);
+		X_Opd(&e, 0, X_MOVZX8, H_A + i, &m);
+	}
+	X_RR(&e, 0, 0x33, H_CYC, H_CYC);
+
+	/* Straight-line code until a jump or an instruction that can't be
+	 * translated */
+	while ((nbInst < DYNAREC_BLOCK_INST) && (pc < 0x10000) &&
+			(result == TR_NEXT)) {
+		Opcode info;
+		if (mapper->pageRd[pc >> 8] == NULL)
+			break;
+		opc = mapper->pageRd[pc >> 8] + (pc & 0xFF);
+		info = Opcode_Get(opc[0]);
+		if (info.addressingMode >= NUL)
+			break;
+		nbArg = (info.addressingMode <= ACC) ? 0 :
+			((info.addressingMode <= REL) ? 1 : 2);
+		/* Instruction must not straddle two pages */
+		if ((pc & 0xFF) + nbArg >= 0x100)
+			break;
+		result = D_Instruction(mapper, &e, pc, opc, info);
+		if (result == TR_NONE)
+			break;
+		maxCycle = info.cycle + ((D_HasPenalty(info) &&
+					((info.addressingMode == ABX) ||
+					 (info.addressingMode == ABY) ||
+					 (info.addressingMode == INY))) ? 1 : 0);
+		total += maxCycle;
+		nbInst++;
+		pc += 1 + nbArg;
+	}
+
+	/* Nothing can be translated here */
+	if (nbInst == 0) {
+		block->state = DS_NONE;
+		return;
+	}
+
+	/* Fall through to next instruction */
+	if (result != TR_END)
+		D_SetPC(&e, pc);
+
+	/* Epilogue: save 6502 registers and restore host ones */
+	epilogue = e.p;
+	for (i = 0; i < e.nbEnd; i++)
+		X_Patch(e.endRel[i], epilogue);
+	for (i = 0; i < 4; i++) {
+		m = O_Mem(H_CPU, -1, 0, regOffset[i]);
+		X_Opd(&e, 0, X_STORE8, H_A + i, &m);
+	}
+	for (i = sizeof(saved); i > 0; i--) {
+		if (saved[i - 1] >= R8)
+			X_Byte(&e, 0x41);
+		X_Byte(&e, 0x58 | (saved[i - 1] & 7));
+	}
+	X_Byte(&e, 0xC3);
+
+	/* Side exits: instruction is left to threaded core */
+	for (i = 0; i < e.nbExit; i++) {
+		X_Patch(e.exitRel[i], e.p);
+		D_SetPC(&e, e.exitPC[i]);
+		X_Patch(X_Jmp(&e), epilogue);
+	}
+
+	self->used += e.p - code;
+	/* Keep blocks aligned */
+	self->used = (self->used + 15) & ~15;
+	block->code = code;
+	block->prefix = total - maxCycle;
+	block->state = DS_CODE;
+}
+
+static DynarecBlock* Dynarec_GetBlock(Dynarec *self, CPU *cpu) {
+	uint8_t index = (cpu->PC - DYNAREC_BASE) >> 8;
+	DynarecBlock *page = self->page[index], *block;
+
+	/* Allocate page on first use */
+	if (page == NULL) {
+		page = (DynarecBlock*) calloc(256, sizeof(DynarecBlock));
+		if (page == NULL) {
+			ERROR_MSG("can't allocate Dynarec page");
+			return NULL;
+		}
+		self->page[index] = page;
+	}
+
+	block = page + (cpu->PC & 0x00FF);
+	if (block->state == DS_EMPTY)
+		Dynarec_Translate(self, cpu->mapper, cpu->PC, block);
+	return block;
+}
+
+#endif /* DYNAREC_HOST */
+
+Dynarec* Dynarec_Create(Mapper *mapper) {
+#ifdef DYNAREC_HOST
+	Dynarec *self;
+	uint16_t i;
+
+	if (mapper == NULL)
+		return NULL;
+
+	/* CPU RAM must be a single 2 KiB buffer mirrored up to 0x1FFF */
+	for (i = 0; i < 0x20; i++) {
+		if ((mapper->pageRd[0] == NULL) ||
+				(mapper->pageRd[i] != mapper->pageRd[0] + ((i & 7) << 8)) ||
+				(mapper->pageWr[i] != mapper->pageRd[i]))
+			return NULL;
+	}
+
+	self = (Dynarec*) malloc(sizeof(Dynarec));
+	if (self == NULL) {
+		ERROR_MSG("can't allocate Dynarec structure");
+		return NULL;
+	}
+
+	self->code = mmap(NULL, DYNAREC_CODE_SIZE,
+			PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS,
+			-1, 0);
+	if (self->code == MAP_FAILED) {
+		ERROR_MSG("can't allocate Dynarec code buffer");
+		free(self);
+		return NULL;
+	}
+
+	for (i = 0; i < DYNAREC_PAGE_CNT; i++)
+		self->page[i] = NULL;
+	for (i = 0; i < 256; i++)
+		self->nz[i] = (i & P_SIGN) | ((i == 0) ? P_ZERO : 0);
+	self->ram = mapper->pageRd[0];
+	self->used = 0;
+	self->nbExecuted = 0;
+
+	return self;
+#else
+	(void) mapper;
+	return NULL;
+#endif
+}
+
+uint8_t Dynarec_Execute(Dynarec *self, CPU *cpu, uint8_t *context,
+		uint64_t *clockCycle, uint32_t budget) {
+#ifdef DYNAREC_HOST
+	DynarecBlock *block;
+	uint32_t cycles;
+
+	/* Interrupts, DMA and code outside of PRG-ROM are not translated */
+	if ((self == NULL) || *context || (cpu->cntDMA != -1) ||
+			(cpu->PC < DYNAREC_BASE))
+		return Threaded_Execute(cpu, context, clockCycle);
+
+	/* Run block only if its last instruction starts before budget ends */
+	block = Dynarec_GetBlock(self, cpu);
+	if ((block == NULL) || (block->state != DS_CODE) ||
+			(block->prefix >= budget))
+		return Threaded_Execute(cpu, context, clockCycle);
+
+	/* Blocks work on a materialized status register */
+	cpu->P = CPU_GetP(cpu);
+	cycles = ((DynarecCode) (void*) block->code)(cpu, self->ram, self->nz,
+			cpu->mapper->pageRd, cpu->mapper->pageWr);
+	CPU_SetP(cpu, cpu->P);
+	/* Left on first instruction, it needs threaded core */
+	if (cycles == 0)
+		return Threaded_Execute(cpu, context, clockCycle);
+
+	self->nbExecuted++;
+	*clockCycle += cycles;
+	return EXIT_SUCCESS;
+#else
+	(void) self;
+	(void) budget;
+	return Threaded_Execute(cpu, context, clockCycle);
+#endif
+}
+
+void Dynarec_Invalidate(Dynarec *self, uint16_t address) {
+	/* Blocks may span several pages, ROM writes are rare: drop everything */
+	if ((self != NULL) && (address >= DYNAREC_BASE))
+		Dynarec_Flush(self);
+}
+
+void Dynarec_Flush(Dynarec *self) {
+	if (self == NULL)
+		return;
+
+	uint8_t i;
+	for (i = 0; i < DYNAREC_PAGE_CNT; i++)
+		if (self->page[i] != NULL)
+			memset(self->page[i], 0, 256 * sizeof(DynarecBlock));
+	self->used = 0;
+}
+
+void Dynarec_Destroy(Dynarec *self) {
+	if (self == NULL)
+		return;
+
+	uint8_t i;
+	for (i = 0; i < DYNAREC_PAGE_CNT; i++)
+		free(self->page[i]);
+#ifdef DYNAREC_HOST
+	munmap(self->code, DYNAREC_CODE_SIZE);
+#endif
+	free(self);
+}
@@ -0,0 +1,120 @@
+/**
+ * \file dynarec.h
+ * \brief header file of Dynarec module
+ * \author Dylan Gageot
+ * \version 1.0
+ * \date 2019-06-08
+ *
+ * Dynamic recompiler: straight-line 6502 blocks located in PRG-ROM are
+ * translated into x86-64 host code. Anything else (IO accesses, interrupts,
+ * DMA, unsupported instructions) is executed by the threaded core.
+ * Build with CPU_DYNAREC to make CPU_ExecuteBlock use it. Blocks are not
+ * run while the CPU is traced (see CPU_SetTrace).
+ */
+
+#ifndef DYNAREC_H
+#define DYNAREC_H
+
+#include "cpu.h"
+
+/**
+ * \brief First address that can be translated (PRG-ROM)
+ */
+#define DYNAREC_BASE			0x8000
+
+/**
+ * \brief Number of 256-byte pages covered by block table
+ */
+#define DYNAREC_PAGE_CNT		128
+
+/**
+ * \brief Maximum number of instructions per block
+ */
+#define DYNAREC_BLOCK_INST		64
+
+/**
+ * \brief Size of host code buffer
+ */
+#define DYNAREC_CODE_SIZE		(4 * 1024 * 1024)
+
+/**
+ * \brief State of a block table entry
+ */
+enum DynarecState {
+	DS_EMPTY = 0,		/*!< Not translated yet							*/
+	DS_CODE,			/*!< Host code available						*/
+	DS_NONE				/*!< Can't be translated, use threaded core		*/
+};
+
+/**
+ * \brief Translated block starting at a given PC
+ */
+typedef struct {
+	uint8_t *code;		/*!< Host code								*/
+	uint16_t prefix;	/*!< Cycles that may elapse before last
+						     instruction of block starts			*/
+	uint8_t state;		/*!< DynarecState							*/
+} DynarecBlock;
+
+/**
+ * \brief Hold translated blocks and host code buffer
+ */
+struct Dynarec {
+	DynarecBlock *page[DYNAREC_PAGE_CNT];	/*!< Blocks, page by page	*/
+	uint8_t *code;							/*!< Host code buffer		*/
+	uint32_t used;							/*!< Bytes used in buffer	*/
+	uint8_t *ram;							/*!< CPU RAM (2 KiB)		*/
+	uint8_t nz[256];						/*!< N and Z flags of value	*/
+	uint32_t nbExecuted;					/*!< Blocks executed		*/
+};
+
+/**
+ * \brief Create dynamic recompiler for a mapper
+ *
+ * \param mapper mapper the CPU is connected to
+ *
+ * \return instance of Dynarec, NULL if host or mapper is not supported
+ */
+Dynarec* Dynarec_Create(Mapper *mapper);
+
+/**
+ * \brief Execute next block, or next instruction if no block can be used
+ *
+ * A block is run only if every instruction of it can start before budget
+ * is exhausted, so that interrupts are taken at the same time as with the
+ * interpreter.
+ *
+ * \param self instance of Dynarec
+ * \param cpu instance of CPU
+ * \param context variable containing interrupt flags
+ * \param clockCycle pointer to clock cycle variable
+ * \param budget number of cycles before next event
+ *
+ * \return EXIT_SUCCESS if succeed, EXIT_FAILURE otherwise
+ */
+uint8_t Dynarec_Execute(Dynarec *self, CPU *cpu, uint8_t *context,
+		uint64_t *clockCycle, uint32_t budget);
+
+/**
+ * \brief Drop translations that may contain a written address
+ *
+ * \param self instance of Dynarec
+ * \param address address that has been written
+ */
+void Dynarec_Invalidate(Dynarec *self, uint16_t address);
+
+/**
+ * \brief Drop every translation
+ *
+ * \param self instance of Dynarec
+ */
+void Dynarec_Flush(Dynarec *self);
+
+/**
+ * \brief Free instance of Dynarec
+ *
+ * \param self instance of Dynarec
+ */
+void Dynarec_Destroy(Dynarec *self);
+
+#endif /* DYNAREC_H */
@@ -0,0 +1,102 @@
+#include "icache.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "../../common/macro.h"
+
+#define ICACHE_PAGE_SIZE	(256 * sizeof(ICacheEntry))
+
+ICache* ICache_Create(void) {
+	ICache *self = (ICache*) malloc(sizeof(ICache));
+	if (self == NULL) {
+		ERROR_MSG("can't allocate ICache structure");
+		return NULL;
+	}
+
+	/* No page is decoded yet */
+	uint8_t i;
+	for (i = 0; i < ICACHE_PAGE_CNT; i++)
+		self->page[i] = NULL;
+
+	return self;
+}
+
+uint8_t ICache_Fetch(ICache *self, Instruction *inst, CPU *cpu) {
+	ICacheEntry *page, *entry;
+	uint16_t pc = cpu->PC;
+
+	/* Code outside of PRG-ROM (or no cache) is decoded every time */
+	if ((self == NULL) || (pc < ICACHE_BASE)) {
+		if (Instruction_Fetch(inst, cpu) == EXIT_FAILURE)
+			return EXIT_FAILURE;
+		return Instruction_Resolve(inst, cpu);
+	}
+
+	/* Allocate page on first use */
+	page = self->page[(pc - ICACHE_BASE) >> 8];
+	if (page == NULL) {
+		page = (ICacheEntry*) calloc(1, ICACHE_PAGE_SIZE);
+		if (page == NULL) {
+			ERROR_MSG("can't allocate ICache page");
+			return EXIT_FAILURE;
+		}
+		self->page[(pc - ICACHE_BASE) >> 8] = page;
+	}
+
+	entry = page + (pc & 0x00FF);
+	if (entry->opcode.inst == NULL) {
+		/* Miss: decode from memory and save result */
+		if (Instruction_Fetch(inst, cpu) == EXIT_FAILURE)
+			return EXIT_FAILURE;
+		entry->opcode = inst->opcode;
+		entry->resolve = Instruction_GetResolver(inst->opcode.addressingMode);
+		entry->opcodeArg[0] = inst->opcodeArg[0];
+		entry->opcodeArg[1] = inst->opcodeArg[1];
+		entry->rawOpcode = inst->rawOpcode;
+		entry->nbArg = inst->nbArg;
+	} else {
+		/* Hit: restore decoded instruction and update PC */
+		inst->opcode = entry->opcode;
+		inst->opcodeArg[0] = entry->opcodeArg[0];
+		inst->opcodeArg[1] = entry->opcodeArg[1];
+		inst->rawOpcode = entry->rawOpcode;
+		inst->nbArg = entry->nbArg;
+		inst->lastPC = pc;
+		cpu->PC = pc + 1 + entry->nbArg;
+	}
+
+	return entry->resolve(inst, cpu);
+}
+
+void ICache_Invalidate(ICache *self, uint16_t address) {
+	if ((self == NULL) || (address < ICACHE_BASE))
+		return;
+
+	uint8_t index = (address - ICACHE_BASE) >> 8;
+	/* Written byte may be an argument of an instruction of previous page */
+	if (((address & 0x00FF) < 2) && (index > 0) &&
+			(self->page[index - 1] != NULL))
+		memset(self->page[index - 1], 0, ICACHE_PAGE_SIZE);
+	if (self->page[index] != NULL)
+		memset(self->page[index], 0, ICACHE_PAGE_SIZE);
+}
+
+void ICache_Flush(ICache *self) {
+	if (self == NULL)
+		return;
+
+	uint8_t i;
+	for (i = 0; i < ICACHE_PAGE_CNT; i++)
+		if (self->page[i] != NULL)
+			memset(self->page[i], 0, ICACHE_PAGE_SIZE);
+}
+
+void ICache_Destroy(ICache *self) {
+	if (self == NULL)
+		return;
+
+	uint8_t i;
+	for (i = 0; i < ICACHE_PAGE_CNT; i++)
+		free(self->page[i]);
+	free(self);
+}
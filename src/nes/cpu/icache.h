@@ -0,0 +1,90 @@
+/**
+ * \file icache.h
+ * \brief header file of ICache module
+ * \author Dylan Gageot
+ * \version 1.0
+ * \date 2019-06-02
+ *
+ * Cache of pre-decoded instructions located in PRG-ROM
+ */
+
+#ifndef ICACHE_H
+#define ICACHE_H
+
+#include "instruction.h"
+
+/**
+ * \brief First address covered by the cache (PRG-ROM)
+ */
+#define ICACHE_BASE			0x8000
+
+/**
+ * \brief Number of 256-byte pages covered by the cache
+ */
+#define ICACHE_PAGE_CNT		128
+
+/**
+ * \brief Hold a decoded instruction
+ *
+ * An entry with a NULL opcode callback is not decoded yet.
+ */
+typedef struct {
+	Opcode opcode;					/*!< Opcode information				*/
+	Resolver resolve;				/*!< Addressing mode resolver		*/
+	uint8_t opcodeArg[2];			/*!< Argument given with opcode		*/
+	uint8_t rawOpcode;				/*!< Opcode byte value				*/
+	uint8_t nbArg;					/*!< Number of argument given		*/
+} ICacheEntry;
+
+/**
+ * \brief Hold decoded instructions, page by page
+ *
+ * Pages are allocated the first time code is executed from them.
+ */
+struct ICache {
+	ICacheEntry *page[ICACHE_PAGE_CNT];	/*!< Decoded pages				*/
+};
+
+/**
+ * \brief Allocate an empty instruction cache
+ *
+ * \return instance of ICache
+ */
+ICache* ICache_Create(void);
+
+/**
+ * \brief Fetch, decode and resolve the instruction pointed by PC
+ *
+ * Instructions outside of PRG-ROM are always decoded from memory.
+ *
+ * \param self instance of ICache
+ * \param inst instance of Instruction to fill
+ * \param cpu instance of CPU
+ *
+ * \return EXIT_SUCCESS if succeed, EXIT_FAILURE otherwise
+ */
+uint8_t ICache_Fetch(ICache *self, Instruction *inst, CPU *cpu);
+
+/**
+ * \brief Forget decoded instructions that may use a written address
+ *
+ * \param self instance of ICache
+ * \param address address that has been written
+ */
+void ICache_Invalidate(ICache *self, uint16_t address);
+
+/**
+ * \brief Forget every decoded instruction (e.g. after a bank switch)
+ *
+ * \param self instance of ICache
+ */
+void ICache_Flush(ICache *self);
+
+/**
+ * \brief Free instance of ICache
+ *
+ * \param self instance of ICache
+ */
+void ICache_Destroy(ICache *self);
+
+#endif /* ICACHE_H */
@@ -4,6 +4,8 @@
 #include "../../common/macro.h"
 #include "../mapper/ioreg.h"
 #include "../const.h"
+#include "icache.h"
+#include "dynarec.h"
 
 /* Opcode LUT */
 static Opcode opcode[256] = {
@@ -77,39 +79,34 @@ Opcode Opcode_Get(uint8_t index) {
 	return opcode[index];
 }
 
-/* Macros used by instructions */
-#define SET_SIGN(x)		cpu->P = (*x & 0x80) ? cpu->P | P_SIGN : cpu->P & (~P_SIGN)
+/* Macros used by instructions
+ * N, Z, C and V are lazy: only the value they come from is saved */
+#define SET_SIGN(x)		cpu->resN = *x
 void _SET_SIGN(CPU *cpu, uint8_t *src) {
-	if (*src & 0x80)
-		cpu->P |= P_SIGN;
-	else
-		cpu->P &= ~P_SIGN;
+	cpu->resN = *src;
 }
 
-#define SET_ZERO(x)		cpu->P = (*x == 0) ? cpu->P | P_ZERO : cpu->P & (~P_ZERO)
+#define SET_ZERO(x)		cpu->resZ = *x
 void _SET_ZERO(CPU *cpu, uint8_t *src) {
-	if (*src == 0)
-		cpu->P |= P_ZERO;
-	else
-		cpu->P &= ~P_ZERO;
+	cpu->resZ = *src;
 }
 
-#define SET_CARRY(x)	cpu->P = (x) ? cpu->P | P_CARRY : cpu->P & (~P_CARRY)   
+#define SET_CARRY(x)	cpu->C = (x) ? 1 : 0
 void _SET_CARRY(CPU *cpu, uint8_t cond) {
-	if (cond)
-		cpu->P |= P_CARRY;
-	else
-		cpu->P &= ~P_CARRY;
+	cpu->C = cond ? 1 : 0;
 }
 
-#define SET_OVERFLOW(x)	cpu->P = (x) ? cpu->P | P_OVERFLOW : cpu->P & (~P_OVERFLOW)  
+#define SET_OVERFLOW(x)	_SET_OVERFLOW(cpu, x)
 void _SET_OVERFLOW(CPU *cpu, uint8_t cond) {
-	if (cond)
-		cpu->P |= P_OVERFLOW;
-	else
-		cpu->P &= ~P_OVERFLOW;
+	cpu->vOp1 = 0;
+	cpu->vOp2 = 0;
+	cpu->vRes = cond ? 0x80 : 0;
 }
 
+/* Overflow of an addition, computed only when V is read */
+#define SET_OVERFLOW_ADD(a, b, r)	\
+	cpu->vOp1 = (a); cpu->vOp2 = (b); cpu->vRes = (r)
+
 #define SET_INTERRUPT(x)	cpu->P |= P_INTERRUPT
 void _SET_INTERRUPT(CPU *cpu) {
 	cpu->P |= P_INTERRUPT;
@@ -125,59 +122,71 @@ uint16_t _REL_ADDR(CPU *cpu, int8_t *src) {
 	return cpu->PC + (int16_t) *src;
 }
 
-#define SET_SR(x)	cpu->P = *x
+#define SET_SR(x)	CPU_SetP(cpu, *x)
 void _SET_SR(CPU *cpu, uint8_t *src) {
-	cpu->P = *src;
+	CPU_SetP(cpu, *src);
 }
 
-#define GET_SR()	(cpu->P)
+#define GET_SR()	CPU_GetP(cpu)
 uint8_t _GET_SR(CPU *cpu) {
-	return cpu->P;
+	return CPU_GetP(cpu);
 }
 
-#define PULL()		(*Mapper_Get(cpu->mapper, AS_CPU, ADDR_STACK | (++cpu->SP)))
+#define PULL()		(*Mapper_GetRd(cpu->mapper, ADDR_STACK | (++cpu->SP)))
 uint8_t _PULL(CPU *cpu) {
-	return *Mapper_Get(cpu->mapper, AS_CPU, ADDR_STACK | (++cpu->SP));
+	return *Mapper_GetRd(cpu->mapper, ADDR_STACK | (++cpu->SP));
 }
 
-#define	PUSH(x)		*(Mapper_Get(cpu->mapper, AS_CPU, ADDR_STACK | (cpu->SP--))) = *x
+#define	PUSH(x)		*(Mapper_GetWr(cpu->mapper, ADDR_STACK | (cpu->SP--))) = *x
 void _PUSH(CPU *cpu, uint8_t *src) {
-	*(Mapper_Get(cpu->mapper, AS_CPU, ADDR_STACK | (cpu->SP--))) = *src;
+	*(Mapper_GetWr(cpu->mapper, ADDR_STACK | (cpu->SP--))) = *src;
 }
 
-#define LOAD(x)		Mapper_Get(cpu->mapper, AC_RD | AS_CPU, x)
+#define LOAD(x)		Mapper_GetRd(cpu->mapper, x)
 uint8_t* _LOAD(CPU *cpu, uint16_t address) {
-	return Mapper_Get(cpu->mapper, AC_RD | AS_CPU, address);
+	return Mapper_GetRd(cpu->mapper, address);
 }
 
-#define STORE(x,y)	*(Mapper_Get(cpu->mapper, AC_WR | AS_CPU, x)) = *y
+#define STORE(x,y)	_STORE(cpu, x, y)
 void _STORE(CPU *cpu, uint16_t address, uint8_t *src) {
-	*(Mapper_Get(cpu->mapper, AC_WR | AS_CPU, address)) = *src;
+	Mapper_Write(cpu->mapper, address, *src);
+	/* Code may have been modified */
+	if (address >= ICACHE_BASE) {
+		ICache_Invalidate(cpu->icache, address);
+		Dynarec_Invalidate(cpu->dynarec, address);
+	}
 }
 
-#define SET_WR(x)	Mapper_Get(cpu->mapper, AC_WR | AS_CPU, x)
-void _SET_WR(CPU *cpu, uint16_t address) {
-	Mapper_Get(cpu->mapper, AC_WR | AS_CPU, address);
+#define SET_WR(x, y)	_SET_WR(cpu, x, y)
+void _SET_WR(CPU *cpu, uint16_t address, uint8_t value) {
+	/* Operand was a copy (see Instruction_Operand), write it back */
+	if (cpu->mapper->pageWr[address >> 8] == NULL)
+		Mapper_Write(cpu->mapper, address, value);
+	/* Code may have been modified */
+	if (address >= ICACHE_BASE) {
+		ICache_Invalidate(cpu->icache, address);
+		Dynarec_Invalidate(cpu->dynarec, address);
+	}
 }
 
-#define IF_CARRY()	((cpu->P & P_CARRY) == P_CARRY)
+#define IF_CARRY()	(cpu->C)
 uint8_t _IF_CARRY(CPU *cpu) {
-	return (cpu->P & P_CARRY) == P_CARRY;
+	return cpu->C;
 }
 
-#define IF_OVERFLOW()	((cpu->P & P_OVERFLOW) == P_OVERFLOW)
+#define IF_OVERFLOW()	(CPU_LAZY_V(cpu) == P_OVERFLOW)
 uint8_t _IF_OVERFLOW(CPU *cpu) {
-	return (cpu->P & P_OVERFLOW) == P_OVERFLOW;
+	return CPU_LAZY_V(cpu) == P_OVERFLOW;
 }
 
-#define IF_SIGN()	((cpu->P & P_SIGN) == P_SIGN)
+#define IF_SIGN()	((cpu->resN & P_SIGN) == P_SIGN)
 uint8_t _IF_SIGN(CPU *cpu) {
-	return (cpu->P & P_SIGN) == P_SIGN;
+	return (cpu->resN & P_SIGN) == P_SIGN;
 }
 
-#define IF_ZERO()	((cpu->P & P_ZERO) == P_ZERO)
+#define IF_ZERO()	(cpu->resZ == 0)
 uint8_t _IF_ZERO(CPU *cpu) {
-	return (cpu->P & P_ZERO) == P_ZERO;
+	return cpu->resZ == 0;
 }
 
 #define IF_INTERRUPT()	((cpu->P & P_INTERRUPT) == P_INTERRUPT)
@@ -204,11 +213,11 @@ uint8_t _BRANCH(CPU* cpu, Instruction *arg, uint8_t cond) {
 
 /* Instructions management */
 
-uint8_t Instruction_DMA(Instruction *self, CPU *cpu, uint32_t *clockCycle) {
+uint8_t Instruction_DMA(Instruction *self, CPU *cpu, uint64_t *clockCycle) {
 	uint8_t data;
 
-	/* Start DMA operation if needed */
-	if (Mapper_Ack(cpu->mapper, ADDR_OAMDMA)) {
+	/* Start DMA operation if OAMDMA was written (see CPU_WriteOAMDMA) */
+	if (cpu->cntDMA == DMA_PENDING) {
 		cpu->cntDMA = 0;
 		/* Add 1 (+1 if odd) to clock cycle 1 */
 		*clockCycle += 1 + (*clockCycle % 2);
@@ -269,132 +278,181 @@ uint8_t Instruction_Fetch(Instruction *self, CPU *cpu) {
 	return EXIT_SUCCESS;
 }
 
-uint8_t Instruction_Resolve(Instruction *self, CPU *cpu) {
+/* Addressing mode resolvers */
+
+/* Instructions which don't read their operand: stores and jumps */
+#define NO_READ(x)	(((x)->opcode.inst == _STA) || ((x)->opcode.inst == _STX) || \
+					 ((x)->opcode.inst == _STY) || ((x)->opcode.inst == _JMP) || \
+					 ((x)->opcode.inst == _JSR))
+
+/* Instructions which write their operand: stores and read-modify-write */
+#define WRITE(x)	(((x)->opcode.inst == _STA) || ((x)->opcode.inst == _STX) || \
+					 ((x)->opcode.inst == _STY) || ((x)->opcode.inst == _ASL) || \
+					 ((x)->opcode.inst == _LSR) || ((x)->opcode.inst == _ROL) || \
+					 ((x)->opcode.inst == _ROR) || ((x)->opcode.inst == _INC) || \
+					 ((x)->opcode.inst == _DEC))
+
+/* Operand of instruction: plain memory is used in place, and so is ROM when
+ * instruction only reads it. Otherwise (IO registers, writes to ROM)
+ * instruction works on a copy, read through mapper unless instruction
+ * doesn't need it, and written back by SET_WR */
+static uint8_t* Instruction_Operand(Instruction *self, CPU *cpu,
+		uint16_t address) {
+	uint8_t *page = cpu->mapper->pageRd[address >> 8];
+	if ((page != NULL) && ((cpu->mapper->pageWr[address >> 8] != NULL) ||
+				!WRITE(self))) {
+		Mapper_Count(cpu->mapper, AC_RD | AS_CPU, address);
+		return page + (address & 0x00FF);
+	}
+	if (!NO_READ(self))
+		cpu->bus = Mapper_Read(cpu->mapper, address);
+	return &cpu->bus;
+}
+
+static uint8_t Resolve_IMP(Instruction *self, CPU *cpu) {
+	/* Nothing to do */
+	(void) cpu;
+	self->pageCrossed = 0;
+	self->dataAddr = 0;
+	return EXIT_SUCCESS;
+}
+
+static uint8_t Resolve_ACC(Instruction *self, CPU *cpu) {
+	self->dataMem = &cpu->A;
+	self->pageCrossed = 0;
+	self->dataAddr = 0;
+	return EXIT_SUCCESS;
+}
+
+static uint8_t Resolve_ZEX(Instruction *self, CPU *cpu) {
+	uint16_t address = (self->opcodeArg[0] + cpu->X) & 0xFF;
+	self->dataMem = Instruction_Operand(self, cpu, address);
+	self->pageCrossed = 0;
+	self->dataAddr = address;
+	return EXIT_SUCCESS;
+}
+
+static uint8_t Resolve_ZEY(Instruction *self, CPU *cpu) {
+	uint16_t address = (self->opcodeArg[0] + cpu->Y) & 0xFF;
+	self->dataMem = Instruction_Operand(self, cpu, address);
+	self->pageCrossed = 0;
+	self->dataAddr = address;
+	return EXIT_SUCCESS;
+}
+
+static uint8_t Resolve_INX(Instruction *self, CPU *cpu) {
 	uint8_t lWeight, hWeight;
-	uint16_t address = 0;
-	
-	/* Init pageCrossed at 0 */
+	uint16_t address = (self->opcodeArg[0] + cpu->X) & 0xFF;
+	lWeight = *(LOAD(address));
+	hWeight = *(LOAD((address + 1) & 0xFF));
+	address = (hWeight << 8) + lWeight;
+	self->dataMem = Instruction_Operand(self, cpu, address);
 	self->pageCrossed = 0;
+	self->dataAddr = address;
+	return EXIT_SUCCESS;
+}
 
-	switch (self->opcode.addressingMode) {
-		case IMP :
-			/* Nothing to do */
-			break;
-
-		case ACC :
-			self->dataMem = &cpu->A;
-			break;
-
-		case ZEX :
-			address = (self->opcodeArg[0] + cpu->X) & 0xFF;
-			self->dataMem = LOAD(address);
-			break;
-
-		case ZEY :
-			address = (self->opcodeArg[0] + cpu->Y) & 0xFF;
-			self->dataMem = LOAD(address);
-			break;
-
-		case INX :
-			address = (self->opcodeArg[0] + cpu->X) & 0xFF;
-			lWeight = *(LOAD(address));
-			hWeight = *(LOAD((address + 1) & 0xFF));
-			address = (hWeight << 8) + lWeight;
-			self->dataMem = LOAD(address);
-			break;
-
-		case INY :
-			address = self->opcodeArg[0] & 0xFF;
-			lWeight = *(LOAD(address));
-			hWeight = *(LOAD((address + 1) & 0xFF));
-			address = (hWeight << 8) + lWeight;
-			if ((address & 0xFF00) != ((address + cpu->Y) & 0xFF00))
-				self->pageCrossed = 1;
-			address = (hWeight << 8) + lWeight + cpu->Y;
-			self->dataMem = LOAD(address);
-			break;
-
-		case IMM :
-			self->dataMem = self->opcodeArg;
-			break;
-
-		case ZER :
-			address = self->opcodeArg[0] & 0xFF;
-			self->dataMem = LOAD(address);
-			break;
-
-		case REL :
-			self->dataMem = self->opcodeArg;
-			break;
-
-		case ABS :
-			address = (self->opcodeArg[1] << 8) + self->opcodeArg[0];
-			self->dataMem = LOAD(address);
-			break;
-
-		case ABX :
-			address = (self->opcodeArg[1] << 8) + self->opcodeArg[0];
-			if ((address & 0xFF00) != ((address + cpu->X) & 0xFF00))
-				self->pageCrossed = 1;
-			address = (self->opcodeArg[1] << 8) + self->opcodeArg[0] + cpu->X;
-			self->dataMem = LOAD(address);
-			break;
-
-		case ABY :
-			address = (self->opcodeArg[1] << 8) + self->opcodeArg[0];
-			if ((address & 0xFF00) != ((address + cpu->Y) & 0xFF00))
-				self->pageCrossed = 1;
-			address = (self->opcodeArg[1] << 8) + self->opcodeArg[0] + cpu->Y;
-			self->dataMem = LOAD(address);
-			break;
-
-		case ABI :
-			address = (self->opcodeArg[1] << 8) + self->opcodeArg[0];
-			lWeight = *(LOAD(address));
-			hWeight = *(LOAD((address & 0xFF00) | ((address + 1) & 0xFF)));
-			address = (hWeight << 8) + lWeight;
-			self->dataMem = LOAD(address);
-			break;
-
-		default :
-			ERROR_MSG("can't resolve addressing mode of the next instruction");	
-			return EXIT_FAILURE;
-	}
+static uint8_t Resolve_INY(Instruction *self, CPU *cpu) {
+	uint8_t lWeight, hWeight;
+	uint16_t address = self->opcodeArg[0] & 0xFF;
+	lWeight = *(LOAD(address));
+	hWeight = *(LOAD((address + 1) & 0xFF));
+	address = (hWeight << 8) + lWeight;
+	self->pageCrossed = ((address & 0xFF00) != ((address + cpu->Y) & 0xFF00));
+	address = (hWeight << 8) + lWeight + cpu->Y;
+	self->dataMem = Instruction_Operand(self, cpu, address);
+	self->dataAddr = address;
+	return EXIT_SUCCESS;
+}
+
+static uint8_t Resolve_IMM(Instruction *self, CPU *cpu) {
+	(void) cpu;
+	self->dataMem = self->opcodeArg;
+	self->pageCrossed = 0;
+	self->dataAddr = 0;
+	return EXIT_SUCCESS;
+}
+
+static uint8_t Resolve_ZER(Instruction *self, CPU *cpu) {
+	uint16_t address = self->opcodeArg[0] & 0xFF;
+	self->dataMem = Instruction_Operand(self, cpu, address);
+	self->pageCrossed = 0;
+	self->dataAddr = address;
+	return EXIT_SUCCESS;
+}
+
+static uint8_t Resolve_ABS(Instruction *self, CPU *cpu) {
+	uint16_t address = (self->opcodeArg[1] << 8) + self->opcodeArg[0];
+	self->dataMem = Instruction_Operand(self, cpu, address);
+	self->pageCrossed = 0;
 	self->dataAddr = address;
 	return EXIT_SUCCESS;
 }
 
-void Instruction_PrintLog(Instruction *self, CPU *cpu, uint32_t clockCycle) {
-	FILE* fLog = NULL;
-	int i;
-	/* Open log file for append line into */
-	fLog = fopen("cpu.log", "a+");
-	if (fLog == NULL) {
-		ERROR_MSG("can't access cpu.log");
-		return;
+static uint8_t Resolve_ABX(Instruction *self, CPU *cpu) {
+	uint16_t address = (self->opcodeArg[1] << 8) + self->opcodeArg[0];
+	self->pageCrossed = ((address & 0xFF00) != ((address + cpu->X) & 0xFF00));
+	address = (self->opcodeArg[1] << 8) + self->opcodeArg[0] + cpu->X;
+	self->dataMem = Instruction_Operand(self, cpu, address);
+	self->dataAddr = address;
+	return EXIT_SUCCESS;
+}
+
+static uint8_t Resolve_ABY(Instruction *self, CPU *cpu) {
+	uint16_t address = (self->opcodeArg[1] << 8) + self->opcodeArg[0];
+	self->pageCrossed = ((address & 0xFF00) != ((address + cpu->Y) & 0xFF00));
+	address = (self->opcodeArg[1] << 8) + self->opcodeArg[0] + cpu->Y;
+	self->dataMem = Instruction_Operand(self, cpu, address);
+	self->dataAddr = address;
+	return EXIT_SUCCESS;
+}
+
+static uint8_t Resolve_ABI(Instruction *self, CPU *cpu) {
+	uint8_t lWeight, hWeight;
+	uint16_t address = (self->opcodeArg[1] << 8) + self->opcodeArg[0];
+	lWeight = *(LOAD(address));
+	hWeight = *(LOAD((address & 0xFF00) | ((address + 1) & 0xFF)));
+	address = (hWeight << 8) + lWeight;
+	self->dataMem = Instruction_Operand(self, cpu, address);
+	self->pageCrossed = 0;
+	self->dataAddr = address;
+	return EXIT_SUCCESS;
+}
+
+/* Resolver LUT, indexed by addressing mode */
+static Resolver resolver[NUL] = {
+	Resolve_IMP, Resolve_ACC, Resolve_ZEX, Resolve_ZEY, Resolve_INX,
+	Resolve_INY, Resolve_IMM, Resolve_ZER, Resolve_IMM, Resolve_ABS,
+	Resolve_ABX, Resolve_ABY, Resolve_ABI
+};
+
+Resolver Instruction_GetResolver(uint8_t addressingMode) {
+	if (addressingMode >= NUL)
+		return NULL;
+	return resolver[addressingMode];
+}
+
+uint8_t Instruction_Resolve(Instruction *self, CPU *cpu) {
+	/* Undefined addressing mode can't be resolved */
+	if (self->opcode.addressingMode >= NUL) {
+		ERROR_MSG("can't resolve addressing mode of the next instruction");	
+		return EXIT_FAILURE;
 	}
+	return resolver[self->opcode.addressingMode](self, cpu);
+}
+
+void Instruction_Trace(Instruction *self, CPU *cpu, uint64_t clockCycle) {
+	uint8_t address[2];
 
-	/* Print to cpu.log */
-	fprintf(fLog, "%04X ", self->lastPC);
 	if (self->nbArg == NBARG_DMA) {
-		/* If instruction is a DMA */
-		fprintf(fLog, "DMA @%04X   ", self->dataAddr);
+		/* DMA step records the address it reads */
+		address[0] = self->dataAddr & 0xFF;
+		address[1] = self->dataAddr >> 8;
+		CPU_Trace(cpu, self->lastPC, 0, address, NBARG_DMA, clockCycle);
 	} else {
-		/* If instruction is not a DMA */
-		/* Print opcode and args */
-		fprintf(fLog, "%02X ", self->rawOpcode);
-		for (i = 0; i < 3; i++) {
-			if (i < self->nbArg)
-				fprintf(fLog, "%02X ", self->opcodeArg[i]);
-			else
-				fprintf(fLog, "   ");
-		}
+		CPU_Trace(cpu, self->lastPC, self->rawOpcode, self->opcodeArg,
+				self->nbArg, clockCycle);
 	}
-	fprintf(fLog, "A:%02X X:%02X Y:%02X P:%02X SP:%02X CYC:%-d\n",
-			cpu->A, cpu->X, cpu->Y, cpu->P,cpu->SP, clockCycle);
-
-	/* Close file */
-	fclose(fLog);
 }
 
 /* Instructions */
@@ -406,7 +464,7 @@ uint8_t _ADC(CPU *cpu, Instruction *arg) {
 	/* Set bit flag */
 	SET_ZERO((uint8_t*) &temp);
 	SET_SIGN((uint8_t*) &temp);
-	SET_OVERFLOW(!((cpu->A ^ *arg->dataMem) & 0x80)&&((cpu->A ^ temp) & 0x80));
+	SET_OVERFLOW_ADD(cpu->A, *arg->dataMem, temp);
 	SET_CARRY(temp > 0xFF);
 	/* Save in Accumulator */
 	cpu->A = ((uint8_t) temp & 0xFF);
@@ -429,7 +487,7 @@ uint8_t _ASL(CPU *cpu, Instruction *arg) {
 	/* Execute */
 	SET_CARRY(*arg->dataMem & 0x80);
 	*arg->dataMem <<= 1;
-	SET_WR(arg->dataAddr);
+	SET_WR(arg->dataAddr, *arg->dataMem);
 	SET_SIGN(arg->dataMem);
 	SET_ZERO(arg->dataMem);
 	/* Manage CPU cycle */
@@ -475,7 +533,7 @@ uint8_t _BRK(CPU *cpu, Instruction *arg) {
 	PUSH(&temp);
 	temp = cpu->PC & 0xFF;
 	PUSH(&temp);
-	temp = cpu->P | 0x10;
+	temp = GET_SR() | 0x10;
 	PUSH(&temp);
 	SET_INTERRUPT();
 	/* Set program counter from memory */
@@ -493,7 +551,7 @@ uint8_t _BVS(CPU *cpu, Instruction *arg) {
 
 uint8_t _CLC(CPU *cpu, Instruction *arg){
 	/*Carry flag -> 0 */
-	cpu->P&=(0xFE);
+	SET_CARRY(0);
 	return arg->opcode.cycle;
 }
 
@@ -511,7 +569,7 @@ uint8_t _CLI(CPU *cpu, Instruction *arg){
 
 uint8_t _CLV(CPU *cpu, Instruction *arg){
 	/* Overflow flag -> 0 */
-	cpu->P&=(0xBF);
+	SET_OVERFLOW(0);
 	return arg->opcode.cycle;
 }
 
@@ -553,7 +611,7 @@ uint8_t _DEC(CPU *cpu, Instruction *arg){
 	SET_SIGN(&m);
 	SET_ZERO(&m);
 	*(arg->dataMem) = m;
-	SET_WR(arg->dataAddr);
+	SET_WR(arg->dataAddr, *arg->dataMem);
 	return arg->opcode.cycle;
 }
 
@@ -595,7 +653,7 @@ uint8_t _INC(CPU *cpu, Instruction *arg){
 	SET_SIGN(&m);
 	SET_ZERO(&m);
 	*(arg->dataMem) = m;
-	SET_WR(arg->dataAddr);
+	SET_WR(arg->dataAddr, *arg->dataMem);
 	return arg->opcode.cycle;
 }
 
@@ -661,7 +719,7 @@ uint8_t _LDY(CPU *cpu, Instruction *arg){
 uint8_t _LSR(CPU *cpu, Instruction *arg){
 	SET_CARRY((*(arg->dataMem) & 0x01));
 	*arg->dataMem >>= 1;
-	SET_WR(arg->dataAddr);
+	SET_WR(arg->dataAddr, *arg->dataMem);
 	SET_SIGN(arg->dataMem);
 	SET_ZERO(arg->dataMem);
 	return arg->opcode.cycle;
@@ -711,7 +769,7 @@ uint8_t _ROL(CPU *cpu, Instruction *arg){
 	if (IF_CARRY()){
 		*arg->dataMem |= 0x1;
 	}
-	SET_WR(arg->dataAddr);
+	SET_WR(arg->dataAddr, *arg->dataMem);
 	SET_CARRY(newCarry == 0x80);
 	SET_SIGN(arg->dataMem);
 	SET_ZERO(arg->dataMem);
@@ -724,7 +782,7 @@ uint8_t _ROR(CPU *cpu, Instruction *arg){
 	if (IF_CARRY()){
 		*arg->dataMem |= 0x80;
 	}
-	SET_WR(arg->dataAddr);
+	SET_WR(arg->dataAddr, *arg->dataMem);
 	SET_CARRY(newCarry == 0x01);
 	SET_SIGN(arg->dataMem);
 	SET_ZERO(arg->dataMem);
@@ -752,7 +810,8 @@ uint8_t _SBC(CPU *cpu, Instruction *arg){
 	uint16_t temp = cpu->A - *arg->dataMem - (IF_CARRY() ? 0 : 1);
 	SET_SIGN((uint8_t*) &temp);
 	SET_ZERO((uint8_t*) &temp);
-	SET_OVERFLOW(((cpu->A ^ temp) & 0x80) && ((cpu->A ^ *arg->dataMem) & 0x80));
+	/* A - M - !C is A + ~M + C */
+	SET_OVERFLOW_ADD(cpu->A, ~*arg->dataMem, temp);
 	SET_CARRY(temp < 0x100);
 	cpu->A = (uint8_t)(temp & 0xff);
 	return arg->opcode.cycle + arg->pageCrossed;
@@ -775,19 +834,19 @@ uint8_t _SEI(CPU *cpu, Instruction *arg) {
 
 uint8_t _STA(CPU *cpu, Instruction *arg){
 	*(arg->dataMem) = cpu->A;
-	SET_WR(arg->dataAddr);
+	SET_WR(arg->dataAddr, *arg->dataMem);
 	return arg->opcode.cycle;
 }
 
 uint8_t _STX(CPU *cpu, Instruction *arg){
 	*(arg->dataMem) = cpu->X;
-	SET_WR(arg->dataAddr);
+	SET_WR(arg->dataAddr, *arg->dataMem);
 	return arg->opcode.cycle;
 }
 
 uint8_t _STY(CPU *cpu, Instruction *arg){
 	*(arg->dataMem) = cpu->Y;
-	SET_WR(arg->dataAddr);
+	SET_WR(arg->dataAddr, *arg->dataMem);
 	return arg->opcode.cycle;
 }
 
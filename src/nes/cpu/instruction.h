@@ -13,7 +13,9 @@
 
 #define DMA_OFF		0
 #define DMA_ON		1
-#define NBARG_DMA	0xFF
+#define NBARG_DMA	TRACE_DMA
+/* cntDMA value when OAMDMA was accessed and transfer is not started yet */
+#define DMA_PENDING	(-2)
 
 typedef struct Instruction Instruction;
 
@@ -41,6 +43,12 @@ struct Instruction {
 	uint8_t nbArg;					/*!< Number of argument	given		*/
 };
 
+/**
+ * \brief Callback that resolves the data of an instruction for a specific
+ * addressing mode
+ */
+typedef uint8_t (*Resolver)(Instruction*, CPU*);
+
 /**
  * \brief Mnemonic for every addressing mode
  */
@@ -69,7 +77,7 @@ enum AddressingMode {
  *
  * \return EXIT_SUCCESS if succeed, EXIT_FAILURE otherwise
  */
-uint8_t Instruction_DMA(Instruction *self, CPU *cpu, uint32_t *clockCycle);
+uint8_t Instruction_DMA(Instruction *self, CPU *cpu, uint64_t *clockCycle);
 
 /**
  * \brief Fetch and decode instruction from PGR-ROM
@@ -92,13 +100,22 @@ uint8_t Instruction_Fetch(Instruction *self, CPU *cpu);
 uint8_t Instruction_Resolve(Instruction *self, CPU *cpu);
 
 /**
- * \brief Print instruction 
+ * \brief Give the resolver associated to an addressing mode
  *
- * \param self instance of CPU
- * \param inst instance of Instruction
- * \param clockCycle number of clock cycle needed
+ * \param addressingMode addressing mode to resolve
+ *
+ * \return resolver callback, NULL if addressing mode is undefined
+ */
+Resolver Instruction_GetResolver(uint8_t addressingMode);
+
+/**
+ * \brief Record instruction (or DMA step) to trace of CPU
+ *
+ * \param self instance of Instruction
+ * \param cpu instance of CPU, traced
+ * \param clockCycle clock cycle before execution
  */
-void Instruction_PrintLog(Instruction *self, CPU *cpu, uint32_t clockCycle);
+void Instruction_Trace(Instruction *self, CPU *cpu, uint64_t clockCycle);
 
 /**
  * \brief Function to use opcode LUT in unit-test
@@ -125,7 +142,7 @@ uint8_t _PULL(CPU *cpu);
 void _PUSH(CPU *cpu, uint8_t *src);
 uint8_t* _LOAD(CPU *cpu, uint16_t address);
 void _STORE(CPU *cpu, uint16_t address, uint8_t *src);
-void _SET_WR(CPU *cpu, uint16_t address);
+void _SET_WR(CPU *cpu, uint16_t address, uint8_t value);
 uint8_t _IF_CARRY(CPU *cpu);
 uint8_t _IF_OVERFLOW(CPU *cpu);
 uint8_t _IF_SIGN(CPU *cpu);
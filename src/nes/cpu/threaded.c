@@ -0,0 +1,594 @@
+#include "threaded.h"
+#include "instruction.h"
+#include "icache.h"
+#include "dynarec.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include "../../common/macro.h"
+#include "../const.h"
+
+/* Use computed goto when compiler supports it */
+#if defined(__GNUC__) && !defined(THREADED_SWITCH)
+#define DISPATCH(x)	goto *dispatch[x];
+#define CASE(x)		op_##x:
+#define ILLEGAL		op_ILL:
+#else
+#define DISPATCH(x)	switch (x)
+#define CASE(x)		case 0x##x:
+#define ILLEGAL		default:
+#endif
+
+/* Memory access */
+
+static inline uint8_t* Threaded_Rd(CPU *self, uint16_t address) {
+	uint8_t *page = self->mapper->pageRd[address >> 8];
+	/* Plain memory, no need to call mapper */
+	if (page != NULL) {
+		Mapper_Count(self->mapper, AC_RD | AS_CPU, address);
+		return page + (address & 0x00FF);
+	}
+	/* IO registers are read now, instruction works on a copy */
+	self->bus = Mapper_Read(self->mapper, address);
+	return &self->bus;
+}
+
+static inline uint8_t* Threaded_Rw(CPU *self, uint16_t address) {
+	uint8_t *page = self->mapper->pageRd[address >> 8];
+	/* Plain memory is modified in place */
+	if ((page != NULL) && (self->mapper->pageWr[address >> 8] != NULL)) {
+		Mapper_Count(self->mapper, AC_RD | AS_CPU, address);
+		return page + (address & 0x00FF);
+	}
+	/* IO registers and ROM are modified on a copy, written back by WR */
+	self->bus = Mapper_Read(self->mapper, address);
+	return &self->bus;
+}
+
+static inline void Threaded_Wr(CPU *self, uint16_t address, uint8_t *mem) {
+	/* Only a copy needs to go through mapper */
+	if (mem == &self->bus)
+		Mapper_Write(self->mapper, address, self->bus);
+	/* Code may have been modified */
+	if (address >= ICACHE_BASE) {
+		ICache_Invalidate(self->icache, address);
+		Dynarec_Invalidate(self->dynarec, address);
+	}
+}
+
+static inline void Threaded_St(CPU *self, uint16_t address, uint8_t value) {
+	Mapper_Write(self->mapper, address, value);
+	/* Code may have been modified */
+	if (address >= ICACHE_BASE) {
+		ICache_Invalidate(self->icache, address);
+		Dynarec_Invalidate(self->dynarec, address);
+	}
+}
+
+#define RD(x)		Threaded_Rd(self, x)
+#define RW(x)		Threaded_Rw(self, x)
+#define WR(x)		Threaded_Wr(self, x, mem)
+#define ST(x, y)	Threaded_St(self, x, y)
+#define PUSH(x)		*(Mapper_GetWr(self->mapper, ADDR_STACK | (self->SP--))) = (x)
+#define PULL()		(*Mapper_GetRd(self->mapper, ADDR_STACK | (++self->SP)))
+
+/* Status register, N Z C and V are lazy (see CPU_GetP) */
+
+#define FLAG_C(x)	self->C = (x) ? 1 : 0
+#define FLAG_V(x)	self->vOp1 = self->vOp2 = 0; self->vRes = (x) ? 0x80 : 0
+#define FLAG_VADD(a, b, r)	self->vOp1 = (a); self->vOp2 = (b); self->vRes = (r)
+#define FLAG_N(x)	self->resN = (x)
+#define FLAG_Z(x)	self->resZ = (x)
+#define FLAG_NZ(x)	self->resN = self->resZ = (x)
+#define IF_C()		(self->C)
+#define IF_V()		CPU_LAZY_V(self)
+#define IF_N()		(self->resN & P_SIGN)
+#define IF_Z()		(self->resZ == 0)
+#define GET_SR()	CPU_GetP(self)
+#define SET_SR(x)	CPU_SetP(self, x)
+
+/* Addressing modes: PC is moved to next instruction, address is computed */
+
+#define M_IMP()		self->PC += 1
+#define M_ACC()		self->PC += 1; mem = &self->A
+#define M_IMM()		self->PC += 2; mem = opc + 1
+#define M_REL()		self->PC += 2
+#define A_ZER()		self->PC += 2; addr = opc[1]
+#define A_ZEX()		self->PC += 2; addr = (opc[1] + self->X) & 0xFF
+#define A_ZEY()		self->PC += 2; addr = (opc[1] + self->Y) & 0xFF
+#define A_ABS()		self->PC += 3; addr = (opc[2] << 8) | opc[1]
+#define A_ABX()		self->PC += 3; base = (opc[2] << 8) | opc[1];			\
+					addr = base + self->X;									\
+					cross = ((base ^ addr) & 0xFF00) != 0
+#define A_ABY()		self->PC += 3; base = (opc[2] << 8) | opc[1];			\
+					addr = base + self->Y;									\
+					cross = ((base ^ addr) & 0xFF00) != 0
+#define A_INX()		self->PC += 2; base = (opc[1] + self->X) & 0xFF;		\
+					addr = *RD(base) | (*RD((base + 1) & 0xFF) << 8)
+#define A_INY()		self->PC += 2; base = *RD(opc[1]) |						\
+					(*RD((opc[1] + 1) & 0xFF) << 8);						\
+					addr = base + self->Y;									\
+					cross = ((base ^ addr) & 0xFF00) != 0
+#define A_ABI()		self->PC += 3; base = (opc[2] << 8) | opc[1];			\
+					addr = *RD(base) |										\
+					(*RD((base & 0xFF00) | ((base + 1) & 0xFF)) << 8)
+
+/* Operand is read (M_), or read and written back by WR (W_). Stores use
+ * address only, so that IO registers don't see a read */
+
+#define M_ZER()		A_ZER(); mem = RD(addr)
+#define M_ZEX()		A_ZEX(); mem = RD(addr)
+#define M_ZEY()		A_ZEY(); mem = RD(addr)
+#define M_ABS()		A_ABS(); mem = RD(addr)
+#define M_ABX()		A_ABX(); mem = RD(addr)
+#define M_ABY()		A_ABY(); mem = RD(addr)
+#define M_INX()		A_INX(); mem = RD(addr)
+#define M_INY()		A_INY(); mem = RD(addr)
+#define W_ZER()		A_ZER(); mem = RW(addr)
+#define W_ZEX()		A_ZEX(); mem = RW(addr)
+#define W_ABS()		A_ABS(); mem = RW(addr)
+#define W_ABX()		A_ABX(); mem = RW(addr)
+
+/* Instructions */
+
+#define OP_ADC()	val = *mem; tmp = self->A + val + (IF_C() ? 1 : 0);	\
+					FLAG_VADD(self->A, val, tmp);							\
+					FLAG_C(tmp > 0xFF); self->A = tmp & 0xFF; FLAG_NZ(self->A)
+#define OP_SBC()	val = *mem; tmp = self->A - val - (IF_C() ? 0 : 1);	\
+					FLAG_VADD(self->A, ~val, tmp);							\
+					FLAG_C(tmp < 0x100); self->A = tmp & 0xFF; FLAG_NZ(self->A)
+#define OP_AND()	self->A &= *mem; FLAG_NZ(self->A)
+#define OP_ORA()	self->A |= *mem; FLAG_NZ(self->A)
+#define OP_EOR()	self->A ^= *mem; FLAG_NZ(self->A)
+#define OP_BIT()	val = *mem; FLAG_N(val); FLAG_V(val & 0x40);			\
+					FLAG_Z(val & self->A)
+#define COMPARE(r)	tmp = (r) - *mem; FLAG_C(tmp < 0x100); FLAG_NZ(tmp & 0xFF)
+#define OP_CMP()	COMPARE(self->A)
+#define OP_CPX()	COMPARE(self->X)
+#define OP_CPY()	COMPARE(self->Y)
+#define OP_LDA()	self->A = *mem; FLAG_NZ(self->A)
+#define OP_LDX()	self->X = *mem; FLAG_NZ(self->X)
+#define OP_LDY()	self->Y = *mem; FLAG_NZ(self->Y)
+#define OP_STA()	ST(addr, self->A)
+#define OP_STX()	ST(addr, self->X)
+#define OP_STY()	ST(addr, self->Y)
+#define OP_ASL()	val = *mem; FLAG_C(val & 0x80); val <<= 1;				\
+					*mem = val; FLAG_NZ(val)
+#define OP_LSR()	val = *mem; FLAG_C(val & 0x01); val >>= 1;				\
+					*mem = val; FLAG_NZ(val)
+#define OP_ROL()	val = *mem; tmp = (val << 1) | (IF_C() ? 0x01 : 0);	\
+					FLAG_C(val & 0x80); val = tmp & 0xFF; *mem = val; FLAG_NZ(val)
+#define OP_ROR()	val = *mem; tmp = (val >> 1) | (IF_C() ? 0x80 : 0);	\
+					FLAG_C(val & 0x01); val = tmp & 0xFF; *mem = val; FLAG_NZ(val)
+#define OP_INC()	val = *mem + 1; *mem = val; FLAG_NZ(val)
+#define OP_DEC()	val = *mem - 1; *mem = val; FLAG_NZ(val)
+#define OP_INX()	self->X++; FLAG_NZ(self->X)
+#define OP_INY()	self->Y++; FLAG_NZ(self->Y)
+#define OP_DEX()	self->X--; FLAG_NZ(self->X)
+#define OP_DEY()	self->Y--; FLAG_NZ(self->Y)
+#define OP_TAX()	self->X = self->A; FLAG_NZ(self->X)
+#define OP_TAY()	self->Y = self->A; FLAG_NZ(self->Y)
+#define OP_TSX()	self->X = self->SP; FLAG_NZ(self->X)
+#define OP_TXA()	self->A = self->X; FLAG_NZ(self->A)
+#define OP_TYA()	self->A = self->Y; FLAG_NZ(self->A)
+#define OP_TXS()	self->SP = self->X
+#define OP_CLC()	FLAG_C(0)
+#define OP_CLD()	self->P &= ~P_DECIMAL
+#define OP_CLI()	self->P &= ~P_INTERRUPT
+#define OP_CLV()	FLAG_V(0)
+#define OP_SEC()	FLAG_C(1)
+#define OP_SED()	self->P |= P_DECIMAL
+#define OP_SEI()	self->P |= P_INTERRUPT
+#define OP_NOP()
+#define OP_PHA()	PUSH(self->A)
+#define OP_PHP()	PUSH(GET_SR() | 0x30)
+#define OP_PLA()	self->A = PULL(); FLAG_NZ(self->A)
+#define OP_PLP()	val = PULL(); SET_SR((val | 0x20) & ~0x10)
+#define OP_JMP()	self->PC = addr
+#define OP_JSR()	self->PC--; PUSH(self->PC >> 8); PUSH(self->PC & 0xFF);	\
+					self->PC = addr
+#define OP_RTS()	tmp = PULL(); tmp |= PULL() << 8; self->PC = tmp + 1
+#define OP_RTI()	val = PULL(); SET_SR((val | 0x20) & ~0x10);			\
+					tmp = PULL(); tmp |= PULL() << 8; self->PC = tmp
+#define OP_BRK()	self->PC++; PUSH(self->PC >> 8); PUSH(self->PC & 0xFF);	\
+					PUSH(GET_SR() | 0x10); self->P |= P_INTERRUPT;			\
+					self->PC = *RD(IRQ_JMP_ADD) | (*RD(IRQ_JMP_ADD + 1) << 8)
+
+/* Branch: +1 cycle if taken, +2 if it goes to another page */
+#define BRANCH(x)	if (x) {												\
+						addr = self->PC + (int8_t) opc[1];					\
+						*clockCycle += ((self->PC ^ addr) & 0xFF00) ? 2 : 1;\
+						self->PC = addr;									\
+					}
+#define OP_BCC()	BRANCH(!IF_C())
+#define OP_BCS()	BRANCH(IF_C())
+#define OP_BNE()	BRANCH(!IF_Z())
+#define OP_BEQ()	BRANCH(IF_Z())
+#define OP_BPL()	BRANCH(!IF_N())
+#define OP_BMI()	BRANCH(IF_N())
+#define OP_BVC()	BRANCH(!IF_V())
+#define OP_BVS()	BRANCH(IF_V())
+
+/* End of instruction */
+#define NEXT(x)		*clockCycle += (x); return EXIT_SUCCESS;
+
+static void Threaded_Trace(CPU *self, uint8_t *opc, uint64_t clockCycle) {
+	Opcode info = Opcode_Get(opc[0]);
+	uint8_t nbArg;
+
+	/* Undefined opcodes are never recorded */
+	if (info.addressingMode >= NUL)
+		return;
+
+	/* Same number of arguments as the interpreter decodes */
+	if (info.addressingMode <= ACC)
+		nbArg = 0;
+	else if (info.addressingMode <= REL)
+		nbArg = 1;
+	else
+		nbArg = 2;
+	CPU_Trace(self, self->PC, opc[0], opc + 1, nbArg, clockCycle);
+}
+
+uint8_t Threaded_Execute(CPU *self, uint8_t *context, uint64_t *clockCycle) {
+#if defined(__GNUC__) && !defined(THREADED_SWITCH)
+	static const void *dispatch[256] = {
+		&&op_00, &&op_01, &&op_ILL, &&op_ILL, /* 0x00 */
+		&&op_ILL, &&op_05, &&op_06, &&op_ILL, /* 0x04 */
+		&&op_08, &&op_09, &&op_0A, &&op_ILL, /* 0x08 */
+		&&op_ILL, &&op_0D, &&op_0E, &&op_ILL, /* 0x0C */
+		&&op_10, &&op_11, &&op_ILL, &&op_ILL, /* 0x10 */
+		&&op_ILL, &&op_15, &&op_16, &&op_ILL, /* 0x14 */
+		&&op_18, &&op_19, &&op_ILL, &&op_ILL, /* 0x18 */
+		&&op_ILL, &&op_1D, &&op_1E, &&op_ILL, /* 0x1C */
+		&&op_20, &&op_21, &&op_ILL, &&op_ILL, /* 0x20 */
+		&&op_24, &&op_25, &&op_26, &&op_ILL, /* 0x24 */
+		&&op_28, &&op_29, &&op_2A, &&op_ILL, /* 0x28 */
+		&&op_2C, &&op_2D, &&op_2E, &&op_ILL, /* 0x2C */
+		&&op_30, &&op_31, &&op_ILL, &&op_ILL, /* 0x30 */
+		&&op_ILL, &&op_35, &&op_36, &&op_ILL, /* 0x34 */
+		&&op_38, &&op_39, &&op_ILL, &&op_ILL, /* 0x38 */
+		&&op_ILL, &&op_3D, &&op_3E, &&op_ILL, /* 0x3C */
+		&&op_40, &&op_41, &&op_ILL, &&op_ILL, /* 0x40 */
+		&&op_ILL, &&op_45, &&op_46, &&op_ILL, /* 0x44 */
+		&&op_48, &&op_49, &&op_4A, &&op_ILL, /* 0x48 */
+		&&op_4C, &&op_4D, &&op_4E, &&op_ILL, /* 0x4C */
+		&&op_50, &&op_51, &&op_ILL, &&op_ILL, /* 0x50 */
+		&&op_ILL, &&op_55, &&op_56, &&op_ILL, /* 0x54 */
+		&&op_58, &&op_59, &&op_ILL, &&op_ILL, /* 0x58 */
+		&&op_ILL, &&op_5D, &&op_5E, &&op_ILL, /* 0x5C */
+		&&op_60, &&op_61, &&op_ILL, &&op_ILL, /* 0x60 */
+		&&op_ILL, &&op_65, &&op_66, &&op_ILL, /* 0x64 */
+		&&op_68, &&op_69, &&op_6A, &&op_ILL, /* 0x68 */
+		&&op_6C, &&op_6D, &&op_6E, &&op_ILL, /* 0x6C */
+		&&op_70, &&op_71, &&op_ILL, &&op_ILL, /* 0x70 */
+		&&op_ILL, &&op_75, &&op_76, &&op_ILL, /* 0x74 */
+		&&op_78, &&op_79, &&op_ILL, &&op_ILL, /* 0x78 */
+		&&op_ILL, &&op_7D, &&op_7E, &&op_ILL, /* 0x7C */
+		&&op_ILL, &&op_81, &&op_ILL, &&op_ILL, /* 0x80 */
+		&&op_84, &&op_85, &&op_86, &&op_ILL, /* 0x84 */
+		&&op_88, &&op_ILL, &&op_8A, &&op_ILL, /* 0x88 */
+		&&op_8C, &&op_8D, &&op_8E, &&op_ILL, /* 0x8C */
+		&&op_90, &&op_91, &&op_ILL, &&op_ILL, /* 0x90 */
+		&&op_94, &&op_95, &&op_96, &&op_ILL, /* 0x94 */
+		&&op_98, &&op_99, &&op_9A, &&op_ILL, /* 0x98 */
+		&&op_ILL, &&op_9D, &&op_ILL, &&op_ILL, /* 0x9C */
+		&&op_A0, &&op_A1, &&op_A2, &&op_ILL, /* 0xA0 */
+		&&op_A4, &&op_A5, &&op_A6, &&op_ILL, /* 0xA4 */
+		&&op_A8, &&op_A9, &&op_AA, &&op_ILL, /* 0xA8 */
+		&&op_AC, &&op_AD, &&op_AE, &&op_ILL, /* 0xAC */
+		&&op_B0, &&op_B1, &&op_ILL, &&op_ILL, /* 0xB0 */
+		&&op_B4, &&op_B5, &&op_B6, &&op_ILL, /* 0xB4 */
+		&&op_B8, &&op_B9, &&op_BA, &&op_ILL, /* 0xB8 */
+		&&op_BC, &&op_BD, &&op_BE, &&op_ILL, /* 0xBC */
+		&&op_C0, &&op_C1, &&op_ILL, &&op_ILL, /* 0xC0 */
+		&&op_C4, &&op_C5, &&op_C6, &&op_ILL, /* 0xC4 */
+		&&op_C8, &&op_C9, &&op_CA, &&op_ILL, /* 0xC8 */
+		&&op_CC, &&op_CD, &&op_CE, &&op_ILL, /* 0xCC */
+		&&op_D0, &&op_D1, &&op_ILL, &&op_ILL, /* 0xD0 */
+		&&op_ILL, &&op_D5, &&op_D6, &&op_ILL, /* 0xD4 */
+		&&op_D8, &&op_D9, &&op_ILL, &&op_ILL, /* 0xD8 */
+		&&op_ILL, &&op_DD, &&op_DE, &&op_ILL, /* 0xDC */
+		&&op_E0, &&op_E1, &&op_ILL, &&op_ILL, /* 0xE0 */
+		&&op_E4, &&op_E5, &&op_E6, &&op_ILL, /* 0xE4 */
+		&&op_E8, &&op_E9, &&op_EA, &&op_ILL, /* 0xE8 */
+		&&op_EC, &&op_ED, &&op_EE, &&op_ILL, /* 0xEC */
+		&&op_F0, &&op_F1, &&op_ILL, &&op_ILL, /* 0xF0 */
+		&&op_ILL, &&op_F5, &&op_F6, &&op_ILL, /* 0xF4 */
+		&&op_F8, &&op_F9, &&op_ILL, &&op_ILL, /* 0xF8 */
+		&&op_ILL, &&op_FD, &&op_FE, &&op_ILL  /* 0xFC */
+	};
+#endif
+	uint8_t *opc, *mem = NULL, val, cross = 0;
+	uint16_t addr = 0, base, tmp;
+
+	/* Check for special event */
+	if (*context)
+		*clockCycle += CPU_InterruptManager(self, context);
+
+	/* DMA requested or on-going, steal this step */
+	if (self->cntDMA != -1) {
+		Instruction inst;
+		if (Instruction_DMA(&inst, self, clockCycle) == DMA_ON) {
+			if (self->trace != NULL)
+				Instruction_Trace(&inst, self, *clockCycle);
+			*clockCycle += inst.opcode.cycle;
+			return EXIT_SUCCESS;
+		}
+	}
+
+	/* Fetch opcode, arguments are read from the same pointer */
+	opc = Mapper_GetRd(self->mapper, self->PC);
+
+	/* Record execution information */
+	if (self->trace != NULL)
+		Threaded_Trace(self, opc, *clockCycle);
+
+	DISPATCH(opc[0]) {
+	/* ADC */
+	CASE(61)	M_INX(); OP_ADC(); NEXT(6)
+	CASE(65)	M_ZER(); OP_ADC(); NEXT(3)
+	CASE(69)	M_IMM(); OP_ADC(); NEXT(2)
+	CASE(6D)	M_ABS(); OP_ADC(); NEXT(4)
+	CASE(71)	M_INY(); OP_ADC(); NEXT(5 + cross)
+	CASE(75)	M_ZEX(); OP_ADC(); NEXT(4)
+	CASE(79)	M_ABY(); OP_ADC(); NEXT(4 + cross)
+	CASE(7D)	M_ABX(); OP_ADC(); NEXT(4 + cross)
+
+	/* AND */
+	CASE(21)	M_INX(); OP_AND(); NEXT(6)
+	CASE(25)	M_ZER(); OP_AND(); NEXT(3)
+	CASE(29)	M_IMM(); OP_AND(); NEXT(2)
+	CASE(2D)	M_ABS(); OP_AND(); NEXT(4)
+	CASE(31)	M_INY(); OP_AND(); NEXT(5 + cross)
+	CASE(35)	M_ZEX(); OP_AND(); NEXT(4)
+	CASE(39)	M_ABY(); OP_AND(); NEXT(4 + cross)
+	CASE(3D)	M_ABX(); OP_AND(); NEXT(4 + cross)
+
+	/* ASL */
+	CASE(06)	W_ZER(); OP_ASL(); WR(addr); NEXT(5)
+	CASE(0A)	M_ACC(); OP_ASL(); NEXT(2)
+	CASE(0E)	W_ABS(); OP_ASL(); WR(addr); NEXT(6)
+	CASE(16)	W_ZEX(); OP_ASL(); WR(addr); NEXT(6)
+	CASE(1E)	W_ABX(); OP_ASL(); WR(addr); NEXT(7)
+
+	/* BCC */
+	CASE(90)	M_REL(); OP_BCC(); NEXT(2)
+
+	/* BCS */
+	CASE(B0)	M_REL(); OP_BCS(); NEXT(2)
+
+	/* BEQ */
+	CASE(F0)	M_REL(); OP_BEQ(); NEXT(2)
+
+	/* BIT */
+	CASE(24)	M_ZER(); OP_BIT(); NEXT(3)
+	CASE(2C)	M_ABS(); OP_BIT(); NEXT(4)
+
+	/* BMI */
+	CASE(30)	M_REL(); OP_BMI(); NEXT(2)
+
+	/* BNE */
+	CASE(D0)	M_REL(); OP_BNE(); NEXT(2)
+
+	/* BPL */
+	CASE(10)	M_REL(); OP_BPL(); NEXT(2)
+
+	/* BRK */
+	CASE(00)	M_IMP(); OP_BRK(); NEXT(7)
+
+	/* BVC */
+	CASE(50)	M_REL(); OP_BVC(); NEXT(2)
+
+	/* BVS */
+	CASE(70)	M_REL(); OP_BVS(); NEXT(2)
+
+	/* CLC */
+	CASE(18)	M_IMP(); OP_CLC(); NEXT(2)
+
+	/* CLD */
+	CASE(D8)	M_IMP(); OP_CLD(); NEXT(2)
+
+	/* CLI */
+	CASE(58)	M_IMP(); OP_CLI(); NEXT(2)
+
+	/* CLV */
+	CASE(B8)	M_IMP(); OP_CLV(); NEXT(2)
+
+	/* CMP */
+	CASE(C1)	M_INX(); OP_CMP(); NEXT(6)
+	CASE(C5)	M_ZER(); OP_CMP(); NEXT(3)
+	CASE(C9)	M_IMM(); OP_CMP(); NEXT(2)
+	CASE(CD)	M_ABS(); OP_CMP(); NEXT(4)
+	CASE(D1)	M_INY(); OP_CMP(); NEXT(5 + cross)
+	CASE(D5)	M_ZEX(); OP_CMP(); NEXT(4)
+	CASE(D9)	M_ABY(); OP_CMP(); NEXT(4 + cross)
+	CASE(DD)	M_ABX(); OP_CMP(); NEXT(4 + cross)
+
+	/* CPX */
+	CASE(E0)	M_IMM(); OP_CPX(); NEXT(2)
+	CASE(E4)	M_ZER(); OP_CPX(); NEXT(3)
+	CASE(EC)	M_ABS(); OP_CPX(); NEXT(4)
+
+	/* CPY */
+	CASE(C0)	M_IMM(); OP_CPY(); NEXT(2)
+	CASE(C4)	M_ZER(); OP_CPY(); NEXT(3)
+	CASE(CC)	M_ABS(); OP_CPY(); NEXT(4)
+
+	/* DEC */
+	CASE(C6)	W_ZER(); OP_DEC(); WR(addr); NEXT(5)
+	CASE(CE)	W_ABS(); OP_DEC(); WR(addr); NEXT(6)
+	CASE(D6)	W_ZEX(); OP_DEC(); WR(addr); NEXT(6)
+	CASE(DE)	W_ABX(); OP_DEC(); WR(addr); NEXT(7)
+
+	/* DEX */
+	CASE(CA)	M_IMP(); OP_DEX(); NEXT(2)
+
+	/* DEY */
+	CASE(88)	M_IMP(); OP_DEY(); NEXT(2)
+
+	/* EOR */
+	CASE(41)	M_INX(); OP_EOR(); NEXT(6)
+	CASE(45)	M_ZER(); OP_EOR(); NEXT(3)
+	CASE(49)	M_IMM(); OP_EOR(); NEXT(2)
+	CASE(4D)	M_ABS(); OP_EOR(); NEXT(4)
+	CASE(51)	M_INY(); OP_EOR(); NEXT(5 + cross)
+	CASE(55)	M_ZEX(); OP_EOR(); NEXT(4)
+	CASE(59)	M_ABY(); OP_EOR(); NEXT(4 + cross)
+	CASE(5D)	M_ABX(); OP_EOR(); NEXT(4 + cross)
+
+	/* INC */
+	CASE(E6)	W_ZER(); OP_INC(); WR(addr); NEXT(5)
+	CASE(EE)	W_ABS(); OP_INC(); WR(addr); NEXT(6)
+	CASE(F6)	W_ZEX(); OP_INC(); WR(addr); NEXT(6)
+	CASE(FE)	W_ABX(); OP_INC(); WR(addr); NEXT(7)
+
+	/* INX */
+	CASE(E8)	M_IMP(); OP_INX(); NEXT(2)
+
+	/* INY */
+	CASE(C8)	M_IMP(); OP_INY(); NEXT(2)
+
+	/* JMP */
+	CASE(4C)	A_ABS(); OP_JMP(); NEXT(3)
+	CASE(6C)	A_ABI(); OP_JMP(); NEXT(5)
+
+	/* JSR */
+	CASE(20)	A_ABS(); OP_JSR(); NEXT(6)
+
+	/* LDA */
+	CASE(A1)	M_INX(); OP_LDA(); NEXT(6)
+	CASE(A5)	M_ZER(); OP_LDA(); NEXT(3)
+	CASE(A9)	M_IMM(); OP_LDA(); NEXT(2)
+	CASE(AD)	M_ABS(); OP_LDA(); NEXT(4)
+	CASE(B1)	M_INY(); OP_LDA(); NEXT(5 + cross)
+	CASE(B5)	M_ZEX(); OP_LDA(); NEXT(4)
+	CASE(B9)	M_ABY(); OP_LDA(); NEXT(4 + cross)
+	CASE(BD)	M_ABX(); OP_LDA(); NEXT(4 + cross)
+
+	/* LDX */
+	CASE(A2)	M_IMM(); OP_LDX(); NEXT(2)
+	CASE(A6)	M_ZER(); OP_LDX(); NEXT(3)
+	CASE(AE)	M_ABS(); OP_LDX(); NEXT(4)
+	CASE(B6)	M_ZEY(); OP_LDX(); NEXT(4)
+	CASE(BE)	M_ABY(); OP_LDX(); NEXT(4 + cross)
+
+	/* LDY */
+	CASE(A0)	M_IMM(); OP_LDY(); NEXT(2)
+	CASE(A4)	M_ZER(); OP_LDY(); NEXT(3)
+	CASE(AC)	M_ABS(); OP_LDY(); NEXT(4)
+	CASE(B4)	M_ZEX(); OP_LDY(); NEXT(4)
+	CASE(BC)	M_ABX(); OP_LDY(); NEXT(4 + cross)
+
+	/* LSR */
+	CASE(46)	W_ZER(); OP_LSR(); WR(addr); NEXT(5)
+	CASE(4A)	M_ACC(); OP_LSR(); NEXT(2)
+	CASE(4E)	W_ABS(); OP_LSR(); WR(addr); NEXT(6)
+	CASE(56)	W_ZEX(); OP_LSR(); WR(addr); NEXT(6)
+	CASE(5E)	W_ABX(); OP_LSR(); WR(addr); NEXT(7)
+
+	/* NOP */
+	CASE(EA)	M_IMP(); OP_NOP(); NEXT(2)
+
+	/* ORA */
+	CASE(01)	M_INX(); OP_ORA(); NEXT(6)
+	CASE(05)	M_ZER(); OP_ORA(); NEXT(3)
+	CASE(09)	M_IMM(); OP_ORA(); NEXT(2)
+	CASE(0D)	M_ABS(); OP_ORA(); NEXT(4)
+	CASE(11)	M_INY(); OP_ORA(); NEXT(5 + cross)
+	CASE(15)	M_ZEX(); OP_ORA(); NEXT(4)
+	CASE(19)	M_ABY(); OP_ORA(); NEXT(4 + cross)
+	CASE(1D)	M_ABX(); OP_ORA(); NEXT(4 + cross)
+
+	/* PHA */
+	CASE(48)	M_IMP(); OP_PHA(); NEXT(3)
+
+	/* PHP */
+	CASE(08)	M_IMP(); OP_PHP(); NEXT(3)
+
+	/* PLA */
+	CASE(68)	M_IMP(); OP_PLA(); NEXT(4)
+
+	/* PLP */
+	CASE(28)	M_IMP(); OP_PLP(); NEXT(4)
+
+	/* ROL */
+	CASE(26)	W_ZER(); OP_ROL(); WR(addr); NEXT(5)
+	CASE(2A)	M_ACC(); OP_ROL(); NEXT(2)
+	CASE(2E)	W_ABS(); OP_ROL(); WR(addr); NEXT(6)
+	CASE(36)	W_ZEX(); OP_ROL(); WR(addr); NEXT(6)
+	CASE(3E)	W_ABX(); OP_ROL(); WR(addr); NEXT(7)
+
+	/* ROR */
+	CASE(66)	W_ZER(); OP_ROR(); WR(addr); NEXT(5)
+	CASE(6A)	M_ACC(); OP_ROR(); NEXT(2)
+	CASE(6E)	W_ABS(); OP_ROR(); WR(addr); NEXT(6)
+	CASE(76)	W_ZEX(); OP_ROR(); WR(addr); NEXT(6)
+	CASE(7E)	W_ABX(); OP_ROR(); WR(addr); NEXT(7)
+
+	/* RTI */
+	CASE(40)	M_IMP(); OP_RTI(); NEXT(6)
+
+	/* RTS */
+	CASE(60)	M_IMP(); OP_RTS(); NEXT(6)
+
+	/* SBC */
+	CASE(E1)	M_INX(); OP_SBC(); NEXT(6)
+	CASE(E5)	M_ZER(); OP_SBC(); NEXT(3)
+	CASE(E9)	M_IMM(); OP_SBC(); NEXT(2)
+	CASE(ED)	M_ABS(); OP_SBC(); NEXT(4)
+	CASE(F1)	M_INY(); OP_SBC(); NEXT(5 + cross)
+	CASE(F5)	M_ZEX(); OP_SBC(); NEXT(4)
+	CASE(F9)	M_ABY(); OP_SBC(); NEXT(4 + cross)
+	CASE(FD)	M_ABX(); OP_SBC(); NEXT(4 + cross)
+
+	/* SEC */
+	CASE(38)	M_IMP(); OP_SEC(); NEXT(2)
+
+	/* SED */
+	CASE(F8)	M_IMP(); OP_SED(); NEXT(2)
+
+	/* SEI */
+	CASE(78)	M_IMP(); OP_SEI(); NEXT(2)
+
+	/* STA */
+	CASE(81)	A_INX(); OP_STA(); NEXT(6)
+	CASE(85)	A_ZER(); OP_STA(); NEXT(3)
+	CASE(8D)	A_ABS(); OP_STA(); NEXT(4)
+	CASE(91)	A_INY(); OP_STA(); NEXT(6)
+	CASE(95)	A_ZEX(); OP_STA(); NEXT(4)
+	CASE(99)	A_ABY(); OP_STA(); NEXT(5)
+	CASE(9D)	A_ABX(); OP_STA(); NEXT(5)
+
+	/* STX */
+	CASE(86)	A_ZER(); OP_STX(); NEXT(3)
+	CASE(8E)	A_ABS(); OP_STX(); NEXT(4)
+	CASE(96)	A_ZEY(); OP_STX(); NEXT(4)
+
+	/* STY */
+	CASE(84)	A_ZER(); OP_STY(); NEXT(3)
+	CASE(8C)	A_ABS(); OP_STY(); NEXT(4)
+	CASE(94)	A_ZEX(); OP_STY(); NEXT(4)
+
+	/* TAX */
+	CASE(AA)	M_IMP(); OP_TAX(); NEXT(2)
+
+	/* TAY */
+	CASE(A8)	M_IMP(); OP_TAY(); NEXT(2)
+
+	/* TSX */
+	CASE(BA)	M_IMP(); OP_TSX(); NEXT(2)
+
+	/* TXA */
+	CASE(8A)	M_IMP(); OP_TXA(); NEXT(2)
+
+	/* TXS */
+	CASE(9A)	M_IMP(); OP_TXS(); NEXT(2)
+
+	/* TYA */
+	CASE(98)	M_IMP(); OP_TYA(); NEXT(2)
+	ILLEGAL
+		self->PC++;
+		ERROR_MSG("can't fetch the next instruction");
+		return EXIT_FAILURE;
+	}
+}
@@ -0,0 +1,33 @@
+/**
+ * \file threaded.h
+ * \brief header file of Threaded module
+ * \author Dylan Gageot
+ * \version 1.0
+ * \date 2019-06-04
+ *
+ * Alternative CPU core: every opcode/addressing mode pair is specialized and
+ * reached from a single dispatch (computed goto with GCC/Clang, switch
+ * otherwise). Build with CPU_THREADED to make it the core used by
+ * CPU_Execute.
+ */
+
+#ifndef THREADED_H
+#define THREADED_H
+
+#include "cpu.h"
+
+/**
+ * \brief Execute the next instruction with the threaded core
+ *
+ * Behaves exactly as CPU_Interpret: interrupts, OAM DMA, cycle count,
+ * IO register acknowledges and debug log are the same.
+ *
+ * \param self instance of CPU
+ * \param context variable containing interrupt flags
+ * \param clockCycle pointer to clock cycle variable
+ *
+ * \return EXIT_SUCCESS if succeed, EXIT_FAILURE otherwise
+ */
+uint8_t Threaded_Execute(CPU *self, uint8_t *context, uint64_t *clockCycle);
+
+#endif /* THREADED_H */
@@ -1,10 +1,11 @@
 #include "loader.h"
+#include "romimage.h"
 #include "../mapper/nrom.h"
 #include "../../common/macro.h"
 
 /* Mapper function LUT */
-static Mapper* (*createLUT[MAPPER_TOTAL])(Header*) = {
-	MapNROM_Create,		/* 0 NROM/no mapper */
+static Mapper* (*createLUT[MAPPER_TOTAL])(Arena*, ROMImage*) = {
+	MapNROM_CreateSharedIn,	/* 0 NROM/no mapper */
 	NULL,				/* 1 MMC1 */
 	NULL,				/* 2 CNROM */
 	NULL,				/* 3 UNROM */
@@ -51,75 +52,35 @@ void fillHeader(Header * header, uint8_t * h){
 /* Load ROM into Mapper structure */
 Mapper * loadROM(char* filename){
 
-	/* Opening the file whose name is given in parameters */
-	FILE *romFile = NULL;
-	romFile = fopen(filename,"rb");
-	if(romFile ==  (FILE*)NULL){
-		ERROR_MSG("can't open ROM file (is the path right?)");
+	/* Mapping and checking the .nes file */
+	ROMImage *image = ROMImage_Load(filename);
+	if(image == (ROMImage*)NULL)
 		return NULL;
-	}
 
-	Header * header = malloc(sizeof(Header));
-	if(header == (Header*)NULL){
-		ERROR_MSG("can't allocate Header structure");
-		free(header);
-		fclose(romFile);
-		return NULL;
-	}
+	/* Mapper points to the file content, and is its only holder */
+	Mapper *mapper = loadImage(NULL, image);
+	ROMImage_Release(image);
+	return mapper;
+}
 
-	/* Storing the .nes header into a 16 unsigned Byte table */
-	uint8_t h[16];
-	if (fread(h,16,1,romFile) != 1){
-		ERROR_MSG("while reading file header");
-		free(header);
-		fclose(romFile);
-		return NULL;
-	}
+/* Largest arena space needed by a mapper */
+size_t loadRequiredSize(const ROMImage *image){
+	/* Only NROM is described (yet) */
+	return MapNROM_RequiredSize(image);
+}
 
-	/* Checking the file format */
-	if(h[0]!='N' || h[1]!='E' || h[2]!='S' || h[3]!=26){
-		ERROR_MSG("given ROM is not a .nes file");
-		free(header);
-		fclose(romFile);
+/* Create mapper pointing to shared ROM */
+Mapper * loadImage(Arena *arena, ROMImage *image){
+	if(image == (ROMImage*)NULL)
 		return NULL;
-	}
-
-	/* Checking its integrity, only supports iNES (1.0) format */
-	for(int i=10; i<16 ; i++){
-		if(h[i]!=0){
-			ERROR_MSG("given ROM is not upright or may be a rip");
-			free(header);
-			fclose(romFile);
-			return NULL;
-		}
-	}
-
-	/* Filling the Header structure */
-	fillHeader(header,h);
 
 	/* Checking if mapper is described */
-	if(header->mapper > MAPPER_TOTAL || createLUT[header->mapper] == NULL){
+	if(image->header.mapper >= MAPPER_TOTAL ||
+		createLUT[image->header.mapper] == NULL){
 		ERROR_MSG("ROM mapper is not described (yet)");
-		free(header);
-		fclose(romFile);
 		return NULL;
 	}
 
 	/* Creating the needed mapper */
-	Mapper *mapper = createLUT[header->mapper](header);
-
-	/* Fetching the ROM and VROM adresses */
-	void * romAddr = Mapper_Get(mapper, AS_LDR, LDR_PRG);
-	void * vromAddr = Mapper_Get(mapper, AS_LDR, LDR_CHR);
-
-	/* Copying the programm into the Mapper structure*/
-	fseek(romFile,16,SEEK_SET);
-	fread(romAddr,(header->romSize)*16384,1,romFile);
-	fseek(romFile,16+(header->romSize)*16384,SEEK_SET);
-	fread(vromAddr,(header->vromSize)*8192,1,romFile);
-
-	/* Returning the Mapper structure */
-	free(header);
-	fclose(romFile);
-	return mapper;
+	return createLUT[image->header.mapper](arena, image);
 }
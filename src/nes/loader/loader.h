@@ -49,9 +49,29 @@ void fillHeader(Header * header, uint8_t * h);
 
 /**
  * \brief Load ROM into Mapper structure
+ *
+ * PRG-ROM and CHR-ROM are not copied, mapper points to the file mapping
+ * (see ROMImage_Load).
  * \param filename .nes file to load
  * \return instance of Mapper
  */
 Mapper* loadROM(char* filename);
 
+struct ROMImage;
+
+/**
+ * \brief Create mapper of a loaded ROM, sharing its read-only content
+ * \param arena arena to allocate mapper from, NULL for heap
+ * \param image ROM to map, a reference is taken by the mapper
+ * \return instance of Mapper
+ */
+Mapper* loadImage(Arena *arena, struct ROMImage *image);
+
+/**
+ * \brief Arena space needed by loadImage, whatever the mapper
+ * \param image ROM to map, NULL for the largest size whatever the cartridge
+ * \return size in bytes
+ */
+size_t loadRequiredSize(const struct ROMImage *image);
+
 #endif /* LOADER_H */
@@ -0,0 +1,220 @@
+#include "romimage.h"
+#include "../ppu/ppu.h"
+#include "../const.h"
+#include "../../common/macro.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#define ROMIMAGE_MMAP
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+/* Check header in place, and that every bank it announces is in file */
+static uint8_t ROMImage_Check(const uint8_t *h, size_t fileSize) {
+	int i;
+
+	if (fileSize < 16) {
+		ERROR_MSG("while reading file header");
+		return EXIT_FAILURE;
+	}
+
+	/* Checking the file format */
+	if (h[0] != 'N' || h[1] != 'E' || h[2] != 'S' || h[3] != 26) {
+		ERROR_MSG("given ROM is not a .nes file");
+		return EXIT_FAILURE;
+	}
+
+	/* Checking its integrity, only supports iNES (1.0) format */
+	for (i = 10; i < 16; i++) {
+		if (h[i] != 0) {
+			ERROR_MSG("given ROM is not upright or may be a rip");
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (fileSize < 16UL + h[4] * ROMIMAGE_PRG_BANK + h[5] * ROMIMAGE_CHR_BANK) {
+		ERROR_MSG("given ROM is truncated");
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
+
+/* Fill image from its header, PRG-ROM and CHR-ROM following each other,
+ * and decode pattern tables of CHR-ROM */
+static uint8_t ROMImage_Fill(ROMImage *self, uint8_t *h, uint8_t *prg) {
+	uint16_t tile;
+
+	fillHeader(&self->header, h);
+	self->prg = prg;
+	self->chr = (self->header.vromSize > 0) ?
+		prg + self->header.romSize * ROMIMAGE_PRG_BANK : NULL;
+	self->tiles = NULL;
+	self->refCount = 1;
+	if (self->chr == NULL)
+		return EXIT_SUCCESS;
+
+	self->tiles = (uint8_t*) malloc(TILE_CNT * SIZE_TILE_DECODED);
+	if (self->tiles == NULL) {
+		ERROR_MSG("can't allocate memory for decoded CHR-ROM");
+		return EXIT_FAILURE;
+	}
+	for (tile = 0; tile < TILE_CNT; tile++)
+		PPU_ExpandTile(self->tiles + tile * SIZE_TILE_DECODED,
+				self->chr + tile * SIZE_TILE);
+	return EXIT_SUCCESS;
+}
+
+#ifdef ROMIMAGE_MMAP
+/* Map whole file, pages are read from page cache when first touched */
+static ROMImage* ROMImage_Map(char *filename, uint8_t *failed) {
+	struct stat info;
+	uint8_t *data;
+	int fd;
+
+	*failed = 0;
+	fd = open(filename, O_RDONLY);
+	if (fd < 0) {
+		ERROR_MSG("can't open ROM file (is the path right?)");
+		*failed = 1;
+		return NULL;
+	}
+	/* Not a regular file (pipe, device...), let caller read it */
+	if ((fstat(fd, &info) != 0) || !S_ISREG(info.st_mode) ||
+		(info.st_size == 0)) {
+		close(fd);
+		return NULL;
+	}
+
+	/* Private mapping: file is never modified, a page patched through
+	 * mapper (debugger, tests) is copied by the system */
+	data = (uint8_t*) mmap(NULL, info.st_size, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED)
+		return NULL;
+
+	if (ROMImage_Check(data, info.st_size) == EXIT_FAILURE) {
+		munmap(data, info.st_size);
+		*failed = 1;
+		return NULL;
+	}
+
+	ROMImage *self = (ROMImage*) malloc(sizeof(ROMImage));
+	if (self == NULL) {
+		ERROR_MSG("can't allocate ROMImage structure");
+		munmap(data, info.st_size);
+		*failed = 1;
+		return NULL;
+	}
+	if (ROMImage_Fill(self, data, data + 16) == EXIT_FAILURE) {
+		munmap(data, info.st_size);
+		free(self);
+		*failed = 1;
+		return NULL;
+	}
+	self->data = data;
+	self->size = info.st_size;
+	self->mapped = 1;
+	return self;
+}
+#endif
+
+/* Copy file content in memory */
+static ROMImage* ROMImage_Read(char *filename) {
+	FILE *romFile = NULL;
+	uint8_t h[16];
+	uint32_t size;
+	long fileSize;
+
+	/* Opening the file whose name is given in parameters */
+	romFile = fopen(filename, "rb");
+	if (romFile == NULL) {
+		ERROR_MSG("can't open ROM file (is the path right?)");
+		return NULL;
+	}
+
+	/* Storing the .nes header into a 16 unsigned Byte table */
+	if ((fseek(romFile, 0, SEEK_END) != 0) ||
+		((fileSize = ftell(romFile)) < 0) ||
+		(fseek(romFile, 0, SEEK_SET) != 0) ||
+		((fileSize >= 16) && (fread(h, 16, 1, romFile) != 1)) ||
+		(ROMImage_Check(h, fileSize) == EXIT_FAILURE)) {
+		fclose(romFile);
+		return NULL;
+	}
+
+	ROMImage *self = (ROMImage*) malloc(sizeof(ROMImage));
+	if (self == NULL) {
+		ERROR_MSG("can't allocate ROMImage structure");
+		fclose(romFile);
+		return NULL;
+	}
+
+	/* PRG-ROM and CHR-ROM are read in a single block */
+	size = h[4] * ROMIMAGE_PRG_BANK + h[5] * ROMIMAGE_CHR_BANK;
+	self->data = (uint8_t*) malloc(size + 1);
+	if (self->data == NULL) {
+		ERROR_MSG("can't allocate memory for ROMImage");
+		free(self);
+		fclose(romFile);
+		return NULL;
+	}
+	if ((size > 0) && (fread(self->data, size, 1, romFile) != 1)) {
+		ERROR_MSG("while reading ROM content");
+		free(self->data);
+		free(self);
+		fclose(romFile);
+		return NULL;
+	}
+	if (ROMImage_Fill(self, h, self->data) == EXIT_FAILURE) {
+		free(self->data);
+		free(self);
+		fclose(romFile);
+		return NULL;
+	}
+	self->size = size;
+	self->mapped = 0;
+
+	fclose(romFile);
+	return self;
+}
+
+ROMImage* ROMImage_Load(char *filename) {
+	if (filename == NULL)
+		return NULL;
+
+#ifdef ROMIMAGE_MMAP
+	uint8_t failed;
+	ROMImage *self = ROMImage_Map(filename, &failed);
+	/* File can't be mapped, fall back on copying it */
+	if ((self != NULL) || failed)
+		return self;
+#endif
+
+	return ROMImage_Read(filename);
+}
+
+ROMImage* ROMImage_Retain(ROMImage *self) {
+	if (self != NULL)
+		__atomic_fetch_add(&self->refCount, 1, __ATOMIC_RELAXED);
+	return self;
+}
+
+void ROMImage_Release(ROMImage *self) {
+	if (self == NULL)
+		return;
+	/* Last holder frees the image */
+	if (__atomic_sub_fetch(&self->refCount, 1, __ATOMIC_ACQ_REL) != 0)
+		return;
+#ifdef ROMIMAGE_MMAP
+	if (self->mapped)
+		munmap(self->data, self->size);
+	else
+#endif
+		free(self->data);
+	free(self->tiles);
+	free(self);
+}
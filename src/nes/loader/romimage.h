@@ -0,0 +1,75 @@
+/**
+ * \file romimage.h
+ * \brief header file of ROMImage module
+ * \author Dylan Gageot
+ * \version 1.0
+ * \date 2019-06-24
+ *
+ * A ROMImage holds the PRG-ROM and CHR-ROM of a .nes file, loaded once and
+ * never written afterwards. Any number of mappers, possibly running on
+ * different threads, can point to it. Each of them holds a reference: the
+ * image is freed when the last one is released.
+ *
+ * Where available, the file is memory-mapped: the header is checked in place
+ * and PRG-ROM and CHR-ROM are pages of the mapping, read from page cache
+ * only when touched. Otherwise, the file is copied in memory.
+ *
+ * Pattern tables of CHR-ROM are decoded once for the PPU (see PPU_ExpandTile)
+ * when loading, so that instances don't need a tile cache of their own.
+ */
+
+#ifndef ROMIMAGE_H
+#define ROMIMAGE_H
+
+#include "loader.h"
+
+/**
+ * \brief Size of a PRG-ROM bank
+ */
+#define ROMIMAGE_PRG_BANK	16384
+
+/**
+ * \brief Size of a CHR-ROM bank
+ */
+#define ROMIMAGE_CHR_BANK	8192
+
+/**
+ * \brief Read-only content of a .nes file
+ */
+typedef struct ROMImage {
+	Header header;			/*!< Decoded iNES header					*/
+	uint8_t *prg;			/*!< PRG-ROM, header.romSize banks			*/
+	uint8_t *chr;			/*!< CHR-ROM, NULL when cartridge has RAM	*/
+	uint8_t *tiles;			/*!< Decoded CHR-ROM, NULL along with chr	*/
+	uint8_t *data;			/*!< Mapped or allocated block holding both	*/
+	size_t size;			/*!< Size of data							*/
+	uint8_t mapped;			/*!< Data is a mapping of the file			*/
+	uint32_t refCount;		/*!< Number of holders						*/
+} ROMImage;
+
+/**
+ * \brief Load a .nes file
+ *
+ * \param filename .nes file to load
+ *
+ * \return instance of ROMImage holding one reference, NULL if failed
+ */
+ROMImage* ROMImage_Load(char *filename);
+
+/**
+ * \brief Take a new reference on image
+ *
+ * \param self instance of ROMImage
+ *
+ * \return self
+ */
+ROMImage* ROMImage_Retain(ROMImage *self);
+
+/**
+ * \brief Drop a reference on image, free it if it was the last one
+ *
+ * \param self instance of ROMImage
+ */
+void ROMImage_Release(ROMImage *self);
+
+#endif /* ROMIMAGE_H */
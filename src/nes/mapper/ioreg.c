@@ -3,9 +3,14 @@
 #include "ioreg.h"
 #include "mapper.h"
 #include "../../common/macro.h"
+#include "../const.h"
 
 IOReg* IOReg_Create(void) {
-	IOReg *self = (IOReg*) malloc(sizeof(IOReg));
+	return IOReg_CreateIn(NULL);
+}
+
+IOReg* IOReg_CreateIn(Arena *arena) {
+	IOReg *self = (IOReg*) Arena_Alloc(arena, sizeof(IOReg));
 	
 	/*	If allocation failed, return NULL */
 	if (self == NULL) {
@@ -15,12 +20,19 @@ IOReg* IOReg_Create(void) {
 
 	/* Initialize arrays */
 	uint8_t i;
-	for (i = 0; i < 40; i++)
+	for (i = 0; i < IOREG_CNT; i++) {
 		self->acknowledge[i] = AC_NO;
+		self->read[i] = NULL;
+		self->write[i] = NULL;
+		self->handlerData[i] = NULL;
+	}
 	for (i = 0; i < 8; i++)
 		self->bank1[i] = &(self->dummy);
 	for (i = 0; i < 32; i++)
 		self->bank2[i] = &(self->dummy);
+	self->ppu = NULL;
+	self->stats = NULL;
+	self->arena = arena;
 
 	return self;
 }
@@ -38,30 +50,102 @@ uint8_t IOReg_Connect(IOReg *self, CPU *cpu, PPU *ppu, Controller *ctrl) {
 	self->bank1[PPUSCROLL]	= &(ppu->PPUSCROLL);
 	self->bank1[PPUADDR]	= &(ppu->PPUADDR);
 	self->bank1[PPUDATA]	= &(ppu->PPUDATA);
+	self->ppu				= ppu;
 
 	/* Bank 2 connection */
 	self->bank2[OAMDMA]		= &(cpu->OAMDMA);
 	self->bank2[JOY1]		= &(ctrl->JOY1);
 	self->bank2[JOY2]		= &(ctrl->JOY2);
 
+	/* Registers with side effects are handled at time of access */
+	IOReg_SetHandler(self, ADDR_PPUCTRL, NULL, PPU_WriteRegister, ppu);
+	IOReg_SetHandler(self, ADDR_PPUSTATUS, PPU_ReadRegister, NULL, ppu);
+	IOReg_SetHandler(self, ADDR_OAMDATA, PPU_ReadRegister, PPU_WriteRegister,
+			ppu);
+	IOReg_SetHandler(self, ADDR_PPUSCROLL, NULL, PPU_WriteRegister, ppu);
+	IOReg_SetHandler(self, ADDR_PPUADDR, NULL, PPU_WriteRegister, ppu);
+	IOReg_SetHandler(self, ADDR_PPUDATA, PPU_ReadRegister, PPU_WriteRegister,
+			ppu);
+	IOReg_SetHandler(self, ADDR_OAMDMA, NULL, CPU_WriteOAMDMA, cpu);
+	IOReg_SetHandler(self, ADDR_JOY1, Controller_Read, Controller_Write, ctrl);
+	IOReg_SetHandler(self, ADDR_JOY2, Controller_Read, NULL, ctrl);
+
 	return EXIT_SUCCESS;
 }
 
-uint8_t* IOReg_Get(IOReg *self, uint8_t accessType, uint16_t address) {
-	if (self == NULL)
-		return NULL;
-
+/* Index of register in acknowledge and handler arrays, -1 if not a register.
+ * PPU must be up to date before one of its registers is accessed */
+static int8_t IOReg_Index(IOReg *self, uint16_t address) {
 	/* If address is in 0x2000-0x3FFF */
 	if (VALUE_IN(address, 0x2000, 0x3FFF)) {
-		self->acknowledge[address & 0x0007] = accessType;
-		return self->bank1[address % 8];
+		if (self->ppu != NULL)
+			PPU_Sync(self->ppu);
+		return address & 0x0007;
 	/* If address is in 0x4000-0x4019 */
 	} else if (VALUE_IN(address, 0x4000, 0x401F)) {
-		self->acknowledge[(address & 0x001F) + 8] = accessType;
-		return self->bank2[address & 0x001F];
+		return (address & 0x001F) + 8;
 	}
-	
-	return NULL;
+	return -1;
+}
+
+/* Register behind an index */
+#define IOREG_BANK(self, i)	(((i) < 8) ? (self)->bank1[i] : (self)->bank2[(i) - 8])
+
+uint8_t* IOReg_Get(IOReg *self, uint8_t accessType, uint16_t address) {
+	if (self == NULL)
+		return NULL;
+
+	int8_t i = IOReg_Index(self, address);
+	if (i < 0)
+		return NULL;
+	if (accessType & AC_RD)
+		STATS_ADD(self->stats, read[i], 1);
+	else if (accessType & AC_WR)
+		STATS_ADD(self->stats, write[i], 1);
+	self->acknowledge[i] = accessType;
+	return IOREG_BANK(self, i);
+}
+
+uint8_t IOReg_SetHandler(IOReg *self, uint16_t address, IORegRead read,
+		IORegWrite write, void *data) {
+	if (self == NULL)
+		return EXIT_FAILURE;
+
+	int8_t i = IOReg_Index(self, address);
+	if (i < 0)
+		return EXIT_FAILURE;
+	self->read[i] = read;
+	self->write[i] = write;
+	self->handlerData[i] = data;
+	return EXIT_SUCCESS;
+}
+
+uint8_t IOReg_Read(IOReg *self, uint16_t address) {
+	if (self == NULL)
+		return 0;
+
+	int8_t i = IOReg_Index(self, address);
+	if (i < 0)
+		return self->dummy;
+	STATS_ADD(self->stats, read[i], 1);
+	self->acknowledge[i] = AC_RD;
+	if (self->read[i] != NULL)
+		return self->read[i](self->handlerData[i], address);
+	return *IOREG_BANK(self, i);
+}
+
+void IOReg_Write(IOReg *self, uint16_t address, uint8_t value) {
+	if (self == NULL)
+		return;
+
+	int8_t i = IOReg_Index(self, address);
+	if (i < 0)
+		return;
+	STATS_ADD(self->stats, write[i], 1);
+	self->acknowledge[i] = AC_WR;
+	*IOREG_BANK(self, i) = value;
+	if (self->write[i] != NULL)
+		self->write[i](self->handlerData[i], address, value);
 }
 
 uint8_t IOReg_Ack(IOReg *self, uint16_t address) {
@@ -84,7 +168,7 @@ uint8_t IOReg_Ack(IOReg *self, uint16_t address) {
 
 void IOReg_Destroy(IOReg* self) {
 	if (self != NULL)
-		free(self);
+		Arena_Free(self->arena, self);
 }
 
 IOReg* IOReg_Extract(Mapper *mapper) {
@@ -14,6 +14,27 @@
 #include "../ppu/ppu.h"
 #include "../controller/controller.h"
 
+/**
+ * \brief Number of IO registers, bank 1 then bank 2
+ */
+#define IOREG_CNT	40
+
+/**
+ * \brief Read handler of an IO register
+ *
+ * Called with handler data and address when CPU reads the register, returns
+ * value read. Side effects of the read happen in it.
+ */
+typedef uint8_t (*IORegRead)(void*, uint16_t);
+
+/**
+ * \brief Write handler of an IO register
+ *
+ * Called with handler data, address and value when CPU writes the register,
+ * once value is stored in it.
+ */
+typedef void (*IORegWrite)(void*, uint16_t, uint8_t);
+
 /**
  * \brief Register use to communicate with PPU, APU and joystick
  *
@@ -21,13 +42,22 @@
  *  - bank1 : @0x2000, registers for PPU
  *  - bank2 : @0x4000, registers for APU and joystick
  * Flags array are used to know if data was read or written
+ * Accessing bank 1 first executes cycles kept by the PPU (PPU_Sync)
+ * IOReg_Read and IOReg_Write call the handlers of a register, if any, at the
+ * time of access: two accesses are never merged.
  */
 typedef struct {
 	uint8_t *bank1[8];			/*!< Pointer bank 1		*/
 	uint8_t *bank2[32];			/*!< Pointer bank 2		*/
-	uint8_t acknowledge[40];	/*!< Acknowledge array	*/
+	uint8_t acknowledge[IOREG_CNT];	/*!< Acknowledge array	*/
+	IORegRead read[IOREG_CNT];		/*!< Read handlers		*/
+	IORegWrite write[IOREG_CNT];	/*!< Write handlers		*/
+	void *handlerData[IOREG_CNT];	/*!< Data given to handlers	*/
 	uint8_t dummy;				/*!< Dummy byte which pointer is returned from 
 								     IOReg_Get for unconnected registers */
+	PPU *ppu;					/*!< PPU to synchronize before bank 1 access	*/
+	Stats *stats;				/*!< Counters, NULL if none						*/
+	Arena *arena;				/*!< Arena holding IOReg, NULL for heap			*/
 } IOReg;
 
 /**
@@ -37,6 +67,15 @@ typedef struct {
  */
 IOReg* IOReg_Create(void);
 
+/**
+ * \brief Instanciation of IOReg in an arena
+ *
+ * \param arena arena to allocate from, NULL for heap
+ *
+ * \return instance of IOReg if succeed
+ */
+IOReg* IOReg_CreateIn(Arena *arena);
+
 /**
  * \brief IOReg_Connect
  *
@@ -60,6 +99,39 @@ uint8_t IOReg_Connect(IOReg *self, CPU *cpu, PPU *ppu, Controller *ctrl);
  */
 uint8_t* IOReg_Get(IOReg *self, uint8_t accessType, uint16_t address);
 
+/**
+ * \brief Set handlers called when CPU reads or writes an IO register
+ *
+ * \param self instance of IOReg
+ * \param address address of register
+ * \param read read handler, NULL if read has no side effect
+ * \param write write handler, NULL if write has no side effect
+ * \param data data given to handlers
+ *
+ * \return EXIT_SUCCESS if succeed, EXIT_FAILURE otherwise 
+ */
+uint8_t IOReg_SetHandler(IOReg *self, uint16_t address, IORegRead read,
+		IORegWrite write, void *data);
+
+/**
+ * \brief Read an IO register as CPU does
+ *
+ * \param self instance of IOReg
+ * \param address address to read
+ *
+ * \return value given by read handler, content of register otherwise
+ */
+uint8_t IOReg_Read(IOReg *self, uint16_t address);
+
+/**
+ * \brief Write an IO register as CPU does, then call its write handler
+ *
+ * \param self instance of IOReg
+ * \param address address to write
+ * \param value value to write
+ */
+void IOReg_Write(IOReg *self, uint16_t address, uint8_t value);
+
 /**
  * \brief Check if the selected IO register was accessed before and acknowledge
  * it
@@ -88,15 +160,6 @@ void IOReg_Destroy(IOReg *self);
  */
 IOReg* IOReg_Extract(Mapper *mapper);
 
-/**
- * \brief Type of access
- */
-enum Acknowledge {
-	AC_NO = 0,		/*!< Transparent access		*/
-	AC_RD = 16,		/*!< Set register as read	*/
-	AC_WR = 32		/*!< Set register as written*/
-};
-
 /**
  * \brief Mnemonic for Bank 1 registers
  */
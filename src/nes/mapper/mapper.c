@@ -6,7 +6,15 @@ Mapper* Mapper_Create(void* (*get)(void*, uint8_t, uint16_t),
 					  void (*destroyer)(void*),
 					  uint8_t (*ack)(void*, uint16_t),
 					  void *mapperData) {
-	Mapper *self = (Mapper*) malloc(sizeof(Mapper));
+	return Mapper_CreateIn(NULL, get, destroyer, ack, mapperData);
+}
+
+Mapper* Mapper_CreateIn(Arena *arena,
+						void* (*get)(void*, uint8_t, uint16_t),
+						void (*destroyer)(void*),
+						uint8_t (*ack)(void*, uint16_t),
+						void *mapperData) {
+	Mapper *self = (Mapper*) Arena_Alloc(arena, sizeof(Mapper));
 	if (self == NULL) {
 		fprintf(stderr, "Error: can't allocate Mapper structure "
 				"at %s, line %d.\n", __FILE__, __LINE__);
@@ -17,7 +25,17 @@ Mapper* Mapper_Create(void* (*get)(void*, uint8_t, uint16_t),
 	self->get = get;
 	self->destroyer = destroyer;
 	self->ack = ack;
+	self->read = NULL;
+	self->write = NULL;
 	self->mapperData = mapperData;
+	self->arena = arena;
+	self->stats = NULL;
+	/* Every page is resolved by get callback until mapper maps it */
+	uint16_t i;
+	for (i = 0; i < MAPPER_PAGE_CNT; i++) {
+		self->pageRd[i] = NULL;
+		self->pageWr[i] = NULL;
+	}
 	return self;
 }
 
@@ -27,13 +45,17 @@ void Mapper_Destroy(Mapper *self) {
 	/* If there is a mapper data, destroy it */
 	if ((self->mapperData != NULL) && (self->destroyer != NULL))
 		self->destroyer(self->mapperData);
-	free((void*) self);
+	Arena_Free(self->arena, (void*) self);
 }
 
 uint8_t* Mapper_Get(Mapper *self, uint8_t space, uint16_t address) {
 	if (self == NULL)
 		return NULL;
 
+#ifdef NES_STATS
+	Stats_Get(self->stats, space, address);
+#endif
+
 	/* If there is a mapper data and get's callback, use it */
 	if ((self->mapperData != NULL) && (self->get != NULL))
 		return (uint8_t*) self->get(self->mapperData, space, address);
@@ -51,3 +73,18 @@ uint8_t Mapper_Ack(Mapper *self, uint16_t address) {
 	else
 		return 0;
 }
+
+void Mapper_SetPage(Mapper *self, uint8_t page, uint8_t *rd, uint8_t *wr) {
+	if (self == NULL)
+		return;
+	self->pageRd[page] = rd;
+	self->pageWr[page] = wr;
+}
+
+void Mapper_SetIO(Mapper *self, uint8_t (*read)(void*, uint16_t),
+				  void (*write)(void*, uint16_t, uint8_t)) {
+	if (self == NULL)
+		return;
+	self->read = read;
+	self->write = write;
+}
@@ -10,16 +10,66 @@
 #define MAPPER_H
 
 #include "stdint.h"
+#include <stddef.h>
+#include "../../common/arena.h"
+#include "../stats/stats.h"
+
+/**
+ * \brief Number of 256-byte pages in CPU address space
+ */
+#define MAPPER_PAGE_CNT 256
+
+/**
+ * \brief Use to specify to the mapper in which address space we want to 
+ * retrieve the data.
+ */
+enum AddressSpace {
+	AS_CPU = 0,			/*!< CPU address space		*/
+	AS_PPU,				/*!< PPU addrsss space		*/
+	AS_LDR				/*!< Loader special access	*/
+};
+
+/**
+ * \brief Use to get pointer to PRGROM and CHRROM
+ */
+enum LoaderData {
+	LDR_PRG = 0,		/*!< Get pointer for PGR-ROM	*/
+	LDR_CHR,			/*!< Get pointer for CHR		*/
+	LDR_IOR,			/*!< Get pointer for IOReg		*/
+	LDR_TIL				/*!< Get pointer for decoded CHR-ROM, NULL if
+						     pattern tables are CHR-RAM	*/
+};
+
+/**
+ * \brief Type of access
+ */
+enum Acknowledge {
+	AC_NO = 0,		/*!< Transparent access		*/
+	AC_RD = 16,		/*!< Set register as read	*/
+	AC_WR = 32		/*!< Set register as written*/
+};
 
 /**
  * \struct Mapper
  * \brief Generic structure to hold mapper
+ *
+ * CPU accesses go through two page tables (one for read, one for write) that
+ * hold a host pointer for each 256-byte page. A NULL entry means the page has
+ * to be resolved by the get callback (IO registers, unmapped regions).
+ * CPU reads and writes of a value on such pages go through read and write
+ * callbacks, so that IO registers handle them at the time of access.
  */
 typedef struct {
 	void* (*get)(void*, uint8_t, uint16_t);		/*!< Get callback			*/
 	void (*destroyer)(void*);					/*!< Destroyer callback		*/
 	uint8_t (*ack)(void*, uint16_t);			/*!< Acknowledge callback	*/
+	uint8_t (*read)(void*, uint16_t);			/*!< CPU read callback		*/
+	void (*write)(void*, uint16_t, uint8_t);	/*!< CPU write callback		*/
 	void *mapperData;							/*!< Mapper data			*/
+	uint8_t *pageRd[MAPPER_PAGE_CNT];			/*!< CPU read page table	*/
+	uint8_t *pageWr[MAPPER_PAGE_CNT];			/*!< CPU write page table	*/
+	Arena *arena;								/*!< Arena holding mapper	*/
+	Stats *stats;								/*!< Counters, NULL if none	*/
 } Mapper;
 
 /**
@@ -37,6 +87,23 @@ Mapper* Mapper_Create(void* (*get)(void*, uint8_t, uint16_t),
 					  uint8_t (*ack)(void*, uint16_t),
 					  void *mapperData);
 
+/**
+ * \brief Create instance of mapper in an arena
+ *
+ * \param arena arena to allocate from, NULL for heap
+ * \param get Get callback
+ * \param destroyer Destroyer callback
+ * \param ack Acknowledge callback
+ * \param mapperData Mapper data
+ *
+ * \return instance of Mapper
+ */
+Mapper* Mapper_CreateIn(Arena *arena,
+						void* (*get)(void*, uint8_t, uint16_t),
+						void (*destroyer)(void*),
+						uint8_t (*ack)(void*, uint16_t),
+						void *mapperData);
+
 /**
  * \brief Destroy instance of Mapper
  *
@@ -66,22 +133,130 @@ uint8_t* Mapper_Get(Mapper *self, uint8_t space, uint16_t address);
 uint8_t Mapper_Ack(Mapper *self, uint16_t address);
 
 /**
- * \brief Use to specify to the mapper in which address space we want to 
- * retrieve the data.
+ * \brief Map a 256-byte page of CPU address space to host memory
+ *
+ * \param self instance of Mapper
+ * \param page page index (address >> 8)
+ * \param rd pointer used for read access, NULL to use get callback
+ * \param wr pointer used for write access, NULL to use get callback
  */
-enum AddressSpace {
-	AS_CPU = 0,			/*!< CPU address space		*/
-	AS_PPU,				/*!< PPU addrsss space		*/
-	AS_LDR				/*!< Loader special access	*/
-};
+void Mapper_SetPage(Mapper *self, uint8_t page, uint8_t *rd, uint8_t *wr);
 
 /**
- * \brief Use to get pointer to PRGROM and CHRROM
+ * \brief Set callbacks reading and writing a value at a CPU address which
+ * page is not mapped
+ * \param self instance of Mapper
+ * \param read read callback, NULL to read through get callback
+ * \param write write callback, NULL to write through get callback
  */
-enum LoaderData {
-	LDR_PRG = 0,		/*!< Get pointer for PGR-ROM	*/
-	LDR_CHR,			/*!< Get pointer for CHR		*/
-	LDR_IOR				/*!< Get pointer for IOReg		*/
-};
+void Mapper_SetIO(Mapper *self, uint8_t (*read)(void*, uint16_t),
+				  void (*write)(void*, uint16_t, uint8_t));
+
+/**
+ * \brief Counters of components connected to mapper
+ *
+ * \param self instance of Mapper, NULL if none
+ *
+ * \return instance of Stats, NULL if none
+ */
+static inline Stats* Mapper_Stats(Mapper *self) {
+	return (self != NULL) ? self->stats : NULL;
+}
+
+/**
+ * \brief Count a CPU access that doesn't go through Mapper_Get
+ *
+ * \param self instance of Mapper
+ * \param space address space and type of access
+ * \param address address accessed
+ */
+static inline void Mapper_Count(Mapper *self, uint8_t space,
+		uint16_t address) {
+#ifdef NES_STATS
+	Stats_Get(self->stats, space, address);
+#else
+	(void) self;
+	(void) space;
+	(void) address;
+#endif
+}
+
+/**
+ * \brief Get pointer to read data at a CPU address
+ *
+ * \param self instance of Mapper
+ * \param address address to read from
+ *
+ * \return pointer of pointed data
+ */
+static inline uint8_t* Mapper_GetRd(Mapper *self, uint16_t address) {
+	uint8_t *page = self->pageRd[address >> 8];
+	/* Plain memory, no need to call mapper */
+	if (page != NULL) {
+		Mapper_Count(self, AC_RD | AS_CPU, address);
+		return page + (address & 0x00FF);
+	}
+	return Mapper_Get(self, AC_RD | AS_CPU, address);
+}
+
+/**
+ * \brief Get pointer to write data at a CPU address
+ *
+ * \param self instance of Mapper
+ * \param address address to write to
+ *
+ * \return pointer of pointed data
+ */
+static inline uint8_t* Mapper_GetWr(Mapper *self, uint16_t address) {
+	uint8_t *page = self->pageWr[address >> 8];
+	/* Plain memory, no need to call mapper */
+	if (page != NULL) {
+		Mapper_Count(self, AC_WR | AS_CPU, address);
+		return page + (address & 0x00FF);
+	}
+	return Mapper_Get(self, AC_WR | AS_CPU, address);
+}
+
+/**
+ * \brief Read a value at a CPU address, side effects of IO registers happen
+ * before returning
+ * \param self instance of Mapper
+ * \param address address to read from
+ * \return value read
+ */
+static inline uint8_t Mapper_Read(Mapper *self, uint16_t address) {
+	uint8_t *page = self->pageRd[address >> 8];
+	/* Plain memory, no need to call mapper */
+	if (page != NULL) {
+		Mapper_Count(self, AC_RD | AS_CPU, address);
+		return page[address & 0x00FF];
+	}
+	if (self->read != NULL) {
+		Mapper_Count(self, AC_RD | AS_CPU, address);
+		return self->read(self->mapperData, address);
+	}
+	return *Mapper_Get(self, AC_RD | AS_CPU, address);
+}
+
+/**
+ * \brief Write a value at a CPU address, side effects of IO registers happen
+ * before returning
+ * \param self instance of Mapper
+ * \param address address to write to
+ * \param value value to write
+ */
+static inline void Mapper_Write(Mapper *self, uint16_t address,
+		uint8_t value) {
+	uint8_t *page = self->pageWr[address >> 8];
+	/* Plain memory, no need to call mapper */
+	if (page != NULL) {
+		Mapper_Count(self, AC_WR | AS_CPU, address);
+		page[address & 0x00FF] = value;
+	} else if (self->write != NULL) {
+		Mapper_Count(self, AC_WR | AS_CPU, address);
+		self->write(self->mapperData, address, value);
+	} else
+		*Mapper_Get(self, AC_WR | AS_CPU, address) = value;
+}
 
 #endif /* MAPPER_H */
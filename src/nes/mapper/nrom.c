@@ -3,27 +3,78 @@
 #include "nrom.h"
 #include "../../common/macro.h"
 
+/* CHR comes from a shared image (CHR-ROM), not from mapper (CHR-RAM) */
+#define MAPNROM_SHARED_CHR(map) \
+	(((map)->image != NULL) && ((map)->ppu.chr == (map)->image->chr))
+
+/* Size of memories allocated by mapper */
+#define NROM_SRAM_ALLOC			8192
+#define NROM_RAM_ALLOC			8192
+#define NROM_CHR_ALLOC			8192
+#define NROM_NAMETABLE_ALLOC	2048
+#define NROM_PALETTE_ALLOC		256
+
+/* Allocate memories not coming from cartridge and build page table */
+static Mapper* MapNROM_Build(MapNROM *mapperData) {
+	Arena *arena = mapperData->arena;
+	/* Allocate Mapper structure */
+	Mapper *self = Mapper_CreateIn(arena,
+								   MapNROM_Get,
+								   MapNROM_Destroy,
+								   MapNROM_Ack,
+								   mapperData);
+	if (self == NULL) {
+		MapNROM_Destroy(mapperData);
+		return self;
+	}
+
+	/*	Allocation of SRAM space */
+	mapperData->cpu.sram = (uint8_t*) Arena_Alloc(arena, NROM_SRAM_ALLOC);
+
+	/*	Allocation of IOReg space */
+	mapperData->cpu.ioReg = IOReg_CreateIn(arena);
+
+	/*	Allocation of RAM space */
+	mapperData->cpu.ram = (uint8_t*) Arena_Alloc(arena, NROM_RAM_ALLOC);
+
+	/*	Allocation of nametable space */
+	mapperData->ppu.nametable = (uint8_t*) Arena_Alloc(arena,
+			NROM_NAMETABLE_ALLOC);
+
+	/*	Allocation of palette space */
+	mapperData->ppu.palette = (uint8_t*) Arena_Alloc(arena,
+			NROM_PALETTE_ALLOC);
+
+
+	/*	Test if allocation failed */
+	if ((mapperData->cpu.rom == NULL) || (mapperData->cpu.ram == NULL) ||
+		(mapperData->cpu.ioReg == NULL) || (mapperData->cpu.sram == NULL) ||
+		(mapperData->ppu.chr == NULL) || (mapperData->ppu.nametable == NULL) ||
+		(mapperData->ppu.palette == NULL)) {
+		ERROR_MSG("can't allocate memory for NROM");
+		Mapper_Destroy(self);
+		return NULL;
+	}
+
+	/*	Build CPU page table, pages left unmapped are read and written
+	 *	through IOReg handlers */
+	MapNROM_MapPages(self);
+	Mapper_SetIO(self, MapNROM_Read, MapNROM_Write);
+
+	return self;
+}
+
 Mapper* MapNROM_Create(Header * header) {
 	if (header == NULL)
 		return NULL;
 	
-	MapNROM *mapperData = (MapNROM*) malloc(sizeof(MapNROM));
+	MapNROM *mapperData = (MapNROM*) calloc(1, sizeof(MapNROM));
 	/*	If allocation failed, return NULL */
 	if (mapperData == NULL) {
 		ERROR_MSG("can't allocate MapNROM structure");
 		return NULL;
 	}
 
-	/* Allocate Mapper structure */
-	Mapper *self = Mapper_Create(MapNROM_Get,
-								 MapNROM_Destroy,
-								 MapNROM_Ack,
-								 mapperData);
-	if (self == NULL) {
-		MapNROM_Destroy(mapperData);
-		return self;
-	}
-
 	/*	Save context */
 	mapperData->romSize = header->romSize;
 	mapperData->mirroring = header->mirroring;
@@ -37,36 +88,88 @@ Mapper* MapNROM_Create(Header * header) {
 			mapperData->cpu.rom = (uint8_t*) malloc(32768);
 	}
 
-	/*	Allocation of SRAM space */
-	mapperData->cpu.sram = (uint8_t*) malloc(8192);
-
-	/*	Allocation of IOReg space */
-	mapperData->cpu.ioReg = IOReg_Create();
-
-	/*	Allocation of RAM space */
-	mapperData->cpu.ram = (uint8_t*) malloc(8192);
-
 	/*	Allocation of CHR-ROM space */
-	mapperData->ppu.chr = (uint8_t*) malloc(8192);
+	mapperData->ppu.chr = (uint8_t*) malloc(NROM_CHR_ALLOC);
 
-	/*	Allocation of nametable space */
-	mapperData->ppu.nametable = (uint8_t*) malloc(2048);
+	return MapNROM_Build(mapperData);
+}
 
-	/*	Allocation of palette space */
-	mapperData->ppu.palette = (uint8_t*) malloc(256);
+Mapper* MapNROM_CreateShared(ROMImage *image) {
+	return MapNROM_CreateSharedIn(NULL, image);
+}
 
+Mapper* MapNROM_CreateSharedIn(Arena *arena, ROMImage *image) {
+	if (image == NULL)
+		return NULL;
 
-	/*	Test if allocation failed */
-	if ((mapperData->cpu.rom == NULL) || (mapperData->cpu.ram == NULL) ||
-		(mapperData->cpu.ioReg == NULL) || (mapperData->cpu.sram == NULL) ||
-		(mapperData->ppu.chr == NULL) || (mapperData->ppu.nametable == NULL) ||
-		(mapperData->ppu.palette == NULL)) {
-		ERROR_MSG("can't allocate memory for NROM");
-		Mapper_Destroy(self);
+	/*	NROM needs 16 or 32kiB of PRG-ROM */
+	if ((image->header.romSize == 0) || (image->header.romSize > 2)) {
+		ERROR_MSG("PRG-ROM size doesn't fit NROM");
 		return NULL;
 	}
 
-	return self;
+	MapNROM *mapperData = (MapNROM*) Arena_Alloc(arena, sizeof(MapNROM));
+	/*	If allocation failed, return NULL */
+	if (mapperData == NULL) {
+		ERROR_MSG("can't allocate MapNROM structure");
+		return NULL;
+	}
+
+	/*	Save context */
+	mapperData->arena = arena;
+	mapperData->romSize = image->header.romSize;
+	mapperData->mirroring = image->header.mirroring;
+	mapperData->image = ROMImage_Retain(image);
+
+	/*	Point to ROM instead of copying it */
+	mapperData->cpu.rom = image->prg;
+
+	/*	Cartridge without CHR-ROM has its own CHR-RAM */
+	if (image->chr != NULL)
+		mapperData->ppu.chr = image->chr;
+	else
+		mapperData->ppu.chr = (uint8_t*) Arena_Alloc(arena, NROM_CHR_ALLOC);
+
+	return MapNROM_Build(mapperData);
+}
+
+size_t MapNROM_RequiredSize(const ROMImage *image) {
+	/* Same chunks as MapNROM_CreateSharedIn */
+	size_t size = ARENA_SIZE(sizeof(MapNROM)) + ARENA_SIZE(sizeof(Mapper)) +
+		ARENA_SIZE(NROM_SRAM_ALLOC) + ARENA_SIZE(sizeof(IOReg)) +
+		ARENA_SIZE(NROM_RAM_ALLOC) + ARENA_SIZE(NROM_NAMETABLE_ALLOC) +
+		ARENA_SIZE(NROM_PALETTE_ALLOC);
+	if ((image == NULL) || (image->chr == NULL))
+		size += ARENA_SIZE(NROM_CHR_ALLOC);
+	return size;
+}
+
+void MapNROM_MapPages(Mapper *mapper) {
+	MapNROM *map = (MapNROM*) mapper->mapperData;
+	uint8_t *ptr;
+	uint16_t page;
+	/* Function of ROM size, map twice or following memory */
+	uint16_t romMask = ((map->romSize % 2) == NROM_16KIB) ? 0x3F : 0x7F;
+
+	for (page = 0; page < MAPPER_PAGE_CNT; page++) {
+		/* 0x0000 -> 0x1FFF : RAM mirrored every 0x0800 */
+		if (VALUE_INF(page, 0x1F))
+			ptr = map->cpu.ram + ((page & 0x07) << 8);
+		/* 0x6000 -> 0x7FFF : SRAM */
+		else if (VALUE_IN(page, 0x60, 0x7F))
+			ptr = map->cpu.sram + ((page & 0x1F) << 8);
+		/* 0x8000 -> 0xFFFF : PRGROM */
+		else if (VALUE_SUP(page, 0x80))
+			ptr = map->cpu.rom + ((page & romMask) << 8);
+		/* IO registers and dummy region are left to MapNROM_Get */
+		else
+			ptr = NULL;
+		/* Writes to shared PRGROM are left to MapNROM_Get too */
+		if (VALUE_SUP(page, 0x80) && (map->image != NULL))
+			Mapper_SetPage(mapper, page, ptr, NULL);
+		else
+			Mapper_SetPage(mapper, page, ptr, ptr);
+	}
 }
 
 void MapNROM_Destroy(void* mapperData) {
@@ -75,28 +178,29 @@ void MapNROM_Destroy(void* mapperData) {
 
 	MapNROM *self = (MapNROM*) mapperData;
 
-	/*	Free only if it's necessary */
-	if (self->cpu.rom != NULL)
-		free((void*) self->cpu.rom);
+	/*	Free only if it's necessary, shared ROM belongs to image */
+	if ((self->cpu.rom != NULL) && (self->image == NULL))
+		Arena_Free(self->arena, (void*) self->cpu.rom);
 
 	if (self->cpu.ram != NULL)
-		free((void*) self->cpu.ram);
+		Arena_Free(self->arena, (void*) self->cpu.ram);
 
 	IOReg_Destroy(self->cpu.ioReg);
 
 	if (self->cpu.sram != NULL)
-		free((void*) self->cpu.sram);
+		Arena_Free(self->arena, (void*) self->cpu.sram);
 
-	if (self->ppu.chr != NULL)
-		free((void*) self->ppu.chr);
+	if ((self->ppu.chr != NULL) && !MAPNROM_SHARED_CHR(self))
+		Arena_Free(self->arena, (void*) self->ppu.chr);
 
 	if (self->ppu.nametable != NULL)
-		free((void*) self->ppu.nametable);
+		Arena_Free(self->arena, (void*) self->ppu.nametable);
 
 	if (self->ppu.palette != NULL)
-		free((void*) self->ppu.palette);
+		Arena_Free(self->arena, (void*) self->ppu.palette);
 
-	free(mapperData);
+	ROMImage_Release(self->image);
+	Arena_Free(self->arena, mapperData);
 	return;
 }
 
@@ -128,6 +232,9 @@ void* MapNROM_Get(void* mapperData, uint8_t space, uint16_t address) {
 		/* 0x6000 -> 0x7FFF : SRAM */
 		} else if (VALUE_IN(address, 0x6000, 0x7FFF)) {
 			return cpu->sram + (address & 0x1FFF);
+		/* 0x8000 -> 0xFFFF : shared PRGROM is read-only */
+		} else if ((map->image != NULL) && (accessType & AC_WR)) {
+			return &(map->dummy);
 		/* 0x8000 -> 0xBFFF : PRGROM 1 */
 		} else if (VALUE_IN(address, 0x8000, 0xBFFF)) {
 			return cpu->rom + (address & 0x3FFF);
@@ -147,8 +254,10 @@ void* MapNROM_Get(void* mapperData, uint8_t space, uint16_t address) {
 		MapNROM_PPU *ppu = &map->ppu;
 		address &= 0x3FFF;
 		/* Which memory is addressed? */
-		/* 0x0000 -> 0x1FFF : Pattern Table */
+		/* 0x0000 -> 0x1FFF : Pattern Table, read-only if shared */
 		if (VALUE_INF(address, 0x1FFF)) {
+			if (MAPNROM_SHARED_CHR(map) && (accessType & AC_WR))
+				return &(map->dummy);
 			return ppu->chr + (address & 0x1FFF);
 		/* 0x2000 -> 0x3EFF : Nametable and Attribute Table */
 		} else if (VALUE_IN(address, 0x2000, 0x3EFF)) {
@@ -182,6 +291,8 @@ void* MapNROM_Get(void* mapperData, uint8_t space, uint16_t address) {
 				return map->ppu.chr;
 			case LDR_IOR:
 				return map->cpu.ioReg;
+			case LDR_TIL:
+				return MAPNROM_SHARED_CHR(map) ? map->image->tiles : NULL;
 		}
 
 	}
@@ -189,6 +300,27 @@ void* MapNROM_Get(void* mapperData, uint8_t space, uint16_t address) {
 	return NULL;
 }
 
+uint8_t MapNROM_Read(void *mapperData, uint16_t address) {
+	if (mapperData == NULL)
+		return 0;
+	MapNROM *self = (MapNROM*) mapperData;
+	/* 0x2000 -> 0x401F : IO bank 1 and 2 */
+	if (VALUE_IN(address, 0x2000, 0x401F))
+		return IOReg_Read(self->cpu.ioReg, address);
+	return *(uint8_t*) MapNROM_Get(mapperData, AC_RD | AS_CPU, address);
+}
+
+void MapNROM_Write(void *mapperData, uint16_t address, uint8_t value) {
+	if (mapperData == NULL)
+		return;
+	MapNROM *self = (MapNROM*) mapperData;
+	/* 0x2000 -> 0x401F : IO bank 1 and 2 */
+	if (VALUE_IN(address, 0x2000, 0x401F))
+		IOReg_Write(self->cpu.ioReg, address, value);
+	else
+		*(uint8_t*) MapNROM_Get(mapperData, AC_WR | AS_CPU, address) = value;
+}
+
 uint8_t MapNROM_Ack(void *mapperData, uint16_t address) {
 	if (mapperData == NULL)
 		return 0;
@@ -12,6 +12,7 @@
 #include "mapper.h"
 #include "ioreg.h"
 #include "../loader/loader.h"
+#include "../loader/romimage.h"
 
 #define NROM_RAM_SIZE 2048
 
@@ -45,6 +46,8 @@ typedef struct {
 	/*	Mapper data */
 	uint8_t romSize;
 	uint8_t mirroring;
+	ROMImage *image;	/*!< Shared ROM, NULL if ROM is owned		*/
+	Arena *arena;		/*!< Arena holding mapper, NULL for heap	*/
 } MapNROM;
 
 /**
@@ -73,6 +76,44 @@ enum NROMMirroring {
  */
 Mapper* MapNROM_Create(Header * header);
 
+/**
+ * \brief Create NROM mapper pointing to PRG-ROM and CHR-ROM of an image
+ *
+ * Only RAM, SRAM, nametables, palettes (and CHR-RAM if cartridge has no
+ * CHR-ROM) are allocated. Writes to shared ROM are ignored, as on hardware.
+ *
+ * \param image ROM to map, a reference is taken until mapper is destroyed
+ *
+ * \return pointer to the new allocated mapper
+ */
+Mapper* MapNROM_CreateShared(ROMImage *image);
+
+/**
+ * \brief Create NROM mapper sharing an image, in an arena
+ *
+ * \param arena arena to allocate from, NULL for heap
+ * \param image ROM to map, a reference is taken until mapper is destroyed
+ *
+ * \return pointer to the new allocated mapper
+ */
+Mapper* MapNROM_CreateSharedIn(Arena *arena, ROMImage *image);
+
+/**
+ * \brief Arena space needed by MapNROM_CreateSharedIn
+ *
+ * \param image ROM to map, NULL for the largest size whatever the cartridge
+ *
+ * \return size in bytes
+ */
+size_t MapNROM_RequiredSize(const ROMImage *image);
+
+/**
+ * \brief Fill CPU page table of the mapper with RAM, SRAM and PRGROM pages
+ *
+ * \param mapper instance of Mapper holding a MapNROM
+ */
+void MapNROM_MapPages(Mapper *mapper);
+
 /**
  * \brief Give access to the data addressed in argument
  *
@@ -84,6 +125,27 @@ Mapper* MapNROM_Create(Header * header);
  */
 void* MapNROM_Get(void* mapperData, uint8_t space, uint16_t address);
 
+/**
+ * \brief Read a value in CPU address space, IO registers are read through
+ * their handlers
+ *
+ * \param mapperData Memory map pointer
+ * \param address Address to read
+ *
+ * \return value read
+ */
+uint8_t MapNROM_Read(void *mapperData, uint16_t address);
+
+/**
+ * \brief Write a value in CPU address space, IO registers are written through
+ * their handlers and writes to shared PRGROM are ignored
+ *
+ * \param mapperData Memory map pointer
+ * \param address Address to write
+ * \param value Value to write
+ */
+void MapNROM_Write(void *mapperData, uint16_t address, uint8_t value);
+
 /**
  * \brief Acknowledge IOReg from MapNROM
  *
@@ -1,22 +1,48 @@
 #include "nes.h"
 #include "loader/loader.h"
+#include "loader/romimage.h"
 #include "mapper/ioreg.h"
+#include "const.h"
 #include "../common/macro.h"
+#include <stddef.h>
+#include <string.h>
 
 NES* NES_Create(char *filename) {
-	NES *self = (NES*) malloc(sizeof(NES));
+	/* Load data from .nes, the only reference left is the mapper's one */
+	ROMImage *image = ROMImage_Load(filename);
+	if (image == NULL)
+		return NULL;
+	NES *self = NES_CreateFromImage(image);
+	ROMImage_Release(image);
+	return self;
+}
+
+/* Arena holding components, NULL if they are on heap */
+#define NES_ARENA(self)	(((self)->arena.base != NULL) ? &(self)->arena : NULL)
+
+/* Size of RGB picture */
+#define NES_IMAGE_SIZE	(NES_SCREEN_WIDTH * NES_SCREEN_HEIGTH * sizeof(uint32_t))
+
+/* Create components of an allocated NES */
+static NES* NES_Build(NES *self, ROMImage *image) {
+	Arena *arena = NES_ARENA(self);
 	if (self != NULL) {
-		/* Load data from .nes */
-		self->mapper = loadROM(filename);
+		/* Map loaded .nes data */
+		self->mapper = loadImage(arena, image);
 		/* Create instance of CPU */
-		self->cpu = CPU_Create(self->mapper);
+		self->cpu = CPU_CreateIn(arena, self->mapper);
 		/* Create instance of PPU */
-		self->ppu = PPU_Create(self->mapper);
+		self->ppu = PPU_CreateIn(arena, self->mapper);
 		/* Create instance of Controller */
-		self->controller = Controller_Create(self->mapper);
+		self->controller = Controller_CreateIn(arena, self->mapper);
+		/* Create timeline of events */
+		self->scheduler = Scheduler_CreateIn(arena);
+		/* Colors converted from PPU picture */
+		self->image = (uint32_t*) Arena_Alloc(arena, NES_IMAGE_SIZE);
 		/* If an allocation goes wrong, free everything */
 		if ((self->mapper == NULL) || (self->cpu == NULL) ||
-			(self->ppu == NULL) || (self->controller == NULL)) {
+			(self->ppu == NULL) || (self->controller == NULL) ||
+			(self->scheduler == NULL) || (self->image == NULL)) {
 			ERROR_MSG("can't allocate memory for NES");
 			NES_Destroy(self);
 			return NULL;
@@ -31,6 +57,15 @@ NES* NES_Create(char *filename) {
 		self->clockCount = 0;
 		/* Set to RESET context */
 		self->context = 0x01;
+		/* PPU follows CPU clock */
+		PPU_Attach(self->ppu, &self->clockCount, &self->context);
+#ifdef NES_STATS
+		/* Components count into the same stats */
+		Stats_Begin(&self->stats, 0);
+		self->frameCount = 0;
+		self->mapper->stats = &self->stats;
+		IOReg_Extract(self->mapper)->stats = &self->stats;
+#endif
 
 	} else
 		ERROR_MSG("can't allocate NES structure");
@@ -38,18 +73,96 @@ NES* NES_Create(char *filename) {
 	return self;
 }
 
+NES* NES_CreateFromImage(ROMImage *image) {
+	if (image == NULL)
+		return NULL;
+	NES *self = (NES*) Arena_Alloc(NULL, sizeof(NES));
+	return NES_Build(self, image);
+}
+
+NES* NES_CreateIn(void *memory, size_t size, ROMImage *image) {
+	Arena arena;
+	if ((image == NULL) || (size < NES_RequiredSize(image)) ||
+		(Arena_Init(&arena, memory, size) == EXIT_FAILURE))
+		return NULL;
+	/* Instance holds the arena its components come from */
+	NES *self = (NES*) Arena_Alloc(&arena, sizeof(NES));
+	self->arena = arena;
+	return NES_Build(self, image);
+}
+
+size_t NES_RequiredSize(const ROMImage *image) {
+	/* Decoded CHR-ROM is shared by image */
+	uint8_t tileShared = (image != NULL) && (image->tiles != NULL);
+	return ARENA_SIZE(sizeof(NES)) + loadRequiredSize(image) +
+		ARENA_SIZE(sizeof(CPU)) + PPU_RequiredSize(tileShared) +
+		Controller_RequiredSize() + Scheduler_RequiredSize() +
+		ARENA_SIZE(NES_IMAGE_SIZE);
+}
+
+/* Vertical blank as predicted by PPU. Prediction is rounded down, odd frames
+ * may be one cycle shorter: it is checked again once reached, at least one
+ * cycle later so that CPU moves on */
+static void NES_ScheduleVBlank(NES *self) {
+	uint32_t cycles = PPU_DotsToVBlank(self->ppu) / 3;
+	Scheduler_Set(self->scheduler, SCHED_VBLANK,
+			self->clockCount + ((cycles > 0) ? cycles : 1));
+}
+
+/* Bring components up to date with an event that is due */
+static void NES_Event(NES *self, int8_t event) {
+	switch (event) {
+		/* Not there yet, or next frame */
+		case SCHED_VBLANK:
+			PPU_CatchUp(self->ppu);
+			NES_ScheduleVBlank(self);
+			break;
+		/* Asserted until CPU takes it */
+		case SCHED_IRQ:
+			self->context |= 0x04;
+			break;
+		default:
+			break;
+	}
+}
+
 uint8_t NES_NextFrame(NES *self, uint16_t keysPressed) {
-	uint32_t previousClockCount = self->clockCount;
+	uint64_t deadline;
+	int8_t event;
+#ifdef NES_STATS
+	uint64_t start = self->clockCount;
+	Stats_Begin(&self->stats, self->frameCount++);
+#endif
+	/* Registers are handled when accessed, keys are read from there */
+	Controller_SetKeys(self->controller, keysPressed);
+	NES_ScheduleVBlank(self);
 	while (PPU_PictureDrawn(self->ppu) == 0) {
-		if (CPU_Execute(self->cpu, &self->context, &self->clockCount) 
-				== EXIT_FAILURE)
-			return EXIT_FAILURE;
-		PPU_Execute(self->ppu, &self->context, 
-				(self->clockCount - previousClockCount) * 3);
-		Controller_Execute(self->controller, keysPressed);
-		previousClockCount = self->clockCount;
+		/* CPU runs up to the next event, PPU catches up with it when one of
+		 * its registers is accessed */
+		deadline = Scheduler_Next(self->scheduler);
+		do {
+			if (CPU_ExecuteBlock(self->cpu, &self->context, &self->clockCount,
+						deadline - self->clockCount) == EXIT_FAILURE)
+				return EXIT_FAILURE;
+		} while (self->clockCount < deadline);
+		while ((event = Scheduler_Pop(self->scheduler, self->clockCount)) >= 0)
+			NES_Event(self, event);
 	}
+#ifdef NES_STATS
+	Stats_End(&self->stats, self->clockCount - start);
+#endif
+	return EXIT_SUCCESS;
+}
+
+uint8_t NES_GetStats(NES *self, Stats *stats) {
+	if ((self == NULL) || (stats == NULL))
+		return EXIT_FAILURE;
+#ifdef NES_STATS
+	*stats = self->stats;
 	return EXIT_SUCCESS;
+#else
+	return EXIT_FAILURE;
+#endif
 }
 
 uint32_t* NES_Render(NES *self) {
@@ -57,19 +170,241 @@ uint32_t* NES_Render(NES *self) {
 		return NULL;
 	if (self->ppu == NULL)
 		return NULL;
-	/* Return pixel array */
+	/* Convert and return pixel array */
+	PPU_ConvertImage(self->ppu, self->image);
+	return self->image;
+}
+
+uint8_t* NES_RenderIndex(NES *self) {
+	if (self == NULL)
+		return NULL;
+	if (self->ppu == NULL)
+		return NULL;
+	/* Return palette index array */
 	return self->ppu->image;
 }
 
+/* Pattern tables are CHR-ROM shared with other instances, that can't be
+ * written and are left out of states */
+static uint8_t NES_SharedCHR(NES *self, uint8_t *chr) {
+	return Mapper_Get(self->mapper, AS_PPU | AC_WR, ADDR_PATTERN_1) != chr;
+}
+
+/* Base of each memory in state, as given by mapper */
+static uint8_t NES_StateMemories(NES *self, uint8_t **ram, uint8_t **sram,
+		uint8_t **chr, uint8_t **nametable, uint8_t **palette) {
+	*ram = (uint8_t*) Mapper_Get(self->mapper, AS_CPU, 0x0000);
+	*sram = (uint8_t*) Mapper_Get(self->mapper, AS_CPU, 0x6000);
+	*chr = (uint8_t*) Mapper_Get(self->mapper, AS_PPU, ADDR_PATTERN_1);
+	*nametable = (uint8_t*) Mapper_Get(self->mapper, AS_PPU, ADDR_NAMETABLE_1);
+	*palette = (uint8_t*) Mapper_Get(self->mapper, AS_PPU, ADDR_PALETTE_BG);
+	if ((*ram == NULL) || (*sram == NULL) || (*chr == NULL) ||
+			(*nametable == NULL) || (*palette == NULL))
+		return EXIT_FAILURE;
+	return EXIT_SUCCESS;
+}
+
+uint8_t NES_SaveState(NES *self, NESState *state) {
+	uint8_t *ram, *sram, *chr, *nametable, *palette;
+	uint8_t i;
+	if ((self == NULL) || (state == NULL))
+		return EXIT_FAILURE;
+	if (NES_StateMemories(self, &ram, &sram, &chr, &nametable, &palette)
+			== EXIT_FAILURE)
+		return EXIT_FAILURE;
+
+	CPU *cpu = self->cpu;
+	PPU *ppu = self->ppu;
+	Controller *ctrl = self->controller;
+
+	/* Padding is zeroed so that snapshots of a same machine compare equal */
+	memset(state, 0, offsetof(NESState, ram));
+	/* Header */
+	state->magic = NES_STATE_MAGIC;
+	state->version = NES_STATE_VERSION;
+	state->size = sizeof(NESState);
+	/* NES */
+	state->clockCount = self->clockCount;
+	for (i = 0; i < SCHED_EVENT_CNT; i++)
+		state->event[i] = Scheduler_Time(self->scheduler, i);
+	state->context = self->context;
+	/* CPU, with lazy flags materialized */
+	state->A = cpu->A;
+	state->X = cpu->X;
+	state->Y = cpu->Y;
+	state->SP = cpu->SP;
+	state->P = CPU_GetP(cpu);
+	state->OAMDMA = cpu->OAMDMA;
+	state->PC = cpu->PC;
+	state->cntDMA = cpu->cntDMA;
+	/* PPU */
+	state->PPUCTRL = ppu->PPUCTRL;
+	state->PPUMASK = ppu->PPUMASK;
+	state->PPUSTATUS = ppu->PPUSTATUS;
+	state->OAMADDR = ppu->OAMADDR;
+	state->OAMDATA = ppu->OAMDATA;
+	state->PPUSCROLL = ppu->PPUSCROLL;
+	state->PPUADDR = ppu->PPUADDR;
+	state->PPUDATA = ppu->PPUDATA;
+	state->vram = ppu->vram;
+	state->cycle = ppu->cycle;
+	state->scanline = ppu->scanline;
+	state->nbFrame = ppu->nbFrame;
+	state->nmiSent = ppu->nmiSent;
+	state->pictureDrawn = ppu->pictureDrawn;
+	state->pendingDots = ppu->pendingDots;
+	memcpy(state->OAM, ppu->OAM, SIZE_OAM);
+	memcpy(state->SOAM, ppu->SOAM, SIZE_SOAM);
+	state->SOAMADDR = ppu->SOAMADDR;
+	state->spriteState = ppu->spriteState;
+	state->spriteData = ppu->spriteData;
+	state->spriteZero = ppu->spriteZero;
+	state->bitmapL = ppu->bitmapL;
+	state->bitmapH = ppu->bitmapH;
+	state->attributeL = ppu->attributeL;
+	state->attributeH = ppu->attributeH;
+	memcpy(state->sprite, ppu->sprite, sizeof(state->sprite));
+	/* IOReg */
+	memcpy(state->acknowledge, IOReg_Extract(self->mapper)->acknowledge,
+			sizeof(state->acknowledge));
+	/* Controller */
+	state->lastState = ctrl->lastState;
+	state->keysPressed = ctrl->keysPressed;
+	state->JOY1 = ctrl->JOY1;
+	state->JOY2 = ctrl->JOY2;
+	state->polling[0] = ctrl->joy1->polling;
+	state->polling[1] = ctrl->joy2->polling;
+	state->shiftState[0] = ctrl->joy1->shiftState;
+	state->shiftState[1] = ctrl->joy2->shiftState;
+	state->stateRegister[0] = ctrl->joy1->stateRegister;
+	state->stateRegister[1] = ctrl->joy2->stateRegister;
+	/* Memories */
+	memcpy(state->ram, ram, sizeof(state->ram));
+	memcpy(state->sram, sram, sizeof(state->sram));
+	if (!NES_SharedCHR(self, chr))
+		memcpy(state->chr, chr, sizeof(state->chr));
+	else
+		memset(state->chr, 0, sizeof(state->chr));
+	memcpy(state->nametable, nametable, sizeof(state->nametable));
+	memcpy(state->palette, palette, sizeof(state->palette));
+	memset(state->palette + sizeof(state->palette), 0, sizeof(NESState)
+			- offsetof(NESState, palette) - sizeof(state->palette));
+
+	return EXIT_SUCCESS;
+}
+
+uint8_t NES_LoadState(NES *self, const NESState *state) {
+	uint8_t *ram, *sram, *chr, *nametable, *palette;
+	uint16_t tile;
+	uint8_t i;
+	if ((self == NULL) || (state == NULL))
+		return EXIT_FAILURE;
+	/* Snapshot must have been saved with this layout */
+	if ((state->magic != NES_STATE_MAGIC) ||
+			(state->version != NES_STATE_VERSION) ||
+			(state->size != sizeof(NESState))) {
+		ERROR_MSG("state is not valid");
+		return EXIT_FAILURE;
+	}
+	if (NES_StateMemories(self, &ram, &sram, &chr, &nametable, &palette)
+			== EXIT_FAILURE)
+		return EXIT_FAILURE;
+
+	CPU *cpu = self->cpu;
+	PPU *ppu = self->ppu;
+	Controller *ctrl = self->controller;
+
+	/* NES */
+	self->clockCount = state->clockCount;
+	for (i = 0; i < SCHED_EVENT_CNT; i++) {
+		if (state->event[i] == SCHED_NEVER)
+			Scheduler_Cancel(self->scheduler, i);
+		else
+			Scheduler_Set(self->scheduler, i, state->event[i]);
+	}
+	self->context = state->context;
+	/* CPU */
+	cpu->A = state->A;
+	cpu->X = state->X;
+	cpu->Y = state->Y;
+	cpu->SP = state->SP;
+	CPU_SetP(cpu, state->P);
+	cpu->OAMDMA = state->OAMDMA;
+	cpu->PC = state->PC;
+	cpu->cntDMA = state->cntDMA;
+	/* PPU */
+	ppu->PPUCTRL = state->PPUCTRL;
+	ppu->PPUMASK = state->PPUMASK;
+	ppu->PPUSTATUS = state->PPUSTATUS;
+	ppu->OAMADDR = state->OAMADDR;
+	ppu->OAMDATA = state->OAMDATA;
+	ppu->PPUSCROLL = state->PPUSCROLL;
+	ppu->PPUADDR = state->PPUADDR;
+	ppu->PPUDATA = state->PPUDATA;
+	ppu->vram = state->vram;
+	ppu->cycle = state->cycle;
+	ppu->scanline = state->scanline;
+	ppu->nbFrame = state->nbFrame;
+	ppu->nmiSent = state->nmiSent;
+	ppu->pictureDrawn = state->pictureDrawn;
+	ppu->pendingDots = state->pendingDots;
+	ppu->clockSynced = self->clockCount;
+	memcpy(ppu->OAM, state->OAM, SIZE_OAM);
+	memcpy(ppu->SOAM, state->SOAM, SIZE_SOAM);
+	ppu->SOAMADDR = state->SOAMADDR;
+	ppu->spriteState = state->spriteState;
+	ppu->spriteData = state->spriteData;
+	ppu->spriteZero = state->spriteZero;
+	ppu->bitmapL = state->bitmapL;
+	ppu->bitmapH = state->bitmapH;
+	ppu->attributeL = state->attributeL;
+	ppu->attributeH = state->attributeH;
+	memcpy(ppu->sprite, state->sprite, sizeof(state->sprite));
+	/* IOReg */
+	memcpy(IOReg_Extract(self->mapper)->acknowledge, state->acknowledge,
+			sizeof(state->acknowledge));
+	/* Controller */
+	ctrl->lastState = state->lastState;
+	ctrl->keysPressed = state->keysPressed;
+	ctrl->JOY1 = state->JOY1;
+	ctrl->JOY2 = state->JOY2;
+	ctrl->joy1->polling = state->polling[0];
+	ctrl->joy2->polling = state->polling[1];
+	ctrl->joy1->shiftState = state->shiftState[0];
+	ctrl->joy2->shiftState = state->shiftState[1];
+	ctrl->joy1->stateRegister = state->stateRegister[0];
+	ctrl->joy2->stateRegister = state->stateRegister[1];
+	/* Memories */
+	memcpy(ram, state->ram, sizeof(state->ram));
+	memcpy(sram, state->sram, sizeof(state->sram));
+	memcpy(nametable, state->nametable, sizeof(state->nametable));
+	memcpy(palette, state->palette, sizeof(state->palette));
+	/* CHR-RAM: decode only tiles that changed */
+	for (tile = 0; (tile < TILE_CNT) && !NES_SharedCHR(self, chr); tile++) {
+		if (memcmp(chr + tile * SIZE_TILE, state->chr + tile * SIZE_TILE,
+					SIZE_TILE) == 0)
+			continue;
+		memcpy(chr + tile * SIZE_TILE, state->chr + tile * SIZE_TILE,
+				SIZE_TILE);
+		PPU_DecodeTile(ppu, tile);
+	}
+
+	return EXIT_SUCCESS;
+}
+
 void NES_Destroy(NES *self) {
 	if (self == NULL)
 		return;
 	CPU_Destroy(self->cpu);
 	PPU_Destroy(self->ppu);
 	Controller_Destroy(self->controller);
+	Scheduler_Destroy(self->scheduler);
+	if (self->image != NULL)
+		Arena_Free(NES_ARENA(self), self->image);
 	if (self->mapper != NULL) {
 		/* Free mapper data */
 		Mapper_Destroy(self->mapper);
 	}
-	free(self);
+	/* Block of an arena instance belongs to caller */
+	Arena_Free(NES_ARENA(self), self);
 }
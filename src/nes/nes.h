@@ -13,7 +13,10 @@
 #include "ppu/ppu.h"
 #include "mapper/mapper.h"
 #include "loader/loader.h"
+#include "loader/romimage.h"
 #include "controller/controller.h"
+#include "scheduler/scheduler.h"
+#include "const.h"
 
 /**
  * \brief Hold every component to emulate the Nintendo Entertainement System
@@ -23,10 +26,99 @@ typedef struct {
 	PPU *ppu;
 	Controller *controller;
 	Mapper *mapper;
-	uint32_t clockCount;
+	Scheduler *scheduler;
+	uint32_t *image;
+	uint64_t clockCount;
 	uint8_t context;
+	Arena arena;		/*!< Block holding instance, base is NULL on heap	*/
+#ifdef NES_STATS
+	Stats stats;		/*!< Counters of last frame							*/
+	uint64_t frameCount;/*!< Frames executed								*/
+#endif
 } NES;
 
+/**
+ * \brief Magic number at the beginning of a state ("MGST")
+ */
+#define NES_STATE_MAGIC		0x5453474D
+
+/**
+ * \brief Version of state layout, to increase whenever NESState changes
+ */
+#define NES_STATE_VERSION	2
+
+/**
+ * \brief Snapshot of every emulated component, see NES_SaveState
+ *
+ * Layout is flat and fixed: no pointer, so that a state can be copied around
+ * with memcpy and restored into any NES running the same ROM. ROM data and
+ * caches derived from it are not part of the state. Nor is the picture,
+ * which is drawn again by the next frame.
+ */
+typedef struct {
+	/* Header */
+	uint32_t magic;					/*!< NES_STATE_MAGIC				*/
+	uint32_t version;				/*!< NES_STATE_VERSION				*/
+	uint32_t size;					/*!< sizeof(NESState)				*/
+	/* NES */
+	uint64_t clockCount;			/*!< CPU clock counter				*/
+	uint64_t event[SCHED_EVENT_CNT];/*!< Scheduled events, SCHED_NEVER	*/
+	uint8_t context;				/*!< Interrupt context				*/
+	/* CPU */
+	uint8_t A;						/*!< Accumulator					*/
+	uint8_t X;						/*!< X index						*/
+	uint8_t Y;						/*!< Y index						*/
+	uint8_t SP;						/*!< Stack pointer					*/
+	uint8_t P;						/*!< Status, with every flag		*/
+	uint8_t OAMDMA;					/*!< OAMDMA register				*/
+	uint16_t PC;					/*!< Program counter				*/
+	int16_t cntDMA;					/*!< DMA counter					*/
+	/* PPU */
+	uint8_t PPUCTRL;				/*!< PPU control register			*/
+	uint8_t PPUMASK;				/*!< PPU mask register				*/
+	uint8_t PPUSTATUS;				/*!< PPU status register			*/
+	uint8_t OAMADDR;				/*!< OAM address register			*/
+	uint8_t OAMDATA;				/*!< OAM data register				*/
+	uint8_t PPUSCROLL;				/*!< PPU scroll register			*/
+	uint8_t PPUADDR;				/*!< PPU address register			*/
+	uint8_t PPUDATA;				/*!< PPU data register				*/
+	VRAM vram;						/*!< VRAM address					*/
+	uint16_t cycle;					/*!< Cycle counter					*/
+	int16_t scanline;				/*!< Scanline counter				*/
+	uint8_t nbFrame;				/*!< Odd/even frame counter			*/
+	uint8_t nmiSent;				/*!< NMI sent flag					*/
+	uint8_t pictureDrawn;			/*!< Picture drawn flag				*/
+	uint32_t pendingDots;			/*!< Cycles not executed yet		*/
+	uint8_t OAM[SIZE_OAM];			/*!< OAM array						*/
+	uint8_t SOAM[SIZE_SOAM];		/*!< Secondary OAM array			*/
+	uint8_t SOAMADDR;				/*!< SOAM address					*/
+	uint8_t spriteState;			/*!< Sprite evaluation state		*/
+	uint8_t spriteData;				/*!< Sprite evaluation data			*/
+	uint8_t spriteZero;				/*!< Sprite zero on scanline		*/
+	uint16_t bitmapL;				/*!< Tile bitmap low shift-reg		*/
+	uint16_t bitmapH;				/*!< Tile bitmap high shift-reg		*/
+	uint16_t attributeL;			/*!< Tile attribute low shift-reg	*/
+	uint16_t attributeH;			/*!< Tile attribute high shift-reg	*/
+	Sprite sprite[SPR_SOAM_CNT];	/*!< Sprite rendering registers		*/
+	/* IOReg */
+	uint8_t acknowledge[40];		/*!< Acknowledge array				*/
+	/* Controller */
+	int32_t lastState;				/*!< Last strobe state				*/
+	uint16_t keysPressed;			/*!< Keys latched					*/
+	uint8_t JOY1;					/*!< JOY1 register					*/
+	uint8_t JOY2;					/*!< JOY2 register					*/
+	int32_t polling[2];				/*!< Joypads polling flag			*/
+	int32_t shiftState[2];			/*!< Joypads number of shifts		*/
+	uint8_t stateRegister[2];		/*!< Joypads shift register			*/
+	/* Memories */
+	uint8_t ram[0x0800];			/*!< CPU RAM						*/
+	uint8_t sram[0x2000];			/*!< CPU SRAM						*/
+	uint8_t chr[0x2000];			/*!< Pattern tables, CHR-RAM only,
+									     zero for CHR-ROM				*/
+	uint8_t nametable[0x0800];		/*!< Nametables						*/
+	uint8_t palette[0x0100];		/*!< Palettes						*/
+} NESState;
+
 /**
  * \brief Allocate memory for the emulator and load the ROM provide in arg.
  *
@@ -36,6 +128,48 @@ typedef struct {
  */
 NES* NES_Create(char *filename);
 
+/**
+ * \brief Allocate memory for the emulator, running an already loaded ROM
+ *
+ * PRG-ROM and CHR-ROM, and tiles decoded from CHR-ROM, are not copied: the
+ * instance points to the image and holds a reference on it until destroyed.
+ * Each instance still owns RAM, SRAM, nametables, palettes, the picture,
+ * CHR-RAM and its tile cache if cartridge has no CHR-ROM, and the caches of
+ * decoded and translated code of its CPU (see ICache and Dynarec), which
+ * grow on demand.
+ *
+ * \param image loaded .nes file, possibly shared with other instances
+ *
+ * \return instance of NES allocated
+ */
+NES* NES_CreateFromImage(ROMImage *image);
+
+/**
+ * \brief Build the emulator in a single block provided by caller
+ *
+ * Every component lives in the block, cache-line aligned, instead of being
+ * spread over heap. Caches of decoded and translated code, that grow on
+ * demand, are still allocated on heap. NES_Destroy must be called before
+ * block is freed or reused.
+ *
+ * \param memory block, aligned on ARENA_ALIGN
+ * \param size size of block, at least NES_RequiredSize(image)
+ * \param image loaded .nes file, possibly shared with other instances
+ *
+ * \return instance of NES, at the start of the block
+ */
+NES* NES_CreateIn(void *memory, size_t size, ROMImage *image);
+
+/**
+ * \brief Size of block needed by NES_CreateIn
+ *
+ * \param image loaded .nes file, NULL for the largest size whatever the
+ * cartridge
+ *
+ * \return size in bytes, multiple of ARENA_ALIGN
+ */
+size_t NES_RequiredSize(const ROMImage *image);
+
 /**
  * \brief Execute the system for one frame
  * \param self instance of NES
@@ -44,6 +178,18 @@ NES* NES_Create(char *filename);
  */
 uint8_t NES_NextFrame(NES *self, uint16_t keysPressed);
 
+/**
+ * \brief Give counters of last frame executed by NES_NextFrame
+ *
+ * Counters are only kept when built with NES_STATS (see Stats module).
+ *
+ * \param self instance of NES
+ * \param stats counters to fill
+ *
+ * \return EXIT_SUCCESS if succeed, EXIT_FAILURE if built without NES_STATS
+ */
+uint8_t NES_GetStats(NES *self, Stats *stats);
+
 /**
  * \brief Render image from PPU
  *
@@ -53,6 +199,41 @@ uint8_t NES_NextFrame(NES *self, uint16_t keysPressed);
  */
 uint32_t* NES_Render(NES *self);
 
+/**
+ * \brief Image from PPU as palette indexes, without color conversion
+ *
+ * \param self instance of NES
+ *
+ * \return image array with one palette index (0 to 63) per pixel
+ */
+uint8_t* NES_RenderIndex(NES *self);
+
+/**
+ * \brief Save state of the emulator into given snapshot
+ *
+ * Neither allocation nor emulation is done: it may be called at any time,
+ * even between two frames of a NES_NextFrame loop.
+ *
+ * \param self instance of NES
+ * \param state snapshot to fill
+ *
+ * \return EXIT_SUCCESS if succeed, EXIT_FAILURE otherwise
+ */
+uint8_t NES_SaveState(NES *self, NESState *state);
+
+/**
+ * \brief Restore state of the emulator from given snapshot
+ *
+ * Snapshot must have been saved by a NES running the same ROM. Only tiles
+ * of pattern tables that differ are decoded again.
+ *
+ * \param self instance of NES
+ * \param state snapshot to restore
+ *
+ * \return EXIT_SUCCESS if succeed, EXIT_FAILURE if snapshot is not valid
+ */
+uint8_t NES_LoadState(NES *self, const NESState *state);
+
 /**
  * \brief Free the memory used by the emulator
  *
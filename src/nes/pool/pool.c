@@ -0,0 +1,204 @@
+#include "pool.h"
+#include "../../common/macro.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* Run instances of a queue until it is empty */
+static void NESPool_RunQueue(NESPool *self, NESPoolQueue *queue) {
+	uint32_t index;
+	uint8_t status;
+	while ((index = __atomic_fetch_add(&queue->next, 1, __ATOMIC_RELAXED))
+			< queue->end) {
+		status = NES_NextFrame(self->nes[index], self->keys[index]);
+		if (status == EXIT_FAILURE)
+			__atomic_fetch_add(&self->failed, 1, __ATOMIC_RELAXED);
+		if (self->callback != NULL)
+			self->callback(self->data, index, self->nes[index], status);
+	}
+}
+
+static void* NESPool_Work(void *arg) {
+	NESPoolWorker *worker = (NESPoolWorker*) arg;
+	NESPool *self = worker->pool;
+	uint32_t generation = 0, i;
+
+	while (1) {
+		/* Wait for next frame */
+		pthread_mutex_lock(&self->lock);
+		while (!self->quit && (self->generation == generation))
+			pthread_cond_wait(&self->start, &self->lock);
+		if (self->quit) {
+			pthread_mutex_unlock(&self->lock);
+			return NULL;
+		}
+		generation = self->generation;
+		pthread_mutex_unlock(&self->lock);
+
+		/* Own queue first, then steal from others */
+		for (i = 0; i < self->workerCount; i++)
+			NESPool_RunQueue(self,
+					self->queue + (worker->id + i) % self->workerCount);
+
+		/* Last worker done wakes caller up */
+		pthread_mutex_lock(&self->lock);
+		if (--self->running == 0)
+			pthread_cond_signal(&self->done);
+		pthread_mutex_unlock(&self->lock);
+	}
+}
+
+/* Create every instance, sharing image of same filenames */
+static uint8_t NESPool_CreateInstances(NESPool *self, char **filename) {
+	ROMImage **image = (ROMImage**) calloc(self->count, sizeof(ROMImage*));
+	uint8_t status = (image != NULL) ? EXIT_SUCCESS : EXIT_FAILURE;
+	size_t size = 0;
+	uint32_t i, j;
+
+	/* Load images first, instances are given room of the largest one */
+	for (i = 0; (i < self->count) && (status == EXIT_SUCCESS); i++) {
+		for (j = 0; (j < i) && (image[i] == NULL); j++)
+			if (strcmp(filename[j], filename[i]) == 0)
+				image[i] = ROMImage_Retain(image[j]);
+		if (image[i] == NULL)
+			image[i] = ROMImage_Load(filename[i]);
+		if (image[i] == NULL)
+			status = EXIT_FAILURE;
+		else if (NES_RequiredSize(image[i]) > size)
+			size = NES_RequiredSize(image[i]);
+	}
+
+	/* Instances are laid out one after the other in a single block */
+	if ((status == EXIT_SUCCESS) && (posix_memalign((void**) &self->block,
+					ARENA_ALIGN, size * self->count) != 0)) {
+		ERROR_MSG("can't allocate memory for NESPool instances");
+		self->block = NULL;
+		status = EXIT_FAILURE;
+	}
+	for (i = 0; (i < self->count) && (status == EXIT_SUCCESS); i++) {
+		self->nes[i] = NES_CreateIn(self->block + size * i, size, image[i]);
+		if (self->nes[i] == NULL)
+			status = EXIT_FAILURE;
+	}
+
+	/* Instances hold their own reference */
+	for (i = 0; (image != NULL) && (i < self->count); i++)
+		ROMImage_Release(image[i]);
+	free(image);
+	return status;
+}
+
+NESPool* NESPool_Create(char **filename, uint32_t count, uint32_t workerCount,
+		NESPoolCallback callback, void *data) {
+	uint32_t i;
+	if ((filename == NULL) || (count == 0) || (workerCount == 0))
+		return NULL;
+
+	NESPool *self = (NESPool*) malloc(sizeof(NESPool));
+	if (self == NULL) {
+		ERROR_MSG("can't allocate NESPool structure");
+		return NULL;
+	}
+
+	self->count = count;
+	self->keys = NULL;
+	self->callback = callback;
+	self->data = data;
+	self->failed = 0;
+	self->workerCount = 0;
+	self->generation = self->running = 0;
+	self->quit = 0;
+	self->block = NULL;
+	self->nes = (NES**) calloc(count, sizeof(NES*));
+	self->worker = (NESPoolWorker*) malloc(workerCount * sizeof(NESPoolWorker));
+	self->queue = (NESPoolQueue*) malloc(workerCount * sizeof(NESPoolQueue));
+	if ((self->nes == NULL) || (self->worker == NULL) || (self->queue == NULL)
+			|| (pthread_mutex_init(&self->lock, NULL) != 0)) {
+		ERROR_MSG("can't allocate memory for NESPool");
+		free(self->nes);
+		free(self->worker);
+		free(self->queue);
+		free(self);
+		return NULL;
+	}
+	pthread_cond_init(&self->start, NULL);
+	pthread_cond_init(&self->done, NULL);
+
+	/* Create instances, a file run by many of them is loaded once */
+	if (NESPool_CreateInstances(self, filename) == EXIT_FAILURE) {
+		NESPool_Destroy(self);
+		return NULL;
+	}
+
+	/* Start workers, waiting for first frame */
+	for (i = 0; i < workerCount; i++) {
+		self->worker[i].pool = self;
+		self->worker[i].id = i;
+		self->queue[i].next = self->queue[i].end = 0;
+		if (pthread_create(&self->worker[i].thread, NULL, NESPool_Work,
+					self->worker + i) != 0) {
+			ERROR_MSG("can't start NESPool worker");
+			NESPool_Destroy(self);
+			return NULL;
+		}
+		self->workerCount++;
+	}
+
+	return self;
+}
+
+uint8_t NESPool_NextFrame(NESPool *self, const uint16_t *keys) {
+	uint32_t i;
+	if ((self == NULL) || (keys == NULL))
+		return EXIT_FAILURE;
+
+	pthread_mutex_lock(&self->lock);
+	/* Split instances evenly between workers */
+	for (i = 0; i < self->workerCount; i++) {
+		self->queue[i].next = (uint64_t) self->count * i / self->workerCount;
+		self->queue[i].end = (uint64_t) self->count * (i + 1) /
+			self->workerCount;
+	}
+	self->keys = keys;
+	self->failed = 0;
+	self->running = self->workerCount;
+	self->generation++;
+	pthread_cond_broadcast(&self->start);
+
+	/* Wait for every worker */
+	while (self->running != 0)
+		pthread_cond_wait(&self->done, &self->lock);
+	pthread_mutex_unlock(&self->lock);
+
+	return (self->failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+NES* NESPool_Get(NESPool *self, uint32_t index) {
+	if ((self == NULL) || (index >= self->count))
+		return NULL;
+	return self->nes[index];
+}
+
+void NESPool_Destroy(NESPool *self) {
+	uint32_t i;
+	if (self == NULL)
+		return;
+
+	/* Stop workers */
+	pthread_mutex_lock(&self->lock);
+	self->quit = 1;
+	pthread_cond_broadcast(&self->start);
+	pthread_mutex_unlock(&self->lock);
+	for (i = 0; i < self->workerCount; i++)
+		pthread_join(self->worker[i].thread, NULL);
+
+	for (i = 0; i < self->count; i++)
+		NES_Destroy(self->nes[i]);
+	free(self->block);
+	pthread_cond_destroy(&self->start);
+	pthread_cond_destroy(&self->done);
+	pthread_mutex_destroy(&self->lock);
+	free(self->nes);
+	free(self->worker);
+	free(self->queue);
+	free(self);
+}
@@ -0,0 +1,125 @@
+/**
+ * \file pool.h
+ * \brief header file of NESPool module
+ * \author Dylan Gageot
+ * \version 1.0
+ * \date 2019-06-20
+ *
+ * Run many NES instances side by side on a set of threads. Instances only
+ * share their read-only ROM, so each one is given to a single thread per
+ * frame. They are split evenly between threads; a thread that ran out of
+ * instances steals the next ones from the queue of another thread.
+ *
+ * Instances are built one after the other in a single block (see
+ * NES_CreateIn).
+ */
+
+#ifndef POOL_H
+#define POOL_H
+
+#include <pthread.h>
+#include "../nes.h"
+
+/**
+ * \brief Called by a worker thread once an instance has executed its frame
+ *
+ * \param data user data given to NESPool_Create
+ * \param index index of the instance
+ * \param nes instance that executed the frame
+ * \param status value returned by NES_NextFrame
+ */
+typedef void (*NESPoolCallback)(void *data, uint32_t index, NES *nes,
+		uint8_t status);
+
+/**
+ * \brief Instances left to a worker, alone on its cache line
+ */
+typedef struct {
+	uint32_t next;					/*!< Next instance to run (atomic)	*/
+	uint32_t end;					/*!< End of instances given			*/
+	uint8_t padding[56];			/*!< Avoid false sharing			*/
+} NESPoolQueue;
+
+typedef struct NESPool NESPool;
+
+/**
+ * \brief Hold a worker thread
+ */
+typedef struct {
+	NESPool *pool;					/*!< Pool the worker belongs to		*/
+	uint32_t id;					/*!< Index of worker and its queue	*/
+	pthread_t thread;				/*!< Thread running the worker		*/
+} NESPoolWorker;
+
+/**
+ * \brief Hold instances and threads
+ */
+struct NESPool {
+	/* Instances */
+	NES **nes;						/*!< Instances of NES				*/
+	uint8_t *block;					/*!< Block holding every instance	*/
+	uint32_t count;					/*!< Number of instances			*/
+	const uint16_t *keys;			/*!< Keys of each instance			*/
+	NESPoolCallback callback;		/*!< Frame completion callback		*/
+	void *data;						/*!< User data of callback			*/
+	uint32_t failed;				/*!< Instances failed (atomic)		*/
+	/* Workers */
+	NESPoolWorker *worker;			/*!< Worker threads					*/
+	NESPoolQueue *queue;			/*!< Queue of each worker			*/
+	uint32_t workerCount;			/*!< Number of worker threads		*/
+	/* Synchronization */
+	pthread_mutex_t lock;			/*!< Protect fields below			*/
+	pthread_cond_t start;			/*!< Signaled when a frame starts	*/
+	pthread_cond_t done;			/*!< Signaled when a frame is done	*/
+	uint32_t generation;			/*!< Number of frames started		*/
+	uint32_t running;				/*!< Workers still running			*/
+	uint8_t quit;					/*!< Workers must exit				*/
+};
+
+/**
+ * \brief Create instances of NES and start worker threads
+ *
+ * \param filename ROM of each instance, the same name may be repeated
+ * \param count number of instances
+ * \param workerCount number of worker threads
+ * \param callback called after each instance frame, may be NULL
+ * \param data user data given to callback
+ *
+ * \return instance of NESPool allocated, NULL if failed
+ */
+NESPool* NESPool_Create(char **filename, uint32_t count, uint32_t workerCount,
+		NESPoolCallback callback, void *data);
+
+/**
+ * \brief Execute one frame of every instance, return once all are done
+ *
+ * Callback is called from worker threads, concurrently for different
+ * instances.
+ *
+ * \param self instance of NESPool
+ * \param keys keys pressed of each instance
+ *
+ * \return EXIT_SUCCESS if every instance succeed, EXIT_FAILURE otherwise
+ */
+uint8_t NESPool_NextFrame(NESPool *self, const uint16_t *keys);
+
+/**
+ * \brief Give an instance of the pool
+ *
+ * Must not be used while NESPool_NextFrame is running.
+ *
+ * \param self instance of NESPool
+ * \param index index of the instance
+ *
+ * \return instance of NES, NULL if index is out of range
+ */
+NES* NESPool_Get(NESPool *self, uint32_t index);
+
+/**
+ * \brief Stop worker threads and free every instance
+ *
+ * \param self instance of NESPool
+ */
+void NESPool_Destroy(NESPool *self);
+
+#endif /* POOL_H */
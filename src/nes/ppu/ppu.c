@@ -5,9 +5,22 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <pthread.h>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <tmmintrin.h>
+#define PPU_CONVERT_SSSE3
+#endif
 
 #define IS_RENDERING_ON() ((self->PPUMASK & (PPUMASK_SHOW_BG | PPUMASK_SHOW_SPR)) != 0)
 
+/* Tasks executed whatever rendering is enabled or not */
+#define ACTION_ALWAYS (ACTION_FRAME | ACTION_CLEAR_FLAG | ACTION_SET_FLAG)
+
+/* Tasks of every dot, indexed by scanline + 1 and cycle */
+static uint16_t actionTable[SCANLINE_CNT][CYCLE_CNT];
+static pthread_once_t actionTableOnce = PTHREAD_ONCE_INIT;
+
 static uint32_t colorPalette[64] = {
 	0x007C7C7C, 0x000000FC, 0x000000BC, 0x004428BC,
 	0x00940084, 0x00A80020, 0x00A81000, 0x00881400,
@@ -65,26 +78,111 @@ static unsigned char reverse_byte(unsigned char x) {
 	return table[x];
 }
 
+static void PPU_BuildActionTable(void) {
+	int scanline, cycle;
+	uint16_t action;
+
+	for (scanline = -1; scanline < SCANLINE_CNT - 1; scanline++) {
+		for (cycle = 0; cycle < CYCLE_CNT; cycle++) {
+			action = 0;
+			/* Pre-render and visible scanlines */
+			if (VALUE_IN(scanline, -1, 239)) {
+				/* Count frame and skip cycle if odd */
+				if ((scanline == 0) && (cycle == 0))
+					action |= ACTION_FRAME;
+				/* Visible dot part */
+				if (VALUE_IN(cycle, 1, 256)) {
+					/* Draw pixel, except on pre-render scanline */
+					if (scanline != -1)
+						action |= ACTION_DRAW;
+					/* Fetch Tile at every cycle */
+					action |= ACTION_FETCH_TILE;
+					/* Clean Secondary OAM, then Sprite Evaluation */
+					action |= (cycle <= 64) ? ACTION_CLEAR_SOAM : ACTION_SPRITE_EVAL;
+					/* Clear flags in the second cycle of pre-render line */
+					if ((scanline == -1) && (cycle == 1))
+						action |= ACTION_CLEAR_FLAG;
+					/* Increment hori(v) every 8's clock */
+					if ((cycle % 8) == 0)
+						action |= ACTION_MANAGE_V;
+				} else if (VALUE_IN(cycle, 257, 320)) {
+					/* Fetch Sprite every 8's clock cycle */
+					if (((cycle - 256) % 8) == 0)
+						action |= ACTION_FETCH_SPRITE;
+					/* Affect hori(t) to hori(v) or vert(t) to vert(v) */
+					if ((cycle == 257) ||
+							(VALUE_IN(cycle, 280, 304) && (scanline == -1)))
+						action |= ACTION_MANAGE_V;
+				/* Fetch Tile for next scanline */
+				} else if (VALUE_IN(cycle, 321, 336)) {
+					action |= ACTION_FETCH_TILE;
+					if ((cycle % 8) == 0)
+						action |= ACTION_MANAGE_V;
+				}
+			/* Set Vertical Blank flag */
+			} else if ((scanline == 241) && (cycle == 1)) {
+				action |= ACTION_SET_FLAG;
+			}
+			actionTable[scanline + 1][cycle] = action;
+		}
+	}
+}
+
 PPU* PPU_Create(Mapper *mapper) {
+	return PPU_CreateIn(NULL, mapper);
+}
+
+PPU* PPU_CreateIn(Arena *arena, Mapper *mapper) {
+	/* Tasks of every dot are computed once, whatever thread comes first */
+	pthread_once(&actionTableOnce, PPU_BuildActionTable);
+
 	/* Allocate PPU structure */
-	PPU *self = (PPU*) malloc(sizeof(PPU));
+	PPU *self = (PPU*) Arena_Alloc(arena, sizeof(PPU));
 	if (self == NULL) {
 		ERROR_MSG("can't allocate memory for PPU structure");
 		return NULL;
 	}
 
-	self->image = (uint32_t*) malloc(NES_SCREEN_WIDTH * NES_SCREEN_HEIGTH * sizeof(uint32_t));
+	self->arena = arena;
+	self->tileCache = NULL;
+	self->tileShared = 0;
+	self->image = (uint8_t*) Arena_Alloc(arena,
+			NES_SCREEN_WIDTH * NES_SCREEN_HEIGTH);
 	if (self->image == NULL) {
 		ERROR_MSG("can't allocate memory for graphics array in PPU");
 		PPU_Destroy(self);
 		return NULL;
 	}
+	memset(self->image, PPU_BLANK_INDEX, NES_SCREEN_WIDTH * NES_SCREEN_HEIGTH);
+
+	/* CHR-ROM is decoded once by its image, CHR-RAM has a cache of its own */
+	self->tileCache = (uint8_t*) Mapper_Get(mapper, AS_LDR, LDR_TIL);
+	self->tileShared = (self->tileCache != NULL);
+	if (!self->tileShared)
+		self->tileCache = (uint8_t*) Arena_Alloc(arena,
+				TILE_CNT * SIZE_TILE_DECODED);
+	if (self->tileCache == NULL) {
+		ERROR_MSG("can't allocate memory for tile cache in PPU");
+		PPU_Destroy(self);
+		return NULL;
+	}
 
 	/* Connect mapper to PPU */
 	self->mapper = mapper;
+	/* Executed from explicit cycle counts until attached */
+	self->clock = NULL;
+	self->clockSynced = 0;
+	self->context = NULL;
+	self->timeline = NULL;
 	return self;
 }
 
+size_t PPU_RequiredSize(uint8_t tileShared) {
+	return ARENA_SIZE(sizeof(PPU)) +
+		ARENA_SIZE(NES_SCREEN_WIDTH * NES_SCREEN_HEIGTH) +
+		(tileShared ? 0 : ARENA_SIZE(TILE_CNT * SIZE_TILE_DECODED));
+}
+
 uint8_t PPU_Init(PPU *self) {
 	int i;
 
@@ -106,10 +204,53 @@ uint8_t PPU_Init(PPU *self) {
 	self->nbFrame = 0;
 	self->nmiSent = 0;
 	self->pictureDrawn = 0;
+	self->pendingDots = 0;
 
 	for (i = 0; i < SIZE_OAM; i++)
 		self->OAM[i] = 0;
 
+	/* Pixels not drawn while rendering is off are black */
+	memset(self->image, PPU_BLANK_INDEX, NES_SCREEN_WIDTH * NES_SCREEN_HEIGTH);
+
+	/* Pattern tables have been loaded */
+	return PPU_DecodePattern(self);
+}
+
+void PPU_ExpandTile(uint8_t *pixel, const uint8_t *chr) {
+	int row, x;
+
+	/* Merge both bitplanes of each row, leftmost pixel first */
+	for (row = 0; row < SIZE_TILE_LAYER; row++) {
+		for (x = 0; x < SIZE_TILE_PIXEL; x++) {
+			*(pixel++) = ((chr[row] >> (7 - x)) & 0x01) |
+				(((chr[row | SIZE_TILE_LAYER] >> (7 - x)) & 0x01) << 1);
+		}
+	}
+}
+
+uint8_t PPU_DecodeTile(PPU *self, uint16_t tile) {
+	uint8_t *chr = Mapper_Get(self->mapper, AS_LDR, LDR_CHR);
+
+	if ((chr == NULL) || (tile >= TILE_CNT))
+		return EXIT_FAILURE;
+	/* Shared CHR-ROM can't be written, its tiles are decoded already */
+	if (self->tileShared)
+		return EXIT_SUCCESS;
+
+	PPU_ExpandTile(self->tileCache + tile * SIZE_TILE_DECODED,
+			chr + tile * SIZE_TILE);
+	return EXIT_SUCCESS;
+}
+
+uint8_t PPU_DecodePattern(PPU *self) {
+	uint16_t tile;
+
+	if (self->tileShared)
+		return EXIT_SUCCESS;
+	for (tile = 0; tile < TILE_CNT; tile++) {
+		if (PPU_DecodeTile(self, tile) == EXIT_FAILURE)
+			return EXIT_FAILURE;
+	}
 	return EXIT_SUCCESS;
 }
 
@@ -206,157 +347,157 @@ uint8_t PPU_Init(PPU *self) {
 //	}
 //}
 
-uint8_t PPU_CheckRegister(PPU *self) {
-	uint8_t ack = 0;
-
-	/* PPUCTRL behavior:
-	 * Write	->	Update VRAM.t with nametable content */
-	if (Mapper_Ack(self->mapper, ADDR_PPUCTRL) & AC_WR) {
-		/* t: ...BA.. ........ = d: ......BA */
-		self->vram.t &= ~0x0C00;
-		self->vram.t |= (self->PPUCTRL & PPUCTRL_BASE_NT) << 10;
-		return EXIT_SUCCESS;
-	}
-
-	/* PPUSTATUS behavior:
-	 * Read		->	Clear Vertical Blank Bit and VRAM.w latch */
-	if (Mapper_Ack(self->mapper, ADDR_PPUSTATUS)) {
-		self->PPUSTATUS &= ~PPUSTATUS_VBL;
-		self->vram.w = 0;
-		return EXIT_SUCCESS;
+/* PPUDATA access moves VRAM.v, depending of the state of rendering */
+static void PPU_IncrementAddress(PPU *self) {
+	if (VALUE_IN(self->scanline, -1, 239) && IS_RENDERING_ON()) {
+		PPU_IncrementCorseX(self);
+		PPU_IncrementY(self);
+		/* If not rendering, increment linearly */
+	} else {
+		self->vram.v += (self->PPUCTRL & PPUCTRL_VRAM_INC) ? 32 : 1;
 	}
+}
 
-	/* OAMDATA behavior:
-	 * Write	->	Update OAM[OAMADDR] with given value and inc OAMADDR */
-	if (Mapper_Ack(self->mapper, ADDR_OAMDATA) & AC_WR) {
-		self->OAM[self->OAMADDR++] = self->OAMDATA;
-		return EXIT_SUCCESS;
-	}
+uint8_t PPU_ReadRegister(void *ppu, uint16_t address) {
+	PPU *self = (PPU*) ppu;
+	uint8_t value;
 
-	/* PPUSCROLL behavior:
-	 * 2 Write	->	VRAM.w++ and update VRAM.t */
-	if (Mapper_Ack(self->mapper, ADDR_PPUSCROLL) & AC_WR) {
-		if (self->vram.w == 0) {
-			/* t: ....... ...HGFED = d: HGFED... */
-			self->vram.t &= ~0x001F;
-			self->vram.t |= self->PPUSCROLL >> 3;
-			/* x:              CBA = d: .....CBA */
-			self->vram.x = self->PPUSCROLL & 0x07;
-			self->vram.w++;
-		} else {
-			/* t: CBA..HG FED..... = d: HGFEDCBA */
-			self->vram.t &= ~0xE3E0;
-			self->vram.t |= (self->PPUSCROLL << 12) & 0x7FFF;
-			self->vram.t |= (self->PPUSCROLL & 0xF8) << 2;
+	switch (address & 0x0007) {
+		/* PPUSTATUS behavior:
+		 * Read		->	Clear Vertical Blank Bit and VRAM.w latch */
+		case PPUSTATUS:
+			value = self->PPUSTATUS;
+			self->PPUSTATUS &= ~PPUSTATUS_VBL;
 			self->vram.w = 0;
-		}
-		return EXIT_SUCCESS;
+			return value;
+
+		/* OAMDATA behavior:
+		 * Read		->	Give OAM[OAMADDR] */
+		case OAMDATA:
+			return self->OAM[self->OAMADDR];
+
+		/* PPUDATA behavior:
+		 * Read		->	Give buffered VRAM (palette is not buffered), fill
+		 * 				buffer with Mapper[VRAM] and update VRAM.v */
+		case PPUDATA:
+			if (VALUE_IN(self->vram.v, ADDR_PALETTE_BG, ADDR_PALETTE_BG + 0x00FF))
+				self->PPUDATA = *Mapper_Get(self->mapper, AS_PPU, self->vram.v);
+			value = self->PPUDATA;
+			self->PPUDATA = *Mapper_Get(self->mapper, AS_PPU, self->vram.v);
+			PPU_IncrementAddress(self);
+			return value;
 	}
 
-	/* PPUADDR behavior:
-	 * 2 Write	->	VRAM.w++ and update VRAM.t */
-	if (Mapper_Ack(self->mapper, ADDR_PPUADDR) & AC_WR) {
-		if (self->vram.w == 0) {
-			/* t: 0FEDCBA ........ = d: ..FEDCBA */
-			self->vram.t &= ~0x7F00;
-			self->vram.t |= (self->PPUADDR << 8) & 0x7F00;
-			self->vram.w++;
-		} else {
-			/* t: ....... HGFEDCBA = d: HGFEDCBA */
-			self->vram.t &= ~0x00FF;
-			self->vram.t |= self->PPUADDR;
-			/* v = t */
-			self->vram.v = self->vram.t;
-			self->vram.w = 0;
-		}
-		return EXIT_SUCCESS;
-	}
+	return 0;
+}
 
-	/* PPUDATA behavior:
-	 * R/W		->	Update Mapper[VRAM] with given value and update VRAM.v */
-	if ((ack = Mapper_Ack(self->mapper, ADDR_PPUDATA))) {
+void PPU_WriteRegister(void *ppu, uint16_t address, uint8_t value) {
+	PPU *self = (PPU*) ppu;
+
+	switch (address & 0x0007) {
+		/* PPUCTRL behavior:
+		 * Write	->	Update VRAM.t with nametable content */
+		case PPUCTRL:
+			/* t: ...BA.. ........ = d: ......BA */
+			self->vram.t &= ~0x0C00;
+			self->vram.t |= (value & PPUCTRL_BASE_NT) << 10;
+			/* NMI enabled in vertical blank is sent right away */
+			if (self->context != NULL)
+				PPU_RefreshRegister(self, self->context);
+			break;
+
+		/* OAMDATA behavior:
+		 * Write	->	Update OAM[OAMADDR] with given value and inc OAMADDR */
+		case OAMDATA:
+			self->OAM[self->OAMADDR++] = value;
+			break;
+
+		/* PPUSCROLL behavior:
+		 * 2 Write	->	VRAM.w++ and update VRAM.t */
+		case PPUSCROLL:
+			if (self->vram.w == 0) {
+				/* t: ....... ...HGFED = d: HGFED... */
+				self->vram.t &= ~0x001F;
+				self->vram.t |= value >> 3;
+				/* x:              CBA = d: .....CBA */
+				self->vram.x = value & 0x07;
+				self->vram.w++;
+			} else {
+				/* t: CBA..HG FED..... = d: HGFEDCBA */
+				self->vram.t &= ~0xE3E0;
+				self->vram.t |= (value << 12) & 0x7FFF;
+				self->vram.t |= (value & 0xF8) << 2;
+				self->vram.w = 0;
+			}
+			break;
+
+		/* PPUADDR behavior:
+		 * 2 Write	->	VRAM.w++ and update VRAM.t */
+		case PPUADDR:
+			if (self->vram.w == 0) {
+				/* t: 0FEDCBA ........ = d: ..FEDCBA */
+				self->vram.t &= ~0x7F00;
+				self->vram.t |= (value << 8) & 0x7F00;
+				self->vram.w++;
+			} else {
+				/* t: ....... HGFEDCBA = d: HGFEDCBA */
+				self->vram.t &= ~0x00FF;
+				self->vram.t |= value;
+				/* v = t */
+				self->vram.v = self->vram.t;
+				self->vram.w = 0;
+			}
+			break;
+
+		/* PPUDATA behavior:
+		 * Write	->	Update Mapper[VRAM] with given value and update VRAM.v */
+		case PPUDATA:
+			/* Write access lets mapper protect CHR-ROM */
+			*Mapper_Get(self->mapper, AS_PPU | AC_WR, self->vram.v) = value;
+			/* Pattern table has been modified (CHR-RAM) */
+			if ((self->vram.v & 0x3FFF) < (SIZE_PATTERN * 2))
+				PPU_DecodeTile(self, (self->vram.v & 0x1FFF) / SIZE_TILE);
+			PPU_IncrementAddress(self);
+			break;
+	}
+}
 
-		uint8_t *vram = Mapper_Get(self->mapper, AS_PPU, self->vram.v);
-		/* Set value in VRAM correspondly to value of PPUDATA */
-		if (ack & AC_WR)
-			*vram = self->PPUDATA;
-		/* Place in PPUDATA the desired data from VRAM */
-		else if (ack & AC_RD)
-			self->PPUDATA = *vram;
+static uint16_t PPU_Action(PPU *self) {
+	uint16_t action = actionTable[self->scanline + 1][self->cycle];
 
-		/* Depending of the self->spriteState of rendering,
-		 * increment is acting differently */
-		if (VALUE_IN(self->scanline, -1, 239) && IS_RENDERING_ON()) {
-			PPU_IncrementCorseX(self);
-			PPU_IncrementY(self);
-			/* If not rendering, increment linearly */
-		} else {
-			self->vram.v += (self->PPUCTRL & PPUCTRL_VRAM_INC) ? 32 : 1;
+	/* Skip cycle if odd frame and rendering enable */
+	if (action & ACTION_FRAME) {
+		if ((self->nbFrame % 2) && IS_RENDERING_ON()) {
+			self->cycle++;
+			action = actionTable[self->scanline + 1][self->cycle];
 		}
-		return EXIT_SUCCESS;
+		self->nbFrame++;
 	}
-
-	return EXIT_SUCCESS;
+	if (!IS_RENDERING_ON())
+		action &= ACTION_ALWAYS;
+	return action;
 }
 
 uint8_t PPU_ManageTiming(PPU *self, Stack *taskList) {
+	uint16_t action = PPU_Action(self);
 
-	/* Pre-render and visible scanlines */
-	if (VALUE_IN(self->scanline, -1, 239)) {
-		/* Skip cycle if odd frame and rendering enable */
-		if ((self->scanline == 0) && (self->cycle == 0)) {
-			if ((self->nbFrame % 2) && IS_RENDERING_ON()) {
-				self->cycle++;
-			}
-			self->nbFrame++;
-		}
-		/* Visible dot part */
-		if (VALUE_IN(self->cycle, 1, 256)) {
-			/* Increment hori(v) every 8's clock */
-			if (((self->cycle % 8) == 0) && IS_RENDERING_ON()) {
-				Stack_Push(taskList, (void*) PPU_ManageV);
-			}
-			/* Clear Vertical Blank flag and Sprite 0 hit
-			 * when we are in the second cycle of pre-render line */
-			if ((self->scanline == -1) && (self->cycle == 1)) {
-				Stack_Push(taskList, (void*) PPU_ClearFlag);
-			}
-			/* Clean Secondary OAM */
-			if (VALUE_IN(self->cycle, 1, 64) && IS_RENDERING_ON()) {
-				Stack_Push(taskList, (void*) PPU_ClearSecondaryOAM);
-				/* Sprite Evaluation */
-			} else if (VALUE_IN(self->cycle, 65, 256) && IS_RENDERING_ON()) {
-				Stack_Push(taskList, (void*) PPU_SpriteEvaluation);
-			}
-			/* Fetch Tile at every cycle */
-			if (IS_RENDERING_ON())
-				Stack_Push(taskList, (void*) PPU_FetchTile);
-			/* Draw pixel */
-			if (VALUE_IN(self->scanline, 0, 239) && IS_RENDERING_ON())
-				Stack_Push(taskList, (void*) PPU_Draw);
-		} else if (VALUE_IN(self->cycle, 257, 320) && IS_RENDERING_ON()) {
-			/* Affect hori(t) to hori(v)
-			 * or vert(t) to vert(v) */
-			if ((self->cycle == 257) ||
-					(VALUE_IN(self->cycle, 280, 304) && (self->scanline == -1))) {
-				Stack_Push(taskList, (void*) PPU_ManageV);
-			}
-			/* Fetch Sprite every 8's clock cycle */
-			if (((self->cycle - 256) % 8) == 0)
-				Stack_Push(taskList, (void*) PPU_FetchSprite);
-			/* Fetch Tile for next scanline */
-		} else if (VALUE_IN(self->cycle, 321, 336) && IS_RENDERING_ON()) {
-			/* Increment hori(v) every 8's clock cycle */
-			if ((self->cycle % 8) == 0) {
-				Stack_Push(taskList, (void*) PPU_ManageV);
-			}
-			/* Fetch tile at every cycle */
-			Stack_Push(taskList, (void*) PPU_FetchTile);
-		}
-		/* Set Vertical Blank flag */
-	} else if ((self->scanline == 241) && (self->cycle == 1)) {
+	/* Last task to execute is pushed first */
+	if (action & ACTION_SET_FLAG)
 		Stack_Push(taskList, (void*) PPU_SetFlag);
-	}
+	if (action & ACTION_MANAGE_V)
+		Stack_Push(taskList, (void*) PPU_ManageV);
+	if (action & ACTION_FETCH_SPRITE)
+		Stack_Push(taskList, (void*) PPU_FetchSprite);
+	if (action & ACTION_CLEAR_FLAG)
+		Stack_Push(taskList, (void*) PPU_ClearFlag);
+	if (action & ACTION_SPRITE_EVAL)
+		Stack_Push(taskList, (void*) PPU_SpriteEvaluation);
+	if (action & ACTION_CLEAR_SOAM)
+		Stack_Push(taskList, (void*) PPU_ClearSecondaryOAM);
+	if (action & ACTION_FETCH_TILE)
+		Stack_Push(taskList, (void*) PPU_FetchTile);
+	if (action & ACTION_DRAW)
+		Stack_Push(taskList, (void*) PPU_Draw);
 
 	return EXIT_SUCCESS;
 }
@@ -365,6 +506,9 @@ uint8_t PPU_SetFlag(PPU *self) {
 	/* Set Vertical Blank bit */
 	self->PPUSTATUS |= PPUSTATUS_VBL;
 	self->pictureDrawn = 1;
+	if (self->timeline != NULL)
+		Timeline_Instant(self->timeline, TIMELINE_PPU, "vblank",
+				self->nbFrame);
 	return EXIT_SUCCESS;
 }
 
@@ -436,8 +580,7 @@ uint8_t PPU_ManageV(PPU *self) {
 	return EXIT_SUCCESS;
 }
 
-uint8_t PPU_RefreshRegister(PPU *self, uint8_t *context) {
-
+static void PPU_RefreshData(PPU *self) {
 	/* OAMDATA read behavior */
 	self->OAMDATA = self->OAM[self->OAMADDR];
 
@@ -445,12 +588,19 @@ uint8_t PPU_RefreshRegister(PPU *self, uint8_t *context) {
 	if (VALUE_IN(self->vram.v, ADDR_PALETTE_BG, ADDR_PALETTE_BG + 0x00FF)) {
 		self->PPUDATA = *Mapper_Get(self->mapper, AS_PPU, self->vram.v);
 	}
+}
+
+uint8_t PPU_RefreshRegister(PPU *self, uint8_t *context) {
+
+	/* OAMDATA and PPUDATA read behavior */
+	PPU_RefreshData(self);
 
 	/* NMI Interrupt Generator */
 	if (!self->nmiSent && ((self->PPUSTATUS & PPUSTATUS_VBL) != 0) &&
 			((self->PPUCTRL & PPUCTRL_NMI) != 0)) {
 		*context |= 0x02;
 		self->nmiSent = 1;
+		STATS_ADD(Mapper_Stats(self->mapper), nmi, 1);
 	}
 
 	return EXIT_SUCCESS;
@@ -559,53 +709,59 @@ uint8_t PPU_SpriteEvaluation(PPU *self) {
 	return EXIT_SUCCESS;
 }
 
-uint8_t PPU_FetchTile(PPU *self) {
+static inline void PPU_ShiftTile(PPU *self) {
+	/* shift the attribute and bitmap registers */
+	self->bitmapL <<= 0x01;
+	self->bitmapH <<= 0x01;
+	self->attributeL <<= 0x01;
+	self->attributeH <<= 0x01;
+}
 
-	uint8_t* pattern_address = Mapper_Get(self->mapper, AS_PPU, 
-			ADDR_NAMETABLE_1 | (self->vram.v & 0x0FFF));
+static inline uint8_t PPU_TileAttribute(PPU *self) {
 	uint8_t* attribute = Mapper_Get(self->mapper, AS_PPU, ADDR_ATTRIBUTE_1
 			| (self->vram.v & 0x0C00)
 			| ((self->vram.v >> 4) & 0x38)
 			| ((self->vram.v >> 2) & 0x07));
-	uint8_t* pattern = Mapper_Get(self->mapper, AS_LDR, LDR_CHR) +
-		((self->PPUCTRL & PPUCTRL_BG_PT) ? SIZE_PATTERN : 0);
-
-	uint8_t shift, attribute_value = *attribute;
 	/* coarse X */
 	uint8_t x = self->vram.v & 0x01F;
 	/* coarse Y */
 	uint8_t y = (self->vram.v >> 5) & 0x1F;
+	/* get and decode attribute */
+	uint8_t shift = (x & 0x02) | ((y & 0x02) << 1);
+	return (*attribute >> shift) & 0x03;
+}
+
+static inline void PPU_LoadTile(PPU *self, uint8_t *pattern) {
+	uint8_t* pattern_address = Mapper_Get(self->mapper, AS_PPU, 
+			ADDR_NAMETABLE_1 | (self->vram.v & 0x0FFF));
+	uint8_t attribute_value = PPU_TileAttribute(self);
 	/* fine y */
 	uint8_t fine_y = self->vram.v >> 12;
 
 	uint8_t* tile_pattern = pattern + (*pattern_address << 4);
 
-	/* shift the attribute and bitmap registers */
-	self->bitmapL <<= 0x01;
-	self->bitmapH <<= 0x01;
-	self->attributeL <<= 0x01;
-	self->attributeH <<= 0x01;
-
+	/* insert data from pattern table into shift registers */
+	self->bitmapL &=~ 0x00FF;
+	self->bitmapL |= tile_pattern[fine_y];
 
-	if((self->cycle % 8) == 0) {
-		/* insert data from pattern table into shift registers */
-		self->bitmapL &=~ 0x00FF;
-		self->bitmapL |= tile_pattern[fine_y];
+	self->bitmapH &=~ 0x00FF;
+	self->bitmapH |= tile_pattern[fine_y | SIZE_TILE_LAYER];
 
-		self->bitmapH &=~ 0x00FF;
-		self->bitmapH |= tile_pattern[fine_y | SIZE_TILE_LAYER];
+	/* set all the byte's bits to the value of the attribute bit */
+	self->attributeL &=~ 0x00FF;
+	self->attributeL |= ((attribute_value & 0x01) ? 0x00FF : 0);
 
-		/* get and decode attribute */
-		shift = (x & 0x02) | ((y & 0x02) << 1);
-		attribute_value = (attribute_value >> shift) & 0x03;
+	self->attributeH &=~ 0x00FF;
+	self->attributeH |= (((attribute_value >> 0x01) & 0x01) ? 0x00FF : 0);
+}
 
-		/* set all the byte's bits to the value of the attribute bit */
-		self->attributeL &=~ 0x00FF;
-		self->attributeL |= ((attribute_value & 0x01) ? 0x00FF : 0);
+uint8_t PPU_FetchTile(PPU *self) {
+	uint8_t* pattern = Mapper_Get(self->mapper, AS_LDR, LDR_CHR) +
+		((self->PPUCTRL & PPUCTRL_BG_PT) ? SIZE_PATTERN : 0);
 
-		self->attributeH &=~ 0x00FF;
-		self->attributeH |= (((attribute_value >> 0x01) & 0x01) ? 0x00FF : 0);
-	}
+	PPU_ShiftTile(self);
+	if((self->cycle % 8) == 0)
+		PPU_LoadTile(self, pattern);
 	return EXIT_SUCCESS;
 }
 
@@ -671,10 +827,8 @@ uint8_t PPU_FetchSprite(PPU *self) {
 }
 
 
-uint8_t PPU_Draw(PPU *self) {
+static inline void PPU_DrawPixel(PPU *self, uint8_t *palette) {
 	/* variables used for background */
-	uint8_t *palette = Mapper_Get(self->mapper, AS_PPU, ADDR_PALETTE_BG);
-
 	uint8_t attribute = (self->attributeL & (0x8000 >> self->vram.x)) >> (15 - self->vram.x)
 						| (self->attributeH & (0x8000 >> self->vram.x)) >> (14 - self->vram.x);
 
@@ -738,11 +892,14 @@ uint8_t PPU_Draw(PPU *self) {
 	}
 
 	if (color == 0) {
-		self->image[(self->scanline << 8) + self->cycle-1] = colorPalette[palette[0]];
+		self->image[(self->scanline << 8) + self->cycle-1] = palette[0] & 0x3F;
 	} else {
-		self->image[(self->scanline << 8) + self->cycle-1] = colorPalette[color_palette[color]];
+		self->image[(self->scanline << 8) + self->cycle-1] = color_palette[color] & 0x3F;
 	}
+}
 
+uint8_t PPU_Draw(PPU *self) {
+	PPU_DrawPixel(self, Mapper_Get(self->mapper, AS_PPU, ADDR_PALETTE_BG));
 	return EXIT_SUCCESS;
 }
 
@@ -756,31 +913,273 @@ uint8_t PPU_UpdateCycle(PPU *self) {
 			self->scanline++;
 		else
 			self->scanline = -1;
+		if (self->timeline != NULL)
+			Timeline_Instant(self->timeline, TIMELINE_PPU, "scanline",
+					self->scanline);
 	}
 	return EXIT_SUCCESS;
 }
 
-uint8_t PPU_Execute(PPU* self, uint8_t *context, uint8_t clock) {
-	Stack taskList;
-	uint8_t (*task)(PPU*) = NULL;
+static void PPU_DrawScanline(PPU *self) {
+	uint8_t background[(TILE_X_CNT + 2) * SIZE_TILE_PIXEL];
+	uint8_t sprite[NES_SCREEN_WIDTH];
+	uint8_t *palette = Mapper_Get(self->mapper, AS_PPU, ADDR_PALETTE_BG);
+	uint8_t *tileCache = self->tileCache +
+		((self->PPUCTRL & PPUCTRL_BG_PT) ? TILE_CNT / 2 : 0) * SIZE_TILE_DECODED;
+	uint8_t *tile, *color_palette;
+	uint8_t attribute, bitmap, pixel, color;
+	uint8_t *image = self->image + (self->scanline << 8);
+	int i, x, bit;
+
+	/* Two first tiles are already in shift registers */
+	for (i = 0; i < 2 * SIZE_TILE_PIXEL; i++) {
+		bit = 15 - i;
+		background[i] = ((self->bitmapL >> bit) & 0x01)
+			| (((self->bitmapH >> bit) & 0x01) << 1)
+			| (((self->attributeL >> bit) & 0x01) << 2)
+			| (((self->attributeH >> bit) & 0x01) << 3);
+	}
+	/* Following ones are fetched every 8 cycles, v incremented afterwards */
+	for (; i < (int) sizeof(background); i += SIZE_TILE_PIXEL) {
+		tile = tileCache + *Mapper_Get(self->mapper, AS_PPU, ADDR_NAMETABLE_1 |
+				(self->vram.v & 0x0FFF)) * SIZE_TILE_DECODED +
+			(self->vram.v >> 12) * SIZE_TILE_PIXEL;
+		attribute = PPU_TileAttribute(self) << 2;
+		for (x = 0; x < SIZE_TILE_PIXEL; x++)
+			background[i + x] = tile[x] | attribute;
+		if (i < (int) sizeof(background) - SIZE_TILE_PIXEL)
+			PPU_IncrementCorseX(self);
+		else
+			PPU_IncrementY(self);
+	}
+
+	/* Pre-render scanline only fetches */
+	if (self->scanline == -1)
+		return;
+
+	/* First non transparent sprite pixel wins, lowest sprite index first */
+	memset(sprite, 0, sizeof(sprite));
+	for (i = SPR_SOAM_CNT - 1; i >= 0; i--) {
+		for (x = 0; (x < SIZE_TILE_PIXEL) &&
+				((self->sprite[i].x + x) < NES_SCREEN_WIDTH); x++) {
+			pixel = ((self->sprite[i].patternL >> (7 - x)) & 0x01)
+				| (((self->sprite[i].patternH >> (7 - x)) & 0x01) << 1);
+			if (pixel != 0) {
+				sprite[self->sprite[i].x + x] = pixel
+					| ((self->sprite[i].attribute & OAM_ATTRIBUTE_PALETTE) << 2)
+					| (self->sprite[i].attribute & OAM_ATTRIBUTE_PRIOTIY)
+					| (self->sprite[i].isSpriteZero ? 0x40 : 0);
+			}
+		}
+	}
+
+	for (x = 0; x < NES_SCREEN_WIDTH; x++) {
+		bitmap = background[x + self->vram.x];
+		pixel = sprite[x];
+		/* Same sprite 0 hit conditions as PPU_Draw, x being cycle - 1 */
+		if ((pixel & 0x40) && ((bitmap & 0x03) != 0)
+				&& (((self->PPUMASK >> 3) & 0x03) == 0x03)
+				&& !((x <= 7) && (((self->PPUMASK >> 1) & 0x03) != 0x00))
+				&& (x != 255)
+				&& !((self->PPUSTATUS >> 6) & 0x01)) {
+			self->PPUSTATUS |= PPUSTATUS_SPR_ZERO;
+		}
+		/* Sprite has priority over background or BG pixel is zero */
+		if ((pixel != 0) && (!(pixel & OAM_ATTRIBUTE_PRIOTIY) ||
+					((bitmap & 0x03) == 0))) {
+			color_palette = palette + (pixel & 0x0C) + 0x10;
+			color = pixel & 0x03;
+		} else {
+			color_palette = palette + (bitmap & 0x0C);
+			color = bitmap & 0x03;
+		}
+		image[x] = ((color == 0) ? palette[0] : color_palette[color]) & 0x3F;
+	}
+}
+
+uint16_t PPU_RenderScanline(PPU *self) {
+	uint8_t *pattern;
+	uint16_t dots = CYCLE_CNT;
+
+	STATS_ADD(Mapper_Stats(self->mapper), task[STATS_TASK_SCANLINE], 1);
+
+	/* Idle scanlines or rendering disabled: only flags are updated */
+	if (!VALUE_IN(self->scanline, -1, 239) || !IS_RENDERING_ON()) {
+		if (self->scanline == 0)
+			self->nbFrame++;
+		self->cycle = 1;
+		if (self->scanline == -1)
+			PPU_ClearFlag(self);
+		else if (self->scanline == 241)
+			PPU_SetFlag(self);
+		self->cycle = 340;
+		PPU_UpdateCycle(self);
+		return dots;
+	}
+
+	/* Rendering can't be changed by CPU in the middle of the scanline */
+	pattern = Mapper_Get(self->mapper, AS_LDR, LDR_CHR) +
+		((self->PPUCTRL & PPUCTRL_BG_PT) ? SIZE_PATTERN : 0);
+
+	/* Skip cycle if odd frame */
+	if (self->scanline == 0) {
+		if (self->nbFrame % 2)
+			dots--;
+		self->nbFrame++;
+	}
+
+	/* Clear flags in the second cycle of pre-render line */
+	if (self->scanline == -1) {
+		self->cycle = 1;
+		PPU_ClearFlag(self);
+	}
+
+	/* Clean Secondary OAM, then Sprite Evaluation */
+	for (self->cycle = 1; self->cycle <= 64; self->cycle++)
+		PPU_ClearSecondaryOAM(self);
+	for (; self->cycle <= 256; self->cycle++)
+		PPU_SpriteEvaluation(self);
+
+	/* Fetch background (cycle 8 to 256) and draw it with sprites */
+	PPU_DrawScanline(self);
+
+	/* hori(v) = hori(t), then vert(v) = vert(t) on pre-render scanline */
+	self->cycle = 257;
+	PPU_ManageV(self);
+	if (self->scanline == -1) {
+		self->cycle = 280;
+		PPU_ManageV(self);
+	}
+
+	/* Fetch sprites for next scanline */
+	for (self->cycle = 264; self->cycle <= 320; self->cycle += 8)
+		PPU_FetchSprite(self);
+
+	/* Fetch first two tiles of next scanline */
+	for (self->cycle = 321; self->cycle <= 336; self->cycle++) {
+		PPU_ShiftTile(self);
+		if ((self->cycle % 8) == 0) {
+			PPU_LoadTile(self, pattern);
+			PPU_ManageV(self);
+		}
+	}
+
+	self->cycle = 340;
+	PPU_UpdateCycle(self);
+	return dots;
+}
+
+static void PPU_Dot(PPU *self) {
+	uint16_t action = PPU_Action(self);
+
+#ifdef NES_STATS
+	Stats_Tasks(Mapper_Stats(self->mapper), action);
+#endif
+
+	/* Execute tasks of the dot */
+	if (action) {
+		if (action & ACTION_DRAW)
+			PPU_Draw(self);
+		if (action & ACTION_FETCH_TILE)
+			PPU_FetchTile(self);
+		if (action & ACTION_CLEAR_SOAM)
+			PPU_ClearSecondaryOAM(self);
+		if (action & ACTION_SPRITE_EVAL)
+			PPU_SpriteEvaluation(self);
+		if (action & ACTION_CLEAR_FLAG)
+			PPU_ClearFlag(self);
+		if (action & ACTION_FETCH_SPRITE)
+			PPU_FetchSprite(self);
+		if (action & ACTION_MANAGE_V)
+			PPU_ManageV(self);
+		if (action & ACTION_SET_FLAG)
+			PPU_SetFlag(self);
+	}
+	PPU_UpdateCycle(self);
+}
 
-	Stack_Init(&taskList);
-	PPU_CheckRegister(self);
+static void PPU_Run(PPU *self, uint32_t clock) {
 	while (clock) {
-		PPU_ManageTiming(self, &taskList);
-		while (!Stack_IsEmpty(&taskList)) {
-			/* Execute task */
-			task = Stack_Pop(&taskList);
-			task(self);
+		/* Whole scanline available */
+		if ((self->cycle == 0) && (clock >= CYCLE_CNT)) {
+			clock -= PPU_RenderScanline(self);
+			continue;
 		}
+		PPU_Dot(self);
 		clock--;
-		PPU_UpdateCycle(self);
+	}
+}
+
+uint8_t PPU_Execute(PPU* self, uint8_t *context, uint16_t clock) {
+	PPU_Sync(self);
+	PPU_Run(self, clock);
+	PPU_RefreshRegister(self, context);
+
+	return EXIT_SUCCESS;
+}
+
+uint8_t PPU_Defer(PPU *self, uint8_t *context, uint16_t clock) {
+	/* Registers were handled at time of access, after PPU_Sync */
+	self->pendingDots += clock;
+
+	/* Vertical blank: execute everything */
+	if (PPU_DotsToVBlank(self) == 0) {
+		PPU_Sync(self);
+	} else {
+		/* Complete current scanline, then execute whole scanlines */
+		while (self->cycle != 0 && self->pendingDots) {
+			PPU_Dot(self);
+			self->pendingDots--;
+		}
+		while (self->pendingDots >= CYCLE_CNT)
+			self->pendingDots -= PPU_RenderScanline(self);
 	}
 	PPU_RefreshRegister(self, context);
 
 	return EXIT_SUCCESS;
 }
 
+/* Cycles elapsed on attached clock are to be executed */
+static inline uint32_t PPU_Elapsed(PPU *self) {
+	if (self->clock == NULL)
+		return 0;
+	return (*self->clock - self->clockSynced) * 3;
+}
+
+uint8_t PPU_Sync(PPU *self) {
+	self->pendingDots += PPU_Elapsed(self);
+	if (self->clock != NULL)
+		self->clockSynced = *self->clock;
+	if (self->pendingDots) {
+		PPU_Run(self, self->pendingDots);
+		self->pendingDots = 0;
+		PPU_RefreshData(self);
+	}
+	return EXIT_SUCCESS;
+}
+
+uint8_t PPU_Attach(PPU *self, uint64_t *clock, uint8_t *context) {
+	if ((self == NULL) || (clock == NULL) || (context == NULL))
+		return EXIT_FAILURE;
+	self->clock = clock;
+	self->clockSynced = *clock;
+	self->context = context;
+	return EXIT_SUCCESS;
+}
+
+void PPU_SetTimeline(PPU *self, Timeline *timeline) {
+	self->timeline = timeline;
+}
+
+uint8_t PPU_CatchUp(PPU *self) {
+	if (self->clock == NULL)
+		return EXIT_FAILURE;
+	/* Elapsed cycles are deferred as if they were given by the CPU */
+	self->pendingDots += PPU_Elapsed(self);
+	self->clockSynced = *self->clock;
+	return PPU_Defer(self, self->context, 0);
+}
+
 uint8_t PPU_PictureDrawn(PPU *self) {
 	/* Retrieve information and acknowledge it */
 	uint8_t result = self->pictureDrawn;
@@ -788,10 +1187,88 @@ uint8_t PPU_PictureDrawn(PPU *self) {
 	return result;
 }
 
+uint32_t PPU_DotsToVBlank(PPU *self) {
+	/* Vertical blank starts when cycle 1 of scanline 241 is executed */
+	int32_t dots = (241 - self->scanline) * CYCLE_CNT + (1 - self->cycle);
+	if (dots < 0)
+		dots += SCANLINE_CNT * CYCLE_CNT;
+	uint32_t pending = self->pendingDots + PPU_Elapsed(self);
+	/* Skipped cycle of odd frames may bring it one cycle closer */
+	if (pending >= (uint32_t) dots)
+		return 0;
+	return dots - pending;
+}
+
+#ifdef PPU_CONVERT_SSSE3
+__attribute__((target("ssse3")))
+static uint32_t PPU_ConvertSSSE3(const uint8_t *index, uint32_t *rgb,
+		uint32_t count) {
+	/* Blue, green and red bytes of colors, 16 colors per register */
+	__m128i plane[3][4], color[3], mask;
+	__m128i lowMask = _mm_set1_epi8(0x0F), indexMask = _mm_set1_epi8(0x3F);
+	__m128i idx, low, high, bg, r0;
+	uint8_t bytes[16];
+	uint32_t done = 0;
+	int p, k, i;
+
+	for (p = 0; p < 3; p++) {
+		for (k = 0; k < 4; k++) {
+			for (i = 0; i < 16; i++)
+				bytes[i] = colorPalette[(k << 4) | i] >> (p << 3);
+			plane[p][k] = _mm_loadu_si128((__m128i*) bytes);
+		}
+	}
+
+	for (; (count - done) >= 16; done += 16) {
+		idx = _mm_and_si128(_mm_loadu_si128((__m128i*) (index + done)),
+				indexMask);
+		low = _mm_and_si128(idx, lowMask);
+		high = _mm_and_si128(_mm_srli_epi16(idx, 4), lowMask);
+		/* Look up in each group of 16 colors, keep the matching one */
+		for (p = 0; p < 3; p++) {
+			color[p] = _mm_setzero_si128();
+			for (k = 0; k < 4; k++) {
+				mask = _mm_cmpeq_epi8(high, _mm_set1_epi8(k));
+				color[p] = _mm_or_si128(color[p], _mm_and_si128(mask,
+							_mm_shuffle_epi8(plane[p][k], low)));
+			}
+		}
+		/* Interleave to 0x00RRGGBB */
+		bg = _mm_unpacklo_epi8(color[0], color[1]);
+		r0 = _mm_unpacklo_epi8(color[2], _mm_setzero_si128());
+		_mm_storeu_si128((__m128i*) (rgb + done), _mm_unpacklo_epi16(bg, r0));
+		_mm_storeu_si128((__m128i*) (rgb + done + 4), _mm_unpackhi_epi16(bg, r0));
+		bg = _mm_unpackhi_epi8(color[0], color[1]);
+		r0 = _mm_unpackhi_epi8(color[2], _mm_setzero_si128());
+		_mm_storeu_si128((__m128i*) (rgb + done + 8), _mm_unpacklo_epi16(bg, r0));
+		_mm_storeu_si128((__m128i*) (rgb + done + 12), _mm_unpackhi_epi16(bg, r0));
+	}
+	return done;
+}
+#endif
+
+uint8_t PPU_ConvertImage(PPU *self, uint32_t *rgb) {
+	uint32_t i = 0, count = NES_SCREEN_WIDTH * NES_SCREEN_HEIGTH;
+
+	if ((self == NULL) || (rgb == NULL))
+		return EXIT_FAILURE;
+
+#ifdef PPU_CONVERT_SSSE3
+	if (__builtin_cpu_supports("ssse3"))
+		i = PPU_ConvertSSSE3(self->image, rgb, count);
+#endif
+	/* Remaining pixels, or every pixel if SSSE3 is not available */
+	for (; i < count; i++)
+		rgb[i] = colorPalette[self->image[i] & 0x3F];
+	return EXIT_SUCCESS;
+}
+
 void PPU_Destroy(PPU *self) {
 	if (self == NULL)
 		return;
 	if (self->image != NULL)
-		free(self->image);
-	free(self);
+		Arena_Free(self->arena, self->image);
+	if ((self->tileCache != NULL) && !self->tileShared)
+		Arena_Free(self->arena, self->tileCache);
+	Arena_Free(self->arena, self);
 }
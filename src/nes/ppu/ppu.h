@@ -11,6 +11,7 @@
 
 #include "../mapper/mapper.h"
 #include "../../common/stack.h"
+#include "../timeline/timeline.h"
 
 /**
  * \brief Hold pointer that is used to address VRAM
@@ -56,6 +57,11 @@ typedef struct {
 	uint8_t nbFrame;		/*!< Odd/even frame counter	*/
 	uint8_t nmiSent;		/*!< NMI sent flag			*/
 	uint8_t pictureDrawn;	/*!< Picture drawn flag		*/
+	uint32_t pendingDots;	/*!< Cycles not executed yet*/
+	uint64_t *clock;		/*!< CPU clock to catch up	*/
+	uint64_t clockSynced;	/*!< CPU clock PPU is at	*/
+	uint8_t *context;		/*!< Context to send NMI to	*/
+	Timeline *timeline;		/*!< Scanlines and vertical blanks, NULL if none	*/
 	/* Sprite evaluation */
 	uint8_t OAM[256];		/*!< OAM array				*/
 	uint8_t SOAM[32];		/*!< Secondary OAM array	*/
@@ -64,7 +70,9 @@ typedef struct {
 	uint8_t spriteData;		/*!< Sprite evaluation data */
 	uint8_t spriteZero;		/*!< Sprite zero on scanline*/
 	/* Graphic memory */
-	uint32_t *image;		/*!< Pixel array			*/
+	uint8_t *image;			/*!< Palette index array	*/
+	uint8_t *tileCache;		/*!< Pattern tables, one byte per pixel	*/
+	uint8_t tileShared;		/*!< Tile cache is decoded CHR-ROM of image	*/
 	/* shift registers filled with values from the pattern table */
 	uint16_t bitmapL;		/*!< Tile bitmap low shift-reg	*/
 	uint16_t bitmapH;		/*!< Tile bitmap high shift-reg */
@@ -74,8 +82,14 @@ typedef struct {
 	/* Sprites array for rendering */
 	Sprite sprite[8];		/*!< Sprite rendering registers		*/
 
+	Arena *arena;			/*!< Arena holding PPU, NULL for heap*/
 } PPU;
 
+/**
+ * \brief Palette index of pixels never drawn (black)
+ */
+#define PPU_BLANK_INDEX	0x0F
+
 /**
  * \brief Create instance of PPU
  * \param mapper instance of Mapper
@@ -84,6 +98,25 @@ typedef struct {
  */
 PPU* PPU_Create(Mapper *mapper);
 
+/**
+ * \brief Create instance of PPU in an arena
+ * \param arena arena to allocate from, NULL for heap
+ * \param mapper instance of Mapper
+ *
+ * \return instance of PPU
+ */
+PPU* PPU_CreateIn(Arena *arena, Mapper *mapper);
+
+/**
+ * \brief Arena space needed by PPU_CreateIn
+ *
+ * \param tileShared 1 if mapper gives decoded CHR-ROM (LDR_TIL), 0 if PPU
+ * needs a tile cache of its own
+ *
+ * \return size in bytes
+ */
+size_t PPU_RequiredSize(uint8_t tileShared);
+
 /**
  * \brief Initialize PPU structure
  *
@@ -102,7 +135,133 @@ uint8_t PPU_Init(PPU *self);
  *
  * \return EXIT_SUCCESS if succeed, EXIT_FAILURE otherwise
  */
-uint8_t PPU_Execute(PPU *self, uint8_t *context, uint8_t clock);
+uint8_t PPU_Execute(PPU *self, uint8_t *context, uint16_t clock);
+
+/**
+ * \brief Execute PPU lazily from a given timestamp
+ *
+ * Cycles are accumulated and executed only by whole scanlines (see
+ * PPU_RenderScanline), the remainder is kept for the next call. Everything is
+ * executed when the vertical blank is reached. CPU accesses to registers must
+ * call PPU_Sync beforehand so that they observe the same PPU state as with
+ * PPU_Execute (IOReg does it before calling register handlers).
+ *
+ * \param self instance of PPU
+ * \param context wire through every component
+ * \param clock number of PPU cycle to consumme
+ *
+ * \return EXIT_SUCCESS if succeed, EXIT_FAILURE otherwise
+ */
+uint8_t PPU_Defer(PPU *self, uint8_t *context, uint16_t clock);
+
+/**
+ * \brief Execute cycles kept by PPU_Defer and refresh readable registers
+ *
+ * When PPU is attached to a CPU clock, cycles elapsed since last call are
+ * executed too.
+ *
+ * \param self instance of PPU
+ *
+ * \return EXIT_SUCCESS if succeed, EXIT_FAILURE otherwise
+ */
+uint8_t PPU_Sync(PPU *self);
+
+/**
+ * \brief Drive PPU from the CPU clock instead of explicit cycle counts
+ *
+ * PPU keeps the clock it has been executed up to. CPU can then run freely:
+ * PPU catches up when one of its registers is accessed (PPU_Sync) or when
+ * PPU_CatchUp is called. Enabling NMI while in vertical blank sends it to
+ * context right away. PPU_Execute and PPU_Defer must not be used afterwards,
+ * their cycles would be counted twice.
+ *
+ * \param self instance of PPU
+ * \param clock CPU clock, PPU is considered up to date with its value
+ * \param context wire through every component
+ *
+ * \return EXIT_SUCCESS if succeed, EXIT_FAILURE otherwise
+ */
+uint8_t PPU_Attach(PPU *self, uint64_t *clock, uint8_t *context);
+
+/**
+ * \brief Record scanline boundaries and vertical blanks to a timeline
+ *
+ * As PPU is executed lazily, scanlines show up in bursts of host time, when
+ * PPU catches up with CPU.
+ *
+ * \param self instance of PPU
+ * \param timeline timeline to record to, NULL to stop recording
+ */
+void PPU_SetTimeline(PPU *self, Timeline *timeline);
+
+/**
+ * \brief Execute PPU lazily up to the CPU clock it is attached to
+ *
+ * Same as PPU_Defer, given the cycles elapsed since PPU was last up to date.
+ *
+ * \param self instance of PPU
+ *
+ * \return EXIT_SUCCESS if succeed, EXIT_FAILURE if PPU is not attached
+ */
+uint8_t PPU_CatchUp(PPU *self);
+
+/**
+ * \brief Execute a whole scanline, starting at cycle 0
+ *
+ * Same result as executing every cycle of the scanline through
+ * PPU_ManageTiming, without task scheduling.
+ *
+ * \param self instance of PPU
+ *
+ * \return number of PPU cycles consumed (340 on skipped cycle, 341 otherwise)
+ */
+uint16_t PPU_RenderScanline(PPU *self);
+
+/**
+ * \brief Convert palette indexes of image into 32-bit colors (0x00RRGGBB)
+ *
+ * Color emphasis is not emulated: indexes only use their 6 lower bits.
+ *
+ * \param self instance of PPU
+ * \param rgb array of NES_SCREEN_WIDTH * NES_SCREEN_HEIGTH colors to fill
+ *
+ * \return EXIT_SUCCESS if succeed, EXIT_FAILURE otherwise
+ */
+uint8_t PPU_ConvertImage(PPU *self, uint32_t *rgb);
+
+/**
+ * \brief Merge both bitplanes of a tile, one byte per pixel
+ *
+ * Each row of a tile is expanded to 8 bytes holding the 2-bit pixel values,
+ * so that scanlines are rendered without bitplane shifting.
+ *
+ * \param pixel SIZE_TILE_DECODED bytes to fill
+ * \param chr SIZE_TILE bytes of tile in pattern tables
+ */
+void PPU_ExpandTile(uint8_t *pixel, const uint8_t *chr);
+
+/**
+ * \brief Decode every tile of pattern tables into tile cache
+ *
+ * Nothing is done when tile cache is the decoded CHR-ROM of a shared image,
+ * as it never changes.
+ *
+ * \param self instance of PPU
+ *
+ * \return EXIT_SUCCESS if succeed, EXIT_FAILURE otherwise
+ */
+uint8_t PPU_DecodePattern(PPU *self);
+
+/**
+ * \brief Decode a single tile into tile cache, after it has been written
+ * (CHR-RAM only, decoded CHR-ROM is shared)
+ *
+ * \param self instance of PPU
+ * \param tile index of tile in pattern tables (0 to 511)
+ *
+ * \return EXIT_SUCCESS if succeed, EXIT_FAILURE otherwise
+ */
+uint8_t PPU_DecodeTile(PPU *self, uint16_t tile);
 
 /**
  * \brief Draw a specified nametable into an array
@@ -130,6 +289,17 @@ void PPU_RenderSprites(PPU *self, uint32_t *image);
  */
 uint8_t PPU_PictureDrawn(PPU *self);
 
+/**
+ * \brief Number of PPU cycles that can be executed before the vertical
+ * blank is reached (NMI and picture drawn), cycles kept by PPU_Defer and
+ * elapsed on attached clock included
+ *
+ * \param self instance of PPU
+ *
+ * \return number of PPU cycles, rounded down
+ */
+uint32_t PPU_DotsToVBlank(PPU *self);
+
 /**
  * \brief Increment cycle and scanline
  *
@@ -140,13 +310,23 @@ uint8_t PPU_PictureDrawn(PPU *self);
 uint8_t PPU_UpdateCycle(PPU *self);
 
 /**
- * \brief Update registers in case of access from CPU
+ * \brief Read handler of PPU registers (see IOReg_SetHandler)
  *
- * \param self instance of PPU
+ * \param ppu instance of PPU
+ * \param address address of register read by CPU
  *
- * \return EXIT_SUCCESS if succeed, EXIT_FAILURE otherwise 
+ * \return value read
  */
-uint8_t PPU_CheckRegister(PPU *self); 
+uint8_t PPU_ReadRegister(void *ppu, uint16_t address);
+
+/**
+ * \brief Write handler of PPU registers (see IOReg_SetHandler)
+ *
+ * \param ppu instance of PPU
+ * \param address address of register written by CPU
+ * \param value value written
+ */
+void PPU_WriteRegister(void *ppu, uint16_t address, uint8_t value);
 
 /**
  * \brief Fill a stack FILO with tasks to execute at a specific cycle
@@ -275,5 +455,20 @@ enum StateSpriteEvaluation {
 	STATE_WAIT,					/*!< All sprites has been evaluated */
 };
 
+/**
+ * \brief Tasks to execute on a dot, in order of execution
+ */
+enum PPUAction {
+	ACTION_FRAME		= 0x0001,	/*!< Count frame, skip cycle if odd		*/
+	ACTION_DRAW			= 0x0002,	/*!< PPU_Draw							*/
+	ACTION_FETCH_TILE	= 0x0004,	/*!< PPU_FetchTile						*/
+	ACTION_CLEAR_SOAM	= 0x0008,	/*!< PPU_ClearSecondaryOAM				*/
+	ACTION_SPRITE_EVAL	= 0x0010,	/*!< PPU_SpriteEvaluation				*/
+	ACTION_CLEAR_FLAG	= 0x0020,	/*!< PPU_ClearFlag						*/
+	ACTION_FETCH_SPRITE	= 0x0040,	/*!< PPU_FetchSprite					*/
+	ACTION_MANAGE_V		= 0x0080,	/*!< PPU_ManageV						*/
+	ACTION_SET_FLAG		= 0x0100	/*!< PPU_SetFlag						*/
+};
+
 
 #endif /* PPU_H */
@@ -0,0 +1,202 @@
+#include "profile.h"
+#include <stdlib.h>
+#include <string.h>
+#include "../../common/macro.h"
+
+/* Opcodes entering and leaving a function */
+#define OPCODE_BRK	0x00
+#define OPCODE_JSR	0x20
+#define OPCODE_RTI	0x40
+#define OPCODE_RTS	0x60
+
+Profile* Profile_Create(void) {
+	Profile *self = (Profile*) malloc(sizeof(Profile));
+	if (self == NULL) {
+		ERROR_MSG("can't allocate Profile structure");
+		return NULL;
+	}
+	Profile_Clear(self);
+	return self;
+}
+
+void Profile_Clear(Profile *self) {
+	memset(self, 0, sizeof(Profile));
+	/* Only root exists, it stands for code run from reset */
+	self->nodeCount = 1;
+}
+
+/* Enter function at address, from current function */
+static void Profile_Call(Profile *self, uint16_t address) {
+	uint16_t index;
+
+	/* Too deep, function is merged in caller */
+	if (self->depth >= PROFILE_DEPTH_MAX) {
+		self->merged++;
+		return;
+	}
+
+	/* Same function from same caller has the same node */
+	for (index = self->node[self->current].child; index != 0;
+			index = self->node[index].sibling) {
+		if (self->node[index].address == address)
+			break;
+	}
+	if (index == 0) {
+		/* No node left, function is merged in caller */
+		if (self->nodeCount == PROFILE_NODE_CNT) {
+			self->merged++;
+			return;
+		}
+		index = self->nodeCount++;
+		self->node[index].address = address;
+		self->node[index].parent = self->current;
+		self->node[index].child = 0;
+		self->node[index].sibling = self->node[self->current].child;
+		self->node[index].cycles = 0;
+		self->node[self->current].child = index;
+	}
+	self->current = index;
+	self->depth++;
+}
+
+/* Leave current function, back to its caller */
+static void Profile_Return(Profile *self) {
+	if (self->merged > 0) {
+		self->merged--;
+	} else if (self->current != 0) {
+		self->current = self->node[self->current].parent;
+		self->depth--;
+	}
+}
+
+void Profile_Record(Profile *self, uint16_t pc, uint8_t opcode, uint8_t dma,
+		uint32_t cycles, uint16_t nextPC) {
+	self->pcCycles[pc] += cycles;
+	self->node[self->current].cycles += cycles;
+	self->totalCycles += cycles;
+
+	/* DMA step doesn't execute opcode */
+	if (dma) {
+		self->dmaCycles += cycles;
+		return;
+	}
+	self->opcodeCycles[opcode] += cycles;
+	self->opcodeCount[opcode]++;
+
+	switch (opcode) {
+		case OPCODE_JSR:
+		case OPCODE_BRK:
+			Profile_Call(self, nextPC);
+			break;
+		case OPCODE_RTS:
+		case OPCODE_RTI:
+			Profile_Return(self);
+			break;
+	}
+}
+
+void Profile_Interrupt(Profile *self, uint16_t handler, uint32_t cycles,
+		uint8_t reset) {
+	if (reset) {
+		self->current = 0;
+		self->depth = 0;
+		self->merged = 0;
+	} else
+		Profile_Call(self, handler);
+	self->node[self->current].cycles += cycles;
+	self->interruptCycles += cycles;
+	self->totalCycles += cycles;
+}
+
+/* Entry of a sorted histogram */
+typedef struct {
+	uint32_t index;
+	uint64_t cycles;
+} ProfileEntry;
+
+static int Profile_Compare(const void *a, const void *b) {
+	const ProfileEntry *x = (const ProfileEntry*) a;
+	const ProfileEntry *y = (const ProfileEntry*) b;
+	if (x->cycles != y->cycles)
+		return (x->cycles < y->cycles) ? 1 : -1;
+	/* Lowest index first for equal cycles, qsort is not stable */
+	return (x->index > y->index) ? 1 : -1;
+}
+
+/* Non-zero values of histogram, by decreasing value */
+static uint32_t Profile_Sort(uint64_t *cycles, uint32_t size,
+		ProfileEntry *entry) {
+	uint32_t i, count = 0;
+	for (i = 0; i < size; i++) {
+		if (cycles[i] != 0) {
+			entry[count].index = i;
+			entry[count++].cycles = cycles[i];
+		}
+	}
+	qsort(entry, count, sizeof(ProfileEntry), Profile_Compare);
+	return count;
+}
+
+void Profile_Report(Profile *self, FILE *file, uint32_t top) {
+	ProfileEntry *entry = (ProfileEntry*) malloc(0x10000 *
+			sizeof(ProfileEntry));
+	double total = (self->totalCycles > 0) ? self->totalCycles : 1;
+	uint32_t i, count, op;
+
+	if (entry == NULL) {
+		ERROR_MSG("can't allocate memory for profile report");
+		return;
+	}
+
+	fprintf(file, "cycles: %llu\n", (unsigned long long) self->totalCycles);
+	fprintf(file, "dma: %llu (%.2f%%)\n", (unsigned long long) self->dmaCycles,
+			100.0 * self->dmaCycles / total);
+	fprintf(file, "interrupts: %llu (%.2f%%)\n",
+			(unsigned long long) self->interruptCycles,
+			100.0 * self->interruptCycles / total);
+
+	/* Hottest addresses */
+	count = Profile_Sort(self->pcCycles, 0x10000, entry);
+	if (count > top)
+		count = top;
+	fprintf(file, "\n%-6s %12s %7s\n", "pc", "cycles", "%");
+	for (i = 0; i < count; i++)
+		fprintf(file, "$%04X  %12llu %6.2f%%\n", entry[i].index,
+				(unsigned long long) entry[i].cycles,
+				100.0 * entry[i].cycles / total);
+
+	/* Every opcode executed */
+	count = Profile_Sort(self->opcodeCycles, 256, entry);
+	fprintf(file, "\n%-6s %12s %12s %7s\n", "opcode", "count", "cycles", "%");
+	for (i = 0; i < count; i++) {
+		op = entry[i].index;
+		fprintf(file, "$%02X    %12llu %12llu %6.2f%%\n", op,
+				(unsigned long long) self->opcodeCount[op],
+				(unsigned long long) entry[i].cycles,
+				100.0 * entry[i].cycles / total);
+	}
+
+	free(entry);
+}
+
+void Profile_Collapsed(Profile *self, FILE *file) {
+	uint16_t stack[PROFILE_DEPTH_MAX + 1], node, i;
+	uint8_t depth;
+
+	for (i = 0; i < self->nodeCount; i++) {
+		if (self->node[i].cycles == 0)
+			continue;
+		/* Walk up to root, then print from it */
+		depth = 0;
+		for (node = i; node != 0; node = self->node[node].parent)
+			stack[depth++] = self->node[node].address;
+		fprintf(file, "reset");
+		while (depth > 0)
+			fprintf(file, ";$%04X", stack[--depth]);
+		fprintf(file, " %llu\n", (unsigned long long) self->node[i].cycles);
+	}
+}
+
+void Profile_Destroy(Profile *self) {
+	free(self);
+}
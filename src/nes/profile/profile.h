@@ -0,0 +1,130 @@
+/**
+ * \file profile.h
+ * \brief header file of Profile module
+ * \author Dylan Gageot
+ * \version 1.0
+ * \date 2019-06-28
+ *
+ * Hot spots of emulated code. While a Profile is given to the CPU (see
+ * CPU_SetProfile), cycles of every instruction are added to the address it
+ * was fetched from, to its opcode and to the guest function running it.
+ * Nothing is written until a report is asked for.
+ *
+ * Guest call stacks are rebuilt from JSR and BRK (or interrupts) that enter
+ * a function and RTS and RTI that leave it. Functions are named after their
+ * entry address. Code that plays with the stack (pushing a return address
+ * and executing RTS to jump) makes stacks less accurate, not the per-address
+ * and per-opcode figures.
+ */
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * \brief Maximum number of distinct call stacks
+ */
+#define PROFILE_NODE_CNT	4096
+
+/**
+ * \brief Maximum depth of a call stack, deeper calls are merged in caller
+ */
+#define PROFILE_DEPTH_MAX	64
+
+/**
+ * \brief Node of call tree, a function reached through a call stack
+ */
+typedef struct {
+	uint16_t address;				/*!< Entry of function				*/
+	uint16_t parent;				/*!< Caller							*/
+	uint16_t child;					/*!< First callee, 0 if none		*/
+	uint16_t sibling;				/*!< Next callee of caller			*/
+	uint64_t cycles;				/*!< Cycles spent in function itself*/
+} ProfileNode;
+
+/**
+ * \brief Hold histograms and call tree
+ */
+typedef struct {
+	/* Histograms */
+	uint64_t pcCycles[0x10000];		/*!< Cycles of every address		*/
+	uint64_t opcodeCycles[256];		/*!< Cycles of every opcode			*/
+	uint64_t opcodeCount[256];		/*!< Executions of every opcode		*/
+	uint64_t dmaCycles;				/*!< Cycles of OAM DMA				*/
+	uint64_t interruptCycles;		/*!< Cycles of interrupt entries	*/
+	uint64_t totalCycles;			/*!< Cycles recorded				*/
+	/* Call tree, node 0 is the root (reset) */
+	ProfileNode node[PROFILE_NODE_CNT];	/*!< Nodes of call tree			*/
+	uint16_t nodeCount;				/*!< Number of nodes used			*/
+	uint16_t current;				/*!< Node of running function		*/
+	uint8_t depth;					/*!< Depth of current node			*/
+	uint32_t merged;				/*!< Calls merged in caller, running*/
+} Profile;
+
+/**
+ * \brief Create an empty profile
+ *
+ * \return instance of Profile, NULL if an error occured
+ */
+Profile* Profile_Create(void);
+
+/**
+ * \brief Forget everything recorded
+ *
+ * \param self instance of Profile
+ */
+void Profile_Clear(Profile *self);
+
+/**
+ * \brief Record an executed instruction or DMA step
+ *
+ * \param self instance of Profile
+ * \param pc address of opcode
+ * \param opcode opcode executed
+ * \param dma 1 if a DMA step was executed instead of opcode
+ * \param cycles cycles used
+ * \param nextPC value of PC after execution
+ */
+void Profile_Record(Profile *self, uint16_t pc, uint8_t opcode, uint8_t dma,
+		uint32_t cycles, uint16_t nextPC);
+
+/**
+ * \brief Record an interrupt taken
+ *
+ * \param self instance of Profile
+ * \param handler address of interrupt handler
+ * \param cycles cycles used to enter handler
+ * \param reset 1 if interrupt is a reset, that empties call stack
+ */
+void Profile_Interrupt(Profile *self, uint16_t handler, uint32_t cycles,
+		uint8_t reset);
+
+/**
+ * \brief Print hottest addresses and every opcode executed, by decreasing
+ * cycles
+ *
+ * \param self instance of Profile
+ * \param file stream to print to
+ * \param top number of addresses to print
+ */
+void Profile_Report(Profile *self, FILE *file, uint32_t top);
+
+/**
+ * \brief Print call stacks in collapsed format ("reset;$C0F3;$C123 42" per
+ * line), as flame graph tools read it
+ *
+ * \param self instance of Profile
+ * \param file stream to print to
+ */
+void Profile_Collapsed(Profile *self, FILE *file);
+
+/**
+ * \brief Free profile
+ *
+ * \param self instance of Profile
+ */
+void Profile_Destroy(Profile *self);
+
+#endif /* PROFILE_H */
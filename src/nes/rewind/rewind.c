@@ -0,0 +1,229 @@
+#include "rewind.h"
+#include "../../common/macro.h"
+#include <stdlib.h>
+#include <string.h>
+
+Rewind* Rewind_Create(uint32_t budget, uint32_t frameCount) {
+	if ((budget < REWIND_BUDGET_MIN) || (frameCount == 0)) {
+		ERROR_MSG("rewind budget or frame count too small");
+		return NULL;
+	}
+
+	Rewind *self = (Rewind*) malloc(sizeof(Rewind));
+	if (self == NULL) {
+		ERROR_MSG("can't allocate Rewind structure");
+		return NULL;
+	}
+
+	self->buffer = (uint8_t*) malloc(budget);
+	self->entry = (RewindEntry*) malloc(frameCount * sizeof(RewindEntry));
+	/* Parts of state a NES leaves untouched (CHR-ROM) stay zero */
+	self->state = (NESState*) calloc(1, sizeof(NESState));
+	self->reference = (NESState*) calloc(1, sizeof(NESState));
+	self->encoded = (uint8_t*) malloc(REWIND_ENCODE_MAX(sizeof(NESState)));
+	if ((self->buffer == NULL) || (self->entry == NULL) ||
+			(self->state == NULL) || (self->reference == NULL) ||
+			(self->encoded == NULL)) {
+		ERROR_MSG("can't allocate memory for Rewind");
+		Rewind_Destroy(self);
+		return NULL;
+	}
+
+	/* Ring is empty */
+	self->budget = budget;
+	self->capacity = frameCount;
+	self->head = self->first = self->end = self->keyframe = 0;
+
+	return self;
+}
+
+/* Drop oldest entry, and following ones as long as they need its keyframe */
+static void Rewind_DropOldest(Rewind *self) {
+	do {
+		self->first++;
+	} while ((self->first != self->end) &&
+			(self->entry[self->first % self->capacity].keyframe == 0));
+	if (self->first == self->end)
+		self->head = 0;
+}
+
+/* Does any entry lie in [offset, offset + size)? */
+static uint8_t Rewind_Overlaps(Rewind *self, uint32_t offset, uint32_t size) {
+	RewindEntry *entry;
+	uint32_t serial;
+	for (serial = self->first; serial != self->end; serial++) {
+		entry = self->entry + (serial % self->capacity);
+		if ((entry->offset < offset + size) &&
+				(offset < entry->offset + entry->size))
+			return 1;
+	}
+	return 0;
+}
+
+uint8_t Rewind_Push(Rewind *self, NES *nes) {
+	RewindEntry *entry;
+	uint32_t size, offset;
+	uint8_t keyframe;
+	if ((self == NULL) || (NES_SaveState(nes, self->state) == EXIT_FAILURE))
+		return EXIT_FAILURE;
+
+	keyframe = (self->first == self->end) ||
+		(self->end - self->keyframe >= REWIND_KEYFRAME_INTERVAL);
+	while (1) {
+		size = Rewind_Encode((uint8_t*) self->state,
+				keyframe ? NULL : (uint8_t*) self->reference,
+				sizeof(NESState), self->encoded);
+
+		/* Make room: one more entry, and size bytes after the newest one */
+		if (self->end - self->first == self->capacity)
+			Rewind_DropOldest(self);
+		offset = (self->head + size > self->budget) ? 0 : self->head;
+		while ((self->first != self->end) &&
+				Rewind_Overlaps(self, offset, size))
+			Rewind_DropOldest(self);
+
+		/* Keyframe of this delta may have been dropped: store a keyframe */
+		if (keyframe || (self->keyframe - self->first <
+					self->end - self->first))
+			break;
+		keyframe = 1;
+	}
+
+	memcpy(self->buffer + offset, self->encoded, size);
+	entry = self->entry + (self->end % self->capacity);
+	entry->offset = offset;
+	entry->size = size;
+	entry->keyframe = keyframe;
+	if (keyframe) {
+		self->keyframe = self->end;
+		memcpy(self->reference, self->state, sizeof(NESState));
+	}
+	self->end++;
+	self->head = offset + size;
+
+	return EXIT_SUCCESS;
+}
+
+uint8_t Rewind_Pop(Rewind *self, NES *nes) {
+	RewindEntry *entry;
+	if ((self == NULL) || (self->first == self->end))
+		return EXIT_FAILURE;
+
+	/* Restore newest entry */
+	entry = self->entry + ((self->end - 1) % self->capacity);
+	if (Rewind_Decode(self->buffer + entry->offset, entry->size,
+				entry->keyframe ? NULL : (uint8_t*) self->reference,
+				sizeof(NESState), (uint8_t*) self->state) == EXIT_FAILURE)
+		return EXIT_FAILURE;
+	if (NES_LoadState(nes, self->state) == EXIT_FAILURE)
+		return EXIT_FAILURE;
+
+	/* Its space can be reused */
+	self->end--;
+	self->head = entry->offset;
+
+	/* Previous entries refer to previous keyframe */
+	if (entry->keyframe && (self->first != self->end)) {
+		do {
+			self->keyframe--;
+			entry = self->entry + (self->keyframe % self->capacity);
+		} while (entry->keyframe == 0);
+		if (Rewind_Decode(self->buffer + entry->offset, entry->size, NULL,
+					sizeof(NESState), (uint8_t*) self->reference)
+				== EXIT_FAILURE)
+			return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
+
+uint32_t Rewind_Count(Rewind *self) {
+	if (self == NULL)
+		return 0;
+	return self->end - self->first;
+}
+
+/* XOR of data against reference at given index */
+#define REWIND_XOR(index)	\
+	(data[index] ^ ((reference != NULL) ? reference[index] : 0))
+
+uint32_t Rewind_Encode(const uint8_t *data, const uint8_t *reference,
+		uint32_t size, uint8_t *encoded) {
+	uint32_t i = 0, length = 0, start, j;
+	uint16_t zero, literal;
+
+	while (i < size) {
+		/* Unchanged bytes */
+		zero = 0;
+		while ((i < size) && (zero < 0xFFFF) && (REWIND_XOR(i) == 0)) {
+			zero++;
+			i++;
+		}
+		if (i == size)
+			break;
+		/* Changed bytes, up to 4 unchanged bytes in a row */
+		start = i;
+		literal = 0;
+		while ((i < size) && (literal < 0xFFFF)) {
+			if ((REWIND_XOR(i) == 0) &&
+					((i + 1 >= size) || (REWIND_XOR(i + 1) == 0)) &&
+					((i + 2 >= size) || (REWIND_XOR(i + 2) == 0)) &&
+					((i + 3 >= size) || (REWIND_XOR(i + 3) == 0)))
+				break;
+			literal++;
+			i++;
+		}
+		encoded[length++] = zero & 0xFF;
+		encoded[length++] = zero >> 8;
+		encoded[length++] = literal & 0xFF;
+		encoded[length++] = literal >> 8;
+		for (j = start; j < start + literal; j++)
+			encoded[length++] = REWIND_XOR(j);
+	}
+
+	return length;
+}
+
+uint8_t Rewind_Decode(const uint8_t *encoded, uint32_t length,
+		const uint8_t *reference, uint32_t size, uint8_t *data) {
+	uint32_t i = 0, r = 0, j;
+	uint16_t zero, literal;
+
+	while (r < length) {
+		if (r + 4 > length)
+			return EXIT_FAILURE;
+		zero = encoded[r] | (encoded[r + 1] << 8);
+		literal = encoded[r + 2] | (encoded[r + 3] << 8);
+		r += 4;
+		if ((i + zero + literal > size) || (r + literal > length))
+			return EXIT_FAILURE;
+		/* Unchanged bytes */
+		if (reference != NULL)
+			memcpy(data + i, reference + i, zero);
+		else
+			memset(data + i, 0, zero);
+		i += zero;
+		/* Changed bytes */
+		for (j = 0; j < literal; j++, i++)
+			data[i] = encoded[r++] ^ ((reference != NULL) ? reference[i] : 0);
+	}
+
+	/* Trailing unchanged bytes */
+	if (reference != NULL)
+		memcpy(data + i, reference + i, size - i);
+	else
+		memset(data + i, 0, size - i);
+
+	return EXIT_SUCCESS;
+}
+
+void Rewind_Destroy(Rewind *self) {
+	if (self == NULL)
+		return;
+	free(self->buffer);
+	free(self->entry);
+	free(self->state);
+	free(self->reference);
+	free(self->encoded);
+	free(self);
+}
@@ -0,0 +1,141 @@
+/**
+ * \file rewind.h
+ * \brief header file of Rewind module
+ * \author Dylan Gageot
+ * \version 1.0
+ * \date 2019-06-18
+ *
+ * Keep the last frames of a NES in a ring of fixed size. Every
+ * REWIND_KEYFRAME_INTERVAL frames, a keyframe is stored. Other frames are
+ * stored as a XOR delta against their keyframe. Both are run-length encoded,
+ * so that unchanged bytes (most of the state) cost nothing.
+ *
+ * Encoded entry is a sequence of (zero run, literal count, literals), both
+ * counts being 16-bit little-endian. Bytes not covered by the sequence are
+ * zero.
+ */
+
+#ifndef REWIND_H
+#define REWIND_H
+
+#include "../nes.h"
+
+/**
+ * \brief Number of frames between two keyframes
+ */
+#define REWIND_KEYFRAME_INTERVAL	60
+
+/**
+ * \brief Worst case size of an encoded entry of given size
+ */
+#define REWIND_ENCODE_MAX(size)		((size) + 4 * ((size) / 0xFFFF + 2))
+
+/**
+ * \brief Smallest budget, so that any keyframe fits in ring
+ */
+#define REWIND_BUDGET_MIN			REWIND_ENCODE_MAX(sizeof(NESState))
+
+/**
+ * \brief Position of an entry in ring
+ */
+typedef struct {
+	uint32_t offset;				/*!< Offset in ring buffer			*/
+	uint32_t size;					/*!< Encoded size					*/
+	uint8_t keyframe;				/*!< Entry is a keyframe			*/
+} RewindEntry;
+
+/**
+ * \brief Hold rewind ring
+ */
+typedef struct {
+	/* Ring of encoded entries */
+	uint8_t *buffer;				/*!< Ring buffer					*/
+	uint32_t budget;				/*!< Size of ring buffer			*/
+	uint32_t head;					/*!< Next write offset				*/
+	RewindEntry *entry;				/*!< Entries, by serial % capacity	*/
+	uint32_t capacity;				/*!< Maximum number of entries		*/
+	uint32_t first;					/*!< Serial of oldest entry			*/
+	uint32_t end;					/*!< Serial of next entry			*/
+	uint32_t keyframe;				/*!< Serial of newest keyframe		*/
+	/* Scratch memory */
+	NESState *state;				/*!< State being saved or restored	*/
+	NESState *reference;			/*!< Newest keyframe, decoded		*/
+	uint8_t *encoded;				/*!< Entry being encoded			*/
+} Rewind;
+
+/**
+ * \brief Allocate a rewind ring
+ *
+ * Memory used is the budget plus three states, whatever the frame count.
+ *
+ * \param budget size of ring buffer in bytes, at least REWIND_BUDGET_MIN
+ * \param frameCount maximum number of frames kept
+ *
+ * \return instance of Rewind allocated, NULL if failed
+ */
+Rewind* Rewind_Create(uint32_t budget, uint32_t frameCount);
+
+/**
+ * \brief Save state of NES as newest entry, dropping oldest ones if needed
+ *
+ * \param self instance of Rewind
+ * \param nes instance of NES
+ *
+ * \return EXIT_SUCCESS if succeed, EXIT_FAILURE otherwise
+ */
+uint8_t Rewind_Push(Rewind *self, NES *nes);
+
+/**
+ * \brief Restore NES from newest entry and remove it
+ *
+ * \param self instance of Rewind
+ * \param nes instance of NES
+ *
+ * \return EXIT_SUCCESS if succeed, EXIT_FAILURE if ring is empty
+ */
+uint8_t Rewind_Pop(Rewind *self, NES *nes);
+
+/**
+ * \brief Number of frames that can be rewound
+ *
+ * \param self instance of Rewind
+ *
+ * \return number of entries in ring
+ */
+uint32_t Rewind_Count(Rewind *self);
+
+/**
+ * \brief XOR given data against reference and run-length encode it
+ *
+ * \param data data to encode
+ * \param reference data to XOR with, NULL for none
+ * \param size size of data and reference
+ * \param encoded output, at least REWIND_ENCODE_MAX(size) bytes
+ *
+ * \return encoded size
+ */
+uint32_t Rewind_Encode(const uint8_t *data, const uint8_t *reference,
+		uint32_t size, uint8_t *encoded);
+
+/**
+ * \brief Decode data encoded by Rewind_Encode
+ *
+ * \param encoded encoded data
+ * \param length encoded size
+ * \param reference data to XOR with, NULL for none
+ * \param size size of data and reference
+ * \param data output of size bytes
+ *
+ * \return EXIT_SUCCESS if succeed, EXIT_FAILURE if encoded data is corrupted
+ */
+uint8_t Rewind_Decode(const uint8_t *encoded, uint32_t length,
+		const uint8_t *reference, uint32_t size, uint8_t *data);
+
+/**
+ * \brief Free rewind ring
+ *
+ * \param self instance of Rewind
+ */
+void Rewind_Destroy(Rewind *self);
+
+#endif /* REWIND_H */
@@ -0,0 +1,123 @@
+#include "scheduler.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include "../../common/macro.h"
+
+Scheduler* Scheduler_Create(void) {
+	return Scheduler_CreateIn(NULL);
+}
+
+Scheduler* Scheduler_CreateIn(Arena *arena) {
+	Scheduler *self = (Scheduler*) Arena_Alloc(arena, sizeof(Scheduler));
+	if (self == NULL) {
+		ERROR_MSG("can't allocate Scheduler structure");
+		return NULL;
+	}
+
+	uint8_t i;
+	for (i = 0; i < SCHED_EVENT_CNT; i++) {
+		self->time[i] = SCHED_NEVER;
+		self->index[i] = -1;
+	}
+	self->count = 0;
+	self->arena = arena;
+	return self;
+}
+
+size_t Scheduler_RequiredSize(void) {
+	return ARENA_SIZE(sizeof(Scheduler));
+}
+
+/* Put event at a position of heap */
+static inline void Scheduler_Place(Scheduler *self, uint8_t position,
+		uint8_t event) {
+	self->heap[position] = event;
+	self->index[event] = position;
+}
+
+/* Move event up while it is earlier than its parent */
+static void Scheduler_Up(Scheduler *self, uint8_t position) {
+	uint8_t event = self->heap[position], parent;
+	while (position > 0) {
+		parent = (position - 1) / 2;
+		if (self->time[self->heap[parent]] <= self->time[event])
+			break;
+		Scheduler_Place(self, position, self->heap[parent]);
+		position = parent;
+	}
+	Scheduler_Place(self, position, event);
+}
+
+/* Move event down while one of its children is earlier */
+static void Scheduler_Down(Scheduler *self, uint8_t position) {
+	uint8_t event = self->heap[position], child;
+	while ((child = 2 * position + 1) < self->count) {
+		if ((child + 1 < self->count) && (self->time[self->heap[child + 1]] <
+					self->time[self->heap[child]]))
+			child++;
+		if (self->time[event] <= self->time[self->heap[child]])
+			break;
+		Scheduler_Place(self, position, self->heap[child]);
+		position = child;
+	}
+	Scheduler_Place(self, position, event);
+}
+
+uint8_t Scheduler_Set(Scheduler *self, uint8_t event, uint64_t time) {
+	if ((self == NULL) || (event >= SCHED_EVENT_CNT) || (time == SCHED_NEVER))
+		return EXIT_FAILURE;
+
+	/* New event goes at the bottom, a scheduled one may go either way */
+	if (self->index[event] < 0)
+		Scheduler_Place(self, self->count++, event);
+	self->time[event] = time;
+	Scheduler_Up(self, self->index[event]);
+	Scheduler_Down(self, self->index[event]);
+	return EXIT_SUCCESS;
+}
+
+uint8_t Scheduler_Cancel(Scheduler *self, uint8_t event) {
+	if ((self == NULL) || (event >= SCHED_EVENT_CNT))
+		return EXIT_FAILURE;
+	if (self->index[event] < 0)
+		return EXIT_SUCCESS;
+
+	/* Last event of heap takes its place */
+	uint8_t position = self->index[event];
+	self->time[event] = SCHED_NEVER;
+	self->index[event] = -1;
+	if (position != --self->count) {
+		uint8_t moved = self->heap[self->count];
+		Scheduler_Place(self, position, moved);
+		Scheduler_Up(self, position);
+		Scheduler_Down(self, self->index[moved]);
+	}
+	return EXIT_SUCCESS;
+}
+
+uint64_t Scheduler_Time(Scheduler *self, uint8_t event) {
+	if ((self == NULL) || (event >= SCHED_EVENT_CNT))
+		return SCHED_NEVER;
+	return self->time[event];
+}
+
+uint64_t Scheduler_Next(Scheduler *self) {
+	if ((self == NULL) || (self->count == 0))
+		return SCHED_NEVER;
+	return self->time[self->heap[0]];
+}
+
+int8_t Scheduler_Pop(Scheduler *self, uint64_t clock) {
+	if ((self == NULL) || (self->count == 0) ||
+			(self->time[self->heap[0]] > clock))
+		return -1;
+
+	uint8_t event = self->heap[0];
+	Scheduler_Cancel(self, event);
+	return event;
+}
+
+void Scheduler_Destroy(Scheduler *self) {
+	if (self != NULL)
+		Arena_Free(self->arena, self);
+}
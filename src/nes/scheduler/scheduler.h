@@ -0,0 +1,134 @@
+/**
+ * \file scheduler.h
+ * \brief header file of Scheduler module
+ * \author Dylan Gageot
+ * \version 1.0
+ * \date 2019-06-27
+ *
+ * Timeline of events, timestamped on the 64-bit master clock (CPU cycles).
+ * Components run freely up to the next event instead of being stepped after
+ * every instruction. Each event is scheduled at most once: scheduling it
+ * again moves it. Events are kept in a binary min-heap, so that the next one
+ * is known at once whatever their number.
+ */
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stdint.h>
+#include "../../common/arena.h"
+
+/**
+ * \brief PPU reaches the vertical blank (NMI and picture drawn)
+ */
+#define SCHED_VBLANK		0
+
+/**
+ * \brief Interrupt request line is asserted (mapper or APU counters)
+ */
+#define SCHED_IRQ			1
+
+/**
+ * \brief Number of events
+ */
+#define SCHED_EVENT_CNT		2
+
+/**
+ * \brief Timestamp of an event that is not scheduled
+ */
+#define SCHED_NEVER			UINT64_MAX
+
+/**
+ * \brief Hold events waiting for their time
+ */
+typedef struct {
+	uint64_t time[SCHED_EVENT_CNT];	/*!< Timestamp of each event		*/
+	uint8_t heap[SCHED_EVENT_CNT];	/*!< Scheduled events, earliest first*/
+	int8_t index[SCHED_EVENT_CNT];	/*!< Position in heap, -1 if none	*/
+	uint8_t count;					/*!< Number of scheduled events		*/
+	Arena *arena;					/*!< Arena holding it, NULL for heap*/
+} Scheduler;
+
+/**
+ * \brief Create instance of Scheduler, without any event
+ *
+ * \return instance of Scheduler, NULL if failed
+ */
+Scheduler* Scheduler_Create(void);
+
+/**
+ * \brief Create instance of Scheduler in an arena
+ *
+ * \param arena arena to allocate from, NULL for heap
+ *
+ * \return instance of Scheduler, NULL if failed
+ */
+Scheduler* Scheduler_CreateIn(Arena *arena);
+
+/**
+ * \brief Arena space needed by Scheduler_CreateIn
+ *
+ * \return size in bytes
+ */
+size_t Scheduler_RequiredSize(void);
+
+/**
+ * \brief Schedule an event, or move it if already scheduled
+ *
+ * \param self instance of Scheduler
+ * \param event event to schedule (SCHED_*)
+ * \param time master clock at which it happens
+ *
+ * \return EXIT_SUCCESS if succeed, EXIT_FAILURE otherwise
+ */
+uint8_t Scheduler_Set(Scheduler *self, uint8_t event, uint64_t time);
+
+/**
+ * \brief Remove an event from the timeline, if scheduled
+ *
+ * \param self instance of Scheduler
+ * \param event event to remove (SCHED_*)
+ *
+ * \return EXIT_SUCCESS if succeed, EXIT_FAILURE otherwise
+ */
+uint8_t Scheduler_Cancel(Scheduler *self, uint8_t event);
+
+/**
+ * \brief Timestamp of an event
+ *
+ * \param self instance of Scheduler
+ * \param event event to look for (SCHED_*)
+ *
+ * \return master clock of event, SCHED_NEVER if not scheduled
+ */
+uint64_t Scheduler_Time(Scheduler *self, uint8_t event);
+
+/**
+ * \brief Timestamp of the earliest event
+ *
+ * \param self instance of Scheduler
+ *
+ * \return master clock of next event, SCHED_NEVER if there is none
+ */
+uint64_t Scheduler_Next(Scheduler *self);
+
+/**
+ * \brief Remove the earliest event if it is due
+ *
+ * Events due at the same time are given in any order.
+ *
+ * \param self instance of Scheduler
+ * \param clock current master clock
+ *
+ * \return event removed (SCHED_*), -1 if none is due
+ */
+int8_t Scheduler_Pop(Scheduler *self, uint64_t clock);
+
+/**
+ * \brief Free instance of Scheduler
+ *
+ * \param self instance of Scheduler
+ */
+void Scheduler_Destroy(Scheduler *self);
+
+#endif /* SCHEDULER_H */
@@ -0,0 +1,149 @@
+#include "stats.h"
+#include <string.h>
+#include <time.h>
+#include "../mapper/mapper.h"
+#include "../../common/macro.h"
+
+/* Names of counters, in order of columns */
+static const char *regionName[STATS_REGION_CNT] = {
+	"ram", "io", "expansion", "sram", "prgrom", "pattern", "nametable",
+	"palette", "loader"
+};
+
+static const char *taskName[STATS_TASK_CNT] = {
+	"frame", "draw", "fetch_tile", "clear_soam", "sprite_eval", "clear_flag",
+	"fetch_sprite", "manage_v", "set_flag", "scanline"
+};
+
+static uint64_t Stats_Now(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t) now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+void Stats_Begin(Stats *self, uint64_t frame) {
+	memset(self, 0, sizeof(Stats));
+	self->frame = frame;
+	self->start = Stats_Now();
+}
+
+void Stats_End(Stats *self, uint64_t cycles) {
+	self->ns = Stats_Now() - self->start;
+	self->cycles = cycles;
+}
+
+void Stats_Get(Stats *self, uint8_t space, uint16_t address) {
+	uint8_t region;
+
+	if (self == NULL)
+		return;
+	switch (space & 0x0F) {
+		case AS_CPU:
+			if (VALUE_INF(address, 0x1FFF))
+				region = STATS_RAM;
+			else if (VALUE_INF(address, 0x401F))
+				region = STATS_IO;
+			else if (VALUE_INF(address, 0x5FFF))
+				region = STATS_EXPANSION;
+			else if (VALUE_INF(address, 0x7FFF))
+				region = STATS_SRAM;
+			else
+				region = STATS_PRGROM;
+			break;
+		case AS_PPU:
+			address &= 0x3FFF;
+			if (VALUE_INF(address, 0x1FFF))
+				region = STATS_PATTERN;
+			else if (VALUE_INF(address, 0x3EFF))
+				region = STATS_NAMETABLE;
+			else
+				region = STATS_PALETTE;
+			break;
+		default:
+			region = STATS_LOADER;
+			break;
+	}
+	self->get[region]++;
+}
+
+void Stats_Tasks(Stats *self, uint16_t action) {
+	uint8_t i;
+
+	if (self == NULL)
+		return;
+	/* Bit i of action is task i */
+	for (i = 0; action != 0; i++, action >>= 1)
+		if (action & 1)
+			self->task[i]++;
+}
+
+uint8_t Stats_Format(const char *filename) {
+	size_t length = strlen(filename);
+	if ((length >= 5) && (strcmp(filename + length - 5, ".json") == 0))
+		return STATS_JSON;
+	return STATS_CSV;
+}
+
+/* Print a counter: its name for CSV header, its value for CSV line, both
+ * for JSON */
+static void Stats_Field(FILE *file, uint8_t format, uint8_t header,
+		uint16_t *column, const char *name, uint64_t value) {
+	if (format == STATS_JSON)
+		fprintf(file, "%s\"%s\":%llu", (*column == 0) ? "{" : ",", name,
+				(unsigned long long) value);
+	else if (header)
+		fprintf(file, "%s%s", (*column == 0) ? "" : ",", name);
+	else
+		fprintf(file, "%s%llu", (*column == 0) ? "" : ",",
+				(unsigned long long) value);
+	(*column)++;
+}
+
+/* Print every counter in order of columns */
+static void Stats_Fields(const Stats *self, FILE *file, uint8_t format,
+		uint8_t header) {
+	uint16_t column = 0;
+	char name[32];
+	uint8_t i;
+
+	Stats_Field(file, format, header, &column, "frame", self->frame);
+	Stats_Field(file, format, header, &column, "ns", self->ns);
+	Stats_Field(file, format, header, &column, "cycles", self->cycles);
+	Stats_Field(file, format, header, &column, "instructions",
+			self->instructions);
+	Stats_Field(file, format, header, &column, "blocks", self->blocks);
+	Stats_Field(file, format, header, &column, "dma", self->dma);
+	Stats_Field(file, format, header, &column, "nmi", self->nmi);
+	for (i = 0; i < STATS_REGION_CNT; i++) {
+		snprintf(name, sizeof(name), "get_%s", regionName[i]);
+		Stats_Field(file, format, header, &column, name, self->get[i]);
+	}
+	/* Registers are named after their address, bank 1 then bank 2 */
+	for (i = 0; i < STATS_IOREG_CNT; i++) {
+		snprintf(name, sizeof(name), "rd_%04X",
+				(i < 8) ? 0x2000 + i : 0x4000 + i - 8);
+		Stats_Field(file, format, header, &column, name, self->read[i]);
+	}
+	for (i = 0; i < STATS_IOREG_CNT; i++) {
+		snprintf(name, sizeof(name), "wr_%04X",
+				(i < 8) ? 0x2000 + i : 0x4000 + i - 8);
+		Stats_Field(file, format, header, &column, name, self->write[i]);
+	}
+	for (i = 0; i < STATS_TASK_CNT; i++) {
+		snprintf(name, sizeof(name), "task_%s", taskName[i]);
+		Stats_Field(file, format, header, &column, name, self->task[i]);
+	}
+	fprintf(file, (format == STATS_JSON) ? "}\n" : "\n");
+}
+
+void Stats_PrintHeader(FILE *file, uint8_t format) {
+	Stats empty;
+	if (format == STATS_JSON)
+		return;
+	memset(&empty, 0, sizeof(Stats));
+	Stats_Fields(&empty, file, format, 1);
+}
+
+void Stats_Print(const Stats *self, FILE *file, uint8_t format) {
+	Stats_Fields(self, file, format, 0);
+}
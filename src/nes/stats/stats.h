@@ -0,0 +1,160 @@
+/**
+ * \file stats.h
+ * \brief header file of Stats module
+ * \author Dylan Gageot
+ * \version 1.0
+ * \date 2019-06-28
+ *
+ * Counters of what the emulator core does during a frame: instructions,
+ * memory accesses by region, IO register accesses, PPU tasks, OAM DMA
+ * transfers and NMIs, along with wall time of the frame. They are only
+ * counted when built with NES_STATS, otherwise counting compiles to nothing.
+ * NES clears them at the start of every frame, see NES_GetStats.
+ *
+ * CPU accesses are counted whether they hit the page tables of Mapper or
+ * not, PPU and loader accesses when they go through Mapper_Get. Accesses of
+ * code translated by the dynamic recompiler, opcode fetches served by the
+ * instruction cache and pattern reads served by the tile cache of PPU are
+ * not counted.
+ */
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * \brief Number of IO registers, as IOREG_CNT
+ */
+#define STATS_IOREG_CNT	40
+
+/**
+ * \brief Regions of address spaces of counted accesses
+ */
+enum StatsRegion {
+	STATS_RAM = 0,			/*!< CPU 0x0000-0x1FFF				*/
+	STATS_IO,				/*!< CPU 0x2000-0x401F				*/
+	STATS_EXPANSION,		/*!< CPU 0x4020-0x5FFF				*/
+	STATS_SRAM,				/*!< CPU 0x6000-0x7FFF				*/
+	STATS_PRGROM,			/*!< CPU 0x8000-0xFFFF				*/
+	STATS_PATTERN,			/*!< PPU 0x0000-0x1FFF				*/
+	STATS_NAMETABLE,		/*!< PPU 0x2000-0x3EFF				*/
+	STATS_PALETTE,			/*!< PPU 0x3F00-0x3FFF				*/
+	STATS_LOADER,			/*!< Loader special access			*/
+	STATS_REGION_CNT
+};
+
+/**
+ * \brief PPU tasks, one per bit of PPUAction then whole scanlines
+ */
+enum StatsTask {
+	STATS_TASK_FRAME = 0,	/*!< ACTION_FRAME					*/
+	STATS_TASK_DRAW,		/*!< ACTION_DRAW					*/
+	STATS_TASK_FETCH_TILE,	/*!< ACTION_FETCH_TILE				*/
+	STATS_TASK_CLEAR_SOAM,	/*!< ACTION_CLEAR_SOAM				*/
+	STATS_TASK_SPRITE_EVAL,	/*!< ACTION_SPRITE_EVAL				*/
+	STATS_TASK_CLEAR_FLAG,	/*!< ACTION_CLEAR_FLAG				*/
+	STATS_TASK_FETCH_SPRITE,/*!< ACTION_FETCH_SPRITE			*/
+	STATS_TASK_MANAGE_V,	/*!< ACTION_MANAGE_V				*/
+	STATS_TASK_SET_FLAG,	/*!< ACTION_SET_FLAG				*/
+	STATS_TASK_SCANLINE,	/*!< PPU_RenderScanline, at once	*/
+	STATS_TASK_CNT
+};
+
+/**
+ * \brief Format of dumped counters
+ */
+enum StatsFormat {
+	STATS_CSV = 0,			/*!< Header line, then a line per frame	*/
+	STATS_JSON				/*!< A JSON object per line				*/
+};
+
+/**
+ * \brief Counters of a frame
+ */
+typedef struct {
+	uint64_t frame;					/*!< Frames executed before			*/
+	uint64_t ns;					/*!< Wall time of frame				*/
+	uint64_t cycles;				/*!< CPU cycles of frame			*/
+	uint64_t instructions;			/*!< Instructions interpreted		*/
+	uint64_t blocks;				/*!< Translated blocks executed		*/
+	uint64_t dma;					/*!< OAM DMA transfers				*/
+	uint64_t nmi;					/*!< NMIs raised by PPU				*/
+	uint64_t get[STATS_REGION_CNT];	/*!< Memory accesses by region		*/
+	uint64_t read[STATS_IOREG_CNT];	/*!< Reads of each IO register		*/
+	uint64_t write[STATS_IOREG_CNT];/*!< Writes of each IO register		*/
+	uint64_t task[STATS_TASK_CNT];	/*!< PPU tasks executed				*/
+	uint64_t start;					/*!< Start of frame, in ns			*/
+} Stats;
+
+/**
+ * \brief Add to a counter, if stats are built and given
+ */
+#ifdef NES_STATS
+#define STATS_ADD(stats, field, n) \
+	do { if ((stats) != NULL) (stats)->field += (n); } while (0)
+#else
+#define STATS_ADD(stats, field, n)	do { } while (0)
+#endif
+
+/**
+ * \brief Clear counters of a new frame and take its start time
+ *
+ * \param self instance of Stats
+ * \param frame frames executed before
+ */
+void Stats_Begin(Stats *self, uint64_t frame);
+
+/**
+ * \brief Take wall time of frame
+ *
+ * \param self instance of Stats
+ * \param cycles CPU cycles of frame
+ */
+void Stats_End(Stats *self, uint64_t cycles);
+
+/**
+ * \brief Count a memory access
+ *
+ * \param self instance of Stats, NULL if none
+ * \param space address space and type of access
+ * \param address address accessed
+ */
+void Stats_Get(Stats *self, uint8_t space, uint16_t address);
+
+/**
+ * \brief Count tasks of a PPU dot
+ *
+ * \param self instance of Stats, NULL if none
+ * \param action PPUAction bits of dot
+ */
+void Stats_Tasks(Stats *self, uint16_t action);
+
+/**
+ * \brief Format matching extension of a file name (".json" or CSV)
+ *
+ * \param filename name of file
+ *
+ * \return StatsFormat
+ */
+uint8_t Stats_Format(const char *filename);
+
+/**
+ * \brief Print names of counters (CSV only, nothing for JSON)
+ *
+ * \param file stream to print to
+ * \param format StatsFormat
+ */
+void Stats_PrintHeader(FILE *file, uint8_t format);
+
+/**
+ * \brief Print counters of a frame on one line
+ *
+ * \param self instance of Stats
+ * \param file stream to print to
+ * \param format StatsFormat
+ */
+void Stats_Print(const Stats *self, FILE *file, uint8_t format);
+
+#endif /* STATS_H */
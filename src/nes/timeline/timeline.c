@@ -0,0 +1,121 @@
+#include "timeline.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+#include "../../common/macro.h"
+
+/* Names of tracks, as shown by viewers */
+static const char *trackName[TIMELINE_TRACK_CNT] = {"app", "ppu"};
+
+static uint64_t Timeline_Now(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t) now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+Timeline* Timeline_Create(uint32_t capacity) {
+	Timeline *self = (Timeline*) malloc(sizeof(Timeline));
+	if (self == NULL) {
+		ERROR_MSG("can't allocate Timeline structure");
+		return NULL;
+	}
+
+	self->event = (TimelineEvent*) malloc(capacity * sizeof(TimelineEvent));
+	if ((capacity == 0) || (self->event == NULL)) {
+		ERROR_MSG("can't allocate timeline ring");
+		free(self->event);
+		free(self);
+		return NULL;
+	}
+	self->capacity = capacity;
+	self->first = 0;
+	self->count = 0;
+	self->dropped = 0;
+	self->start = Timeline_Now();
+	return self;
+}
+
+static void Timeline_Add(Timeline *self, char phase, uint8_t track,
+		const char *name, int32_t value) {
+	TimelineEvent *event;
+
+	if (self == NULL)
+		return;
+	/* Overwrite oldest event once ring is full */
+	if (self->count == self->capacity) {
+		event = &self->event[self->first];
+		self->first = (self->first + 1) % self->capacity;
+		self->dropped++;
+	} else
+		event = &self->event[(self->first + self->count++) % self->capacity];
+	event->name = name;
+	event->ns = Timeline_Now() - self->start;
+	event->value = value;
+	event->phase = phase;
+	event->track = track;
+}
+
+void Timeline_Begin(Timeline *self, uint8_t track, const char *name) {
+	Timeline_Add(self, 'B', track, name, 0);
+}
+
+void Timeline_End(Timeline *self, uint8_t track, const char *name) {
+	Timeline_Add(self, 'E', track, name, 0);
+}
+
+void Timeline_Instant(Timeline *self, uint8_t track, const char *name,
+		int32_t value) {
+	Timeline_Add(self, 'i', track, name, value);
+}
+
+uint8_t Timeline_Write(Timeline *self, const char *filename) {
+	uint32_t depth[TIMELINE_TRACK_CNT] = {0};
+	TimelineEvent *event;
+	uint32_t i;
+	FILE *file = fopen(filename, "w");
+	if (file == NULL) {
+		ERROR_MSG("can't open timeline file");
+		return EXIT_FAILURE;
+	}
+
+	/* Tracks are named first, timestamps are in microseconds */
+	fprintf(file, "{\"traceEvents\":[");
+	for (i = 0; i < TIMELINE_TRACK_CNT; i++)
+		fprintf(file, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+				"\"tid\":%u,\"args\":{\"name\":\"%s\"}}", (i == 0) ? "" : ",",
+				i + 1, trackName[i]);
+	for (i = 0; i < self->count; i++) {
+		event = &self->event[(self->first + i) % self->capacity];
+		/* Leave out ends of spans which begin was overwritten */
+		if (event->phase == 'B')
+			depth[event->track]++;
+		else if (event->phase == 'E') {
+			if (depth[event->track] == 0)
+				continue;
+			depth[event->track]--;
+		}
+		fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%llu.%03u,"
+				"\"pid\":1,\"tid\":%u", event->name, event->phase,
+				(unsigned long long) (event->ns / 1000),
+				(unsigned) (event->ns % 1000), event->track + 1);
+		if (event->phase == 'i')
+			fprintf(file, ",\"s\":\"t\",\"args\":{\"value\":%d}",
+					event->value);
+		fprintf(file, "}");
+	}
+	fprintf(file, "\n],\"displayTimeUnit\":\"ms\","
+			"\"otherData\":{\"dropped\":%u}}\n", self->dropped);
+
+	if (fclose(file) != 0) {
+		ERROR_MSG("can't write timeline file");
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
+
+void Timeline_Destroy(Timeline *self) {
+	if (self == NULL)
+		return;
+	free(self->event);
+	free(self);
+}
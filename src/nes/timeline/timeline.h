@@ -0,0 +1,118 @@
+/**
+ * \file timeline.h
+ * \brief header file of Timeline module
+ * \author Dylan Gageot
+ * \version 1.0
+ * \date 2019-06-28
+ *
+ * Host time spent in phases of the emulator. Spans (begin and end of a
+ * phase) and instants are stored with a monotonic timestamp into a ring
+ * allocated once; once it is full, oldest events are overwritten and counted.
+ * Timeline_Write saves them in the Chrome trace event format, that timeline
+ * viewers (chrome://tracing, Perfetto) open.
+ *
+ * As only older events are overwritten, the end of a kept begin is always
+ * kept. An end which begin was overwritten is left out by Timeline_Write.
+ *
+ * Every event belongs to a track, shown as a thread by viewers. A Timeline
+ * is meant to be used by a single thread.
+ */
+
+#ifndef TIMELINE_H
+#define TIMELINE_H
+
+#include <stdint.h>
+
+/**
+ * \brief Default number of events of ring
+ */
+#define TIMELINE_EVENT_CNT	(1 << 20)
+
+/**
+ * \brief Tracks of events
+ */
+enum TimelineTrack {
+	TIMELINE_APP = 0,		/*!< Phases of application loop		*/
+	TIMELINE_PPU,			/*!< Scanlines and vertical blanks	*/
+	TIMELINE_TRACK_CNT
+};
+
+/**
+ * \brief Event stored in buffer
+ */
+typedef struct {
+	const char *name;				/*!< Name, static string			*/
+	uint64_t ns;					/*!< Time since creation			*/
+	int32_t value;					/*!< Argument of instant			*/
+	char phase;						/*!< 'B'egin, 'E'nd or 'i'nstant	*/
+	uint8_t track;					/*!< TimelineTrack					*/
+} TimelineEvent;
+
+/**
+ * \brief Hold events
+ */
+typedef struct {
+	TimelineEvent *event;			/*!< Ring of events					*/
+	uint32_t capacity;				/*!< Number of events of ring		*/
+	uint32_t first;					/*!< Index of oldest event			*/
+	uint32_t count;					/*!< Number of events stored		*/
+	uint32_t dropped;				/*!< Oldest events overwritten		*/
+	uint64_t start;					/*!< Creation time, in ns			*/
+} Timeline;
+
+/**
+ * \brief Allocate ring of events
+ *
+ * \param capacity number of events of ring
+ *
+ * \return instance of Timeline, NULL if an error occured
+ */
+Timeline* Timeline_Create(uint32_t capacity);
+
+/**
+ * \brief Record start of a phase
+ *
+ * \param self instance of Timeline, NULL if none
+ * \param track TimelineTrack
+ * \param name name of phase, static string
+ */
+void Timeline_Begin(Timeline *self, uint8_t track, const char *name);
+
+/**
+ * \brief Record end of the phase last begun on track
+ *
+ * \param self instance of Timeline, NULL if none
+ * \param track TimelineTrack
+ * \param name name of phase, static string
+ */
+void Timeline_End(Timeline *self, uint8_t track, const char *name);
+
+/**
+ * \brief Record an instant
+ *
+ * \param self instance of Timeline, NULL if none
+ * \param track TimelineTrack
+ * \param name name of instant, static string
+ * \param value argument shown with instant
+ */
+void Timeline_Instant(Timeline *self, uint8_t track, const char *name,
+		int32_t value);
+
+/**
+ * \brief Write events in Chrome trace event format (JSON)
+ *
+ * \param self instance of Timeline
+ * \param filename file to write to
+ *
+ * \return EXIT_SUCCESS if succeed, EXIT_FAILURE otherwise
+ */
+uint8_t Timeline_Write(Timeline *self, const char *filename);
+
+/**
+ * \brief Free ring of events
+ *
+ * \param self instance of Timeline
+ */
+void Timeline_Destroy(Timeline *self);
+
+#endif /* TIMELINE_H */
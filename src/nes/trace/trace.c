@@ -0,0 +1,163 @@
+#include "trace.h"
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include <time.h>
+#include "../../common/macro.h"
+
+/* Write records of ring to file until asked to quit */
+static void* Trace_Work(void *arg) {
+	Trace *self = (Trace*) arg;
+	struct timespec timeout;
+	uint32_t head, tail, index, count;
+
+	for (;;) {
+		head = __atomic_load_n(&self->head, __ATOMIC_ACQUIRE);
+		tail = self->tail;
+		if (head != tail) {
+			/* Records up to the end of ring, the rest comes next time */
+			index = tail & (TRACE_RING_CNT - 1);
+			count = head - tail;
+			if (count > TRACE_RING_CNT - index)
+				count = TRACE_RING_CNT - index;
+			fwrite(self->ring + index, sizeof(TraceRecord), count, self->file);
+			__atomic_store_n(&self->tail, tail + count, __ATOMIC_RELEASE);
+			continue;
+		}
+		if (__atomic_load_n(&self->quit, __ATOMIC_ACQUIRE))
+			break;
+
+		/* Sleep until half ring is filled, records left behind by a CPU
+		 * running slowly are still written every few milliseconds */
+		clock_gettime(CLOCK_REALTIME, &timeout);
+		timeout.tv_nsec += 10000000;
+		if (timeout.tv_nsec >= 1000000000) {
+			timeout.tv_sec++;
+			timeout.tv_nsec -= 1000000000;
+		}
+		pthread_mutex_lock(&self->lock);
+		if (!self->quit && (__atomic_load_n(&self->head, __ATOMIC_ACQUIRE) ==
+					self->tail))
+			pthread_cond_timedwait(&self->wake, &self->lock, &timeout);
+		pthread_mutex_unlock(&self->lock);
+	}
+
+	return NULL;
+}
+
+Trace* Trace_Create(const char *filename) {
+	Trace *self = (Trace*) malloc(sizeof(Trace));
+	if (self == NULL) {
+		ERROR_MSG("can't allocate Trace structure");
+		return NULL;
+	}
+
+	self->head = self->tail = 0;
+	self->stall = 0;
+	self->quit = 0;
+	self->ring = (TraceRecord*) malloc(TRACE_RING_CNT * sizeof(TraceRecord));
+	if (self->ring == NULL) {
+		ERROR_MSG("can't allocate trace ring");
+		free(self);
+		return NULL;
+	}
+
+	self->file = fopen(filename, "wb");
+	if (self->file == NULL) {
+		ERROR_MSG("can't open trace file");
+		free(self->ring);
+		free(self);
+		return NULL;
+	}
+	fwrite(TRACE_MAGIC, 1, strlen(TRACE_MAGIC), self->file);
+
+	pthread_mutex_init(&self->lock, NULL);
+	pthread_cond_init(&self->wake, NULL);
+	if (pthread_create(&self->thread, NULL, Trace_Work, self) != 0) {
+		ERROR_MSG("can't start trace writer");
+		pthread_cond_destroy(&self->wake);
+		pthread_mutex_destroy(&self->lock);
+		fclose(self->file);
+		free(self->ring);
+		free(self);
+		return NULL;
+	}
+
+	return self;
+}
+
+void Trace_Wake(Trace *self) {
+	pthread_mutex_lock(&self->lock);
+	pthread_cond_signal(&self->wake);
+	pthread_mutex_unlock(&self->lock);
+}
+
+void Trace_Wait(Trace *self) {
+	self->stall++;
+	Trace_Wake(self);
+	sched_yield();
+}
+
+void Trace_Print(TraceRecord *record, FILE *file) {
+	int i;
+
+	fprintf(file, "%04X ", record->pc);
+	if (record->nbArg == TRACE_DMA) {
+		/* If record is a DMA step */
+		fprintf(file, "DMA @%04X   ", (record->arg[1] << 8) | record->arg[0]);
+	} else {
+		/* If record is an instruction, print opcode and args */
+		fprintf(file, "%02X ", record->opcode);
+		for (i = 0; i < 3; i++) {
+			if (i < record->nbArg)
+				fprintf(file, "%02X ", record->arg[i]);
+			else
+				fprintf(file, "   ");
+		}
+	}
+	fprintf(file, "A:%02X X:%02X Y:%02X P:%02X SP:%02X CYC:%-llu\n",
+			record->a, record->x, record->y, record->p, record->sp,
+			(unsigned long long) record->cycle);
+}
+
+uint8_t Trace_Render(const char *filename, FILE *file) {
+	char magic[sizeof(TRACE_MAGIC)];
+	TraceRecord record;
+	FILE *trace = fopen(filename, "rb");
+	if (trace == NULL) {
+		ERROR_MSG("can't open trace file");
+		return EXIT_FAILURE;
+	}
+
+	/* Check it is a trace file */
+	if ((fread(magic, 1, strlen(TRACE_MAGIC), trace) != strlen(TRACE_MAGIC)) ||
+			(memcmp(magic, TRACE_MAGIC, strlen(TRACE_MAGIC)) != 0)) {
+		ERROR_MSG("not a trace file");
+		fclose(trace);
+		return EXIT_FAILURE;
+	}
+
+	while (fread(&record, sizeof(TraceRecord), 1, trace) == 1)
+		Trace_Print(&record, file);
+
+	fclose(trace);
+	return EXIT_SUCCESS;
+}
+
+void Trace_Destroy(Trace *self) {
+	if (self == NULL)
+		return;
+
+	/* Writer empties ring before it exits */
+	pthread_mutex_lock(&self->lock);
+	__atomic_store_n(&self->quit, 1, __ATOMIC_RELEASE);
+	pthread_cond_signal(&self->wake);
+	pthread_mutex_unlock(&self->lock);
+	pthread_join(self->thread, NULL);
+
+	pthread_cond_destroy(&self->wake);
+	pthread_mutex_destroy(&self->lock);
+	fclose(self->file);
+	free(self->ring);
+	free(self);
+}
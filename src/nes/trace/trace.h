@@ -0,0 +1,147 @@
+/**
+ * \file trace.h
+ * \brief header file of Trace module
+ * \author Dylan Gageot
+ * \version 1.0
+ * \date 2019-06-28
+ *
+ * Execution trace of the CPU. Every instruction (or DMA step) executed while
+ * a Trace is given to the CPU (see CPU_SetTrace) is stored as a fixed-size
+ * binary record in an in-memory ring. The ring has a single writer, the
+ * thread running the CPU, and a single reader, a thread of the Trace that
+ * writes records to file. Neither takes a lock to move along the ring; the
+ * writer only waits when the ring is full.
+ *
+ * Trace files are turned into the text format of nestest.log by
+ * Trace_Render (see mechgah-trace).
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <pthread.h>
+
+/**
+ * \brief Magic number at the beginning of trace files
+ */
+#define TRACE_MAGIC		"MGHTRACE"
+
+/**
+ * \brief Number of records of ring, power of 2
+ */
+#define TRACE_RING_CNT	65536
+
+/**
+ * \brief nbArg of a record of DMA step, address read is in arg
+ */
+#define TRACE_DMA		0xFF
+
+/**
+ * \brief State of CPU before an instruction is executed
+ */
+typedef struct {
+	uint64_t cycle;					/*!< Clock cycle					*/
+	uint16_t pc;					/*!< Address of opcode				*/
+	uint8_t opcode;					/*!< Opcode							*/
+	uint8_t arg[2];					/*!< Arguments, little endian		*/
+	uint8_t nbArg;					/*!< Number of arguments			*/
+	uint8_t a;						/*!< Accumulator					*/
+	uint8_t x;						/*!< X index						*/
+	uint8_t y;						/*!< Y index						*/
+	uint8_t p;						/*!< Status							*/
+	uint8_t sp;						/*!< Stack pointer					*/
+} TraceRecord;
+
+/**
+ * \brief Hold ring and writer thread
+ */
+typedef struct Trace {
+	TraceRecord *ring;				/*!< Records not written yet		*/
+	uint32_t head;					/*!< Next record to fill (atomic)	*/
+	uint32_t tail;					/*!< Next record to write (atomic)	*/
+	uint32_t stall;					/*!< Times CPU waited for ring		*/
+	FILE *file;						/*!< Trace file						*/
+	pthread_t thread;				/*!< Thread writing to file			*/
+	pthread_mutex_t lock;			/*!< Protect wake					*/
+	pthread_cond_t wake;			/*!< Signaled when records wait		*/
+	uint8_t quit;					/*!< Writer must exit (atomic)		*/
+} Trace;
+
+/**
+ * \brief Open trace file and start writer thread
+ *
+ * \param filename file to write records to
+ *
+ * \return instance of Trace, NULL if an error occured
+ */
+Trace* Trace_Create(const char *filename);
+
+/**
+ * \brief Wake writer and let it make room in ring (called when it is full)
+ *
+ * \param self instance of Trace
+ */
+void Trace_Wait(Trace *self);
+
+/**
+ * \brief Wake writer
+ *
+ * \param self instance of Trace
+ */
+void Trace_Wake(Trace *self);
+
+/**
+ * \brief Give the next record of ring, waiting for room if it is full
+ *
+ * \param self instance of Trace
+ *
+ * \return record to fill, then to publish with Trace_Commit
+ */
+static inline TraceRecord* Trace_Next(Trace *self) {
+	while (self->head - __atomic_load_n(&self->tail, __ATOMIC_ACQUIRE) >=
+			TRACE_RING_CNT)
+		Trace_Wait(self);
+	return &self->ring[self->head & (TRACE_RING_CNT - 1)];
+}
+
+/**
+ * \brief Publish record given by Trace_Next to writer
+ *
+ * \param self instance of Trace
+ */
+static inline void Trace_Commit(Trace *self) {
+	uint32_t head = self->head + 1;
+	__atomic_store_n(&self->head, head, __ATOMIC_RELEASE);
+	/* Writer is woken up every half ring */
+	if ((head & (TRACE_RING_CNT / 2 - 1)) == 0)
+		Trace_Wake(self);
+}
+
+/**
+ * \brief Print a record in the format of nestest.log
+ *
+ * \param record record to print
+ * \param file stream to print to
+ */
+void Trace_Print(TraceRecord *record, FILE *file);
+
+/**
+ * \brief Print every record of a trace file in the format of nestest.log
+ *
+ * \param filename trace file
+ * \param file stream to print to
+ *
+ * \return EXIT_SUCCESS if succeed, EXIT_FAILURE if trace file can't be read
+ */
+uint8_t Trace_Render(const char *filename, FILE *file);
+
+/**
+ * \brief Write remaining records, stop writer thread and close trace file
+ *
+ * \param self instance of Trace
+ */
+void Trace_Destroy(Trace *self);
+
+#endif /* TRACE_H */
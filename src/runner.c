@@ -0,0 +1,398 @@
+#include "runner.h"
+#include "nes/const.h"
+#include "common/macro.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <ctype.h>
+#include <time.h>
+
+/* Read next entry of script, close it at its end */
+static uint8_t Runner_ReadEntry(Runner *self) {
+	char line[256];
+	unsigned int frame, keys;
+
+	/* Look for next line that isn't empty or a comment */
+	while (fgets(line, sizeof(line), self->script) != NULL) {
+		self->scriptLine++;
+		if ((line[0] == '#') || (line[0] == '\n') || (line[0] == '\r'))
+			continue;
+		if ((sscanf(line, "%u %x", &frame, &keys) != 2) ||
+				(frame < self->nextFrame)) {
+			fprintf(stderr, "Error: wrong input script line %u: %s",
+					self->scriptLine, line);
+			return EXIT_FAILURE;
+		}
+		self->nextFrame = frame;
+		self->nextKeys = keys;
+		return EXIT_SUCCESS;
+	}
+	fclose(self->script);
+	self->script = NULL;
+	return EXIT_SUCCESS;
+}
+
+/* Trace, profile and count execution of first instance if requested */
+static uint8_t Runner_Attach(Runner *self, char *traceFileName,
+		char *statsFileName) {
+	Stats stats;
+
+	if (traceFileName != NULL) {
+		self->trace = Trace_Create(traceFileName);
+		if (self->trace == NULL) {
+			fprintf(stderr, "Error: can't create trace file %s\n",
+					traceFileName);
+			Runner_Destroy(self);
+			return EXIT_FAILURE;
+		}
+		CPU_SetTrace(self->nes->cpu, self->trace);
+	}
+	if (self->profilePrefix != NULL) {
+		self->profile = Profile_Create();
+		if (self->profile == NULL) {
+			Runner_Destroy(self);
+			return EXIT_FAILURE;
+		}
+		CPU_SetProfile(self->nes->cpu, self->profile);
+	}
+	if (self->timelineFileName != NULL) {
+		/* Instances run on worker threads, timeline has a single writer */
+		if (self->pool != NULL) {
+			fprintf(stderr, "Error: timeline needs a single instance\n");
+			Runner_Destroy(self);
+			return EXIT_FAILURE;
+		}
+		self->timeline = Timeline_Create(TIMELINE_EVENT_CNT);
+		if (self->timeline == NULL) {
+			Runner_Destroy(self);
+			return EXIT_FAILURE;
+		}
+		PPU_SetTimeline(self->nes->ppu, self->timeline);
+	}
+	if (statsFileName != NULL) {
+		if (NES_GetStats(self->nes, &stats) == EXIT_FAILURE) {
+			fprintf(stderr, "Error: counters need a build with NES_STATS\n");
+			Runner_Destroy(self);
+			return EXIT_FAILURE;
+		}
+		self->stats = fopen(statsFileName, "w");
+		if (self->stats == NULL) {
+			fprintf(stderr, "Error: can't open %s\n", statsFileName);
+			Runner_Destroy(self);
+			return EXIT_FAILURE;
+		}
+		self->statsFormat = Stats_Format(statsFileName);
+		Stats_PrintHeader(self->stats, self->statsFormat);
+	}
+	return EXIT_SUCCESS;
+}
+
+uint8_t Runner_Init(Runner *self, int argc, char **argv) {
+	char *scriptFileName = NULL, *traceFileName = NULL, **fileNames = NULL;
+	char *statsFileName = NULL;
+	uint32_t i;
+	int opt;
+	opterr = 0; /* In order to return '?' if there is an error */
+	self->nes = NULL;
+	self->frameCount = RUNNER_FRAME_CNT;
+	self->script = NULL;
+	self->scriptLine = 0;
+	self->nextFrame = 0;
+	self->nextKeys = 0;
+	self->keysPressed = 0;
+	self->dumpPrefix = NULL;
+	self->dumpEvery = 1;
+	self->pool = NULL;
+	self->keys = NULL;
+	self->instanceCount = self->workerCount = 1;
+	self->trace = NULL;
+	self->profile = NULL;
+	self->profilePrefix = NULL;
+	self->stats = NULL;
+	self->statsFormat = STATS_CSV;
+	self->timeline = NULL;
+	self->timelineFileName = NULL;
+
+	/* Process given option */
+	while ((opt = getopt(argc, argv, "f:i:d:e:n:j:t:p:S:T:")) != -1) {
+		switch (opt) {
+			case 'f':
+			case 'e':
+			case 'n':
+			case 'j':
+				if (!isdigit(*optarg) || (strtol(optarg, NULL, 10) < 1)) {
+					fprintf(stderr, "%s is not a valid value for -%c.\n",
+							optarg, opt);
+					return EXIT_FAILURE;
+				}
+				if (opt == 'f')
+					self->frameCount = strtol(optarg, NULL, 10);
+				else if (opt == 'e')
+					self->dumpEvery = strtol(optarg, NULL, 10);
+				else if (opt == 'n')
+					self->instanceCount = strtol(optarg, NULL, 10);
+				else
+					self->workerCount = strtol(optarg, NULL, 10);
+				break;
+			case 'i':
+				scriptFileName = optarg;
+				break;
+			case 'd':
+				self->dumpPrefix = optarg;
+				break;
+			case 't':
+				traceFileName = optarg;
+				break;
+			case 'p':
+				self->profilePrefix = optarg;
+				break;
+			case 'S':
+				statsFileName = optarg;
+				break;
+			case 'T':
+				self->timelineFileName = optarg;
+				break;
+			case '?':
+				if (strchr("fidenjtpST", optopt) != NULL)
+					fprintf(stderr, "Option -%c requires an argument.\n",
+							optopt);
+				else if (isprint(optopt))
+					fprintf(stderr, "Unknown option `-%c'.\n", optopt);
+				else
+					fprintf(stderr, "Unknown option character `\\x%x'.\n",
+							optopt);
+				return EXIT_FAILURE;
+			default:
+				fprintf(stderr, "Runner requires a ROM to run on.\n");
+				return EXIT_FAILURE;
+		}
+	}
+
+	if (optind == argc) {
+		fprintf(stderr, "Runner requires a ROM to run on.\n");
+		return EXIT_FAILURE;
+	}
+
+	/* Open input script and read its first entry */
+	if (scriptFileName != NULL) {
+		self->script = fopen(scriptFileName, "r");
+		if (self->script == NULL) {
+			fprintf(stderr, "Error: can't open input script %s\n",
+					scriptFileName);
+			return EXIT_FAILURE;
+		}
+		if (Runner_ReadEntry(self) == EXIT_FAILURE) {
+			Runner_Destroy(self);
+			return EXIT_FAILURE;
+		}
+	}
+
+	/* NES initialization */
+	if (self->instanceCount == 1) {
+		self->nes = NES_Create(argv[optind]);
+		if (self->nes == NULL) {
+			Runner_Destroy(self);
+			return EXIT_FAILURE;
+		}
+		return Runner_Attach(self, traceFileName, statsFileName);
+	}
+
+	/* Every instance runs the same ROM */
+	fileNames = (char**) malloc(self->instanceCount * sizeof(char*));
+	self->keys = (uint16_t*) malloc(self->instanceCount * sizeof(uint16_t));
+	if ((fileNames == NULL) || (self->keys == NULL)) {
+		ERROR_MSG("can't allocate memory for instances");
+		free(fileNames);
+		Runner_Destroy(self);
+		return EXIT_FAILURE;
+	}
+	for (i = 0; i < self->instanceCount; i++)
+		fileNames[i] = argv[optind];
+	self->pool = NESPool_Create(fileNames, self->instanceCount,
+			self->workerCount, NULL, NULL);
+	free(fileNames);
+	if (self->pool == NULL) {
+		Runner_Destroy(self);
+		return EXIT_FAILURE;
+	}
+	self->nes = NESPool_Get(self->pool, 0);
+
+	return Runner_Attach(self, traceFileName, statsFileName);
+}
+
+uint8_t Runner_NextKeys(Runner *self, uint32_t frame, uint16_t *keys) {
+	/* Apply every entry reached, script is closed at its end */
+	while ((self->script != NULL) && (self->nextFrame <= frame)) {
+		self->keysPressed = self->nextKeys;
+		if (Runner_ReadEntry(self) == EXIT_FAILURE)
+			return EXIT_FAILURE;
+	}
+	*keys = self->keysPressed;
+	return EXIT_SUCCESS;
+}
+
+uint64_t Runner_Hash(uint8_t *image, uint32_t size) {
+	uint64_t hash = 0xCBF29CE484222325ULL;
+	uint32_t i;
+
+	for (i = 0; i < size; i++) {
+		hash ^= image[i];
+		hash *= 0x00000100000001B3ULL;
+	}
+	return hash;
+}
+
+uint8_t Runner_Dump(Runner *self, uint32_t frame) {
+	uint32_t *image = NES_Render(self->nes);
+	uint8_t pixel[3];
+	char *fileName = NULL;
+	FILE *file = NULL;
+	uint32_t i;
+
+	/* "<prefix><frame>.ppm" */
+	fileName = (char*) malloc(strlen(self->dumpPrefix) + 16);
+	if (fileName == NULL) {
+		ERROR_MSG("can't allocate memory for dump file name");
+		return EXIT_FAILURE;
+	}
+	sprintf(fileName, "%s%06u.ppm", self->dumpPrefix, frame);
+	file = fopen(fileName, "wb");
+	if (file == NULL) {
+		fprintf(stderr, "Error: can't open %s\n", fileName);
+		free(fileName);
+		return EXIT_FAILURE;
+	}
+
+	/* Binary PPM, from 0x00RRGGBB pixels */
+	fprintf(file, "P6\n%d %d\n255\n", NES_SCREEN_WIDTH, NES_SCREEN_HEIGTH);
+	for (i = 0; i < NES_SCREEN_WIDTH * NES_SCREEN_HEIGTH; i++) {
+		pixel[0] = image[i] >> 16;
+		pixel[1] = image[i] >> 8;
+		pixel[2] = image[i];
+		fwrite(pixel, sizeof(pixel), 1, file);
+	}
+
+	fclose(file);
+	free(fileName);
+	return EXIT_SUCCESS;
+}
+
+uint8_t Runner_Execute(Runner *self) {
+	struct timespec start, end;
+	uint8_t returnValue = EXIT_SUCCESS, status;
+	uint16_t keysPressed;
+	uint32_t frame, i;
+	double seconds;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (frame = 0; frame < self->frameCount; frame++) {
+		if (Runner_NextKeys(self, frame, &keysPressed) == EXIT_FAILURE) {
+			returnValue = EXIT_FAILURE;
+			break;
+		}
+		Timeline_Begin(self->timeline, TIMELINE_APP, "frame");
+		if (self->pool != NULL) {
+			for (i = 0; i < self->instanceCount; i++)
+				self->keys[i] = keysPressed;
+			status = NESPool_NextFrame(self->pool, self->keys);
+		} else
+			status = NES_NextFrame(self->nes, keysPressed);
+		Timeline_End(self->timeline, TIMELINE_APP, "frame");
+		if (status == EXIT_FAILURE) {
+			returnValue = EXIT_FAILURE;
+			break;
+		}
+		if ((self->dumpPrefix != NULL) &&
+				(((frame + 1) % self->dumpEvery) == 0) &&
+				(Runner_Dump(self, frame) == EXIT_FAILURE)) {
+			returnValue = EXIT_FAILURE;
+			break;
+		}
+		if (self->stats != NULL)
+			Runner_WriteStats(self);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+	/* Report */
+	printf("frames: %u\n", frame);
+	if (self->instanceCount > 1)
+		printf("instances: %u\n", self->instanceCount);
+	printf("seconds: %.3f\n", seconds);
+	printf("fps: %.1f\n", (seconds > 0) ?
+			(double) frame * self->instanceCount / seconds : 0.0);
+	printf("hash: %016llx\n", (unsigned long long) Runner_Hash(
+				NES_RenderIndex(self->nes), NES_SCREEN_WIDTH * NES_SCREEN_HEIGTH));
+	if ((self->profile != NULL) && (Runner_WriteProfile(self) == EXIT_FAILURE))
+		returnValue = EXIT_FAILURE;
+	if ((self->timeline != NULL) &&
+			(Timeline_Write(self->timeline, self->timelineFileName) ==
+			 EXIT_FAILURE))
+		returnValue = EXIT_FAILURE;
+
+	Runner_Destroy(self);
+	return returnValue;
+}
+
+uint8_t Runner_WriteProfile(Runner *self) {
+	size_t length = strlen(self->profilePrefix) + 8;
+	char *fileName = (char*) malloc(length);
+	FILE *file;
+	uint8_t i;
+
+	if (fileName == NULL) {
+		ERROR_MSG("can't allocate memory for profile file name");
+		return EXIT_FAILURE;
+	}
+	/* Report, then call stacks */
+	for (i = 0; i < 2; i++) {
+		snprintf(fileName, length, "%s%s", self->profilePrefix,
+				(i == 0) ? ".txt" : ".folded");
+		file = fopen(fileName, "w");
+		if (file == NULL) {
+			fprintf(stderr, "Error: can't write profile %s\n", fileName);
+			free(fileName);
+			return EXIT_FAILURE;
+		}
+		if (i == 0)
+			Profile_Report(self->profile, file, RUNNER_PROFILE_TOP);
+		else
+			Profile_Collapsed(self->profile, file);
+		fclose(file);
+	}
+	free(fileName);
+	return EXIT_SUCCESS;
+}
+
+uint8_t Runner_WriteStats(Runner *self) {
+	Stats stats;
+	if (NES_GetStats(self->nes, &stats) == EXIT_FAILURE)
+		return EXIT_FAILURE;
+	Stats_Print(&stats, self->stats, self->statsFormat);
+	return EXIT_SUCCESS;
+}
+
+void Runner_Destroy(Runner *self) {
+	if (self->script != NULL)
+		fclose(self->script);
+	self->script = NULL;
+	if (self->stats != NULL)
+		fclose(self->stats);
+	self->stats = NULL;
+	/* First instance belongs to pool if any */
+	if (self->pool != NULL)
+		NESPool_Destroy(self->pool);
+	else
+		NES_Destroy(self->nes);
+	/* Remaining records are written once CPU is gone */
+	Trace_Destroy(self->trace);
+	Profile_Destroy(self->profile);
+	Timeline_Destroy(self->timeline);
+	free(self->keys);
+	self->pool = NULL;
+	self->keys = NULL;
+	self->nes = NULL;
+	self->trace = NULL;
+	self->profile = NULL;
+	self->timeline = NULL;
+}
@@ -0,0 +1,156 @@
+/**
+ * \file runner.h
+ * \brief header file of Runner, headless batch execution of a ROM
+ * \author Dylan Gageot
+ * \version 1.0
+ * \date 2019-06-15
+ *
+ * Runner only depends on the emulator core: no display, no SDL. Inputs are
+ * read from a script whose lines are "<frame> <keys>", keys being the value
+ * given to NES_NextFrame in hexadecimal (player 1 in low byte, player 2 in
+ * high byte). Keys are held from the given frame up to the next line. Empty
+ * lines and lines starting with '#' are ignored, any other malformed line is
+ * an error.
+ *
+ * Several instances of the ROM may be run on worker threads, all of them
+ * being given the same keys. Reported picture is the one of first instance,
+ * and so are the execution trace, the profile and the counters if they are
+ * requested. A timeline needs a single instance.
+ */
+
+#ifndef RUNNER_H
+#define RUNNER_H
+
+#include <stdio.h>
+#include "nes/nes.h"
+#include "nes/pool/pool.h"
+#include "nes/timeline/timeline.h"
+
+/**
+ * \brief Default number of frames to execute
+ */
+#define RUNNER_FRAME_CNT 600
+
+/**
+ * \brief Number of addresses in profile report
+ */
+#define RUNNER_PROFILE_TOP 50
+
+/**
+ * \brief Hold runner data
+ */
+typedef struct {
+	/* Emulator */
+	NES *nes;						/*!< Instance of NES emulator		*/
+	uint32_t frameCount;			/*!< Number of frames to execute	*/
+	/* Several instances */
+	NESPool *pool;					/*!< Instances, NULL if only one	*/
+	uint16_t *keys;					/*!< Keys of each instance			*/
+	uint32_t instanceCount;			/*!< Number of instances			*/
+	uint32_t workerCount;			/*!< Number of worker threads		*/
+	/* Input script */
+	FILE *script;					/*!< Input script, NULL if none		*/
+	uint32_t scriptLine;			/*!< Lines read from input script	*/
+	uint32_t nextFrame;				/*!< Frame of next script entry		*/
+	uint16_t nextKeys;				/*!< Keys of next script entry		*/
+	uint16_t keysPressed;			/*!< Keys currently pressed			*/
+	/* Frame dumps */
+	char *dumpPrefix;				/*!< Dump path prefix, NULL if none	*/
+	uint32_t dumpEvery;				/*!< Dump one frame every n frames	*/
+	/* Execution trace */
+	Trace *trace;					/*!< Trace of first instance, NULL
+									     if none						*/
+	/* Hot spots */
+	Profile *profile;				/*!< Profile of first instance, NULL
+									     if none						*/
+	char *profilePrefix;			/*!< Profile path prefix			*/
+	/* Counters */
+	FILE *stats;					/*!< Counters of every frame, NULL
+									     if none						*/
+	uint8_t statsFormat;			/*!< StatsFormat of counters		*/
+	/* Timeline */
+	Timeline *timeline;				/*!< Frames, scanlines and vertical
+									     blanks, NULL if none			*/
+	char *timelineFileName;			/*!< File written at the end		*/
+} Runner;
+
+/**
+ * \brief Retrieve information from given launch option and init emulator
+ *
+ * \param self instance of Runner
+ * \param argc value of argc
+ * \param argv address of argv
+ *
+ * \return EXIT_SUCCESS if succeed, EXIT_FAILURE otherwise
+ */
+uint8_t Runner_Init(Runner *self, int argc, char **argv);
+
+/**
+ * \brief Give keys to press on a frame, reading input script if needed
+ *
+ * Must be called with increasing frame numbers.
+ *
+ * \param self instance of Runner
+ * \param frame number of the frame to execute
+ * \param keys address where keys pressed are written
+ *
+ * \return EXIT_SUCCESS if succeed, EXIT_FAILURE if script is malformed
+ */
+uint8_t Runner_NextKeys(Runner *self, uint32_t frame, uint16_t *keys);
+
+/**
+ * \brief Write profile of first instance to "<prefix>.txt" (report) and
+ * "<prefix>.folded" (call stacks, see Profile_Collapsed)
+ *
+ * \param self instance of Runner, profiled
+ *
+ * \return EXIT_SUCCESS if succeed, EXIT_FAILURE otherwise
+ */
+uint8_t Runner_WriteProfile(Runner *self);
+
+/**
+ * \brief Print counters of last frame of first instance (see NES_GetStats)
+ *
+ * \param self instance of Runner, with counters requested
+ *
+ * \return EXIT_SUCCESS if succeed, EXIT_FAILURE otherwise
+ */
+uint8_t Runner_WriteStats(Runner *self);
+
+/**
+ * \brief Hash of a picture (64-bit FNV-1a)
+ *
+ * \param image array of palette indexes
+ * \param size number of pixels
+ *
+ * \return hash value
+ */
+uint64_t Runner_Hash(uint8_t *image, uint32_t size);
+
+/**
+ * \brief Write current picture to "<prefix><frame>.ppm"
+ *
+ * \param self instance of Runner
+ * \param frame number of the frame
+ *
+ * \return EXIT_SUCCESS if succeed, EXIT_FAILURE otherwise
+ */
+uint8_t Runner_Dump(Runner *self, uint32_t frame);
+
+/**
+ * \brief Execute every frame as fast as possible and print report
+ *
+ * \param self instance of Runner
+ *
+ * \return EXIT_SUCCESS if succeed, EXIT_FAILURE otherwise
+ */
+uint8_t Runner_Execute(Runner *self);
+
+/**
+ * \brief Free resources of Runner
+ *
+ * \param self instance of Runner
+ */
+void Runner_Destroy(Runner *self);
+
+#endif /* RUNNER_H */
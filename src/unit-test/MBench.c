@@ -0,0 +1,34 @@
+#include "MBench.h"
+#include <stdio.h>
+#include <string.h>
+
+/* Name prefixes given on command line */
+static char **prefix = NULL;
+static int prefixCnt = 0;
+
+uint8_t MBench_Selected(const char *name) {
+	int i;
+	if (prefixCnt == 0)
+		return 1;
+	for (i = 0; i < prefixCnt; i++) {
+		if (strncmp(name, prefix[i], strlen(prefix[i])) == 0)
+			return 1;
+	}
+	return 0;
+}
+
+void MBench_Report(const char *name, uint64_t ticks, uint32_t calls) {
+	printf("%-32s %10.2f %s/call\n", name, (double) ticks / calls,
+			MBENCH_UNIT);
+}
+
+int main(int argc, char **argv) {
+	int out = 0;
+	/* Only run micro-benchmarks whose name starts with given prefixes */
+	prefix = argv + 1;
+	prefixCnt = argc - 1;
+	out += run_MBinstruction();
+	out += run_MBppu();
+	out += run_MBnrom();
+	return out;
+}
@@ -0,0 +1,114 @@
+/**
+ * \file MBench.h
+ * \brief header file of micro-benchmarks of emulator core functions
+ * \author Dylan Gageot
+ * \version 1.0
+ * \date 2019-06-28
+ *
+ * Each micro-benchmark calls a single function in a loop and reports the
+ * best time per call out of MBENCH_REPEAT_CNT runs, in TSC cycles on x86-64
+ * and in nanoseconds elsewhere. Unlike whole-frame measures of mechgah-bench,
+ * they tell which function moved when a regression happens.
+ */
+
+#ifndef MBENCH_H
+#define MBENCH_H
+
+#include <stdint.h>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <x86intrin.h>
+#define MBENCH_UNIT		"cycles"
+#else
+#include <time.h>
+#define MBENCH_UNIT		"ns"
+#endif
+
+/**
+ * \brief Default number of calls of a run
+ */
+#define MBENCH_CALL_CNT		200000
+
+/**
+ * \brief Number of runs, the best one is reported
+ */
+#define MBENCH_REPEAT_CNT	5
+
+/**
+ * \brief Time MBENCH_REPEAT_CNT runs of calls executions of body, and report
+ * the best one under name if it is selected
+ */
+#define MBENCH_RUN(name, calls, body)										\
+	do {																	\
+		if (MBench_Selected(name)) {										\
+			uint64_t _best = UINT64_MAX, _ticks;							\
+			uint32_t _run, _call;											\
+			for (_run = 0; _run < MBENCH_REPEAT_CNT; _run++) {				\
+				_ticks = MBench_Ticks();									\
+				for (_call = 0; _call < (calls); _call++) {					\
+					body;													\
+				}															\
+				_ticks = MBench_Ticks() - _ticks;							\
+				if (_ticks < _best)											\
+					_best = _ticks;											\
+			}																\
+			MBench_Report(name, _best, (calls));							\
+		}																	\
+	} while (0)
+
+/**
+ * \brief Current time, in MBENCH_UNIT
+ *
+ * \return time stamp
+ */
+static inline uint64_t MBench_Ticks(void) {
+#if defined(__x86_64__) && defined(__GNUC__)
+	return __rdtsc();
+#else
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t) now.tv_sec * 1000000000ULL + now.tv_nsec;
+#endif
+}
+
+/**
+ * \brief Tell if a micro-benchmark has to be run
+ *
+ * \param name name of micro-benchmark
+ *
+ * \return 1 if name starts with one of the prefixes given on command line
+ * (or if none was given), 0 otherwise
+ */
+uint8_t MBench_Selected(const char *name);
+
+/**
+ * \brief Print time per call of a micro-benchmark
+ *
+ * \param name name of micro-benchmark
+ * \param ticks time of the run, in MBENCH_UNIT
+ * \param calls number of calls of the run
+ */
+void MBench_Report(const char *name, uint64_t ticks, uint32_t calls);
+
+/**
+ * \brief Micro-benchmark of opcode handlers and addressing mode resolution
+ *
+ * \return 0 if run, 1 otherwise
+ */
+int run_MBinstruction(void);
+
+/**
+ * \brief Micro-benchmark of PPU tasks
+ *
+ * \return 0 if run, 1 otherwise
+ */
+int run_MBppu(void);
+
+/**
+ * \brief Micro-benchmark of NROM mapper
+ *
+ * \return 0 if run, 1 otherwise
+ */
+int run_MBnrom(void);
+
+#endif /* MBENCH_H */
@@ -0,0 +1,95 @@
+#include "MBench.h"
+#include "../nes/cpu/instruction.h"
+#include "../nes/mapper/nrom.h"
+#include <stdlib.h>
+#include <stdio.h>
+
+/* Names of addressing modes */
+static const char *modeName[NUL] = {
+	"IMP", "ACC", "ZEX", "ZEY", "INX", "INY", "IMM", "ZER", "REL", "ABS",
+	"ABX", "ABY", "ABI"
+};
+
+/* Mnemonic of an opcode handler */
+static const char* MBench_Mnemonic(uint8_t (*inst)(CPU*, Instruction*)) {
+	static const struct {
+		uint8_t (*inst)(CPU*, Instruction*);
+		const char *name;
+	} mnemonic[] = {
+		{_ADC, "ADC"}, {_AND, "AND"}, {_ASL, "ASL"}, {_BCC, "BCC"},
+		{_BCS, "BCS"}, {_BEQ, "BEQ"}, {_BIT, "BIT"}, {_BMI, "BMI"},
+		{_BNE, "BNE"}, {_BPL, "BPL"}, {_BRK, "BRK"}, {_BVC, "BVC"},
+		{_BVS, "BVS"}, {_CLC, "CLC"}, {_CLD, "CLD"}, {_CLI, "CLI"},
+		{_CLV, "CLV"}, {_CMP, "CMP"}, {_CPX, "CPX"}, {_CPY, "CPY"},
+		{_DEC, "DEC"}, {_DEX, "DEX"}, {_DEY, "DEY"}, {_EOR, "EOR"},
+		{_INC, "INC"}, {_INX, "INX"}, {_INY, "INY"}, {_JMP, "JMP"},
+		{_JSR, "JSR"}, {_LDA, "LDA"}, {_LDX, "LDX"}, {_LDY, "LDY"},
+		{_LSR, "LSR"}, {_NOP, "NOP"}, {_ORA, "ORA"}, {_PHA, "PHA"},
+		{_PHP, "PHP"}, {_PLA, "PLA"}, {_PLP, "PLP"}, {_ROL, "ROL"},
+		{_ROR, "ROR"}, {_RTI, "RTI"}, {_RTS, "RTS"}, {_SBC, "SBC"},
+		{_SEC, "SEC"}, {_SED, "SED"}, {_SEI, "SEI"}, {_STA, "STA"},
+		{_STX, "STX"}, {_STY, "STY"}, {_TAX, "TAX"}, {_TAY, "TAY"},
+		{_TSX, "TSX"}, {_TXA, "TXA"}, {_TXS, "TXS"}, {_TYA, "TYA"}
+	};
+	uint8_t i;
+	for (i = 0; i < sizeof(mnemonic) / sizeof(mnemonic[0]); i++) {
+		if (mnemonic[i].inst == inst)
+			return mnemonic[i].name;
+	}
+	return "???";
+}
+
+int run_MBinstruction(void) {
+	Header config;
+	Instruction inst;
+	char name[32];
+	uint16_t index;
+	uint8_t mode;
+
+	config.mirroring = NROM_HORIZONTAL;
+	config.romSize = NROM_16KIB;
+	Mapper *mapper = MapNROM_Create(&config);
+	if (mapper == NULL)
+		return 1;
+	CPU *cpu = CPU_Create(mapper);
+	if (cpu == NULL) {
+		Mapper_Destroy(mapper);
+		return 1;
+	}
+	CPU_Init(cpu);
+
+	/* Operands are taken in RAM: pointers of zero page lead to 0x0210 */
+	*Mapper_Get(mapper, AS_CPU, 0x0010) = 0x10;
+	*Mapper_Get(mapper, AS_CPU, 0x0011) = 0x02;
+	*Mapper_Get(mapper, AS_CPU, 0x0210) = 0x10;
+	*Mapper_Get(mapper, AS_CPU, 0x0211) = 0x02;
+	cpu->X = cpu->Y = 0;
+
+	/* Resolution of every addressing mode, operand being read */
+	for (mode = IMP; mode < NUL; mode++) {
+		inst.opcode.inst = NULL;
+		inst.opcode.addressingMode = mode;
+		inst.opcodeArg[0] = 0x10;
+		inst.opcodeArg[1] = 0x02;
+		snprintf(name, sizeof(name), "resolve %s", modeName[mode]);
+		MBENCH_RUN(name, MBENCH_CALL_CNT, Instruction_Resolve(&inst, cpu));
+	}
+
+	/* Every handler of opcode LUT, its operand being resolved once */
+	for (index = 0; index < 256; index++) {
+		inst.opcode = Opcode_Get(index);
+		if (inst.opcode.inst == NULL)
+			continue;
+		inst.opcodeArg[0] = 0x10;
+		inst.opcodeArg[1] = 0x02;
+		Instruction_Resolve(&inst, cpu);
+		snprintf(name, sizeof(name), "opcode %02X %s %s", index,
+				MBench_Mnemonic(inst.opcode.inst),
+				modeName[inst.opcode.addressingMode]);
+		MBENCH_RUN(name, MBENCH_CALL_CNT, inst.opcode.inst(cpu, &inst));
+	}
+
+	CPU_Destroy(cpu);
+	Mapper_Destroy(mapper);
+	return 0;
+}
@@ -0,0 +1,41 @@
+#include "MBench.h"
+#include "../nes/mapper/nrom.h"
+#include <stdlib.h>
+#include <stdio.h>
+
+int run_MBnrom(void) {
+	/* One address in every region of both address spaces */
+	static const struct {
+		const char *name;
+		uint8_t space;
+		uint16_t address;
+	} region[] = {
+		{"nrom Get CPU RAM",		AC_RD | AS_CPU, 0x0123},
+		{"nrom Get CPU IO",			AC_RD | AS_CPU, 0x2002},
+		{"nrom Get CPU dummy",		AC_RD | AS_CPU, 0x5000},
+		{"nrom Get CPU SRAM",		AC_RD | AS_CPU, 0x6123},
+		{"nrom Get CPU PRGROM 1",	AC_RD | AS_CPU, 0x8123},
+		{"nrom Get CPU PRGROM 2",	AC_RD | AS_CPU, 0xC123},
+		{"nrom Get PPU pattern",	AC_RD | AS_PPU, 0x0123},
+		{"nrom Get PPU nametable",	AC_RD | AS_PPU, 0x2C23},
+		{"nrom Get PPU palette",	AC_RD | AS_PPU, 0x3F11},
+		{"nrom Get LDR CHR",		AS_LDR,			LDR_CHR}
+	};
+	Header config;
+	uint8_t i;
+
+	config.mirroring = NROM_HORIZONTAL;
+	config.romSize = NROM_16KIB;
+	Mapper *mapper = MapNROM_Create(&config);
+	if (mapper == NULL)
+		return 1;
+
+	for (i = 0; i < sizeof(region) / sizeof(region[0]); i++) {
+		MBENCH_RUN(region[i].name, MBENCH_CALL_CNT,
+				MapNROM_Get(mapper->mapperData, region[i].space,
+					region[i].address));
+	}
+
+	Mapper_Destroy(mapper);
+	return 0;
+}
@@ -0,0 +1,69 @@
+#include "MBench.h"
+#include "../nes/ppu/ppu.h"
+#include "../nes/mapper/nrom.h"
+#include "../nes/const.h"
+#include <stdlib.h>
+#include <stdio.h>
+
+/* Scanline every task is run on */
+#define MBENCH_SCANLINE		100
+
+/* Put count sprites in range of MBENCH_SCANLINE, others out of it */
+static void MBench_SetSprites(PPU *ppu, uint8_t count) {
+	uint8_t i;
+	for (i = 0; i < SIZE_OAM / 4; i++) {
+		ppu->OAM[i * 4 + INDEX_OAM_Y_COORD] =
+			(i < count) ? MBENCH_SCANLINE : 0xFF;
+		ppu->OAM[i * 4 + INDEX_OAM_TILE] = i;
+		ppu->OAM[i * 4 + INDEX_OAM_ATTRIBUTE] = 0;
+		ppu->OAM[i * 4 + INDEX_OAM_X_COORD] = i * 4;
+	}
+}
+
+int run_MBppu(void) {
+	static const uint8_t spriteCnt[] = {0, 8, 64};
+	Header config;
+	char name[32];
+	uint8_t i;
+
+	config.mirroring = NROM_HORIZONTAL;
+	config.romSize = NROM_16KIB;
+	Mapper *mapper = MapNROM_Create(&config);
+	if (mapper == NULL)
+		return 1;
+	PPU *ppu = PPU_Create(mapper);
+	if (ppu == NULL) {
+		Mapper_Destroy(mapper);
+		return 1;
+	}
+	PPU_Init(ppu);
+	ppu->scanline = MBENCH_SCANLINE;
+
+	/* Background fetch over visible dots, a tile being loaded every 8 */
+	ppu->cycle = 0;
+	MBENCH_RUN("ppu FetchTile", MBENCH_CALL_CNT,
+			ppu->cycle = (ppu->cycle == 256) ? 1 : ppu->cycle + 1;
+			PPU_FetchTile(ppu));
+
+	/* Sprite evaluation over dots 65 to 256 */
+	for (i = 0; i < sizeof(spriteCnt); i++) {
+		MBench_SetSprites(ppu, spriteCnt[i]);
+		ppu->cycle = 256;
+		snprintf(name, sizeof(name), "ppu SpriteEvaluation %u",
+				spriteCnt[i]);
+		MBENCH_RUN(name, MBENCH_CALL_CNT,
+				ppu->cycle = (ppu->cycle == 256) ? 65 : ppu->cycle + 1;
+				PPU_SpriteEvaluation(ppu));
+	}
+
+	/* Pixel output over visible dots */
+	ppu->cycle = 0;
+	ppu->PPUMASK = PPUMASK_SHOW_BG | PPUMASK_SHOW_SPR;
+	MBENCH_RUN("ppu Draw", MBENCH_CALL_CNT,
+			ppu->cycle = (ppu->cycle == 256) ? 1 : ppu->cycle + 1;
+			PPU_Draw(ppu));
+
+	PPU_Destroy(ppu);
+	Mapper_Destroy(mapper);
+	return 0;
+}
@@ -0,0 +1,76 @@
+#include "UTest.h"
+#include "../common/arena.h"
+#include <stdlib.h>
+
+#define ARENA_BLOCK_SIZE	(4 * ARENA_ALIGN)
+
+static void test_Arena_Init(void **state) {
+	(void) state;
+	Arena arena;
+	uint8_t *block = NULL;
+	assert_int_equal(posix_memalign((void**) &block, ARENA_ALIGN,
+				ARENA_BLOCK_SIZE), 0);
+
+	assert_int_equal(Arena_Init(NULL, block, ARENA_BLOCK_SIZE), EXIT_FAILURE);
+	assert_int_equal(Arena_Init(&arena, NULL, ARENA_BLOCK_SIZE), EXIT_FAILURE);
+	/* Block must be aligned */
+	assert_int_equal(Arena_Init(&arena, block + 1, ARENA_BLOCK_SIZE - 1),
+			EXIT_FAILURE);
+	assert_int_equal(Arena_Init(&arena, block, ARENA_BLOCK_SIZE), EXIT_SUCCESS);
+	assert_ptr_equal(arena.base, block);
+	assert_int_equal(arena.size, ARENA_BLOCK_SIZE);
+	assert_int_equal(arena.used, 0);
+
+	free(block);
+}
+
+static void test_Arena_Alloc(void **state) {
+	(void) state;
+	Arena arena;
+	uint8_t *block = NULL, *chunk;
+	int i;
+	assert_int_equal(posix_memalign((void**) &block, ARENA_ALIGN,
+				ARENA_BLOCK_SIZE), 0);
+	for (i = 0; i < ARENA_BLOCK_SIZE; i++)
+		block[i] = 0xAA;
+	assert_int_equal(Arena_Init(&arena, block, ARENA_BLOCK_SIZE), EXIT_SUCCESS);
+
+	/* Chunks are zeroed and start on a cache line */
+	chunk = Arena_Alloc(&arena, 1);
+	assert_ptr_equal(chunk, block);
+	assert_int_equal(chunk[0], 0);
+	chunk = Arena_Alloc(&arena, ARENA_ALIGN + 1);
+	assert_ptr_equal(chunk, block + ARENA_ALIGN);
+	for (i = 0; i < ARENA_ALIGN + 1; i++)
+		assert_int_equal(chunk[i], 0);
+	assert_int_equal(arena.used, 3 * ARENA_ALIGN);
+	assert_int_equal(ARENA_SIZE(ARENA_ALIGN + 1), 2 * ARENA_ALIGN);
+
+	/* Full arena */
+	assert_ptr_equal(Arena_Alloc(&arena, ARENA_ALIGN + 1), NULL);
+	chunk = Arena_Alloc(&arena, ARENA_ALIGN);
+	assert_ptr_equal(chunk, block + 3 * ARENA_ALIGN);
+	assert_ptr_equal(Arena_Alloc(&arena, 1), NULL);
+	/* Chunks are not given back one by one */
+	Arena_Free(&arena, chunk);
+	assert_int_equal(arena.used, ARENA_BLOCK_SIZE);
+
+	/* No arena: heap */
+	chunk = Arena_Alloc(NULL, 16);
+	assert_ptr_not_equal(chunk, NULL);
+	for (i = 0; i < 16; i++)
+		assert_int_equal(chunk[i], 0);
+	Arena_Free(NULL, chunk);
+
+	free(block);
+}
+
+int run_UTarena(void) {
+	const struct CMUnitTest test_arena[] = {
+		cmocka_unit_test(test_Arena_Init),
+		cmocka_unit_test(test_Arena_Alloc),
+	};
+	int out = 0;
+	out += cmocka_run_group_tests(test_arena, NULL, NULL);
+	return out;
+}
@@ -0,0 +1,74 @@
+#include "UTest.h"
+#include "../bench.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+static void test_Bench_Median(void **state) {
+	(void) state;
+	double odd[3] = {3.0, 1.0, 2.0};
+	double even[4] = {4.0, 1.0, 3.0, 2.0};
+
+	assert_true(Bench_Median(odd, 3) == 2.0);
+	assert_true(Bench_Median(even, 4) == 2.5);
+	assert_true(Bench_Median(odd, 1) == 1.0);
+	assert_true(Bench_Median(NULL, 0) == 0.0);
+}
+
+static void test_Bench_Run(void **state) {
+	(void) state;
+	char *argv[] = {"mechgah-bench", "-f", "3", "-w", "0", "-r", "2", "-J",
+		"src/unit-test/roms/nestest.nes"};
+	char *wrong[] = {"mechgah-bench", "-r", "0"};
+	char report[1024];
+	size_t size;
+	FILE *file;
+	Bench bench;
+
+	/* Wrong values are refused */
+	optind = 1;
+	assert_int_equal(Bench_Init(&bench, 3, wrong), EXIT_FAILURE);
+
+	optind = 1;
+	assert_int_equal(Bench_Init(&bench, 9, argv), EXIT_SUCCESS);
+	assert_int_equal(bench.frameCount, 3);
+	assert_int_equal(bench.warmupCount, 0);
+	assert_int_equal(bench.repeatCount, 2);
+	assert_int_equal(bench.json, 1);
+	assert_int_equal(bench.romCount, 1);
+
+	/* Both repetitions execute the same cycles and give the same picture */
+	assert_int_equal(Bench_Run(&bench, &bench.result[0]), EXIT_SUCCESS);
+	assert_true(bench.result[0].cycles > 0);
+	assert_true(bench.result[0].hash != 0);
+	assert_true(bench.result[0].median > 0);
+
+	file = tmpfile();
+	assert_ptr_not_equal(file, NULL);
+	Bench_Report(&bench, file);
+	rewind(file);
+	size = fread(report, 1, sizeof(report) - 1, file);
+	report[size] = '\0';
+	fclose(file);
+	assert_ptr_not_equal(strstr(report, "\"rom\": "
+				"\"src/unit-test/roms/nestest.nes\""), NULL);
+	assert_ptr_not_equal(strstr(report, "\"ns_per_cycle\""), NULL);
+	assert_ptr_not_equal(strstr(report, "\"ns_per_dot\""), NULL);
+	assert_ptr_not_equal(strstr(report, "\"frames\": 3"), NULL);
+
+	/* Missing ROM fails */
+	bench.result[0].filename = "nothing.nes";
+	assert_int_equal(Bench_Run(&bench, &bench.result[0]), EXIT_FAILURE);
+	Bench_Destroy(&bench);
+}
+
+int run_UTbench(void) {
+	const struct CMUnitTest test_bench[] = {
+		cmocka_unit_test(test_Bench_Median),
+		cmocka_unit_test(test_Bench_Run),
+	};
+	int out = 0;
+	out += cmocka_run_group_tests(test_bench, NULL, NULL);
+	return out;
+}
@@ -52,21 +52,29 @@ static int teardown_CPU_ultimate(void **state) {
 static void test_CPU_ultimate(void **state) {
 	CPU *self = (CPU*) *state;
 	FILE *fCPU = NULL, *fGoal = NULL;
+	Trace *trace = NULL;
 	char strCPU[512], strGoal[512];
 	int i;
-	uint32_t clockCount = 0;
+	uint64_t clockCount = 0;
 	uint8_t context = 1;
 
 	/* Replace reset vector 0xC000 to launch automate test */
 	*(Mapper_Get(self->mapper, AS_CPU, 0xFFFC)) = 0x00;
 
 	/* Execute CPU for 5003 instructions (instruction before illegal opcode) */
+	assert_ptr_not_equal(trace = Trace_Create("cpu.trace"), NULL);
+	CPU_SetTrace(self, trace);
 	for (i = 0; i < 5003; i++) {
 		assert_int_equal(CPU_Execute(self, &context, &clockCount), EXIT_SUCCESS);
 	}
+	CPU_SetTrace(self, NULL);
+	Trace_Destroy(trace);
 
 	/* Diff between log files to ensure that CPU is working as expected */
-	assert_ptr_not_equal(fCPU = fopen("cpu.log", "r"), NULL);
+	assert_ptr_not_equal(fCPU = tmpfile(), NULL);
+	assert_int_equal(Trace_Render("cpu.trace", fCPU), EXIT_SUCCESS);
+	rewind(fCPU);
+	remove("cpu.trace");
 	assert_ptr_not_equal(fGoal = fopen("src/unit-test/roms/nestest.log", "r"), 
 						 NULL);
 	for (i = 0; i < 5003; i++) {
@@ -90,7 +98,7 @@ static void test_RESET(void** state){
     self->PC = 0xFEDC;
     /* NV_B DIZC */
     /* 1111 1011*/
-    self->P = 0xFB;
+    CPU_SetP(self, 0xFB);
     self->SP = 0xA3;
 
     /* set next PC LSByte */
@@ -107,7 +115,7 @@ static void test_RESET(void** state){
     /* PC fetch */
     assert_int_equal(self->PC, 0x5DC9);
     /* set I flag */
-    assert_int_equal(self->P, 0xFF);
+    assert_int_equal(CPU_GetP(self), 0xFF);
     /* decrement SP */
     assert_int_equal(self->SP, 0xA0);
     /* cycleCount set to 7 */
@@ -124,7 +132,7 @@ static void test_NMI(void** state) {
     self->PC = 0xFEDC;
     /* NV_B DIZC */
     /* 1111 1011*/
-    self->P = 0xFB;
+    CPU_SetP(self, 0xFB);
     self->SP = 0xA3;
 
     /* set next PC LSByte */
@@ -157,7 +165,7 @@ static void test_NMI(void** state) {
     /* P on stack */
     assert_int_equal(on_stack_P, 0xEB); /* on stack, B is clear */
     /* set I flag */
-    assert_int_equal(self->P, 0xFF);
+    assert_int_equal(CPU_GetP(self), 0xFF);
     /* decrement SP */
     assert_int_equal(self->SP, 0xA0);
     /* cycleCount set to 7 */
@@ -174,7 +182,7 @@ static void test_IRQ_I_FLAG_CLEAR(void** state) {
     self->PC = 0xFEDC;
     /* NV_B DIZC */
     /* 1111 1011*/
-    self->P = 0xFB;
+    CPU_SetP(self, 0xFB);
     self->SP = 0xA3;
 
     /* set next PC LSByte */
@@ -207,7 +215,7 @@ static void test_IRQ_I_FLAG_CLEAR(void** state) {
     /* P on stack */
     assert_int_equal(on_stack_P, 0xEB); /* on stack, B is clear */
     /* set I flag */
-    assert_int_equal(self->P, 0xFF);
+    assert_int_equal(CPU_GetP(self), 0xFF);
     /* decrement SP */
     assert_int_equal(self->SP, 0xA0);
     /* cycleCount set to 7 */
@@ -224,7 +232,7 @@ static void test_IRQ_I_FLAG_SET(void** state) {
     self->PC = 0xFEDC;
     /* NV_B DIZC */
     /* 1111 1111*/
-    self->P = 0xFF;
+    CPU_SetP(self, 0xFF);
     self->SP = 0xA3;
 
     /* execute function */
@@ -233,7 +241,7 @@ static void test_IRQ_I_FLAG_SET(void** state) {
     /* PC unchanged */
     assert_int_equal(self->PC, 0xFEDC);
     /* P unchanged */
-    assert_int_equal(self->P, 0xFF);
+    assert_int_equal(CPU_GetP(self), 0xFF);
     /* SP unchanged */
     assert_int_equal(self->SP, 0xA3);
     /* cycleCount set to O */
@@ -252,7 +260,7 @@ static void test_NMI_IRQ_CONFLICT(void** state) {
     self->PC = 0xFEDC;
     /* NV_B DIZC */
     /* 1111 1011*/
-    self->P = 0xFB;
+    CPU_SetP(self, 0xFB);
     self->SP = 0xA3;
 
     /* set next PC LSByte */
@@ -285,7 +293,7 @@ static void test_NMI_IRQ_CONFLICT(void** state) {
     /* P on stack */
     assert_int_equal(on_stack_P, 0xEB); /* on stack, B is clear */
     /* set I flag */
-    assert_int_equal(self->P, 0xFF);
+    assert_int_equal(CPU_GetP(self), 0xFF);
     /* decrement SP */
     assert_int_equal(self->SP, 0xA0);
     /* cycleCount set to 7 */
@@ -304,7 +312,7 @@ static void test_NO_INTERRUPT(void** state) {
     self->PC = 0xFEDC;
     /* NV_B DIZC */
     /* 1111 1111*/
-    self->P = 0xFF;
+    CPU_SetP(self, 0xFF);
     self->SP = 0xA3;
 
     /* execute function */
@@ -313,7 +321,7 @@ static void test_NO_INTERRUPT(void** state) {
     /* PC unchanged */
     assert_int_equal(self->PC, 0xFEDC);
     /* P unchanged */
-    assert_int_equal(self->P, 0xFF);
+    assert_int_equal(CPU_GetP(self), 0xFF);
     /* SP unchanged */
     assert_int_equal(self->SP, 0xA3);
     /* cycleCount set to O */
@@ -327,12 +335,12 @@ static void test_CPU_Execute(void **state) {
 	CPU *self = (CPU*) *state;
 	uint8_t *memory = Mapper_Get(self->mapper, AS_CPU, 0x8000);
 	uint8_t context = 0;
-	uint32_t clk = 0;
+	uint64_t clk = 0;
 	
 	/* Init register */
 	self->PC = 0x8000;
 	self->A = 1;
-	self->P = 0;
+	CPU_SetP(self, 0);
 
 	/* ADC $1AAA */
 	memory[0] = 0x6D;
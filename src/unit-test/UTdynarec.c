@@ -0,0 +1,119 @@
+#include "UTest.h"
+#include "../nes/nes.h"
+#include "../nes/cpu/dynarec.h"
+#include "../nes/const.h"
+#include "../common/macro.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* Both NES are run side by side: [0] interpreter, [1] dynamic recompiler */
+#define REF	0
+#define DYN	1
+
+#define DYNAREC_FRAME_CNT	60
+
+static uint8_t NextFrame_Interpret(NES *self, uint16_t keysPressed) {
+	/* Same as NES_NextFrame, one instruction at a time */
+	Controller_SetKeys(self->controller, keysPressed);
+	while (PPU_PictureDrawn(self->ppu) == 0) {
+		if (CPU_Interpret(self->cpu, &self->context, &self->clockCount)
+				== EXIT_FAILURE)
+			return EXIT_FAILURE;
+		PPU_CatchUp(self->ppu);
+	}
+	return EXIT_SUCCESS;
+}
+
+static void PowerUp(NES *self) {
+	PPU *ppu = self->ppu;
+	uint16_t address;
+
+	/* Same power-up memories and picture for both */
+	memset(Mapper_Get(self->mapper, AS_CPU, 0x0000), 0, 0x800);
+	memset(Mapper_Get(self->mapper, AS_CPU, 0x6000), 0, 0x2000);
+	for (address = 0x2000; address < 0x4000; address++)
+		*Mapper_Get(self->mapper, AS_PPU, address) = 0;
+	memset(NES_RenderIndex(self), PPU_BLANK_INDEX,
+			NES_SCREEN_WIDTH * NES_SCREEN_HEIGTH);
+	/* PPU_Init leaves rendering registers as they are */
+	memset(ppu->SOAM, 0, SIZE_SOAM);
+	memset(ppu->sprite, 0, sizeof(ppu->sprite));
+	ppu->SOAMADDR = ppu->spriteState = ppu->spriteData = ppu->spriteZero = 0;
+	ppu->bitmapL = ppu->bitmapH = ppu->attributeL = ppu->attributeH = 0;
+}
+
+static void Dynarec_Compare(char *filename) {
+	NES *nes[2];
+	uint16_t keys;
+	int i;
+
+	for (i = 0; i < 2; i++) {
+		nes[i] = NES_Create(filename);
+		assert_ptr_not_equal(nes[i], NULL);
+		PowerUp(nes[i]);
+	}
+
+	/* Reference never uses blocks, the other one always does */
+	Dynarec_Destroy(nes[REF]->cpu->dynarec);
+	nes[REF]->cpu->dynarec = NULL;
+	if (nes[DYN]->cpu->dynarec == NULL)
+		nes[DYN]->cpu->dynarec = Dynarec_Create(nes[DYN]->mapper);
+
+	/* Host not supported: nothing to compare */
+	if (nes[DYN]->cpu->dynarec != NULL) {
+		for (i = 0; i < DYNAREC_FRAME_CNT; i++) {
+			/* Press every button from time to time */
+			keys = ((i / 10) & 1) ? 0xFFFF : 0x0000;
+			assert_int_equal(NextFrame_Interpret(nes[REF], keys), EXIT_SUCCESS);
+			assert_int_equal(NES_NextFrame(nes[DYN], keys), EXIT_SUCCESS);
+			assert_int_equal(nes[REF]->clockCount, nes[DYN]->clockCount);
+			assert_int_equal(nes[REF]->cpu->A, nes[DYN]->cpu->A);
+			assert_int_equal(nes[REF]->cpu->X, nes[DYN]->cpu->X);
+			assert_int_equal(nes[REF]->cpu->Y, nes[DYN]->cpu->Y);
+			assert_int_equal(CPU_GetP(nes[REF]->cpu), CPU_GetP(nes[DYN]->cpu));
+			assert_int_equal(nes[REF]->cpu->SP, nes[DYN]->cpu->SP);
+			assert_int_equal(nes[REF]->cpu->PC, nes[DYN]->cpu->PC);
+			assert_memory_equal(Mapper_Get(nes[REF]->mapper, AS_CPU, 0x0000),
+					Mapper_Get(nes[DYN]->mapper, AS_CPU, 0x0000), 0x800);
+			assert_memory_equal(NES_Render(nes[REF]), NES_Render(nes[DYN]),
+					NES_SCREEN_WIDTH * NES_SCREEN_HEIGTH * sizeof(uint32_t));
+		}
+		/* Blocks must have been used */
+		assert_int_not_equal(nes[DYN]->cpu->dynarec->nbExecuted, 0);
+	}
+
+	for (i = 0; i < 2; i++)
+		NES_Destroy(nes[i]);
+}
+
+static void test_Dynarec_nestest(void **state) {
+	(void) state;
+	Dynarec_Compare("src/unit-test/roms/nestest.nes");
+}
+
+static void test_Dynarec_background(void **state) {
+	(void) state;
+	Dynarec_Compare("src/unit-test/roms/background.nes");
+}
+
+static void test_Dynarec_allpads(void **state) {
+	(void) state;
+	Dynarec_Compare("src/unit-test/roms/allpads.nes");
+}
+
+static void test_Dynarec_oamdma(void **state) {
+	(void) state;
+	Dynarec_Compare("src/unit-test/roms/oamdma.nes");
+}
+
+int run_UTdynarec(void) {
+	const struct CMUnitTest test_dynarec[] = {
+		cmocka_unit_test(test_Dynarec_nestest),
+		cmocka_unit_test(test_Dynarec_background),
+		cmocka_unit_test(test_Dynarec_allpads),
+		cmocka_unit_test(test_Dynarec_oamdma),
+	};
+	int out = 0;
+	out += cmocka_run_group_tests(test_dynarec, NULL, NULL);
+	return out;
+}
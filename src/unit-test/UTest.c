@@ -7,11 +7,25 @@ int main(void) {
 	out += run_instruction();
 	out += run_UTloader();
 	out += run_UTcpu();
+	out += run_UTicache();
+	out += run_UTthreaded();
+	out += run_UTdynarec();
 	out += run_UTstack();
 	out += run_UTppu();
 	out += run_UTjoypad();
 	out += run_UTcontroller();
 	out += run_UTkeys();
 	out += run_UTnes();
+	out += run_UTrunner();
+	out += run_UTrewind();
+	out += run_UTpool();
+	out += run_UTromimage();
+	out += run_UTarena();
+	out += run_UTscheduler();
+	out += run_UTbench();
+	out += run_UTtrace();
+	out += run_UTprofile();
+	out += run_UTstats();
+	out += run_UTtimeline();
 	return out;
 }
@@ -32,6 +32,27 @@ int run_UTloader(void);
  */
 int run_UTcpu(void);
 
+/**
+ * \brief Unit test of ICache module
+ *
+ * \return 0 if passed, number of failed otherwise
+ */
+int run_UTicache(void);
+
+/**
+ * \brief Unit test of Threaded module
+ *
+ * \return 0 if passed, number of failed otherwise
+ */
+int run_UTthreaded(void);
+
+/**
+ * \brief Unit test of Dynarec module
+ *
+ * \return 0 if passed, number of failed otherwise
+ */
+int run_UTdynarec(void);
+
 /**
  * \brief Unit test of Stack module
  *
@@ -81,3 +102,80 @@ int run_UTkeys(void);
  * \return 0 if passed, number of failed otherwise
  */
 int run_UTnes(void);
+
+/**
+ * \brief Unit test of Runner module
+ *
+ * \return 0 if passed, number of failed otherwise
+ */
+int run_UTrunner(void);
+
+/**
+ * \brief Unit test of Rewind module
+ *
+ * \return 0 if passed, number of failed otherwise
+ */
+int run_UTrewind(void);
+
+/**
+ * \brief Unit test of NESPool module
+ *
+ * \return 0 if passed, number of failed otherwise
+ */
+int run_UTpool(void);
+
+/**
+ * \brief Unit test of ROMImage module
+ *
+ * \return 0 if passed, number of failed otherwise
+ */
+int run_UTromimage(void);
+
+/**
+ * \brief Unit test of Arena module
+ *
+ * \return 0 if passed, number of failed otherwise
+ */
+int run_UTarena(void);
+
+/**
+ * \brief Unit test of Scheduler module
+ *
+ * \return 0 if passed, number of failed otherwise
+ */
+int run_UTscheduler(void);
+
+/**
+ * \brief Unit test of Bench module
+ *
+ * \return 0 if passed, number of failed otherwise
+ */
+int run_UTbench(void);
+
+/**
+ * \brief Unit test of Trace module
+ *
+ * \return 0 if passed, number of failed otherwise
+ */
+int run_UTtrace(void);
+
+/**
+ * \brief Unit test of Profile module
+ *
+ * \return 0 if passed, number of failed otherwise
+ */
+int run_UTprofile(void);
+
+/**
+ * \brief Unit test of Stats module
+ *
+ * \return 0 if passed, number of failed otherwise
+ */
+int run_UTstats(void);
+
+/**
+ * \brief Unit test of Timeline module
+ *
+ * \return 0 if passed, number of failed otherwise
+ */
+int run_UTtimeline(void);
@@ -0,0 +1,162 @@
+#include "UTest.h"
+#include "../nes/cpu/icache.h"
+#include "../nes/mapper/nrom.h"
+#include "../common/macro.h"
+
+static int setup_ICache(void **state) {
+	Header config;
+	config.mirroring = NROM_HORIZONTAL;
+	config.romSize = NROM_16KIB;
+	Mapper *mapper = MapNROM_Create(&config);
+	if (mapper == NULL)
+		return -1;
+
+	*state = (void *) CPU_Create(mapper);
+	if (*state == NULL) {
+		Mapper_Destroy(mapper);
+		return -1;
+	}
+
+	if (CPU_Init(*state))
+		return -1;
+
+	return 0;
+}
+
+static int teardown_ICache(void **state) {
+	CPU *cpu = (CPU*) *state;
+	Mapper_Destroy(cpu->mapper);
+	CPU_Destroy(cpu);
+	return 0;
+}
+
+static void test_ICache_Fetch(void **state) {
+	CPU *cpu = (CPU*) *state;
+	uint8_t *rom = Mapper_Get(cpu->mapper, AS_CPU, 0x8000);
+	Instruction inst;
+
+	assert_ptr_not_equal(cpu->icache, NULL);
+
+	/* LDA $0010,X */
+	rom[0] = 0xBD;
+	rom[1] = 0x10;
+	rom[2] = 0x00;
+	cpu->X = 2;
+	cpu->PC = 0x8000;
+
+	/* Miss: instruction is decoded from memory */
+	assert_int_equal(ICache_Fetch(cpu->icache, &inst, cpu), EXIT_SUCCESS);
+	assert_int_equal(cpu->PC, 0x8003);
+	assert_int_equal(inst.lastPC, 0x8000);
+	assert_int_equal(inst.rawOpcode, 0xBD);
+	assert_int_equal(inst.nbArg, 2);
+	assert_int_equal(inst.dataAddr, 0x0012);
+	assert_ptr_not_equal(cpu->icache->page[0], NULL);
+	assert_ptr_not_equal(cpu->icache->page[0][0].opcode.inst, NULL);
+
+	/* Hit: operand is resolved again with new register value */
+	cpu->X = 4;
+	cpu->PC = 0x8000;
+	assert_int_equal(ICache_Fetch(cpu->icache, &inst, cpu), EXIT_SUCCESS);
+	assert_int_equal(cpu->PC, 0x8003);
+	assert_int_equal(inst.rawOpcode, 0xBD);
+	assert_int_equal(inst.dataAddr, 0x0014);
+	assert_ptr_equal(inst.dataMem, Mapper_Get(cpu->mapper, AS_CPU, 0x0014));
+
+	/* Shared ROM operand is used in place when only read, copied when
+	 * written */
+	Mapper_SetPage(cpu->mapper, 0x81, rom + 0x100, NULL);
+	rom[0] = 0xAD;
+	rom[1] = 0x00;
+	rom[2] = 0x81;
+	ICache_Invalidate(cpu->icache, 0x8000);
+	cpu->PC = 0x8000;
+	assert_int_equal(ICache_Fetch(cpu->icache, &inst, cpu), EXIT_SUCCESS);
+	assert_ptr_equal(inst.dataMem, Mapper_Get(cpu->mapper, AS_CPU, 0x8100));
+	rom[0] = 0x0E;
+	ICache_Invalidate(cpu->icache, 0x8000);
+	cpu->PC = 0x8000;
+	assert_int_equal(ICache_Fetch(cpu->icache, &inst, cpu), EXIT_SUCCESS);
+	assert_ptr_equal(inst.dataMem, &cpu->bus);
+	Mapper_SetPage(cpu->mapper, 0x81, rom + 0x100, rom + 0x100);
+	rom[0] = 0xBD;
+	rom[1] = 0x10;
+	rom[2] = 0x00;
+	ICache_Invalidate(cpu->icache, 0x8000);
+
+	/* Code in RAM is never cached */
+	uint8_t *ram = Mapper_Get(cpu->mapper, AS_CPU, 0x0200);
+	ram[0] = 0xEA;
+	cpu->PC = 0x0200;
+	assert_int_equal(ICache_Fetch(cpu->icache, &inst, cpu), EXIT_SUCCESS);
+	assert_int_equal(cpu->PC, 0x0201);
+	assert_int_equal(inst.rawOpcode, 0xEA);
+
+	/* Without cache, instruction is still decoded */
+	cpu->PC = 0x8000;
+	assert_int_equal(ICache_Fetch(NULL, &inst, cpu), EXIT_SUCCESS);
+	assert_int_equal(cpu->PC, 0x8003);
+	assert_int_equal(inst.rawOpcode, 0xBD);
+}
+
+static void test_ICache_Invalidate(void **state) {
+	CPU *cpu = (CPU*) *state;
+	uint8_t *rom = Mapper_Get(cpu->mapper, AS_CPU, 0x80FF);
+	Instruction inst;
+
+	/* LDA #$01 located on page boundary */
+	rom[0] = 0xA9;
+	rom[1] = 0x01;
+	cpu->PC = 0x80FF;
+	assert_int_equal(ICache_Fetch(cpu->icache, &inst, cpu), EXIT_SUCCESS);
+	assert_int_equal(*inst.dataMem, 0x01);
+	assert_ptr_not_equal(cpu->icache->page[0][0xFF].opcode.inst, NULL);
+
+	/* Writing argument in next page invalidates previous page too */
+	rom[0] = 0xEA;
+	ICache_Invalidate(cpu->icache, 0x8100);
+	assert_ptr_equal(cpu->icache->page[0][0xFF].opcode.inst, NULL);
+	cpu->PC = 0x80FF;
+	assert_int_equal(ICache_Fetch(cpu->icache, &inst, cpu), EXIT_SUCCESS);
+	assert_int_equal(inst.rawOpcode, 0xEA);
+	assert_int_equal(cpu->PC, 0x8100);
+
+	/* Address outside of PRG-ROM is ignored */
+	ICache_Invalidate(cpu->icache, 0x7FFF);
+	ICache_Invalidate(NULL, 0x8000);
+	assert_ptr_not_equal(cpu->icache->page[0][0xFF].opcode.inst, NULL);
+
+	/* Flush forgets everything */
+	ICache_Flush(cpu->icache);
+	assert_ptr_equal(cpu->icache->page[0][0xFF].opcode.inst, NULL);
+}
+
+static void test_ICache_Store(void **state) {
+	CPU *cpu = (CPU*) *state;
+	uint8_t *rom = Mapper_Get(cpu->mapper, AS_CPU, 0x8000);
+	Instruction inst;
+	uint8_t data = 0xEA;
+
+	/* INX */
+	rom[0] = 0xE8;
+	cpu->PC = 0x8000;
+	assert_int_equal(ICache_Fetch(cpu->icache, &inst, cpu), EXIT_SUCCESS);
+	assert_int_equal(inst.rawOpcode, 0xE8);
+
+	/* CPU write in PRG space must drop decoded instruction */
+	_STORE(cpu, 0x8000, &data);
+	cpu->PC = 0x8000;
+	assert_int_equal(ICache_Fetch(cpu->icache, &inst, cpu), EXIT_SUCCESS);
+	assert_int_equal(inst.rawOpcode, 0xEA);
+}
+
+int run_UTicache(void) {
+	const struct CMUnitTest test_icache[] = {
+		cmocka_unit_test(test_ICache_Fetch),
+		cmocka_unit_test(test_ICache_Invalidate),
+		cmocka_unit_test(test_ICache_Store),
+	};
+	int out = 0;
+	out += cmocka_run_group_tests(test_icache, setup_ICache, teardown_ICache);
+	return out;
+}
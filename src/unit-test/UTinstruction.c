@@ -4,6 +4,7 @@
 #include "../nes/mapper/ioreg.h"
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
 static int setup_CPU(void **state) {
 	/* Init NROM */
@@ -23,7 +24,7 @@ static void test_Instruction_DMA(void **state) {
 	CPU *self = (CPU*) *state;
 	Instruction inst;
 	uint8_t oamData;
-	uint32_t clockCycle = 0;
+	uint64_t clockCycle = 0;
 	int i;
 
 	uint8_t *memData = Mapper_Get(self->mapper, AS_CPU, 0x1100);
@@ -31,17 +32,19 @@ static void test_Instruction_DMA(void **state) {
 		memData[i] = i;
 
 	self->cntDMA = -1;
-	/* Reset acknlowdge  bit of OAMDMA */
-	Mapper_Ack(self->mapper, 0x4014);
-	/* Connect to OAMDMA register */
+	/* Connect to OAMDMA register, writing it requests a DMA */
 	IOReg_Extract(self->mapper)->bank2[OAMDMA] = &self->OAMDMA;
 	IOReg_Extract(self->mapper)->bank1[OAMDATA] = &oamData;
+	IOReg_SetHandler(IOReg_Extract(self->mapper), 0x4014, NULL,
+			CPU_WriteOAMDMA, self);
 
-	/* No DMA request */
+	/* No DMA request, reading OAMDMA doesn't start any */
+	assert_int_equal(Instruction_DMA(&inst, self, &clockCycle), 0); 
+	Mapper_Read(self->mapper, 0x4014);
 	assert_int_equal(Instruction_DMA(&inst, self, &clockCycle), 0); 
 
 	/* Request a DMA */
-	*(Mapper_Get(self->mapper, AC_RD | AS_CPU, 0x4014)) = 0x11;
+	Mapper_Write(self->mapper, 0x4014, 0x11);
 	assert_int_equal(Instruction_DMA(&inst, self, &clockCycle), 1); 
 	assert_int_equal(clockCycle, 1);
 	for (i = 0; i < 256; i++) {
@@ -54,7 +57,7 @@ static void test_Instruction_DMA(void **state) {
 	assert_int_equal(self->cntDMA, -1); 
 
 	/* Request a DMA with odd clock cycle */
-	*(Mapper_Get(self->mapper, AC_RD | AS_CPU, 0x4014)) = 0x11;
+	Mapper_Write(self->mapper, 0x4014, 0x11);
 	assert_int_equal(Instruction_DMA(&inst, self, &clockCycle), 1); 
 	assert_int_equal(clockCycle, 515);
 	for (i = 0; i < 256; i++) {
@@ -102,14 +105,16 @@ static void test_Instruction_Fetch(void **state){
 	free(instru);
 }
 
-static void test_Instruction_PrintLog(void **state) {
+static void test_Instruction_Trace(void **state) {
 	CPU *self = (CPU*) *state;
 	Mapper *mapper = self->mapper;
 	Instruction inst;
 	char expectedStr[] =
-		"8000 6D CD AB    A:11 X:22 Y:33 P:44 SP:55 CYC:555\n";
+		"8000 6D CD AB    A:11 X:22 Y:33 P:44 SP:55 CYC:555\n"
+		"8000 DMA @0211   A:11 X:22 Y:33 P:44 SP:55 CYC:556\n";
 	char readStr[256];
 	FILE *fLog = NULL;
+	Trace *trace = NULL;
 	uint8_t *memory = Mapper_Get(mapper, AS_CPU, 0x8000);
 	memory[0] = 0x6D;
 	memory[1] = 0xCD;
@@ -118,15 +123,28 @@ static void test_Instruction_PrintLog(void **state) {
 	self->A = 0x11;
 	self->X = 0x22;
 	self->Y = 0x33;
-	self->P = 0x44;
+	CPU_SetP(self, 0x44);
 	self->SP = 0x55;
 	assert_int_equal(Instruction_Fetch(&inst, self), EXIT_SUCCESS);
-	remove("cpu.log");
-	Instruction_PrintLog(&inst, self, 555);
-	fLog = fopen("cpu.log", "r");
+	assert_ptr_not_equal(trace = Trace_Create("cpu.trace"), NULL);
+	CPU_SetTrace(self, trace);
+	Instruction_Trace(&inst, self, 555);
+	/* DMA step records address read instead of opcode */
+	inst.nbArg = NBARG_DMA;
+	inst.dataAddr = 0x0211;
+	Instruction_Trace(&inst, self, 556);
+	CPU_SetTrace(self, NULL);
+	Trace_Destroy(trace);
+
+	fLog = tmpfile();
 	assert_ptr_not_equal(fLog, NULL);
-	fgets(readStr, 256, fLog);
-	assert_int_equal(strcmp(expectedStr,readStr), 0);
+	assert_int_equal(Trace_Render("cpu.trace", fLog), EXIT_SUCCESS);
+	remove("cpu.trace");
+	rewind(fLog);
+	assert_int_equal(fread(readStr, 1, sizeof(readStr), fLog),
+			strlen(expectedStr));
+	readStr[strlen(expectedStr)] = '\0';
+	assert_int_equal(strcmp(expectedStr, readStr), 0);
 	fclose(fLog);
 }
 
@@ -379,50 +397,50 @@ static void test_SET_SIGN(void **state) {
 	CPU *self = (CPU*) *state;
 	uint8_t val = -128;
 	_SET_SIGN(self, &val);
-	assert_int_equal(self->P & 0x80, 0x80);
+	assert_int_equal(CPU_GetP(self) & 0x80, 0x80);
 	val = 127;
 	_SET_SIGN(self, &val);
-	assert_int_equal(self->P & 0x80, 0x00);
+	assert_int_equal(CPU_GetP(self) & 0x80, 0x00);
 }
 
 static void test_SET_ZERO(void **state) {
 	CPU *self = (CPU*) *state;
 	uint8_t val = 0;
 	_SET_ZERO(self, &val);
-	assert_int_equal(self->P & 0x02, 0x02);
+	assert_int_equal(CPU_GetP(self) & 0x02, 0x02);
 	val = 255;
 	_SET_ZERO(self, &val);
-	assert_int_equal(self->P & 0x02, 0x00);
+	assert_int_equal(CPU_GetP(self) & 0x02, 0x00);
 }
 
 static void test_SET_CARRY(void **state) {
 	CPU *self = (CPU*) *state;
 	_SET_CARRY(self, 1);
-	assert_int_equal(self->P & 0x01, 0x01);
+	assert_int_equal(CPU_GetP(self) & 0x01, 0x01);
 	_SET_CARRY(self, 0);
-	assert_int_equal(self->P & 0x01, 0x00);
+	assert_int_equal(CPU_GetP(self) & 0x01, 0x00);
 }
 
 static void test_SET_OVERFLOW(void **state) {
 	CPU *self = (CPU*) *state;
 	_SET_OVERFLOW(self, 1);
-	assert_int_equal(self->P & 0x40, 0x40);
+	assert_int_equal(CPU_GetP(self) & 0x40, 0x40);
 	_SET_OVERFLOW(self, 0);
-	assert_int_equal(self->P & 0x40, 0x00);
+	assert_int_equal(CPU_GetP(self) & 0x40, 0x00);
 }
 
 static void test_SET_INTERRUPT(void **state) {
 	CPU *self = (CPU*) *state;
-	assert_int_equal(self->P & 0x04, 0x00);
+	assert_int_equal(CPU_GetP(self) & 0x04, 0x00);
 	_SET_INTERRUPT(self);
-	assert_int_equal(self->P & 0x04, 0x04);
+	assert_int_equal(CPU_GetP(self) & 0x04, 0x04);
 }
 
 static void test_SET_BREAK(void **state) {
 	CPU *self = (CPU*) *state;
-	assert_int_equal(self->P & 0x10, 0x00);
+	assert_int_equal(CPU_GetP(self) & 0x10, 0x00);
 	_SET_BREAK(self);
-	assert_int_equal(self->P & 0x10, 0x10);
+	assert_int_equal(CPU_GetP(self) & 0x10, 0x10);
 }
 
 static void test_REL_ADDR(void **state) {
@@ -437,14 +455,14 @@ static void test_REL_ADDR(void **state) {
 static void test_SET_SR(void **state) {
 	CPU *self = (CPU*) *state;
 	uint8_t val = 0xAA;
-	self->P = 0;
+	CPU_SetP(self, 0);
 	_SET_SR(self, &val);
-	assert_int_equal(self->P, val);
+	assert_int_equal(CPU_GetP(self), val);
 }
 
 static void test_GET_SR(void **state) {
 	CPU *self = (CPU*) *state;
-	self->P = 0xAA;
+	CPU_SetP(self, 0xAA);
 	assert_int_equal(_GET_SR(self), 0xAA);
 }
 
@@ -489,57 +507,60 @@ static void test_STORE(void **state) {
 
 static void test_SET_WR(void **state) {
 	CPU *self = (CPU*) *state;
+	uint8_t *ptr = Mapper_Get(self->mapper, AS_CPU, 0x2000);
 	assert_int_equal(Mapper_Ack(self->mapper, 0x2000), 0);
-	_SET_WR(self, 0x2000);
+	/* Operand copy of an IO register is written back */
+	_SET_WR(self, 0x2000, 0x55);
+	assert_int_equal(*ptr, 0x55);
 	assert_int_equal(Mapper_Ack(self->mapper, 0x2000), AC_WR);
 }
 
 static void test_IF_CARRY(void **state) {
 	CPU *self = (CPU*) *state;
-	self->P = 0x01;
+	CPU_SetP(self, 0x01);
 	assert_int_equal(_IF_CARRY(self), 1);
-	self->P = 0x00;
+	CPU_SetP(self, 0x00);
 	assert_int_equal(_IF_CARRY(self), 0);
 }
 
 static void test_IF_OVERFLOW(void **state) {
 	CPU *self = (CPU*) *state;
-	self->P = 0x70;
+	CPU_SetP(self, 0x70);
 	assert_int_equal(_IF_OVERFLOW(self), 1);
-	self->P = 0x00;
+	CPU_SetP(self, 0x00);
 	assert_int_equal(_IF_OVERFLOW(self), 0);
 }
 
 static void test_IF_SIGN(void **state) {
 	CPU *self = (CPU*) *state;
-	self->P = 0x80;
+	CPU_SetP(self, 0x80);
 	assert_int_equal(_IF_SIGN(self), 1);
-	self->P = 0x00;
+	CPU_SetP(self, 0x00);
 	assert_int_equal(_IF_SIGN(self), 0);
 
 }
 
 static void test_IF_ZERO(void **state) {
 	CPU *self = (CPU*) *state;
-	self->P = 0x02;
+	CPU_SetP(self, 0x02);
 	assert_int_equal(_IF_ZERO(self), 1);
-	self->P = 0x00;
+	CPU_SetP(self, 0x00);
 	assert_int_equal(_IF_ZERO(self), 0);
 }
 
 static void test_IF_INTERRUPT(void **state) {
 	CPU *self = (CPU*) *state;
-	self->P = 0x04;
+	CPU_SetP(self, 0x04);
 	assert_int_equal(_IF_INTERRUPT(self), 1);
-	self->P = 0x00;
+	CPU_SetP(self, 0x00);
 	assert_int_equal(_IF_INTERRUPT(self), 0);
 }
 
 static void test_IF_BREAK(void **state) {
 	CPU *self = (CPU*) *state;
-	self->P = 0x10;
+	CPU_SetP(self, 0x10);
 	assert_int_equal(_IF_BREAK(self), 1);
-	self->P = 0x00;
+	CPU_SetP(self, 0x00);
 	assert_int_equal(_IF_BREAK(self), 0);
 }
 
@@ -584,36 +605,36 @@ static void test_ADC(void **state) {
 
 	/* Test ADC general behavior */
 	/* Test : Sign bit */
-	self->P = 0;
+	CPU_SetP(self, 0);
 	self->A = 0x11;
 	clk = inst.opcode.inst(self, &inst);
 	assert_int_equal(clk, 2);
 	assert_int_equal(self->A, 0xAA + 0x11);
-	assert_int_equal(self->P, 0x80);
+	assert_int_equal(CPU_GetP(self), 0x80);
 	/* Test : Overflow and Sign bit */
-	self->P = 0;
+	CPU_SetP(self, 0);
 	self->A = 0x7F;
 	src = 1;
 	clk = inst.opcode.inst(self, &inst);
 	assert_int_equal(clk, 2);
 	assert_int_equal(self->A, 0x7F + 1);
-	assert_int_equal(self->P, 0xC0);
+	assert_int_equal(CPU_GetP(self), 0xC0);
 	/* Test : Zero and Carry bit */
-	self->P = 0;
+	CPU_SetP(self, 0);
 	self->A = 0xFF;
 	src = 1;
 	clk = inst.opcode.inst(self, &inst);
 	assert_int_equal(clk, 2);
 	assert_int_equal(self->A, 0x00);
-	assert_int_equal(self->P, 0x03);
+	assert_int_equal(CPU_GetP(self), 0x03);
 	/* Test : Add with carry */
-	self->P = 0x01;
+	CPU_SetP(self, 0x01);
 	self->A = 1;
 	src = 1;
 	clk = inst.opcode.inst(self, &inst);
 	assert_int_equal(clk, 2);
 	assert_int_equal(self->A, 0x03);
-	assert_int_equal(self->P, 0x00);
+	assert_int_equal(CPU_GetP(self), 0x00);
 
 	/* Test addressing mode clock */
 	inst.opcode = Opcode_Get(0x65); /* ADC ZER */
@@ -681,7 +702,7 @@ static void test_AND(void **state) {
 	inst.dataMem = &src;
 	inst.pageCrossed = 0;
 	self->A = 0x00;
-	self->P = 0x00;
+	CPU_SetP(self, 0x00);
 
 	inst.opcode = Opcode_Get(0x29); /* _AND Immediate clk=2 */
 	clk = inst.opcode.inst(self, &inst);
@@ -726,8 +747,8 @@ static void test_AND(void **state) {
 	assert_ptr_equal(ptr, inst.opcode.inst);
 
 	assert_int_equal(self->A,0x81);
-	assert_int_equal(self->P&0x02,0x00);
-	assert_int_equal(self->P&0x80,0x80);
+	assert_int_equal(CPU_GetP(self)&0x02,0x00);
+	assert_int_equal(CPU_GetP(self)&0x80,0x80);
 }
 
 static void test_ASL(void **state) {
@@ -745,34 +766,34 @@ static void test_ASL(void **state) {
 
 	/* Test ASL general behavior */
 	/* Test : Carry bit */
-	self->P = 0;
+	CPU_SetP(self, 0);
 	Mapper_Ack(self->mapper, 0x2000);
 	clk = inst.opcode.inst(self, &inst);
 	assert_int_equal(Mapper_Ack(self->mapper, 0x2000), AC_WR);
 	assert_int_equal(clk, 2);
 	assert_int_equal(src, (0xAA << 1) & 0xFF);
-	assert_int_equal(self->P, 0x01);
+	assert_int_equal(CPU_GetP(self), 0x01);
 	/* Test : Zero and carry bit */
-	self->P = 0;
+	CPU_SetP(self, 0);
 	src = 0x80;
 	clk = inst.opcode.inst(self, &inst);
 	assert_int_equal(clk, 2);
 	assert_int_equal(src, 0x00);
-	assert_int_equal(self->P, 0x03);
+	assert_int_equal(CPU_GetP(self), 0x03);
 	/* Test : Sign and carry bit */
-	self->P = 0;
+	CPU_SetP(self, 0);
 	src = 0xC0;
 	clk = inst.opcode.inst(self, &inst);
 	assert_int_equal(clk, 2);
 	assert_int_equal(src, 0x80);
-	assert_int_equal(self->P, 0x81);
+	assert_int_equal(CPU_GetP(self), 0x81);
 	/* Test : No carry bit */
-	self->P = 0;
+	CPU_SetP(self, 0);
 	src = 0x3F;
 	clk = inst.opcode.inst(self, &inst);
 	assert_int_equal(clk, 2);
 	assert_int_equal(src, 0x3F << 1);
-	assert_int_equal(self->P, 0x00);
+	assert_int_equal(CPU_GetP(self), 0x00);
 
 	/* Test addressing mode clock */
 	inst.opcode = Opcode_Get(0x06); /* ASL ZER */
@@ -810,11 +831,11 @@ static void test_BXX(void **state, uint8_t keep, uint8_t branch,
 
 	/* Test BXX general behavior */
 	/* Test : Conserve PC */
-	self->P = keep;
+	CPU_SetP(self, keep);
 	clk = inst.opcode.inst(self, &inst);
 	assert_int_equal(clk, 2);
 	/* Test : Branch */
-	self->P = branch;
+	CPU_SetP(self, branch);
 	clk = inst.opcode.inst(self, &inst);
 	assert_int_equal(clk, 3);
 }
@@ -846,24 +867,24 @@ static void test_BIT(void **state) {
 	/* Test BIT general behavior */
 	/* Test : Sign, overflow and zero bit */
 	self->A = 0;
-	self->P = 0;
+	CPU_SetP(self, 0);
 	clk = inst.opcode.inst(self, &inst);
 	assert_int_equal(clk, 3);
-	assert_int_equal(self->P, 0xC2);
+	assert_int_equal(CPU_GetP(self), 0xC2);
 	/* Test : Sign and overflow bit */
 	self->A = 0xC0;
-	self->P = 0;
+	CPU_SetP(self, 0);
 	clk = inst.opcode.inst(self, &inst);
 	assert_int_equal(clk, 3);
-	assert_int_equal(self->P, 0xC0);
+	assert_int_equal(CPU_GetP(self), 0xC0);
 	/* Test : No bit */
 	self->A = 0x20;
-	self->P = 0;
+	CPU_SetP(self, 0);
 	src = 0x20;
 	clk = _BIT(self, &inst);
 	clk = inst.opcode.inst(self, &inst);
 	assert_int_equal(clk, 3);
-	assert_int_equal(self->P, 0x00);
+	assert_int_equal(CPU_GetP(self), 0x00);
 
 	/* Test addressing mode clock */
 	inst.opcode = Opcode_Get(0x2C); /* BIT ABS */
@@ -898,7 +919,7 @@ static void test_BRK(void **state) {
 	/* Test : change PC */
 	self->SP = 0xFF;
 	self->PC = 0xABCC;
-	self->P = 0x00;
+	CPU_SetP(self, 0x00);
 	_STORE(self, 0xFFFE, &temp);
 	temp = 0xFE;
 	_STORE(self, 0xFFFF, &temp);
@@ -909,7 +930,7 @@ static void test_BRK(void **state) {
 	assert_int_equal(0x10, _PULL(self));
 	assert_int_equal(0xCD, _PULL(self));
 	assert_int_equal(0xAB, _PULL(self));
-	assert_int_equal(0x04, self->P);
+	assert_int_equal(0x04, CPU_GetP(self));
 }
 
 static void test_BVC(void **state) {
@@ -978,7 +999,7 @@ static void test_CLC(void **state){
 	uint8_t clk = inst.opcode.inst(self, &inst);
 	self->SP = 0xFF;
 	assert_int_equal(clk,2);
-	assert_int_equal(((self->P)&0x01),0);
+	assert_int_equal(((CPU_GetP(self))&0x01),0);
 	assert_ptr_equal(ptr, inst.opcode.inst);
 }
 
@@ -990,7 +1011,7 @@ static void test_CLD(void **state){
 	uint8_t clk = inst.opcode.inst(self, &inst);
 	self->SP = 0xFF;
 	assert_int_equal(clk,2);
-	assert_int_equal(((self->P)&0x08),0);
+	assert_int_equal(((CPU_GetP(self))&0x08),0);
 	assert_ptr_equal(ptr, inst.opcode.inst);
 }
 
@@ -1002,7 +1023,7 @@ static void test_CLI(void **state){
 	uint8_t clk = inst.opcode.inst(self, &inst);
 	self->SP = 0xFF;
 	assert_int_equal(clk,2);
-	assert_int_equal(((self->P)&0x04),0);
+	assert_int_equal(((CPU_GetP(self))&0x04),0);
 	assert_ptr_equal(ptr, inst.opcode.inst);
 }
 
@@ -1014,7 +1035,7 @@ static void test_CLV(void **state){
 	uint8_t clk = inst.opcode.inst(self, &inst);
 	self->SP = 0xFF;
 	assert_int_equal(clk,2);
-	assert_int_equal(((self->P)&0x40),0);
+	assert_int_equal(((CPU_GetP(self))&0x40),0);
 	assert_ptr_equal(ptr, inst.opcode.inst);
 }
 
@@ -1025,7 +1046,7 @@ static void test_CMP(void **state){
 	uint8_t src = 0x0, clk = 0;
 	inst.pageCrossed = 0;
 	self->A = 0x00;
-	self->P = 0x00;
+	CPU_SetP(self, 0x00);
 	inst.dataMem = &src;
 
 	inst.opcode = Opcode_Get(0xC9); /* CMP Immediate clk=2 */
@@ -1069,9 +1090,9 @@ static void test_CMP(void **state){
 	assert_ptr_equal(ptr, inst.opcode.inst);
 
 	/*Test des bit des flags*/
-	assert_int_equal(((self->P)&0x01),0x01);
-	assert_int_equal(((self->P)&0x02),0x02);
-	assert_int_equal(((self->P)&0x80),0x00);
+	assert_int_equal(((CPU_GetP(self))&0x01),0x01);
+	assert_int_equal(((CPU_GetP(self))&0x02),0x02);
+	assert_int_equal(((CPU_GetP(self))&0x80),0x00);
 }
 
 static void test_CPX(void **state){
@@ -1080,7 +1101,7 @@ static void test_CPX(void **state){
 	uint8_t (*ptr)(CPU*, Instruction*) = _CPX;
 	uint8_t src = 0x0, clk = 0;
 	self->X = 0x80;
-	self->P = 0x00;
+	CPU_SetP(self, 0x00);
 	inst.dataMem = &src;
 
 	inst.opcode = Opcode_Get(0xE0); /* _CPX Immediate clk=2 */
@@ -1098,9 +1119,9 @@ static void test_CPX(void **state){
 	assert_int_equal(clk,4);
 	assert_ptr_equal(ptr, inst.opcode.inst);
 
-	assert_int_equal(((self->P)&0x01),0x00);
-	assert_int_equal(((self->P)&0x02),0x00);
-	assert_int_equal(((self->P)&0x80),0x80);
+	assert_int_equal(((CPU_GetP(self))&0x01),0x00);
+	assert_int_equal(((CPU_GetP(self))&0x02),0x00);
+	assert_int_equal(((CPU_GetP(self))&0x80),0x80);
 
 }
 
@@ -1110,7 +1131,7 @@ static void test_CPY(void **state){
 	uint8_t (*ptr)(CPU*, Instruction*) = _CPY;
 	uint8_t src = 0x0, clk = 0;
 	self->Y = 0x60;
-	self->P = 0x00;
+	CPU_SetP(self, 0x00);
 	inst.dataMem = &src;
 
 	inst.opcode = Opcode_Get(0xC0); /* _CPY Immediate clk=2 */
@@ -1128,9 +1149,9 @@ static void test_CPY(void **state){
 	assert_int_equal(clk,4);
 	assert_ptr_equal(ptr, inst.opcode.inst);
 
-	assert_int_equal(((self->P)&0x01),0x01);
-	assert_int_equal(((self->P)&0x02),0x00);
-	assert_int_equal(((self->P)&0x80),0x00);
+	assert_int_equal(((CPU_GetP(self))&0x01),0x01);
+	assert_int_equal(((CPU_GetP(self))&0x02),0x00);
+	assert_int_equal(((CPU_GetP(self))&0x80),0x00);
 
 }
 
@@ -1166,8 +1187,8 @@ static void test_DEC(void **state){
 	assert_ptr_equal(ptr, inst.opcode.inst);
 
 	assert_int_equal(src,0XFF);
-	assert_int_equal(((self->P)&0x02),0x00);
-	assert_int_equal(((self->P)&0x80),0x80);
+	assert_int_equal(((CPU_GetP(self))&0x02),0x00);
+	assert_int_equal(((CPU_GetP(self))&0x80),0x80);
 }
 
 static void test_DEX(void **state){
@@ -1183,8 +1204,8 @@ static void test_DEX(void **state){
 	assert_ptr_equal(ptr, inst.opcode.inst);
 
 	assert_int_equal(self->X,0x00);
-	assert_int_equal(((self->P)&0x02),0x02);
-	assert_int_equal(((self->P)&0x80),0x00);
+	assert_int_equal(((CPU_GetP(self))&0x02),0x02);
+	assert_int_equal(((CPU_GetP(self))&0x80),0x00);
 }
 
 static void test_DEY(void **state){
@@ -1200,8 +1221,8 @@ static void test_DEY(void **state){
 	assert_ptr_equal(ptr, inst.opcode.inst);
 
 	assert_int_equal(self->Y,0xFF);
-	assert_int_equal(((self->P)&0x02),0x00);
-	assert_int_equal(((self->P)&0x80),0x80);
+	assert_int_equal(((CPU_GetP(self))&0x02),0x00);
+	assert_int_equal(((CPU_GetP(self))&0x80),0x80);
 }
 
 static void test_EOR(void **state){
@@ -1211,7 +1232,7 @@ static void test_EOR(void **state){
 	uint8_t src = 0x00, clk = 0;
 	inst.pageCrossed = 0;
 	self->A = 0x00;
-	self->P = 0x00;
+	CPU_SetP(self, 0x00);
 	inst.dataMem = &src;
 
 	inst.opcode = Opcode_Get(0x49); /* _EOR Immediate clk=2 */
@@ -1255,8 +1276,8 @@ static void test_EOR(void **state){
 	assert_ptr_equal(ptr, inst.opcode.inst);
 
 	assert_int_equal(self->A,0xFF);
-	assert_int_equal(((self->P)&0x02),0x00);
-	assert_int_equal(((self->P)&0x80),0x80);
+	assert_int_equal(((CPU_GetP(self))&0x02),0x00);
+	assert_int_equal(((CPU_GetP(self))&0x80),0x80);
 }
 
 static void test_INC(void **state){
@@ -1292,8 +1313,8 @@ static void test_INC(void **state){
 	assert_ptr_equal(ptr, inst.opcode.inst);
 
 	assert_int_equal(src,0X00);
-	assert_int_equal(((self->P)&0x02),0x02);
-	assert_int_equal(((self->P)&0x80),0x00);
+	assert_int_equal(((CPU_GetP(self))&0x02),0x02);
+	assert_int_equal(((CPU_GetP(self))&0x80),0x00);
 }
 
 static void test_INX(void **state){
@@ -1309,8 +1330,8 @@ static void test_INX(void **state){
 	assert_ptr_equal(ptr, inst.opcode.inst);
 
 	assert_int_equal(self->X,0xFF);
-	assert_int_equal(((self->P)&0x02),0x00);
-	assert_int_equal(((self->P)&0x80),0x80);
+	assert_int_equal(((CPU_GetP(self))&0x02),0x00);
+	assert_int_equal(((CPU_GetP(self))&0x80),0x80);
 }
 
 static void test_INY(void **state){
@@ -1326,8 +1347,8 @@ static void test_INY(void **state){
 	assert_ptr_equal(ptr, inst.opcode.inst);
 
 	assert_int_equal(self->Y,0xFF);
-	assert_int_equal(((self->P)&0x02),0x00);
-	assert_int_equal(((self->P)&0x80),0x80);
+	assert_int_equal(((CPU_GetP(self))&0x02),0x00);
+	assert_int_equal(((CPU_GetP(self))&0x80),0x80);
 }
 
 static void test_LDA(void **state){
@@ -1343,28 +1364,28 @@ static void test_LDA(void **state){
 	assert_ptr_equal(ptr, inst.opcode.inst);
 	/* Test LDA general behavior */
 	/* Signed and Non-Zero */
-	self->P = 0;
+	CPU_SetP(self, 0);
 	src = 0xFF;
 	clk = inst.opcode.inst(self, &inst);
 	assert_int_equal(clk, 2);
-	assert_int_equal(self->P & 0x80,0x80);
-	assert_int_equal(self->P & 0x02,0x00);
+	assert_int_equal(CPU_GetP(self) & 0x80,0x80);
+	assert_int_equal(CPU_GetP(self) & 0x02,0x00);
 	assert_int_equal(self->A,0xFF);
 	/* Unsigned and Non-Zero */
-	self->P = 0;
+	CPU_SetP(self, 0);
 	src = 0x04;
 	clk = inst.opcode.inst(self, &inst);
 	assert_int_equal(clk, 2);
-	assert_int_equal(self->P & 0x80,0x00);
-	assert_int_equal(self->P & 0x02,0x00);
+	assert_int_equal(CPU_GetP(self) & 0x80,0x00);
+	assert_int_equal(CPU_GetP(self) & 0x02,0x00);
 	assert_int_equal(self->A,0x04);
 	/* Unsigned and Zero*/
-	self->P = 0;
+	CPU_SetP(self, 0);
 	src = 0x00;
 	clk = inst.opcode.inst(self, &inst);
 	assert_int_equal(clk, 2);
-	assert_int_equal(self->P & 0x80,0x00);
-	assert_int_equal(self->P & 0x02,0x02);
+	assert_int_equal(CPU_GetP(self) & 0x80,0x00);
+	assert_int_equal(CPU_GetP(self) & 0x02,0x02);
 	assert_int_equal(self->A,0x00);
 
 	/* Test addressing mode clock */
@@ -1439,28 +1460,28 @@ static void test_LDX(void **state){
 	assert_ptr_equal(ptr, inst.opcode.inst);
 	/* Test LDX general behavior */
 	/* Signed and Non-Zero */
-	self->P = 0;
+	CPU_SetP(self, 0);
 	src = 0xFF;
 	clk = inst.opcode.inst(self, &inst);
 	assert_int_equal(clk, 2);
-	assert_int_equal(self->P & 0x80,0x80);
-	assert_int_equal(self->P & 0x02,0x00);
+	assert_int_equal(CPU_GetP(self) & 0x80,0x80);
+	assert_int_equal(CPU_GetP(self) & 0x02,0x00);
 	assert_int_equal(self->X,0xFF);
 	/* Unsigned and Non-Zero */
-	self->P = 0;
+	CPU_SetP(self, 0);
 	src = 0x04;
 	clk = inst.opcode.inst(self, &inst);
 	assert_int_equal(clk, 2);
-	assert_int_equal(self->P & 0x80,0x00);
-	assert_int_equal(self->P & 0x02,0x00);
+	assert_int_equal(CPU_GetP(self) & 0x80,0x00);
+	assert_int_equal(CPU_GetP(self) & 0x02,0x00);
 	assert_int_equal(self->X,0x04);
 	/* Unsigned and Zero*/
-	self->P = 0;
+	CPU_SetP(self, 0);
 	src = 0x00;
 	clk = inst.opcode.inst(self, &inst);
 	assert_int_equal(clk, 2);
-	assert_int_equal(self->P & 0x80,0x00);
-	assert_int_equal(self->P & 0x02,0x02);
+	assert_int_equal(CPU_GetP(self) & 0x80,0x00);
+	assert_int_equal(CPU_GetP(self) & 0x02,0x02);
 	assert_int_equal(self->X,0x00);
 
 	/* Test addressing mode clock */
@@ -1505,28 +1526,28 @@ static void test_LDY(void **state){
 	assert_ptr_equal(ptr, inst.opcode.inst);
 	/* Test LDX general behavior */
 	/* Signed and Non-Zero */
-	self->P = 0;
+	CPU_SetP(self, 0);
 	src = 0xFF;
 	clk = inst.opcode.inst(self, &inst);
 	assert_int_equal(clk, 2);
-	assert_int_equal(self->P & 0x80,0x80);
-	assert_int_equal(self->P & 0x02,0x00);
+	assert_int_equal(CPU_GetP(self) & 0x80,0x80);
+	assert_int_equal(CPU_GetP(self) & 0x02,0x00);
 	assert_int_equal(self->Y,0xFF);
 	/* Unsigned and Non-Zero */
-	self->P = 0;
+	CPU_SetP(self, 0);
 	src = 0x04;
 	clk = inst.opcode.inst(self, &inst);
 	assert_int_equal(clk, 2);
-	assert_int_equal(self->P & 0x80,0x00);
-	assert_int_equal(self->P & 0x02,0x00);
+	assert_int_equal(CPU_GetP(self) & 0x80,0x00);
+	assert_int_equal(CPU_GetP(self) & 0x02,0x00);
 	assert_int_equal(self->Y,0x04);
 	/* Unsigned and Zero*/
-	self->P = 0;
+	CPU_SetP(self, 0);
 	src = 0x00;
 	clk = inst.opcode.inst(self, &inst);
 	assert_int_equal(clk, 2);
-	assert_int_equal(self->P & 0x80,0x00);
-	assert_int_equal(self->P & 0x02,0x02);
+	assert_int_equal(CPU_GetP(self) & 0x80,0x00);
+	assert_int_equal(CPU_GetP(self) & 0x02,0x02);
 	assert_int_equal(self->Y,0x00);
 
 	/* Test addressing mode clock */
@@ -1572,33 +1593,33 @@ static void test_LSR(void **state){
 	assert_ptr_equal(ptr, inst.opcode.inst);
 	/* Test LDX general behavior */
 	/* Signed and Non-Zero */
-	self->P = 0;
+	CPU_SetP(self, 0);
 	src = 0xFF;
 	Mapper_Ack(self->mapper, 0x2000);
 	clk = inst.opcode.inst(self, &inst);
 	assert_int_equal(Mapper_Ack(self->mapper, 0x2000), AC_WR);
 	assert_int_equal(clk, 2);
-	assert_int_equal(self->P & 0x80,0x00);
-	assert_int_equal(self->P & 0x02,0x00);
-	assert_int_equal(self->P & 0x01,0x01);
+	assert_int_equal(CPU_GetP(self) & 0x80,0x00);
+	assert_int_equal(CPU_GetP(self) & 0x02,0x00);
+	assert_int_equal(CPU_GetP(self) & 0x01,0x01);
 	assert_int_equal(src,0x7F);
 	/* Unsigned and Non-Zero */
-	self->P = 0;
+	CPU_SetP(self, 0);
 	src = 0x04;
 	clk = inst.opcode.inst(self, &inst);
 	assert_int_equal(clk, 2);
-	assert_int_equal(self->P & 0x80,0x00);
-	assert_int_equal(self->P & 0x02,0x00);
-	assert_int_equal(self->P & 0x01,0x00);
+	assert_int_equal(CPU_GetP(self) & 0x80,0x00);
+	assert_int_equal(CPU_GetP(self) & 0x02,0x00);
+	assert_int_equal(CPU_GetP(self) & 0x01,0x00);
 	assert_int_equal(src,0x02);
 	/* Unsigned and Zero*/
-	self->P = 0;
+	CPU_SetP(self, 0);
 	src = 0x00;
 	clk = inst.opcode.inst(self, &inst);
 	assert_int_equal(clk, 2);
-	assert_int_equal(self->P & 0x80,0x00);
-	assert_int_equal(self->P & 0x02,0x02);
-	assert_int_equal(self->P & 0x01,0x00);
+	assert_int_equal(CPU_GetP(self) & 0x80,0x00);
+	assert_int_equal(CPU_GetP(self) & 0x02,0x02);
+	assert_int_equal(CPU_GetP(self) & 0x01,0x00);
 	assert_int_equal(src,0x00);
 
 	/* Test addressing mode clock */
@@ -1669,7 +1690,7 @@ static void test_PHP(void **state) {
 	assert_ptr_equal(ptr, inst.opcode.inst);
 
 	/* Test PHP behaviour */
-	self->P = 0x2A;
+	CPU_SetP(self, 0x2A);
 	clock = inst.opcode.inst(self,&inst);
 
 	assert_int_equal(clock, 3);
@@ -1784,7 +1805,8 @@ static void test_RTI(void **state) {
 	_PUSH(self, &temp);
 	temp = self->PC & 0xFF;
 	_PUSH(self, &temp);
-	_PUSH(self, &self->P);
+	temp = CPU_GetP(self);
+	_PUSH(self, &temp);
 
 	/* change values of SR and PC */
 	test_value = 0x6B;
@@ -1840,12 +1862,12 @@ static void test_SEI(void **state) {
 	/* Test SEI behaviour */
 
 	/* clear I flag */
-	self->P &= ~(1UL << 2);
+	CPU_SetP(self, CPU_GetP(self) & ~(1UL << 2));
 
 	clock = inst.opcode.inst(self,&inst);
 
 	assert_int_equal(clock, 2);
-	assert_int_equal(self->P & 0x04, 0x04);
+	assert_int_equal(CPU_GetP(self) & 0x04, 0x04);
 }
 
 static void test_TAX(void **state) {
@@ -2036,7 +2058,7 @@ static void test_SEC(void **state){
 	Instruction inst;
 	uint8_t (*ptr)(CPU*, Instruction*) = _SEC;
 	uint8_t clk = 0;
-	self->P = 0x00;
+	CPU_SetP(self, 0x00);
 
 	/* Verify opcode LUT */
 	inst.opcode = Opcode_Get(0x38); /* SEC IMP */
@@ -2045,7 +2067,7 @@ static void test_SEC(void **state){
 	assert_int_equal(clk, 2);
 
 	/* Verify general behavior */
-	assert_int_equal(self->P & 0x01,0x01);
+	assert_int_equal(CPU_GetP(self) & 0x01,0x01);
 }
 
 static void test_SED(void **state){
@@ -2053,7 +2075,7 @@ static void test_SED(void **state){
 	Instruction inst;
 	uint8_t (*ptr)(CPU*, Instruction*) = _SED;
 	uint8_t clk = 0;
-	self->P = 0x00;
+	CPU_SetP(self, 0x00);
 
 	/* Verify opcode LUT */
 	inst.opcode = Opcode_Get(0xF8); /* SED IMP */
@@ -2062,7 +2084,7 @@ static void test_SED(void **state){
 	assert_int_equal(clk, 2);
 
 	/* Verify general behavior */
-	assert_int_equal(self->P & 0x08,0x08);
+	assert_int_equal(CPU_GetP(self) & 0x08,0x08);
 }
 
 static void test_STA(void **state){
@@ -2194,31 +2216,31 @@ static void test_ORA(void **state){
 	assert_ptr_equal(ptr, inst.opcode.inst);
 	/* Test ORA general behavior */
 	/* Result is signed and non zero */
-	self->P = 0;
+	CPU_SetP(self, 0);
 	self->A = 0x69;
 	src = 0x96;
 	clk = inst.opcode.inst(self, &inst);
 	assert_int_equal(clk, 2);
-	assert_int_equal(self->P & 0x80,0x80);
-	assert_int_equal(self->P & 0x02,0x00);
+	assert_int_equal(CPU_GetP(self) & 0x80,0x80);
+	assert_int_equal(CPU_GetP(self) & 0x02,0x00);
 	assert_int_equal(self->A,0xFF); /* 0x69 | 0x96 = 0xFF */
 	/* Result is unsigned and non zero */
-	self->P = 0;
+	CPU_SetP(self, 0);
 	self->A = 0x1A;
 	src = 0x4F;
 	clk = inst.opcode.inst(self, &inst);
 	assert_int_equal(clk, 2);
-	assert_int_equal(self->P & 0x80,0x00);
-	assert_int_equal(self->P & 0x02,0x00);
+	assert_int_equal(CPU_GetP(self) & 0x80,0x00);
+	assert_int_equal(CPU_GetP(self) & 0x02,0x00);
 	assert_int_equal(self->A,0x5F); /* 0x1A | 0x4F = 0x5F */
 	/* Result is zero */
-	self->P = 0;
+	CPU_SetP(self, 0);
 	self->A = 0x00;
 	src = 0x00;
 	clk = inst.opcode.inst(self, &inst);
 	assert_int_equal(clk, 2);
-	assert_int_equal(self->P & 0x80,0x00);
-	assert_int_equal(self->P & 0x02,0x02);
+	assert_int_equal(CPU_GetP(self) & 0x80,0x00);
+	assert_int_equal(CPU_GetP(self) & 0x02,0x02);
 	assert_int_equal(self->A,0x00); /* 0x00 | 0x00 = 0x00 */
 
 	/* Test addressing mode clock */
@@ -2286,87 +2308,87 @@ static void test_ROL(void **state){
 	assert_ptr_equal(ptr, inst.opcode.inst);
 	/* Test ROL general behavior */
 	/* initial Carry is 0, bit 7 is 0, bit 6 is 0 */
-	self->P = 0x00;
+	CPU_SetP(self, 0x00);
 	src = 0x3F;
 	Mapper_Ack(self->mapper, 0x2000);
 	clk = inst.opcode.inst(self, &inst);
 	assert_int_equal(Mapper_Ack(self->mapper, 0x2000), AC_WR);
 	assert_int_equal(clk, 2);
-	assert_int_equal(self->P & 0x01,0x00);
-	assert_int_equal(self->P & 0x80,0x00);
-	assert_int_equal(self->P & 0x02,0x00);
+	assert_int_equal(CPU_GetP(self) & 0x01,0x00);
+	assert_int_equal(CPU_GetP(self) & 0x80,0x00);
+	assert_int_equal(CPU_GetP(self) & 0x02,0x00);
 	assert_int_equal(src,0x7E); /* 0011 1111 -> 0111 1110 */
 	/* initial Carry is 0, bit 7 is 0, bit 6 is 1 */
-	self->P = 0x00;
+	CPU_SetP(self, 0x00);
 	src = 0x7F;
 	clk = inst.opcode.inst(self, &inst);
 	assert_int_equal(clk, 2);
-	assert_int_equal(self->P & 0x01,0x00);
-	assert_int_equal(self->P & 0x80,0x80);
-	assert_int_equal(self->P & 0x02,0x00);
+	assert_int_equal(CPU_GetP(self) & 0x01,0x00);
+	assert_int_equal(CPU_GetP(self) & 0x80,0x80);
+	assert_int_equal(CPU_GetP(self) & 0x02,0x00);
 	assert_int_equal(src,0xFE); /* 0111 1111 -> 1111 1110 */
 	/* initial Carry is 0, bit 7 is 1, bit 6 is 0 */
-	self->P = 0x00;
+	CPU_SetP(self, 0x00);
 	src = 0xBF;
 	clk = inst.opcode.inst(self, &inst);
 	assert_int_equal(clk, 2);
-	assert_int_equal(self->P & 0x01,0x01);
-	assert_int_equal(self->P & 0x80,0x00);
-	assert_int_equal(self->P & 0x02,0x00);
+	assert_int_equal(CPU_GetP(self) & 0x01,0x01);
+	assert_int_equal(CPU_GetP(self) & 0x80,0x00);
+	assert_int_equal(CPU_GetP(self) & 0x02,0x00);
 	assert_int_equal(src,0x7E); /* 1011 1111 -> 0111 1110 */
 	/* initial Carry is 0, bit 7 is 1, bit 6 is 1 */
-	self->P = 0x00;
+	CPU_SetP(self, 0x00);
 	src = 0xFF;
 	clk = inst.opcode.inst(self, &inst);
 	assert_int_equal(clk, 2);
-	assert_int_equal(self->P & 0x01,0x01);
-	assert_int_equal(self->P & 0x80,0x80);
-	assert_int_equal(self->P & 0x02,0x00);
+	assert_int_equal(CPU_GetP(self) & 0x01,0x01);
+	assert_int_equal(CPU_GetP(self) & 0x80,0x80);
+	assert_int_equal(CPU_GetP(self) & 0x02,0x00);
 	assert_int_equal(src,0xFE); /* 1111 1111 -> 1111 1110 */
 	/* initial Carry is 1, bit 7 is 0, bit 6 is 0 */
-	self->P = 0x01;
+	CPU_SetP(self, 0x01);
 	src = 0x3F;
 	clk = inst.opcode.inst(self, &inst);
 	assert_int_equal(clk, 2);
-	assert_int_equal(self->P & 0x01,0x00);
-	assert_int_equal(self->P & 0x80,0x00);
-	assert_int_equal(self->P & 0x02,0x00);
+	assert_int_equal(CPU_GetP(self) & 0x01,0x00);
+	assert_int_equal(CPU_GetP(self) & 0x80,0x00);
+	assert_int_equal(CPU_GetP(self) & 0x02,0x00);
 	assert_int_equal(src,0x7F); /* 0011 1111 -> 0111 1111 */
 	/* initial Carry is 1, bit 7 is 0, bit 6 is 1 */
-	self->P = 0x01;
+	CPU_SetP(self, 0x01);
 	src = 0x7F;
 	clk = inst.opcode.inst(self, &inst);
 	assert_int_equal(clk, 2);
-	assert_int_equal(self->P & 0x01,0x00);
-	assert_int_equal(self->P & 0x80,0x80);
-	assert_int_equal(self->P & 0x02,0x00);
+	assert_int_equal(CPU_GetP(self) & 0x01,0x00);
+	assert_int_equal(CPU_GetP(self) & 0x80,0x80);
+	assert_int_equal(CPU_GetP(self) & 0x02,0x00);
 	assert_int_equal(src,0xFF); /* 0111 1111 -> 1111 1111 */
 	/* initial Carry is 1, bit 7 is 1, bit 6 is 0 */
-	self->P = 0x01;
+	CPU_SetP(self, 0x01);
 	src = 0xBF;
 	clk = inst.opcode.inst(self, &inst);
 	assert_int_equal(clk, 2);
-	assert_int_equal(self->P & 0x01,0x01);
-	assert_int_equal(self->P & 0x80,0x00);
-	assert_int_equal(self->P & 0x02,0x00);
+	assert_int_equal(CPU_GetP(self) & 0x01,0x01);
+	assert_int_equal(CPU_GetP(self) & 0x80,0x00);
+	assert_int_equal(CPU_GetP(self) & 0x02,0x00);
 	assert_int_equal(src,0x7F); /* 1011 1111 -> 0111 1111 */
 	/* initial Carry is 1, bit 7 is 1, bit 6 is 1 */
-	self->P = 0x01;
+	CPU_SetP(self, 0x01);
 	src = 0xFF;
 	clk = inst.opcode.inst(self, &inst);
 	assert_int_equal(clk, 2);
-	assert_int_equal(self->P & 0x01,0x01);
-	assert_int_equal(self->P & 0x80,0x80);
-	assert_int_equal(self->P & 0x02,0x00);
+	assert_int_equal(CPU_GetP(self) & 0x01,0x01);
+	assert_int_equal(CPU_GetP(self) & 0x80,0x80);
+	assert_int_equal(CPU_GetP(self) & 0x02,0x00);
 	assert_int_equal(src,0xFF); /* 1111 1111 -> 1111 1111 */
 	/* result becomes 0x00 */
-	self->P = 0x00;
+	CPU_SetP(self, 0x00);
 	src = 0x80;
 	clk = inst.opcode.inst(self, &inst);
 	assert_int_equal(clk, 2);
-	assert_int_equal(self->P & 0x01,0x01);
-	assert_int_equal(self->P & 0x80,0x00);
-	assert_int_equal(self->P & 0x02,0x02);
+	assert_int_equal(CPU_GetP(self) & 0x01,0x01);
+	assert_int_equal(CPU_GetP(self) & 0x80,0x00);
+	assert_int_equal(CPU_GetP(self) & 0x02,0x02);
 	assert_int_equal(src,0x00); /* 1000 0000 -> 0000 0000 */
 
 	/* Test addressing mode clock */
@@ -2404,51 +2426,51 @@ static void test_ROR(void **state){
 	assert_ptr_equal(ptr, inst.opcode.inst);
 	/* Test ROL general behavior */
 	/* initial Carry is 0, bit 0 is 0 */
-	self->P = 0x00;
+	CPU_SetP(self, 0x00);
 	src = 0xFE;
 	Mapper_Ack(self->mapper, 0x2000);
 	clk = inst.opcode.inst(self, &inst);
 	assert_int_equal(Mapper_Ack(self->mapper, 0x2000), AC_WR);
 	assert_int_equal(clk, 2);
-	assert_int_equal(self->P & 0x01,0x00);
-	assert_int_equal(self->P & 0x80,0x00);
-	assert_int_equal(self->P & 0x02,0x00);
+	assert_int_equal(CPU_GetP(self) & 0x01,0x00);
+	assert_int_equal(CPU_GetP(self) & 0x80,0x00);
+	assert_int_equal(CPU_GetP(self) & 0x02,0x00);
 	assert_int_equal(src,0x7F); /* 1111 1110 -> 0111 1111 */
 	/* initial Carry is 0, bit 0 is 1 */
-	self->P = 0x00;
+	CPU_SetP(self, 0x00);
 	src = 0xFF;
 	clk = inst.opcode.inst(self, &inst);
 	assert_int_equal(clk, 2);
-	assert_int_equal(self->P & 0x01,0x01);
-	assert_int_equal(self->P & 0x80,0x00);
-	assert_int_equal(self->P & 0x02,0x00);
+	assert_int_equal(CPU_GetP(self) & 0x01,0x01);
+	assert_int_equal(CPU_GetP(self) & 0x80,0x00);
+	assert_int_equal(CPU_GetP(self) & 0x02,0x00);
 	assert_int_equal(src,0x7F); /* 1111 1110 -> 0111 1111 */
 	/* initial Carry is 1, bit 0 is 0 */
-	self->P = 0x01;
+	CPU_SetP(self, 0x01);
 	src = 0xFE;
 	clk = inst.opcode.inst(self, &inst);
 	assert_int_equal(clk, 2);
-	assert_int_equal(self->P & 0x01,0x00);
-	assert_int_equal(self->P & 0x80,0x80);
-	assert_int_equal(self->P & 0x02,0x00);
+	assert_int_equal(CPU_GetP(self) & 0x01,0x00);
+	assert_int_equal(CPU_GetP(self) & 0x80,0x80);
+	assert_int_equal(CPU_GetP(self) & 0x02,0x00);
 	assert_int_equal(src,0xFF); /* 1111 1110 -> 1111 1111 */
 	/* initial Carry is 1, bit 0 is 1 */
-	self->P = 0x01;
+	CPU_SetP(self, 0x01);
 	src = 0xFF;
 	clk = inst.opcode.inst(self, &inst);
 	assert_int_equal(clk, 2);
-	assert_int_equal(self->P & 0x01,0x01);
-	assert_int_equal(self->P & 0x80,0x80);
-	assert_int_equal(self->P & 0x02,0x00);
+	assert_int_equal(CPU_GetP(self) & 0x01,0x01);
+	assert_int_equal(CPU_GetP(self) & 0x80,0x80);
+	assert_int_equal(CPU_GetP(self) & 0x02,0x00);
 	assert_int_equal(src,0xFF); /* 1111 1110 -> 1111 1111 */
 	/* result becomes 0x00 */
-	self->P = 0x00;
+	CPU_SetP(self, 0x00);
 	src = 0x01;
 	clk = inst.opcode.inst(self, &inst);
 	assert_int_equal(clk, 2);
-	assert_int_equal(self->P & 0x01,0x01);
-	assert_int_equal(self->P & 0x80,0x00);
-	assert_int_equal(self->P & 0x02,0x02);
+	assert_int_equal(CPU_GetP(self) & 0x01,0x01);
+	assert_int_equal(CPU_GetP(self) & 0x80,0x00);
+	assert_int_equal(CPU_GetP(self) & 0x02,0x02);
 	assert_int_equal(src,0x00); /* 0000 0001 -> 0000 0000 */
 
 	/* Test addressing mode clock */
@@ -2495,59 +2517,59 @@ CARRY
 
 	/* Test SBC general behavior */
 	/* Unsigned result, without initial carry */
-	self->P = 0x00;
+	CPU_SetP(self, 0x00);
 	self->A = 0x02;
 	src = 0x01;
 	clk = inst.opcode.inst(self, &inst);
 	assert_int_equal(clk, 2);
-	assert_int_equal(self->P & 0x80, 0x00); /* Sign = 0 */
-	assert_int_equal(self->P & 0x02, 0x02); /* Zero = 1 */
-	assert_int_equal(self->P & 0x40, 0x00); /* Ovf = 0 */
-	assert_int_equal(self->P & 0x01, 0x01); /* Carry out = 1 */
+	assert_int_equal(CPU_GetP(self) & 0x80, 0x00); /* Sign = 0 */
+	assert_int_equal(CPU_GetP(self) & 0x02, 0x02); /* Zero = 1 */
+	assert_int_equal(CPU_GetP(self) & 0x40, 0x00); /* Ovf = 0 */
+	assert_int_equal(CPU_GetP(self) & 0x01, 0x01); /* Carry out = 1 */
 	assert_int_equal(self->A, 0x00); /* 0x02 - 0x01 - 0x01 = 0x00 */
 	/* Unsigned result, with initial carry */
-	self->P = 0x01;
+	CPU_SetP(self, 0x01);
 	self->A = 0x02;
 	src = 0x01;
 	clk = inst.opcode.inst(self, &inst);
 	assert_int_equal(clk, 2);
-	assert_int_equal(self->P & 0x80, 0x00); /* Sign = 0 */
-	assert_int_equal(self->P & 0x02, 0x00); /* Zero = 0 */
-	assert_int_equal(self->P & 0x40, 0x00); /* Ovf = 0 */
-	assert_int_equal(self->P & 0x01, 0x01); /* Carry out = 1 */
+	assert_int_equal(CPU_GetP(self) & 0x80, 0x00); /* Sign = 0 */
+	assert_int_equal(CPU_GetP(self) & 0x02, 0x00); /* Zero = 0 */
+	assert_int_equal(CPU_GetP(self) & 0x40, 0x00); /* Ovf = 0 */
+	assert_int_equal(CPU_GetP(self) & 0x01, 0x01); /* Carry out = 1 */
 	assert_int_equal(self->A, 0x01); /* 0x02 - 0x01 = 0x01 */
 	/* Signed result, without initial carry */
-	self->P = 0x00;
+	CPU_SetP(self, 0x00);
 	self->A = 0x01;
 	src = 0x02;
 	clk = inst.opcode.inst(self, &inst);
 	assert_int_equal(clk, 2);
-	assert_int_equal(self->P & 0x80, 0x80); /* Sign = 1 */
-	assert_int_equal(self->P & 0x02, 0x00); /* Zero = 0 */
-	assert_int_equal(self->P & 0x40, 0x00); /* Ovf = 0 */
-	assert_int_equal(self->P & 0x01, 0x00); /* Carry out = 0 */
+	assert_int_equal(CPU_GetP(self) & 0x80, 0x80); /* Sign = 1 */
+	assert_int_equal(CPU_GetP(self) & 0x02, 0x00); /* Zero = 0 */
+	assert_int_equal(CPU_GetP(self) & 0x40, 0x00); /* Ovf = 0 */
+	assert_int_equal(CPU_GetP(self) & 0x01, 0x00); /* Carry out = 0 */
 	assert_int_equal(self->A, 0xFE); /* 0x01 - 0x02 - 0x01 = 0xFE */
 	/* Signed result, with initial carry */
-	self->P = 0x01;
+	CPU_SetP(self, 0x01);
 	self->A = 0x01;
 	src = 0x02;
 	clk = inst.opcode.inst(self, &inst);
 	assert_int_equal(clk, 2);
-	assert_int_equal(self->P & 0x80, 0x80); /* Sign = 1 */
-	assert_int_equal(self->P & 0x02, 0x00); /* Zero = 0 */
-	assert_int_equal(self->P & 0x40, 0x00); /* Ovf = 0 */
-	assert_int_equal(self->P & 0x01, 0x00); /* Carry out = 0 */
+	assert_int_equal(CPU_GetP(self) & 0x80, 0x80); /* Sign = 1 */
+	assert_int_equal(CPU_GetP(self) & 0x02, 0x00); /* Zero = 0 */
+	assert_int_equal(CPU_GetP(self) & 0x40, 0x00); /* Ovf = 0 */
+	assert_int_equal(CPU_GetP(self) & 0x01, 0x00); /* Carry out = 0 */
 	assert_int_equal(self->A, 0xFF); /* 0x01 - 0x02 = 0xFF */
 	/* Result has overflowed */
-	self->P = 0x01;
+	CPU_SetP(self, 0x01);
 	self->A = 0x80;
 	src = 0x01;
 	clk = inst.opcode.inst(self, &inst);
 	assert_int_equal(clk, 2);
-	assert_int_equal(self->P & 0x80, 0x00); /* Sign = 0 */
-	assert_int_equal(self->P & 0x02, 0x00); /* Zero = 0 */
-	assert_int_equal(self->P & 0x40, 0x40); /* Ovf = 1 */
-	assert_int_equal(self->P & 0x01, 0x01); /* Carry out = 1 */
+	assert_int_equal(CPU_GetP(self) & 0x80, 0x00); /* Sign = 0 */
+	assert_int_equal(CPU_GetP(self) & 0x02, 0x00); /* Zero = 0 */
+	assert_int_equal(CPU_GetP(self) & 0x40, 0x40); /* Ovf = 1 */
+	assert_int_equal(CPU_GetP(self) & 0x01, 0x01); /* Carry out = 1 */
 	assert_int_equal(self->A, 0x7F); /* 0x80 - 0x01 = 0x7F (and not -129) */
 
 	/* Test addressing mode clock */
@@ -2863,7 +2885,7 @@ int run_instruction(void) {
 	const struct CMUnitTest test_fetch[] = {
 		cmocka_unit_test(test_Instruction_DMA),
 		cmocka_unit_test(test_Instruction_Fetch),
-		cmocka_unit_test(test_Instruction_PrintLog),
+		cmocka_unit_test(test_Instruction_Trace),
 	};
 	int out = 0;
 	out += cmocka_run_group_tests(test_instruction_macro, setup_CPU, teardown_CPU);
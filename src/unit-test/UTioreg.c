@@ -90,6 +90,69 @@ static void test_IOReg_Connect(void **state) {
 	Controller_Destroy(ctrl);
 }
 
+/* Records every call made by IOReg */
+typedef struct {
+	uint16_t address;
+	uint8_t value;
+	int count;
+} Handled;
+
+static uint8_t Handled_Read(void *data, uint16_t address) {
+	Handled *handled = (Handled*) data;
+	handled->address = address;
+	handled->count++;
+	return 0xA5;
+}
+
+static void Handled_Write(void *data, uint16_t address, uint8_t value) {
+	Handled *handled = (Handled*) data;
+	handled->address = address;
+	handled->value = value;
+	handled->count++;
+}
+
+static void test_IOReg_Handler(void **state) {
+	IOReg *self = (IOReg*) *state;
+	Handled handled = {0, 0, 0};
+	uint8_t reg = 0x00;
+
+	assert_int_equal(IOReg_SetHandler(NULL, 0x2000, Handled_Read, NULL,
+				&handled), EXIT_FAILURE);
+	assert_int_equal(IOReg_SetHandler(self, 0x1FFF, Handled_Read, NULL,
+				&handled), EXIT_FAILURE);
+	assert_int_equal(IOReg_SetHandler(self, 0x4020, Handled_Read, NULL,
+				&handled), EXIT_FAILURE);
+	assert_int_equal(IOReg_SetHandler(self, 0x2002, Handled_Read,
+				Handled_Write, &handled), EXIT_SUCCESS);
+	self->bank1[PPUSTATUS] = &reg;
+
+	/* Handler gives the value, on a mirror too */
+	assert_int_equal(IOReg_Read(self, 0x3FFA), 0xA5);
+	assert_int_equal(handled.count, 1);
+	assert_int_equal(handled.address, 0x3FFA);
+	assert_int_equal(IOReg_Ack(self, 0x2002), AC_RD);
+
+	/* Two writes in a row both reach the handler, register holds the last */
+	IOReg_Write(self, 0x2002, 0x11);
+	IOReg_Write(self, 0x2002, 0x22);
+	assert_int_equal(handled.count, 3);
+	assert_int_equal(handled.value, 0x22);
+	assert_int_equal(reg, 0x22);
+	assert_int_equal(IOReg_Ack(self, 0x2002), AC_WR);
+
+	/* Without handler, register is read and written as memory */
+	assert_int_equal(IOReg_SetHandler(self, 0x2002, NULL, NULL, NULL),
+			EXIT_SUCCESS);
+	assert_int_equal(IOReg_Read(self, 0x2002), 0x22);
+	IOReg_Write(self, 0x2002, 0x33);
+	assert_int_equal(reg, 0x33);
+	assert_int_equal(handled.count, 3);
+	/* Not a register */
+	IOReg_Write(self, 0x4020, 0x44);
+	assert_int_equal(IOReg_Read(NULL, 0x2002), 0);
+	self->bank1[PPUSTATUS] = &self->dummy;
+}
+
 static int teardown_IOReg(void **state) {
 	if (*state != NULL) {
 		IOReg_Destroy((IOReg*) *state);
@@ -106,6 +169,7 @@ int run_UTioreg(void) {
 		cmocka_unit_test(test_IOReg_Ack_NoRead),
 	};
 	const struct CMUnitTest test_IOReg_Connection[] = {
+		cmocka_unit_test(test_IOReg_Handler),
 		cmocka_unit_test(test_IOReg_Connect),
 	};
 	int out = 0;
@@ -1,6 +1,8 @@
 #include "UTest.h"
 #include "../nes/nes.h"
+#include "../nes/const.h"
 #include <stdlib.h>
+#include <string.h>
 
 static int setup_NES(void** state) {
     
@@ -17,9 +19,124 @@ static void test_NES_Execution(void **state) {
 	NES *self = (NES*) *state;
 	assert_int_equal(NES_NextFrame(self, 0), EXIT_SUCCESS);
 	assert_ptr_equal((void*) NES_Render(NULL), (void*) NULL); 
-	assert_ptr_equal((void*) NES_Render(self), (void*) self->ppu->image); 
+	assert_ptr_equal((void*) NES_Render(self), (void*) self->image); 
+	assert_ptr_equal((void*) NES_RenderIndex(NULL), (void*) NULL); 
+	assert_ptr_equal((void*) NES_RenderIndex(self), (void*) self->ppu->image); 
 }
 
+/* Run frames with keys pressed from time to time */
+static void NES_RunFrames(NES *self, uint16_t frameCount) {
+	uint16_t i;
+	for (i = 0; i < frameCount; i++)
+		assert_int_equal(NES_NextFrame(self, (i & 4) ? 0x0101 : 0), EXIT_SUCCESS);
+}
+
+static void test_NES_State(void **state) {
+	NES *self = (NES*) *state;
+	NES *other = NULL;
+	NESState *snapshot = (NESState*) malloc(sizeof(NESState));
+	NESState *again = (NESState*) malloc(sizeof(NESState));
+	uint8_t *ram = NULL, *image = NULL;
+	uint64_t clockCount;
+	assert_ptr_not_equal(snapshot, NULL);
+	assert_ptr_not_equal(again, NULL);
+
+	/* Wrong parameters */
+	assert_int_equal(NES_SaveState(NULL, snapshot), EXIT_FAILURE);
+	assert_int_equal(NES_SaveState(self, NULL), EXIT_FAILURE);
+	assert_int_equal(NES_LoadState(self, NULL), EXIT_FAILURE);
+
+	/* Branch from the same state twice */
+	NES_RunFrames(self, 5);
+	assert_int_equal(NES_SaveState(self, snapshot), EXIT_SUCCESS);
+	assert_int_equal(snapshot->magic, NES_STATE_MAGIC);
+	assert_int_equal(snapshot->version, NES_STATE_VERSION);
+
+	/* Same machine gives the same bytes, whatever the buffer held */
+	memset(again, 0xA5, sizeof(NESState));
+	assert_int_equal(NES_SaveState(self, again), EXIT_SUCCESS);
+	memset(snapshot, 0x5A, sizeof(NESState));
+	assert_int_equal(NES_SaveState(self, snapshot), EXIT_SUCCESS);
+	assert_memory_equal(snapshot, again, sizeof(NESState));
+	NES_RunFrames(self, 20);
+	clockCount = self->clockCount;
+	ram = (uint8_t*) malloc(0x800);
+	image = (uint8_t*) malloc(NES_SCREEN_WIDTH * NES_SCREEN_HEIGTH);
+	assert_ptr_not_equal(ram, NULL);
+	assert_ptr_not_equal(image, NULL);
+	memcpy(ram, Mapper_Get(self->mapper, AS_CPU, 0x0000), 0x800);
+	memcpy(image, NES_RenderIndex(self), NES_SCREEN_WIDTH * NES_SCREEN_HEIGTH);
+
+	assert_int_equal(NES_LoadState(self, snapshot), EXIT_SUCCESS);
+	NES_RunFrames(self, 20);
+	assert_int_equal(self->clockCount, clockCount);
+	assert_memory_equal(Mapper_Get(self->mapper, AS_CPU, 0x0000), ram, 0x800);
+	assert_memory_equal(NES_RenderIndex(self), image,
+			NES_SCREEN_WIDTH * NES_SCREEN_HEIGTH);
+
+	/* Restore into another instance */
+	other = NES_Create("src/unit-test/roms/nestest.nes");
+	assert_ptr_not_equal(other, NULL);
+	assert_int_equal(NES_LoadState(other, snapshot), EXIT_SUCCESS);
+	NES_RunFrames(other, 20);
+	assert_int_equal(other->clockCount, clockCount);
+	assert_int_equal(CPU_GetP(other->cpu), CPU_GetP(self->cpu));
+	assert_int_equal(other->cpu->PC, self->cpu->PC);
+	assert_memory_equal(Mapper_Get(other->mapper, AS_CPU, 0x0000), ram, 0x800);
+	assert_memory_equal(NES_RenderIndex(other), image,
+			NES_SCREEN_WIDTH * NES_SCREEN_HEIGTH);
+	NES_Destroy(other);
+
+	/* Snapshot with another layout is refused */
+	snapshot->version++;
+	assert_int_equal(NES_LoadState(self, snapshot), EXIT_FAILURE);
+	snapshot->version--;
+	snapshot->magic = 0;
+	assert_int_equal(NES_LoadState(self, snapshot), EXIT_FAILURE);
+
+	free(ram);
+	free(image);
+	free(again);
+	free(snapshot);
+}
+
+static void test_NES_Clock(void **state) {
+	NES *self = (NES*) *state;
+	NES *other = NES_Create("src/unit-test/roms/nestest.nes");
+	NESState *snapshot = (NESState*) malloc(sizeof(NESState));
+	assert_ptr_not_equal(other, NULL);
+	assert_ptr_not_equal(snapshot, NULL);
+
+	/* Same run, past what a 32-bit clock holds (parity is kept for DMA) */
+	NES_RunFrames(self, 2);
+	assert_int_equal(NES_SaveState(self, snapshot), EXIT_SUCCESS);
+	snapshot->clockCount += 1ULL << 32;
+	assert_int_equal(NES_LoadState(other, snapshot), EXIT_SUCCESS);
+	NES_RunFrames(self, 10);
+	NES_RunFrames(other, 10);
+	assert_true(other->clockCount == self->clockCount + (1ULL << 32));
+	assert_memory_equal(Mapper_Get(other->mapper, AS_CPU, 0x0000),
+			Mapper_Get(self->mapper, AS_CPU, 0x0000), 0x800);
+	assert_memory_equal(NES_RenderIndex(other), NES_RenderIndex(self),
+			NES_SCREEN_WIDTH * NES_SCREEN_HEIGTH);
+
+	/* Scheduled events are part of the state */
+	assert_int_equal(Scheduler_Set(self->scheduler, SCHED_IRQ,
+				self->clockCount + 100), EXIT_SUCCESS);
+	assert_int_equal(NES_SaveState(self, snapshot), EXIT_SUCCESS);
+	assert_true(snapshot->event[SCHED_IRQ] == self->clockCount + 100);
+	assert_int_equal(NES_LoadState(other, snapshot), EXIT_SUCCESS);
+	assert_true(Scheduler_Time(other->scheduler, SCHED_IRQ) ==
+			self->clockCount + 100);
+
+	/* Interrupt request is sent once its time has come */
+	NES_RunFrames(other, 1);
+	assert_true(Scheduler_Time(other->scheduler, SCHED_IRQ) == SCHED_NEVER);
+	Scheduler_Cancel(self->scheduler, SCHED_IRQ);
+
+	NES_Destroy(other);
+	free(snapshot);
+}
 
 static int teardown_NES(void **state) {
 	if (*state != NULL) {
@@ -31,9 +148,71 @@ static int teardown_NES(void **state) {
     }
 }
 
+/* Whole machine in a block given by caller */
+static void test_NES_Arena(void **state) {
+	(void) state;
+	ROMImage *image = ROMImage_Load("src/unit-test/roms/allpads.nes");
+	size_t size = NES_RequiredSize(image);
+	uint8_t *block = NULL;
+	NES *self, *ref;
+	assert_ptr_not_equal(image, NULL);
+	assert_int_equal(size, NES_RequiredSize(NULL));
+	assert_int_equal(size % ARENA_ALIGN, 0);
+	assert_int_equal(posix_memalign((void**) &block, ARENA_ALIGN, size), 0);
+
+	/* Wrong parameters */
+	assert_ptr_equal(NES_CreateIn(NULL, size, image), NULL);
+	assert_ptr_equal(NES_CreateIn(block, size, NULL), NULL);
+	assert_ptr_equal(NES_CreateIn(block, size - 1, image), NULL);
+	assert_ptr_equal(NES_CreateIn(block + 1, size - 1, image), NULL);
+
+	/* Cartridge with CHR-RAM uses every byte of the block */
+	self = NES_CreateIn(block, size, image);
+	assert_ptr_equal(self, block);
+	assert_int_equal(self->arena.used, size);
+	assert_true(((uint8_t*) self->cpu > block) &&
+			((uint8_t*) self->cpu < block + size));
+	assert_true(((uint8_t*) self->image > block) &&
+			((uint8_t*) self->image < block + size));
+	assert_true((Mapper_Get(self->mapper, AS_CPU, 0x0000) > block) &&
+			(Mapper_Get(self->mapper, AS_CPU, 0x0000) < block + size));
+
+	/* Same behaviour as instance on heap */
+	ref = NES_CreateFromImage(image);
+	assert_ptr_not_equal(ref, NULL);
+	assert_ptr_equal(ref->arena.base, NULL);
+	NES_RunFrames(self, 10);
+	NES_RunFrames(ref, 10);
+	assert_int_equal(self->clockCount, ref->clockCount);
+	assert_memory_equal(Mapper_Get(self->mapper, AS_CPU, 0x0000),
+			Mapper_Get(ref->mapper, AS_CPU, 0x0000), 0x800);
+	assert_memory_equal(NES_RenderIndex(self), NES_RenderIndex(ref),
+			NES_SCREEN_WIDTH * NES_SCREEN_HEIGTH);
+
+	NES_Destroy(ref);
+	NES_Destroy(self);
+	ROMImage_Release(image);
+
+	/* Cartridge with CHR-ROM shares its decoded tiles, no room for them */
+	image = ROMImage_Load("src/unit-test/roms/nestest.nes");
+	assert_ptr_not_equal(image, NULL);
+	assert_true(NES_RequiredSize(image) < size);
+	size = NES_RequiredSize(image);
+	self = NES_CreateIn(block, size, image);
+	assert_ptr_equal(self, block);
+	assert_int_equal(self->arena.used, size);
+	assert_ptr_equal(self->ppu->tileCache, image->tiles);
+	NES_Destroy(self);
+	ROMImage_Release(image);
+	free(block);
+}
+
 int run_UTnes(void) {
     const struct CMUnitTest test_NES[] = {
         cmocka_unit_test(test_NES_Execution),
+        cmocka_unit_test(test_NES_State),
+        cmocka_unit_test(test_NES_Clock),
+        cmocka_unit_test(test_NES_Arena),
     };
     int out = 0;
     out += cmocka_run_group_tests(test_NES, setup_NES, teardown_NES);
@@ -1,5 +1,6 @@
 #include "UTest.h"
 #include "../nes/mapper/nrom.h"
+#include "../common/macro.h"
 
 static int setup_NROM_16(void **state) {
 	Header config;
@@ -135,6 +136,35 @@ static void test_MapNROM_Get(void **state) {
 
 }
 
+static void test_MapNROM_MapPages(void **state) {
+	Mapper *mapper = (Mapper*) *state;
+	MapNROM *self = mapper->mapperData;
+	uint32_t i;
+
+	for (i = 0; i < 0x10000; i++) {
+		/* IO registers and dummy region have to use slow path */
+		if (VALUE_IN(i, 0x2000, 0x5FFF)) {
+			assert_ptr_equal((void*) mapper->pageRd[i >> 8], NULL);
+			assert_ptr_equal((void*) mapper->pageWr[i >> 8], NULL);
+		/* Others must give the same pointer than MapNROM_Get */
+		} else {
+			assert_ptr_equal((void*) Mapper_GetRd(mapper, i),
+							 MapNROM_Get(self, AS_CPU, i));
+			assert_ptr_equal((void*) Mapper_GetWr(mapper, i),
+							 MapNROM_Get(self, AS_CPU, i));
+		}
+	}
+
+	/* Slow path is still able to reach IO registers */
+	assert_ptr_equal((void*) Mapper_GetRd(mapper, 0x2002),
+					 (void*) self->cpu.ioReg->bank1[PPUSTATUS]);
+	assert_ptr_equal((void*) Mapper_GetWr(mapper, 0x4014),
+					 (void*) self->cpu.ioReg->bank2[OAMDMA]);
+	/* Acknowledge them to leave IOReg clean */
+	Mapper_Ack(mapper, 0x2002);
+	Mapper_Ack(mapper, 0x4014);
+}
+
 static void test_MapNROM_Ack_NoRead(void **state) {
 	uint16_t i;
 	/* NULL access test */
@@ -163,6 +193,7 @@ static int teardown_NROM(void **state) {
 
 int run_UTnrom(void) {
 	const struct CMUnitTest test_NROM[] = {
+		cmocka_unit_test(test_MapNROM_MapPages),
 		cmocka_unit_test(test_MapNROM_Ack_NoRead),
 		cmocka_unit_test(test_MapNROM_Get),
 		cmocka_unit_test(test_MapNROM_Ack_IsRead),
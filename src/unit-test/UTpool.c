@@ -0,0 +1,92 @@
+#include "UTest.h"
+#include "../nes/pool/pool.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define POOL_NES_CNT		5
+#define POOL_FRAME_CNT		10
+
+/* Frames completed by each instance */
+static void Pool_Count(void *data, uint32_t index, NES *nes, uint8_t status) {
+	uint32_t *frameCount = (uint32_t*) data;
+	(void) nes;
+	if (status == EXIT_SUCCESS)
+		frameCount[index]++;
+}
+
+static void test_NESPool_Create(void **state) {
+	(void) state;
+	char *filename[2] = {"src/unit-test/roms/nestest.nes", "nothing.nes"};
+	NESPool *pool = NULL;
+	assert_ptr_equal(NESPool_Create(NULL, 1, 1, NULL, NULL), NULL);
+	assert_ptr_equal(NESPool_Create(filename, 0, 1, NULL, NULL), NULL);
+	assert_ptr_equal(NESPool_Create(filename, 1, 0, NULL, NULL), NULL);
+	assert_ptr_equal(NESPool_Create(filename, 2, 1, NULL, NULL), NULL);
+	pool = NESPool_Create(filename, 1, 1, NULL, NULL);
+	assert_ptr_not_equal(pool, NULL);
+	assert_ptr_not_equal(NESPool_Get(pool, 0), NULL);
+	assert_ptr_equal(NESPool_Get(pool, 1), NULL);
+	assert_int_equal(NESPool_NextFrame(pool, NULL), EXIT_FAILURE);
+	NESPool_Destroy(pool);
+}
+
+static void test_NESPool_NextFrame(void **state) {
+	(void) state;
+	char *filename[POOL_NES_CNT];
+	NES *ref[POOL_NES_CNT];
+	uint32_t frameCount[POOL_NES_CNT] = {0};
+	uint16_t keys[POOL_NES_CNT];
+	NESPool *pool = NULL;
+	int i, frame;
+
+	for (i = 0; i < POOL_NES_CNT; i++) {
+		filename[i] = (i & 1) ? "src/unit-test/roms/allpads.nes" :
+			"src/unit-test/roms/nestest.nes";
+		ref[i] = NES_Create(filename[i]);
+		assert_ptr_not_equal(ref[i], NULL);
+	}
+	/* Less threads than instances, so that some are stolen */
+	pool = NESPool_Create(filename, POOL_NES_CNT, 3, Pool_Count, frameCount);
+	assert_ptr_not_equal(pool, NULL);
+	/* Same power-up RAM and picture (not drawn while rendering is off) */
+	for (i = 0; i < POOL_NES_CNT; i++) {
+		memset(Mapper_Get(ref[i]->mapper, AS_CPU, 0x0000), 0, 0x800);
+		memset(Mapper_Get(NESPool_Get(pool, i)->mapper, AS_CPU, 0x0000), 0,
+				0x800);
+		memset(NES_RenderIndex(ref[i]), 0, 256 * 240);
+		memset(NES_RenderIndex(NESPool_Get(pool, i)), 0, 256 * 240);
+	}
+
+	/* Every instance is given its own keys */
+	for (frame = 0; frame < POOL_FRAME_CNT; frame++) {
+		for (i = 0; i < POOL_NES_CNT; i++) {
+			keys[i] = ((frame + i) & 4) ? (0x0101 << (i % 8)) : 0;
+			assert_int_equal(NES_NextFrame(ref[i], keys[i]), EXIT_SUCCESS);
+		}
+		assert_int_equal(NESPool_NextFrame(pool, keys), EXIT_SUCCESS);
+	}
+
+	/* Same result as instances run one after the other */
+	for (i = 0; i < POOL_NES_CNT; i++) {
+		assert_int_equal(frameCount[i], POOL_FRAME_CNT);
+		assert_int_equal(NESPool_Get(pool, i)->clockCount, ref[i]->clockCount);
+		assert_memory_equal(Mapper_Get(NESPool_Get(pool, i)->mapper, AS_CPU,
+					0x0000), Mapper_Get(ref[i]->mapper, AS_CPU, 0x0000),
+				0x800);
+		assert_memory_equal(NES_RenderIndex(NESPool_Get(pool, i)),
+				NES_RenderIndex(ref[i]), 256 * 240);
+		NES_Destroy(ref[i]);
+	}
+
+	NESPool_Destroy(pool);
+}
+
+int run_UTpool(void) {
+	const struct CMUnitTest test_pool[] = {
+		cmocka_unit_test(test_NESPool_Create),
+		cmocka_unit_test(test_NESPool_NextFrame),
+	};
+	int out = 0;
+	out += cmocka_run_group_tests(test_pool, NULL, NULL);
+	return out;
+}
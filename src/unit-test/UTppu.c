@@ -26,70 +26,70 @@ static int setup_PPU(void** state) {
 	ioreg->bank1[PPUSCROLL]	= &(self->PPUSCROLL);
 	ioreg->bank1[PPUADDR]	= &(self->PPUADDR);
 	ioreg->bank1[PPUDATA]	= &(self->PPUDATA);
+	IOReg_SetHandler(ioreg, 0x2000, NULL, PPU_WriteRegister, self);
+	IOReg_SetHandler(ioreg, 0x2002, PPU_ReadRegister, NULL, self);
+	IOReg_SetHandler(ioreg, 0x2004, PPU_ReadRegister, PPU_WriteRegister, self);
+	IOReg_SetHandler(ioreg, 0x2005, NULL, PPU_WriteRegister, self);
+	IOReg_SetHandler(ioreg, 0x2006, NULL, PPU_WriteRegister, self);
+	IOReg_SetHandler(ioreg, 0x2007, PPU_ReadRegister, PPU_WriteRegister, self);
 	PPU_Init(self);
 	return 0;
 }
 
-static void test_PPU_CheckRegister_PPUCTRL(void **state) {
+static void test_PPU_Register_PPUCTRL(void **state) {
 	PPU *self = (PPU*) *state;
 
 	self->vram.t = 0x0000;
 	/* Test if data is written to VRAM.t */
-	*Mapper_Get(self->mapper, AC_WR | AS_CPU, 0x2000) = 0xFF;
-	assert_int_equal(PPU_CheckRegister(self), EXIT_SUCCESS);
+	Mapper_Write(self->mapper, 0x2000, 0xFF);
 	assert_int_equal(self->vram.t, 0x0C00);
-	*Mapper_Get(self->mapper, AC_WR | AS_CPU, 0x2000) = 0xF0;
-	assert_int_equal(PPU_CheckRegister(self), EXIT_SUCCESS);
+	Mapper_Write(self->mapper, 0x2000, 0xF0);
 	assert_int_equal(self->vram.t, 0x0000);
 }
 
-static void test_PPU_CheckRegister_PPUSTATUS(void **state) {
+static void test_PPU_Register_PPUSTATUS(void **state) {
 	PPU *self = (PPU*) *state;
 
 	self->vram.w = 1;
 	self->PPUSTATUS = 0xFF;
 	/* Test if VBL flag is cleared and that VRAM.w is set to zero */
-	*Mapper_Get(self->mapper, AC_RD | AS_CPU, 0x2002) = 0xFF;
-	assert_int_equal(PPU_CheckRegister(self), EXIT_SUCCESS);
+	assert_int_equal(Mapper_Read(self->mapper, 0x2002), 0xFF);
 	assert_int_equal(self->vram.w, 0x00);
 	assert_int_equal(self->PPUSTATUS, 0x7F);
 }
 
-static void test_PPU_CheckRegister_OAMDATA(void **state) {
+static void test_PPU_Register_OAMDATA(void **state) {
 	PPU *self = (PPU*) *state;
 
 	self->OAMADDR = 0;
 	self->OAM[0] = 0;
 	/* Test if OAMADDR is incremented if OAMDATA has been written
 	 * If OAMDATA read only test if not increment */
-	*Mapper_Get(self->mapper, AC_WR | AS_CPU, 0x2004) = 0xAA;
-	assert_int_equal(PPU_CheckRegister(self), EXIT_SUCCESS);
+	Mapper_Write(self->mapper, 0x2004, 0xAA);
 	assert_int_equal(self->OAMADDR, 0x01);
 	assert_int_equal(self->OAM[0], 0xAA);
-	Mapper_Get(self->mapper, AC_RD | AS_CPU, 0x2004);
-	assert_int_equal(PPU_CheckRegister(self), EXIT_SUCCESS);
+	self->OAM[1] = 0x55;
+	assert_int_equal(Mapper_Read(self->mapper, 0x2004), 0x55);
 	assert_int_equal(self->OAMADDR, 0x01);
 }
 
-static void test_PPU_CheckRegister_PPUSCROLL(void **state) {
+static void test_PPU_Register_PPUSCROLL(void **state) {
 	PPU *self = (PPU*) *state;
 
 	self->vram.w = 0;
 	self->vram.t = 0;
 	/* Test if the pattern is correctly written */
-	*Mapper_Get(self->mapper, AC_WR | AS_CPU, 0x2005) = 0x7D;
-	assert_int_equal(PPU_CheckRegister(self), EXIT_SUCCESS);
+	Mapper_Write(self->mapper, 0x2005, 0x7D);
 	assert_int_equal(self->vram.t, 0x000F);
 	assert_int_equal(self->vram.x, 0x05);
 	assert_int_equal(self->vram.w, 1);
-	*Mapper_Get(self->mapper, AC_WR | AS_CPU, 0x2005) = 0x5E;
-	assert_int_equal(PPU_CheckRegister(self), EXIT_SUCCESS);
+	Mapper_Write(self->mapper, 0x2005, 0x5E);
 	assert_int_equal(self->vram.t, 0x616F);
 	assert_int_equal(self->vram.x, 0x05);
 	assert_int_equal(self->vram.w, 0);
 }
 
-static void test_PPU_CheckRegister_PPUADDR(void **state) {
+static void test_PPU_Register_PPUADDR(void **state) {
 	PPU *self = (PPU*) *state;
 
 	self->vram.w = 0;
@@ -97,21 +97,19 @@ static void test_PPU_CheckRegister_PPUADDR(void **state) {
 	self->vram.x = 0x05;
 	self->vram.v = 0;
 	/* Test if the pattern is correctly written */
-	*Mapper_Get(self->mapper, AC_WR | AS_CPU, 0x2006) = 0x3D;
-	assert_int_equal(PPU_CheckRegister(self), EXIT_SUCCESS);
+	Mapper_Write(self->mapper, 0x2006, 0x3D);
 	assert_int_equal(self->vram.t, 0x3D6F);
 	assert_int_equal(self->vram.x, 0x05);
 	assert_int_equal(self->vram.w, 1);
 	assert_int_equal(self->vram.v, 0);
-	*Mapper_Get(self->mapper, AC_WR | AS_CPU, 0x2006) = 0xF0;
-	assert_int_equal(PPU_CheckRegister(self), EXIT_SUCCESS);
+	Mapper_Write(self->mapper, 0x2006, 0xF0);
 	assert_int_equal(self->vram.t, 0x3DF0);
 	assert_int_equal(self->vram.x, 0x05);
 	assert_int_equal(self->vram.w, 0);
 	assert_int_equal(self->vram.v, 0x3DF0);
 }
 
-static void test_PPU_CheckRegister_PPUDATA(void **state) {
+static void test_PPU_Register_PPUDATA(void **state) {
 	PPU *self = (PPU*) *state;
 
 	self->scanline = 241;
@@ -123,42 +121,37 @@ static void test_PPU_CheckRegister_PPUDATA(void **state) {
 
 	/* Write test --------------------------------------- */
 	/* Test if address is update by 1 and data is written */
-	*Mapper_Get(self->mapper, AC_WR | AS_CPU, 0x2007) = 0xAA;
-	assert_int_equal(PPU_CheckRegister(self), EXIT_SUCCESS);
+	Mapper_Write(self->mapper, 0x2007, 0xAA);
 	assert_int_equal(self->vram.v, 1);
 	assert_int_equal(*data, 0xAA);
 	self->PPUCTRL = 0x04;
 	/* Test if address is update by 32 and data is written */
-	*Mapper_Get(self->mapper, AC_WR | AS_CPU, 0x2007) = 0xBB;
-	assert_int_equal(PPU_CheckRegister(self), EXIT_SUCCESS);
+	Mapper_Write(self->mapper, 0x2007, 0xBB);
 	assert_int_equal(self->vram.v, 33);
 	assert_int_equal(*(data + 1), 0xBB);
 	/* Test if PPU is rendering */
-	*Mapper_Get(self->mapper, AC_WR | AS_CPU, 0x2007) = 0xCC;
 	self->scanline = 0;
-	assert_int_equal(PPU_CheckRegister(self), EXIT_SUCCESS);
+	Mapper_Write(self->mapper, 0x2007, 0xCC);
 	assert_int_equal(self->vram.v, 0x1022);
 	assert_int_equal(*(data + 33), 0xCC);
 
 	/* Read test ---------------------------------------- */
-	/* Test if address is update by 1 and read value is in PPUDATA */
+	/* Test if address is update by 1 and read value is in PPUDATA, read
+	 * gives the previous one */
 	self->scanline = 241;
 	self->PPUCTRL = 0;
 	self->vram.v = 0;
-	Mapper_Get(self->mapper, AC_RD | AS_CPU, 0x2007);
-	assert_int_equal(PPU_CheckRegister(self), EXIT_SUCCESS);
+	assert_int_equal(Mapper_Read(self->mapper, 0x2007), 0xCC);
 	assert_int_equal(self->vram.v, 1);
 	assert_int_equal(self->PPUDATA, 0xAA);
 	self->PPUCTRL = 0x04;
 	/* Test if address is update by 32 and data is written */
-	Mapper_Get(self->mapper, AC_RD | AS_CPU, 0x2007);
-	assert_int_equal(PPU_CheckRegister(self), EXIT_SUCCESS);
+	assert_int_equal(Mapper_Read(self->mapper, 0x2007), 0xAA);
 	assert_int_equal(self->vram.v, 33);
 	assert_int_equal(self->PPUDATA, 0xBB);
 	/* Test if PPU is rendering */
 	self->scanline = 0;
-	Mapper_Get(self->mapper, AC_RD | AS_CPU, 0x2007);
-	assert_int_equal(PPU_CheckRegister(self), EXIT_SUCCESS);
+	assert_int_equal(Mapper_Read(self->mapper, 0x2007), 0xBB);
 	assert_int_equal(self->vram.v, 0x1022);
 	assert_int_equal(self->PPUDATA, 0xCC);
 
@@ -605,6 +598,31 @@ static void test_PPU_FetchTile_Filling(void **state) {
 	assert_int_equal(self->attributeH & 0x00FF, 0x00FF);
 }
 
+static void test_PPU_DecodeTile(void **state) {
+	PPU *self = (PPU*) *state;
+	uint8_t *tile = Mapper_Get(self->mapper, AS_PPU, 0x1010);
+	uint8_t *pixel = self->tileCache + 257 * SIZE_TILE_DECODED;
+	const uint8_t expected[8] = {1, 0, 0, 3, 0, 0, 2, 1};
+	int i;
+
+	/* Tile 1 of second pattern table, first row */
+	tile[0] = 0x91;
+	tile[SIZE_TILE_LAYER] = 0x12;
+	assert_int_equal(PPU_DecodeTile(self, 257), EXIT_SUCCESS);
+	for (i = 0; i < SIZE_TILE_PIXEL; i++)
+		assert_int_equal(pixel[i], expected[i]);
+	assert_int_equal(PPU_DecodeTile(self, TILE_CNT), EXIT_FAILURE);
+
+	/* Writing through PPUDATA updates decoded tile */
+	self->scanline = 241;
+	self->PPUCTRL = 0;
+	self->vram.v = 0x1018;
+	Mapper_Write(self->mapper, 0x2007, 0x00);
+	assert_int_equal(tile[SIZE_TILE_LAYER], 0x00);
+	for (i = 0; i < SIZE_TILE_PIXEL; i++)
+		assert_int_equal(pixel[i], (tile[0] >> (7 - i)) & 0x01);
+}
+
 static void test_PPU_ClearSecondaryOAM(void **state) {
 	PPU *self = (PPU*) *state;
 	int i;
@@ -1258,6 +1276,7 @@ static void test_PPU_Draw_No_Color(void** state) {
 	/* tests the paattern shifting */
 
 	PPU* self = (PPU*)*state;
+	uint32_t *rgb = malloc(NES_SCREEN_WIDTH * NES_SCREEN_HEIGTH * sizeof(uint32_t));
 	int i;
 
 	/* setup values for the test */
@@ -1295,7 +1314,10 @@ static void test_PPU_Draw_No_Color(void** state) {
 
 	PPU_Draw(self);
 
-	assert_int_equal(self->image[(self->scanline << 8) + self->cycle-1], 0);
+	assert_int_equal(self->image[(self->scanline << 8) + self->cycle-1], 63);
+	assert_int_equal(PPU_ConvertImage(self, rgb), EXIT_SUCCESS);
+	assert_int_equal(rgb[(self->scanline << 8) + self->cycle-1], 0);
+	free(rgb);
 
 }
 
@@ -1304,6 +1326,7 @@ static void test_PPU_Draw_Color(void** state) {
 	/* tests the color stored in image */
 
 	PPU* self = (PPU*)*state;
+	uint32_t *rgb = malloc(NES_SCREEN_WIDTH * NES_SCREEN_HEIGTH * sizeof(uint32_t));
 	int i;
 
 	/* setup values for the test */
@@ -1366,7 +1389,34 @@ static void test_PPU_Draw_Color(void** state) {
 
 	PPU_Draw(self);
 
-	assert_int_equal(self->image[(value5<<8)+(value6-1)], colorPalette[2]);
+	assert_int_equal(self->image[(value5<<8)+(value6-1)], 2);
+	assert_int_equal(PPU_ConvertImage(self, rgb), EXIT_SUCCESS);
+	assert_int_equal(rgb[(value5<<8)+(value6-1)], colorPalette[2]);
+	free(rgb);
+}
+
+static void test_PPU_ConvertImage(void** state) {
+	PPU* self = (PPU*)*state;
+	uint32_t *rgb = malloc(NES_SCREEN_WIDTH * NES_SCREEN_HEIGTH * sizeof(uint32_t));
+	int i;
+
+	assert_ptr_not_equal(rgb, NULL);
+	for (i = 0; i < NES_SCREEN_WIDTH * NES_SCREEN_HEIGTH; i++)
+		self->image[i] = i;
+	assert_int_equal(PPU_ConvertImage(NULL, rgb), EXIT_FAILURE);
+	assert_int_equal(PPU_ConvertImage(self, NULL), EXIT_FAILURE);
+	assert_int_equal(PPU_ConvertImage(self, rgb), EXIT_SUCCESS);
+
+	/* Some colors of each group of 16 */
+	assert_int_equal(rgb[0], 0x007C7C7C);
+	assert_int_equal(rgb[21], 0x00E40058);
+	assert_int_equal(rgb[35], 0x009878F8);
+	assert_int_equal(rgb[49], 0x00A4E4FC);
+	assert_int_equal(rgb[63], 0x00000000);
+	/* Only 6 lower bits are used, whatever the position */
+	for (i = 0; i < NES_SCREEN_WIDTH * NES_SCREEN_HEIGTH; i++)
+		assert_int_equal(rgb[i], rgb[i & 0x3F]);
+	free(rgb);
 }
 
 static void test_PPU_ClearFlag(void **state) {
@@ -1426,6 +1476,136 @@ static void test_PPU_Execute_Cnt(void **state) {
 	assert_int_equal(self->cycle, 10); 
 }
 
+static void test_PPU_DotsToVBlank(void **state) {
+	PPU* self = (PPU*)*state;
+	uint8_t context = 0;
+	uint32_t dots;
+
+	/* Exactly on the dot that sets the vertical blank flag */
+	self->scanline = 241;
+	self->cycle = 1;
+	assert_int_equal(PPU_DotsToVBlank(self), 0);
+
+	/* Past it: wait for the next frame */
+	self->cycle = 2;
+	assert_int_equal(PPU_DotsToVBlank(self), 263 * 341 - 1);
+
+	/* Executing the returned amount must stop just before the flag */
+	PPU_Init(self);
+	self->scanline = 100;
+	self->cycle = 17;
+	dots = PPU_DotsToVBlank(self);
+	assert_int_equal(dots, 141 * 341 - 16);
+	while (dots > 0xFFFF) {
+		PPU_Execute(self, &context, 0xFFFF);
+		dots -= 0xFFFF;
+	}
+	PPU_Execute(self, &context, dots);
+	assert_int_equal(self->scanline, 241);
+	assert_int_equal(self->cycle, 1);
+	assert_int_equal(self->PPUSTATUS & PPUSTATUS_VBL, 0);
+}
+
+static void test_PPU_Defer(void **state) {
+	PPU* self = (PPU*)*state;
+	PPU* ref = PPU_Create(self->mapper);
+	uint8_t *image = NULL;
+	uint8_t *tileCache = NULL;
+	uint8_t context = 0, contextRef = 0;
+	uint16_t address;
+	int i;
+
+	assert_ptr_not_equal(ref, NULL);
+	/* Fill pattern tables, nametables, palettes and OAM with some garbage */
+	srand(0x2C02);
+	for (address = 0x0000; address < 0x4000; address++)
+		*Mapper_Get(self->mapper, AS_PPU, address) = rand();
+	for (i = 0; i < SIZE_OAM; i++)
+		self->OAM[i] = rand();
+	PPU_Init(self);
+	self->PPUCTRL = PPUCTRL_SPR_PT;
+	self->PPUMASK = PPUMASK_SHOW_BG | PPUMASK_SHOW_SPR |
+		PPUMASK_SHOW_BG_8 | PPUMASK_SHOW_SPR_8;
+
+	/* Same state, reference being executed dot by dot */
+	image = ref->image;
+	tileCache = ref->tileCache;
+	*ref = *self;
+	ref->image = image;
+	ref->tileCache = tileCache;
+	PPU_DecodePattern(ref);
+
+	/* Cycles are kept until a whole scanline can be executed */
+	PPU_Defer(self, &context, 7);
+	PPU_Execute(ref, &contextRef, 7);
+	assert_int_equal(self->pendingDots, 7);
+	assert_int_equal(self->cycle, 0);
+
+	/* Two frames and a half */
+	for (i = 0; i < 5 * 263 * 341 / 2 / 7; i++) {
+		PPU_Defer(self, &context, 7);
+		PPU_Execute(ref, &contextRef, 7);
+		assert_int_equal(PPU_PictureDrawn(self), PPU_PictureDrawn(ref));
+		assert_int_equal(context, contextRef);
+	}
+	PPU_Sync(self);
+	assert_int_equal(self->pendingDots, 0);
+	assert_int_equal(self->scanline, ref->scanline);
+	assert_int_equal(self->cycle, ref->cycle);
+	assert_int_equal(self->vram.v, ref->vram.v);
+	assert_int_equal(self->PPUSTATUS, ref->PPUSTATUS);
+	assert_int_equal(self->OAMADDR, ref->OAMADDR);
+	assert_int_equal(self->OAMDATA, ref->OAMDATA);
+	assert_int_equal(self->nbFrame, ref->nbFrame);
+	assert_memory_equal(self->SOAM, ref->SOAM, SIZE_SOAM);
+	assert_memory_equal(self->image, ref->image,
+			NES_SCREEN_WIDTH * NES_SCREEN_HEIGTH);
+
+	PPU_Destroy(ref);
+}
+
+static void test_PPU_CatchUp(void **state) {
+	PPU* self = (PPU*)*state;
+	IOReg *ioreg = IOReg_Extract(self->mapper);
+	uint64_t clock = 1000;
+	uint8_t context = 0;
+
+	assert_int_equal(PPU_CatchUp(self), EXIT_FAILURE);
+	assert_int_equal(PPU_Attach(self, NULL, &context), EXIT_FAILURE);
+	PPU_Init(self);
+	assert_int_equal(PPU_Attach(self, &clock, &context), EXIT_SUCCESS);
+	ioreg->ppu = self;
+
+	/* Nothing is executed while CPU runs */
+	clock += 100;
+	assert_int_equal(self->scanline, PRERENDER_SCANLINE);
+	assert_int_equal(self->cycle, 0);
+	assert_int_equal(PPU_DotsToVBlank(self), 242 * 341 + 1 - 300);
+
+	/* Accessing a register catches up first */
+	Mapper_Read(self->mapper, 0x2002);
+	assert_int_equal(self->scanline, PRERENDER_SCANLINE);
+	assert_int_equal(self->cycle, 300);
+	assert_int_equal(self->clockSynced, clock);
+	assert_int_equal(self->pendingDots, 0);
+
+	/* Up to the vertical blank, NMI is disabled */
+	clock += PPU_DotsToVBlank(self) / 3 + 1;
+	assert_int_equal(PPU_DotsToVBlank(self), 0);
+	assert_int_equal(PPU_CatchUp(self), EXIT_SUCCESS);
+	assert_int_equal(PPU_PictureDrawn(self), 1);
+	assert_int_equal(self->scanline, 241);
+	assert_int_equal(context, 0);
+
+	/* Enabling it in vertical blank sends it right away */
+	Mapper_Write(self->mapper, 0x2000, PPUCTRL_NMI);
+	assert_int_equal(context & 0x02, 0x02);
+
+	ioreg->ppu = NULL;
+	self->clock = NULL;
+	self->context = NULL;
+}
+
 static int teardown_PPU(void **state) {
 	if (*state != NULL) {
 		PPU *self = (PPU*) *state;
@@ -1437,13 +1617,13 @@ static int teardown_PPU(void **state) {
 }
 
 int run_UTppu(void) {
-	const struct CMUnitTest test_PPU_CheckRegister[] = {
-		cmocka_unit_test(test_PPU_CheckRegister_PPUCTRL),
-		cmocka_unit_test(test_PPU_CheckRegister_PPUSTATUS),
-		cmocka_unit_test(test_PPU_CheckRegister_OAMDATA),
-		cmocka_unit_test(test_PPU_CheckRegister_PPUSCROLL),
-		cmocka_unit_test(test_PPU_CheckRegister_PPUADDR),
-		cmocka_unit_test(test_PPU_CheckRegister_PPUDATA),
+	const struct CMUnitTest test_PPU_Register[] = {
+		cmocka_unit_test(test_PPU_Register_PPUCTRL),
+		cmocka_unit_test(test_PPU_Register_PPUSTATUS),
+		cmocka_unit_test(test_PPU_Register_OAMDATA),
+		cmocka_unit_test(test_PPU_Register_PPUSCROLL),
+		cmocka_unit_test(test_PPU_Register_PPUADDR),
+		cmocka_unit_test(test_PPU_Register_PPUDATA),
 	};
 	const struct CMUnitTest test_PPU_RefreshRegister[] = {
 		cmocka_unit_test(test_PPU_RefreshRegister_OAMDATA),
@@ -1467,6 +1647,7 @@ int run_UTppu(void) {
 	const struct CMUnitTest test_PPU_FetchTile[] = {
 		cmocka_unit_test(test_PPU_FetchTile_Shift),
 		cmocka_unit_test(test_PPU_FetchTile_Filling),
+		cmocka_unit_test(test_PPU_DecodeTile),
 	};
 	const struct CMUnitTest test_PPU_Sprite[] = {
 		cmocka_unit_test(test_PPU_ClearSecondaryOAM),
@@ -1485,7 +1666,8 @@ int run_UTppu(void) {
 		cmocka_unit_test(test_PPU_Draw_SpriteZero),
 		cmocka_unit_test(test_PPU_Draw_Shift),
 		cmocka_unit_test(test_PPU_Draw_No_Color),
-		cmocka_unit_test(test_PPU_Draw_Color)
+		cmocka_unit_test(test_PPU_Draw_Color),
+		cmocka_unit_test(test_PPU_ConvertImage),
 	};
 	const struct CMUnitTest test_PPU_Flag[] = {
 		cmocka_unit_test(test_PPU_ClearFlag),
@@ -1494,10 +1676,13 @@ int run_UTppu(void) {
 	};
 	const struct CMUnitTest test_PPU_Execute[] = {
 		cmocka_unit_test(test_PPU_Execute_Cnt),
+		cmocka_unit_test(test_PPU_DotsToVBlank),
+		cmocka_unit_test(test_PPU_Defer),
+		cmocka_unit_test(test_PPU_CatchUp),
 	};
 
 	int out = 0;
-	out += cmocka_run_group_tests(test_PPU_CheckRegister, setup_PPU, teardown_PPU);
+	out += cmocka_run_group_tests(test_PPU_Register, setup_PPU, teardown_PPU);
 	out += cmocka_run_group_tests(test_PPU_RefreshRegister, setup_PPU, teardown_PPU);
 	out += cmocka_run_group_tests(test_PPU_ManageTiming, setup_PPU, teardown_PPU);
 	out += cmocka_run_group_tests(test_PPU_ManageVRAMAddr, setup_PPU, teardown_PPU);
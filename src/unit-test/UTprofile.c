@@ -0,0 +1,170 @@
+#include "UTest.h"
+#include "../nes/profile/profile.h"
+#include "../nes/cpu/cpu.h"
+#include "../nes/mapper/nrom.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+static int setup_Profile(void **state) {
+	*state = (void*) Profile_Create();
+	if (*state == NULL)
+		return -1;
+	return 0;
+}
+
+static void test_Profile_CPU(void **state) {
+	Profile *self = (Profile*) *state;
+	uint8_t program[] = {0x20, 0x10, 0x80, 0xEA};
+	uint8_t context = 0;
+	uint64_t clockCount = 0;
+	char readStr[64];
+	Header config;
+	FILE *file;
+	int i;
+
+	config.mirroring = NROM_HORIZONTAL;
+	config.romSize = NROM_16KIB;
+	Mapper *mapper = MapNROM_Create(&config);
+	assert_ptr_not_equal(mapper, NULL);
+	CPU *cpu = CPU_Create(mapper);
+	assert_ptr_not_equal(cpu, NULL);
+	CPU_Init(cpu);
+
+	/* JSR $8010, NOP then NOP, RTS in $8010 */
+	memcpy(Mapper_Get(mapper, AS_CPU, 0x8000), program, sizeof(program));
+	*Mapper_Get(mapper, AS_CPU, 0x8010) = 0xEA;
+	*Mapper_Get(mapper, AS_CPU, 0x8011) = 0x60;
+	cpu->PC = 0x8000;
+	cpu->SP = 0xFD;
+	Profile_Clear(self);
+	CPU_SetProfile(cpu, self);
+	for (i = 0; i < 4; i++)
+		assert_int_equal(CPU_Execute(cpu, &context, &clockCount), EXIT_SUCCESS);
+	CPU_SetProfile(cpu, NULL);
+	assert_int_equal(cpu->PC, 0x8004);
+
+	/* Every cycle is given to the address executed */
+	assert_true(self->totalCycles == clockCount);
+	assert_int_equal(self->pcCycles[0x8000], 6);
+	assert_int_equal(self->pcCycles[0x8003], 2);
+	assert_int_equal(self->pcCycles[0x8010], 2);
+	assert_int_equal(self->pcCycles[0x8011], 6);
+	assert_int_equal(self->opcodeCount[0xEA], 2);
+	assert_int_equal(self->opcodeCycles[0xEA], 4);
+
+	/* JSR belongs to caller, RTS to callee */
+	assert_int_equal(self->current, 0);
+	file = tmpfile();
+	assert_ptr_not_equal(file, NULL);
+	Profile_Collapsed(self, file);
+	rewind(file);
+	assert_ptr_not_equal(fgets(readStr, sizeof(readStr), file), NULL);
+	assert_string_equal(readStr, "reset 8\n");
+	assert_ptr_not_equal(fgets(readStr, sizeof(readStr), file), NULL);
+	assert_string_equal(readStr, "reset;$8010 8\n");
+	assert_ptr_equal(fgets(readStr, sizeof(readStr), file), NULL);
+	fclose(file);
+
+	CPU_Destroy(cpu);
+	Mapper_Destroy(mapper);
+}
+
+static void test_Profile_Stack(void **state) {
+	Profile *self = (Profile*) *state;
+	int i;
+
+	Profile_Clear(self);
+
+	/* Same function from same caller is the same node */
+	Profile_Record(self, 0xC000, 0x20, 0, 6, 0xD000);
+	Profile_Record(self, 0xD000, 0x60, 0, 6, 0xC003);
+	Profile_Record(self, 0xC003, 0x20, 0, 6, 0xD000);
+	assert_int_equal(self->nodeCount, 2);
+	assert_int_equal(self->node[self->current].address, 0xD000);
+
+	/* Interrupt enters its handler, RTI leaves it */
+	Profile_Interrupt(self, 0xE000, 7, 0);
+	assert_int_equal(self->depth, 2);
+	assert_int_equal(self->node[self->current].cycles, 7);
+	Profile_Record(self, 0xE000, 0x40, 0, 6, 0xD000);
+	assert_int_equal(self->node[self->current].address, 0xD000);
+
+	/* Unbalanced RTS stays at root */
+	Profile_Record(self, 0xD000, 0x60, 0, 6, 0xC006);
+	Profile_Record(self, 0xC006, 0x60, 0, 6, 0xC009);
+	assert_int_equal(self->current, 0);
+	assert_int_equal(self->depth, 0);
+
+	/* Deeper calls are merged, then left */
+	for (i = 0; i < PROFILE_DEPTH_MAX + 2; i++)
+		Profile_Record(self, 0xC000, 0x20, 0, 6, 0xD000);
+	assert_int_equal(self->depth, PROFILE_DEPTH_MAX);
+	assert_int_equal(self->merged, 2);
+	for (i = 0; i < PROFILE_DEPTH_MAX + 2; i++)
+		Profile_Record(self, 0xD000, 0x60, 0, 6, 0xC003);
+	assert_int_equal(self->current, 0);
+	assert_int_equal(self->merged, 0);
+
+	/* DMA is not an opcode, reset empties stack */
+	Profile_Record(self, 0xC000, 0x20, 0, 6, 0xD000);
+	Profile_Record(self, 0xD000, 0xEA, 1, 2, 0xD000);
+	assert_int_equal(self->opcodeCount[0xEA], 0);
+	assert_int_equal(self->dmaCycles, 2);
+	Profile_Interrupt(self, 0xC000, 7, 1);
+	assert_int_equal(self->current, 0);
+	assert_int_equal(self->depth, 0);
+}
+
+static void test_Profile_Report(void **state) {
+	Profile *self = (Profile*) *state;
+	char readStr[128];
+	FILE *file;
+
+	Profile_Clear(self);
+	Profile_Record(self, 0xC000, 0xA9, 0, 2, 0xC002);
+	Profile_Record(self, 0xC002, 0xAD, 0, 4, 0xC005);
+	Profile_Record(self, 0xC005, 0xA9, 0, 2, 0xC007);
+
+	/* Hottest address first, opcodes by decreasing cycles */
+	file = tmpfile();
+	assert_ptr_not_equal(file, NULL);
+	Profile_Report(self, file, 2);
+	rewind(file);
+	while (fgets(readStr, sizeof(readStr), file) != NULL) {
+		if (strncmp(readStr, "pc", 2) == 0)
+			break;
+	}
+	assert_ptr_not_equal(fgets(readStr, sizeof(readStr), file), NULL);
+	assert_int_equal(strncmp(readStr, "$C002 ", 6), 0);
+	assert_ptr_not_equal(fgets(readStr, sizeof(readStr), file), NULL);
+	assert_int_equal(strncmp(readStr, "$C000 ", 6), 0);
+	/* Only top addresses are given */
+	assert_ptr_not_equal(fgets(readStr, sizeof(readStr), file), NULL);
+	assert_string_equal(readStr, "\n");
+	assert_ptr_not_equal(fgets(readStr, sizeof(readStr), file), NULL);
+	assert_ptr_not_equal(fgets(readStr, sizeof(readStr), file), NULL);
+	assert_int_equal(strncmp(readStr, "$A9 ", 4), 0);
+	assert_ptr_not_equal(strstr(readStr, " 2 "), NULL);
+	fclose(file);
+}
+
+static int teardown_Profile(void **state) {
+	if (*state != NULL) {
+		Profile_Destroy((Profile*) *state);
+		return 0;
+	} else
+		return -1;
+}
+
+int run_UTprofile(void) {
+	const struct CMUnitTest test_profile[] = {
+		cmocka_unit_test(test_Profile_CPU),
+		cmocka_unit_test(test_Profile_Stack),
+		cmocka_unit_test(test_Profile_Report),
+	};
+	int out = 0;
+	out += cmocka_run_group_tests(test_profile, setup_Profile,
+			teardown_Profile);
+	return out;
+}
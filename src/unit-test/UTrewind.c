@@ -0,0 +1,148 @@
+#include "UTest.h"
+#include "../nes/rewind/rewind.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define REWIND_FRAME_CNT	80
+
+static int setup_Rewind(void **state) {
+	*state = (void*) NES_Create("src/unit-test/roms/nestest.nes");
+	if (*state == NULL)
+		return -1;
+	return 0;
+}
+
+static int teardown_Rewind(void **state) {
+	if (*state == NULL)
+		return -1;
+	NES_Destroy((NES*) *state);
+	return 0;
+}
+
+static void test_Rewind_Create(void **state) {
+	Rewind *ring = NULL;
+	assert_ptr_equal(Rewind_Create(REWIND_BUDGET_MIN - 1, 10), NULL);
+	assert_ptr_equal(Rewind_Create(REWIND_BUDGET_MIN, 0), NULL);
+	ring = Rewind_Create(REWIND_BUDGET_MIN, 10);
+	assert_ptr_not_equal(ring, NULL);
+	assert_int_equal(Rewind_Count(ring), 0);
+	assert_int_equal(Rewind_Pop(ring, (NES*) *state), EXIT_FAILURE);
+	Rewind_Destroy(ring);
+}
+
+static void test_Rewind_Encode(void **state) {
+	(void) state;
+	uint8_t data[300], reference[300], decoded[300];
+	uint8_t encoded[REWIND_ENCODE_MAX(300)];
+	uint32_t length, i;
+
+	/* Same data gives nothing to store */
+	for (i = 0; i < sizeof(data); i++)
+		data[i] = reference[i] = i * 7;
+	assert_int_equal(Rewind_Encode(data, reference, sizeof(data), encoded), 0);
+	assert_int_equal(Rewind_Decode(encoded, 0, reference, sizeof(data),
+				decoded), EXIT_SUCCESS);
+	assert_memory_equal(decoded, data, sizeof(data));
+
+	/* A few changes */
+	data[0] ^= 0x01;
+	data[10] ^= 0x80;
+	data[12] ^= 0x80;
+	data[299] ^= 0xFF;
+	length = Rewind_Encode(data, reference, sizeof(data), encoded);
+	assert_int_equal(length, 4 + 1 + 4 + 3 + 4 + 1);
+	assert_int_equal(Rewind_Decode(encoded, length, reference, sizeof(data),
+				decoded), EXIT_SUCCESS);
+	assert_memory_equal(decoded, data, sizeof(data));
+
+	/* Without reference, worst case stays in bound */
+	length = Rewind_Encode(data, NULL, sizeof(data), encoded);
+	assert_true(length <= REWIND_ENCODE_MAX(sizeof(data)));
+	assert_int_equal(Rewind_Decode(encoded, length, NULL, sizeof(data),
+				decoded), EXIT_SUCCESS);
+	assert_memory_equal(decoded, data, sizeof(data));
+
+	/* Corrupted data */
+	assert_int_equal(Rewind_Decode(encoded, 3, NULL, sizeof(data), decoded),
+			EXIT_FAILURE);
+	assert_int_equal(Rewind_Decode(encoded, length, NULL, 10, decoded),
+			EXIT_FAILURE);
+}
+
+static void test_Rewind_PushPop(void **state) {
+	NES *nes = (NES*) *state;
+	Rewind *ring = Rewind_Create(1 << 20, REWIND_FRAME_CNT);
+	uint32_t clockCount[REWIND_FRAME_CNT];
+	uint8_t ram[REWIND_FRAME_CNT][0x100];
+	int i;
+	assert_ptr_not_equal(ring, NULL);
+
+	/* Record every frame, more than ring can hold */
+	for (i = 0; i < REWIND_FRAME_CNT + 20; i++) {
+		assert_int_equal(NES_NextFrame(nes, (i & 8) ? 0x0101 : 0),
+				EXIT_SUCCESS);
+		assert_int_equal(Rewind_Push(ring, nes), EXIT_SUCCESS);
+		clockCount[i % REWIND_FRAME_CNT] = nes->clockCount;
+		memcpy(ram[i % REWIND_FRAME_CNT],
+				Mapper_Get(nes->mapper, AS_CPU, 0x0000), 0x100);
+	}
+	/* Oldest group has been dropped */
+	assert_true(Rewind_Count(ring) <= REWIND_FRAME_CNT);
+	assert_true(Rewind_Count(ring) > REWIND_FRAME_CNT -
+			REWIND_KEYFRAME_INTERVAL);
+
+	/* Go back in time, frame by frame */
+	i = REWIND_FRAME_CNT + 20;
+	while (Rewind_Count(ring) > 0) {
+		i--;
+		assert_int_equal(Rewind_Pop(ring, nes), EXIT_SUCCESS);
+		assert_int_equal(nes->clockCount, clockCount[i % REWIND_FRAME_CNT]);
+		assert_memory_equal(Mapper_Get(nes->mapper, AS_CPU, 0x0000),
+				ram[i % REWIND_FRAME_CNT], 0x100);
+		/* Branching again must not break older entries */
+		if ((i % 25) == 0) {
+			assert_int_equal(NES_NextFrame(nes, 0), EXIT_SUCCESS);
+			assert_int_equal(Rewind_Push(ring, nes), EXIT_SUCCESS);
+			assert_int_equal(Rewind_Pop(ring, nes), EXIT_SUCCESS);
+		}
+	}
+	assert_int_equal(Rewind_Pop(ring, nes), EXIT_FAILURE);
+
+	Rewind_Destroy(ring);
+}
+
+static void test_Rewind_Budget(void **state) {
+	NES *nes = (NES*) *state;
+	Rewind *ring = Rewind_Create(REWIND_BUDGET_MIN, 1000);
+	uint8_t *ram = Mapper_Get(nes->mapper, AS_CPU, 0x0000);
+	int i;
+	assert_ptr_not_equal(ring, NULL);
+
+	/* Whole RAM changes: ring keeps dropping, every push still succeeds */
+	for (i = 0; i < 100; i++) {
+		memset(ram, i, 0x800);
+		assert_int_equal(Rewind_Push(ring, nes), EXIT_SUCCESS);
+		assert_true(Rewind_Count(ring) > 0);
+	}
+	assert_true(Rewind_Count(ring) < 100);
+	while (Rewind_Count(ring) > 0) {
+		i--;
+		assert_int_equal(Rewind_Pop(ring, nes), EXIT_SUCCESS);
+		assert_int_equal(ram[0], i);
+		assert_int_equal(ram[0x7FF], i);
+	}
+
+	Rewind_Destroy(ring);
+}
+
+int run_UTrewind(void) {
+	const struct CMUnitTest test_rewind[] = {
+		cmocka_unit_test(test_Rewind_Create),
+		cmocka_unit_test(test_Rewind_Encode),
+		cmocka_unit_test(test_Rewind_PushPop),
+		cmocka_unit_test(test_Rewind_Budget),
+	};
+	int out = 0;
+	out += cmocka_run_group_tests(test_rewind, setup_Rewind, teardown_Rewind);
+	return out;
+}
@@ -0,0 +1,133 @@
+#include "UTest.h"
+#include "../nes/nes.h"
+#include "../nes/loader/romimage.h"
+#include "../nes/mapper/nrom.h"
+#include <stdlib.h>
+#include <string.h>
+
+static void test_ROMImage_Load(void **state) {
+	(void) state;
+	ROMImage *image = NULL;
+	uint8_t pixel[SIZE_TILE_DECODED];
+	assert_ptr_equal(ROMImage_Load(NULL), NULL);
+	assert_ptr_equal(ROMImage_Load("nopath.nes"), NULL);
+	assert_ptr_equal(ROMImage_Load("src/unit-test/roms/size.nes"), NULL);
+	assert_ptr_equal(ROMImage_Load("src/unit-test/roms/format.nes"), NULL);
+	assert_ptr_equal(ROMImage_Load("src/unit-test/roms/rip.nes"), NULL);
+
+	/* 16kiB of PRG-ROM followed by 8kiB of CHR-ROM */
+	image = ROMImage_Load("src/unit-test/roms/nestest.nes");
+	assert_ptr_not_equal(image, NULL);
+	assert_int_equal(image->refCount, 1);
+	assert_int_equal(image->header.romSize, 1);
+	assert_int_equal(image->header.vromSize, 1);
+	assert_ptr_equal(image->chr, image->prg + ROMIMAGE_PRG_BANK);
+	/* Mapped file: banks are read in place, after header */
+	if (image->mapped)
+		assert_ptr_equal(image->prg, image->data + 16);
+	else
+		assert_ptr_equal(image->prg, image->data);
+	/* Reset vector of nestest */
+	assert_int_equal(image->prg[0x3FFC], 0x04);
+	assert_int_equal(image->prg[0x3FFD], 0xC0);
+	/* Tiles of CHR-ROM are decoded, a pixel per byte */
+	assert_ptr_not_equal(image->tiles, NULL);
+	PPU_ExpandTile(pixel, image->chr + 0x41 * SIZE_TILE);
+	assert_memory_equal(image->tiles + 0x41 * SIZE_TILE_DECODED, pixel,
+			SIZE_TILE_DECODED);
+	assert_ptr_equal(ROMImage_Retain(image), image);
+	assert_int_equal(image->refCount, 2);
+	ROMImage_Release(image);
+	assert_int_equal(image->refCount, 1);
+	ROMImage_Release(image);
+	ROMImage_Release(NULL);
+
+	/* No CHR-ROM, cartridge has CHR-RAM */
+	image = ROMImage_Load("src/unit-test/roms/allpads.nes");
+	assert_ptr_not_equal(image, NULL);
+	assert_ptr_equal(image->chr, NULL);
+	assert_ptr_equal(image->tiles, NULL);
+	ROMImage_Release(image);
+}
+
+static void test_ROMImage_Shared(void **state) {
+	(void) state;
+	ROMImage *image = ROMImage_Load("src/unit-test/roms/nestest.nes");
+	NES *nes[2];
+	uint8_t *rom;
+	int i;
+	assert_ptr_not_equal(image, NULL);
+	assert_ptr_equal(NES_CreateFromImage(NULL), NULL);
+
+	for (i = 0; i < 2; i++) {
+		nes[i] = NES_CreateFromImage(image);
+		assert_ptr_not_equal(nes[i], NULL);
+	}
+	assert_int_equal(image->refCount, 3);
+
+	/* Both instances point to the image, RAM is their own */
+	for (i = 0; i < 2; i++) {
+		assert_ptr_equal(Mapper_Get(nes[i]->mapper, AS_LDR, LDR_PRG),
+				image->prg);
+		assert_ptr_equal(Mapper_Get(nes[i]->mapper, AS_LDR, LDR_CHR),
+				image->chr);
+		assert_ptr_equal(Mapper_GetRd(nes[i]->mapper, 0xC000),
+				image->prg + 0x0000);
+		assert_ptr_equal(nes[i]->ppu->tileCache, image->tiles);
+	}
+	assert_ptr_not_equal(Mapper_Get(nes[0]->mapper, AS_CPU, 0x0000),
+			Mapper_Get(nes[1]->mapper, AS_CPU, 0x0000));
+
+	/* Writes to ROM are ignored */
+	rom = Mapper_GetWr(nes[0]->mapper, 0x8000);
+	assert_ptr_not_equal(rom, image->prg);
+	*rom = image->prg[0] + 1;
+	assert_int_equal(*Mapper_GetRd(nes[1]->mapper, 0x8000), image->prg[0]);
+	assert_ptr_not_equal(Mapper_Get(nes[0]->mapper, AS_PPU | AC_WR, 0x0010),
+			image->chr + 0x0010);
+	assert_ptr_equal(Mapper_Get(nes[0]->mapper, AS_PPU | AC_WR, 0x2000),
+			Mapper_Get(nes[0]->mapper, AS_PPU, 0x2000));
+
+	/* Image lives as long as an instance needs it */
+	ROMImage_Release(image);
+	NES_Destroy(nes[0]);
+	assert_int_equal(image->refCount, 1);
+	assert_int_equal(NES_NextFrame(nes[1], 0), EXIT_SUCCESS);
+	NES_Destroy(nes[1]);
+}
+
+static void test_ROMImage_CHRRAM(void **state) {
+	(void) state;
+	ROMImage *image = ROMImage_Load("src/unit-test/roms/allpads.nes");
+	Mapper *mapper[2];
+	uint8_t *chr;
+	int i;
+	assert_ptr_not_equal(image, NULL);
+
+	/* Each mapper has its own writable pattern tables */
+	for (i = 0; i < 2; i++) {
+		mapper[i] = MapNROM_CreateShared(image);
+		assert_ptr_not_equal(mapper[i], NULL);
+		assert_ptr_equal(Mapper_Get(mapper[i], AS_LDR, LDR_PRG), image->prg);
+	}
+	chr = Mapper_Get(mapper[0], AS_PPU | AC_WR, 0x0010);
+	assert_ptr_equal(chr, Mapper_Get(mapper[0], AS_LDR, LDR_CHR) + 0x0010);
+	assert_ptr_not_equal(chr, Mapper_Get(mapper[1], AS_PPU, 0x0010));
+	*chr = 0x5A;
+	assert_int_equal(*Mapper_Get(mapper[1], AS_PPU, 0x0010), 0x00);
+
+	ROMImage_Release(image);
+	for (i = 0; i < 2; i++)
+		Mapper_Destroy(mapper[i]);
+}
+
+int run_UTromimage(void) {
+	const struct CMUnitTest test_romimage[] = {
+		cmocka_unit_test(test_ROMImage_Load),
+		cmocka_unit_test(test_ROMImage_Shared),
+		cmocka_unit_test(test_ROMImage_CHRRAM),
+	};
+	int out = 0;
+	out += cmocka_run_group_tests(test_romimage, NULL, NULL);
+	return out;
+}
@@ -0,0 +1,70 @@
+#include "UTest.h"
+#include "../runner.h"
+#include <stdlib.h>
+#include <stdio.h>
+
+static void test_Runner_Hash(void **state) {
+	(void) state;
+	uint8_t data[2] = {'a', 'b'};
+
+	/* Reference values of 64-bit FNV-1a */
+	assert_true(Runner_Hash(data, 0) == 0xCBF29CE484222325ULL);
+	assert_true(Runner_Hash(data, 1) == 0xAF63DC4C8601EC8CULL);
+	assert_true(Runner_Hash(data, 2) == 0x089C4407B545986AULL);
+}
+
+static void test_Runner_NextKeys(void **state) {
+	(void) state;
+	Runner runner;
+	uint16_t keys;
+
+	/* Start with an entry of no key on frame 0, as Runner_Init does */
+	runner.nes = NULL;
+	runner.scriptLine = 0;
+	runner.nextFrame = 0;
+	runner.nextKeys = 0;
+	runner.keysPressed = 0;
+	runner.script = tmpfile();
+	assert_ptr_not_equal(runner.script, NULL);
+	fputs("# comment\n\n2 0008\n3 80\n3 0101\n10 FFFF\n", runner.script);
+	rewind(runner.script);
+
+	assert_int_equal(Runner_NextKeys(&runner, 0, &keys), EXIT_SUCCESS);
+	assert_int_equal(keys, 0x0000);
+	assert_int_equal(Runner_NextKeys(&runner, 1, &keys), EXIT_SUCCESS);
+	assert_int_equal(keys, 0x0000);
+	assert_int_equal(Runner_NextKeys(&runner, 2, &keys), EXIT_SUCCESS);
+	assert_int_equal(keys, 0x0008);
+	/* Last entry of a frame wins */
+	assert_int_equal(Runner_NextKeys(&runner, 3, &keys), EXIT_SUCCESS);
+	assert_int_equal(keys, 0x0101);
+	assert_int_equal(Runner_NextKeys(&runner, 9, &keys), EXIT_SUCCESS);
+	assert_int_equal(keys, 0x0101);
+	/* Keys are held after end of script */
+	assert_int_equal(Runner_NextKeys(&runner, 10, &keys), EXIT_SUCCESS);
+	assert_int_equal(keys, 0xFFFF);
+	assert_ptr_equal(runner.script, NULL);
+	assert_int_equal(Runner_NextKeys(&runner, 11, &keys), EXIT_SUCCESS);
+	assert_int_equal(keys, 0xFFFF);
+
+	/* Wrong line is an error, reported with its number */
+	runner.scriptLine = 0;
+	runner.nextFrame = 0;
+	runner.script = tmpfile();
+	assert_ptr_not_equal(runner.script, NULL);
+	fputs("0 0002\n1 nothing\n", runner.script);
+	rewind(runner.script);
+	assert_int_equal(Runner_NextKeys(&runner, 0, &keys), EXIT_FAILURE);
+	assert_int_equal(runner.scriptLine, 2);
+	fclose(runner.script);
+}
+
+int run_UTrunner(void) {
+	const struct CMUnitTest test_runner[] = {
+		cmocka_unit_test(test_Runner_Hash),
+		cmocka_unit_test(test_Runner_NextKeys),
+	};
+	int out = 0;
+	out += cmocka_run_group_tests(test_runner, NULL, NULL);
+	return out;
+}
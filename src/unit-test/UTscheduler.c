@@ -0,0 +1,95 @@
+#include "UTest.h"
+#include "../nes/scheduler/scheduler.h"
+#include <stdlib.h>
+
+static int setup_Scheduler(void **state) {
+	*state = (void*) Scheduler_Create();
+	if (*state == NULL)
+		return -1;
+	return 0;
+}
+
+static void test_Scheduler_Set(void **state) {
+	Scheduler *self = (Scheduler*) *state;
+
+	/* Nothing is scheduled */
+	assert_true(Scheduler_Next(self) == SCHED_NEVER);
+	assert_true(Scheduler_Next(NULL) == SCHED_NEVER);
+	assert_true(Scheduler_Time(self, SCHED_VBLANK) == SCHED_NEVER);
+	assert_int_equal(Scheduler_Pop(self, SCHED_NEVER - 1), -1);
+
+	/* Wrong parameters */
+	assert_int_equal(Scheduler_Set(NULL, SCHED_VBLANK, 0), EXIT_FAILURE);
+	assert_int_equal(Scheduler_Set(self, SCHED_EVENT_CNT, 0), EXIT_FAILURE);
+	assert_int_equal(Scheduler_Set(self, SCHED_VBLANK, SCHED_NEVER),
+			EXIT_FAILURE);
+	assert_int_equal(Scheduler_Cancel(self, SCHED_EVENT_CNT), EXIT_FAILURE);
+
+	/* Earliest event comes first, whatever the order it was set in */
+	assert_int_equal(Scheduler_Set(self, SCHED_VBLANK, 1ULL << 40),
+			EXIT_SUCCESS);
+	assert_int_equal(Scheduler_Set(self, SCHED_IRQ, 1000), EXIT_SUCCESS);
+	assert_int_equal(self->count, 2);
+	assert_true(Scheduler_Next(self) == 1000);
+	assert_true(Scheduler_Time(self, SCHED_VBLANK) == 1ULL << 40);
+
+	/* Moving an event does not add it twice */
+	assert_int_equal(Scheduler_Set(self, SCHED_IRQ, (1ULL << 40) + 1),
+			EXIT_SUCCESS);
+	assert_int_equal(self->count, 2);
+	assert_true(Scheduler_Next(self) == 1ULL << 40);
+	assert_int_equal(Scheduler_Set(self, SCHED_IRQ, 10), EXIT_SUCCESS);
+	assert_true(Scheduler_Next(self) == 10);
+
+	/* Cancelled event is gone, cancelling it again does nothing */
+	assert_int_equal(Scheduler_Cancel(self, SCHED_IRQ), EXIT_SUCCESS);
+	assert_int_equal(Scheduler_Cancel(self, SCHED_IRQ), EXIT_SUCCESS);
+	assert_int_equal(self->count, 1);
+	assert_true(Scheduler_Time(self, SCHED_IRQ) == SCHED_NEVER);
+	assert_true(Scheduler_Next(self) == 1ULL << 40);
+	assert_int_equal(Scheduler_Cancel(self, SCHED_VBLANK), EXIT_SUCCESS);
+	assert_int_equal(self->count, 0);
+}
+
+static void test_Scheduler_Pop(void **state) {
+	Scheduler *self = (Scheduler*) *state;
+
+	assert_int_equal(Scheduler_Set(self, SCHED_VBLANK, 500), EXIT_SUCCESS);
+	assert_int_equal(Scheduler_Set(self, SCHED_IRQ, 200), EXIT_SUCCESS);
+
+	/* Only events due are given, earliest first */
+	assert_int_equal(Scheduler_Pop(NULL, 1000), -1);
+	assert_int_equal(Scheduler_Pop(self, 199), -1);
+	assert_int_equal(Scheduler_Pop(self, 1000), SCHED_IRQ);
+	assert_true(Scheduler_Time(self, SCHED_IRQ) == SCHED_NEVER);
+	assert_int_equal(Scheduler_Pop(self, 499), -1);
+	assert_int_equal(Scheduler_Pop(self, 500), SCHED_VBLANK);
+	assert_int_equal(Scheduler_Pop(self, 1000), -1);
+	assert_true(Scheduler_Next(self) == SCHED_NEVER);
+
+	/* Events at the same time are both given */
+	assert_int_equal(Scheduler_Set(self, SCHED_VBLANK, 300), EXIT_SUCCESS);
+	assert_int_equal(Scheduler_Set(self, SCHED_IRQ, 300), EXIT_SUCCESS);
+	assert_int_equal(Scheduler_Pop(self, 300) + Scheduler_Pop(self, 300),
+			SCHED_VBLANK + SCHED_IRQ);
+	assert_int_equal(Scheduler_Pop(self, 300), -1);
+}
+
+static int teardown_Scheduler(void **state) {
+	if (*state != NULL) {
+		Scheduler_Destroy((Scheduler*) *state);
+		return 0;
+	} else
+		return -1;
+}
+
+int run_UTscheduler(void) {
+	const struct CMUnitTest test_scheduler[] = {
+		cmocka_unit_test(test_Scheduler_Set),
+		cmocka_unit_test(test_Scheduler_Pop),
+	};
+	int out = 0;
+	out += cmocka_run_group_tests(test_scheduler, setup_Scheduler,
+			teardown_Scheduler);
+	return out;
+}
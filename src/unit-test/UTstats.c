@@ -0,0 +1,148 @@
+#include "UTest.h"
+#include "../nes/stats/stats.h"
+#include "../nes/nes.h"
+#include "../nes/mapper/ioreg.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+static void test_Stats_Count(void **state) {
+	(void) state;
+	Stats stats;
+
+	Stats_Begin(&stats, 7);
+	assert_int_equal(stats.frame, 7);
+	assert_int_equal(stats.instructions, 0);
+
+	/* Every region of both address spaces */
+	Stats_Get(&stats, AC_RD | AS_CPU, 0x1234);
+	Stats_Get(&stats, AC_WR | AS_CPU, 0x2002);
+	Stats_Get(&stats, AS_CPU, 0x4016);
+	Stats_Get(&stats, AS_CPU, 0x5000);
+	Stats_Get(&stats, AS_CPU, 0x6000);
+	Stats_Get(&stats, AS_CPU, 0xFFFC);
+	Stats_Get(&stats, AS_PPU, 0x1FFF);
+	Stats_Get(&stats, AS_PPU, 0x2C00);
+	Stats_Get(&stats, AS_PPU, 0x7F00);
+	Stats_Get(&stats, AS_LDR, LDR_CHR);
+	Stats_Get(NULL, AS_CPU, 0x0000);
+	assert_int_equal(stats.get[STATS_RAM], 1);
+	assert_int_equal(stats.get[STATS_IO], 2);
+	assert_int_equal(stats.get[STATS_EXPANSION], 1);
+	assert_int_equal(stats.get[STATS_SRAM], 1);
+	assert_int_equal(stats.get[STATS_PRGROM], 1);
+	assert_int_equal(stats.get[STATS_PATTERN], 1);
+	assert_int_equal(stats.get[STATS_NAMETABLE], 1);
+	assert_int_equal(stats.get[STATS_PALETTE], 1);
+	assert_int_equal(stats.get[STATS_LOADER], 1);
+
+	/* Task i is bit i of action */
+	Stats_Tasks(&stats, 0x0001 | 0x0004 | 0x0100);
+	Stats_Tasks(&stats, 0x0004);
+	Stats_Tasks(NULL, 0x0004);
+	assert_int_equal(stats.task[STATS_TASK_FRAME], 1);
+	assert_int_equal(stats.task[STATS_TASK_FETCH_TILE], 2);
+	assert_int_equal(stats.task[STATS_TASK_SET_FLAG], 1);
+	assert_int_equal(stats.task[STATS_TASK_DRAW], 0);
+
+	Stats_End(&stats, 29781);
+	assert_int_equal(stats.cycles, 29781);
+
+	assert_int_equal(Stats_Format("stats.json"), STATS_JSON);
+	assert_int_equal(Stats_Format("stats.csv"), STATS_CSV);
+	assert_int_equal(Stats_Format("json"), STATS_CSV);
+}
+
+/* Number of occurrences of c in str */
+static uint32_t Stats_CountChar(const char *str, char c) {
+	uint32_t count = 0;
+	for (; *str != '\0'; str++)
+		count += (*str == c);
+	return count;
+}
+
+static void test_Stats_Print(void **state) {
+	(void) state;
+	char header[4096], line[4096];
+	Stats stats;
+	FILE *file;
+
+	Stats_Begin(&stats, 3);
+	stats.nmi = 1;
+	stats.read[2] = 5;
+
+	/* CSV: same number of columns in header and line */
+	file = tmpfile();
+	assert_ptr_not_equal(file, NULL);
+	Stats_PrintHeader(file, STATS_CSV);
+	Stats_Print(&stats, file, STATS_CSV);
+	rewind(file);
+	assert_ptr_not_equal(fgets(header, sizeof(header), file), NULL);
+	assert_ptr_not_equal(fgets(line, sizeof(line), file), NULL);
+	fclose(file);
+	assert_int_equal(strncmp(header, "frame,ns,cycles,instructions,blocks,dma,nmi,",
+				44), 0);
+	assert_ptr_not_equal(strstr(header, ",rd_2002,"), NULL);
+	assert_ptr_not_equal(strstr(header, ",wr_4014,"), NULL);
+	assert_ptr_not_equal(strstr(header, ",task_scanline\n"), NULL);
+	assert_int_equal(Stats_CountChar(header, ','), Stats_CountChar(line, ','));
+	assert_int_equal(strncmp(line, "3,", 2), 0);
+
+	/* JSON: no header, an object per line */
+	file = tmpfile();
+	assert_ptr_not_equal(file, NULL);
+	Stats_PrintHeader(file, STATS_JSON);
+	Stats_Print(&stats, file, STATS_JSON);
+	rewind(file);
+	assert_ptr_not_equal(fgets(line, sizeof(line), file), NULL);
+	assert_ptr_equal(fgets(header, sizeof(header), file), NULL);
+	fclose(file);
+	assert_int_equal(strncmp(line, "{\"frame\":3,", 11), 0);
+	assert_ptr_not_equal(strstr(line, ",\"nmi\":1,"), NULL);
+	assert_ptr_not_equal(strstr(line, ",\"rd_2002\":5,"), NULL);
+	assert_int_equal(strcmp(line + strlen(line) - 2, "}\n"), 0);
+}
+
+static void test_Stats_NES(void **state) {
+	(void) state;
+	NES *nes = NES_Create("src/unit-test/roms/nestest.nes");
+	Stats stats;
+#ifdef NES_STATS
+	uint64_t tasks;
+	uint8_t i;
+#endif
+	assert_ptr_not_equal(nes, NULL);
+
+	assert_int_equal(NES_GetStats(NULL, &stats), EXIT_FAILURE);
+	assert_int_equal(NES_GetStats(nes, NULL), EXIT_FAILURE);
+	assert_int_equal(NES_NextFrame(nes, 0), EXIT_SUCCESS);
+	assert_int_equal(NES_NextFrame(nes, 0), EXIT_SUCCESS);
+#ifdef NES_STATS
+	/* Counters of second frame only */
+	assert_int_equal(NES_GetStats(nes, &stats), EXIT_SUCCESS);
+	assert_int_equal(stats.frame, 1);
+	assert_true((stats.cycles > 29000) && (stats.cycles < 30000));
+	assert_true(stats.instructions + stats.blocks > 0);
+	for (i = 0, tasks = 0; i < STATS_TASK_CNT; i++)
+		tasks += stats.task[i];
+	assert_true(tasks > 0);
+	/* Vertical blank is waited for by reading PPUSTATUS */
+	assert_true(stats.read[PPUSTATUS] > 0);
+	/* Read through callback of mapper, not Mapper_Get */
+	assert_true(stats.get[STATS_IO] >= stats.read[PPUSTATUS]);
+#else
+	assert_int_equal(NES_GetStats(nes, &stats), EXIT_FAILURE);
+#endif
+	NES_Destroy(nes);
+}
+
+int run_UTstats(void) {
+	const struct CMUnitTest test_stats[] = {
+		cmocka_unit_test(test_Stats_Count),
+		cmocka_unit_test(test_Stats_Print),
+		cmocka_unit_test(test_Stats_NES),
+	};
+	int out = 0;
+	out += cmocka_run_group_tests(test_stats, NULL, NULL);
+	return out;
+}
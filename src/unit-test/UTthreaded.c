@@ -0,0 +1,218 @@
+#include "UTest.h"
+#include "../nes/cpu/threaded.h"
+#include "../nes/cpu/instruction.h"
+#include "../nes/cpu/icache.h"
+#include "../nes/mapper/nrom.h"
+#include "../nes/loader/loader.h"
+#include "../common/macro.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* Both cores are run side by side: [0] interpreter, [1] threaded */
+#define REF	0
+#define THR	1
+
+static int setup_Threaded(void **state) {
+	Header config;
+	CPU **cpu = (CPU**) malloc(2 * sizeof(CPU*));
+	int i;
+
+	if (cpu == NULL)
+		return -1;
+	config.mirroring = NROM_HORIZONTAL;
+	config.romSize = NROM_16KIB;
+	for (i = 0; i < 2; i++) {
+		cpu[i] = CPU_Create(MapNROM_Create(&config));
+		if ((cpu[i] == NULL) || (cpu[i]->mapper == NULL))
+			return -1;
+		CPU_Init(cpu[i]);
+	}
+	*state = (void*) cpu;
+	return 0;
+}
+
+static int setup_Threaded_nestest(void **state) {
+	CPU **cpu = (CPU**) malloc(2 * sizeof(CPU*));
+	int i;
+
+	if (cpu == NULL)
+		return -1;
+	for (i = 0; i < 2; i++) {
+		cpu[i] = CPU_Create(loadROM("src/unit-test/roms/nestest.nes"));
+		if ((cpu[i] == NULL) || (cpu[i]->mapper == NULL))
+			return -1;
+		CPU_Init(cpu[i]);
+		/* Same power-up RAM for both cores */
+		memset(Mapper_Get(cpu[i]->mapper, AS_CPU, 0x0000), 0, 0x800);
+	}
+	*state = (void*) cpu;
+	return 0;
+}
+
+static int teardown_Threaded(void **state) {
+	CPU **cpu = (CPU**) *state;
+	int i;
+
+	for (i = 0; i < 2; i++) {
+		Mapper_Destroy(cpu[i]->mapper);
+		CPU_Destroy(cpu[i]);
+	}
+	free(cpu);
+	return 0;
+}
+
+static void assert_CPU_equal(CPU **cpu) {
+	assert_int_equal(cpu[REF]->A, cpu[THR]->A);
+	assert_int_equal(cpu[REF]->X, cpu[THR]->X);
+	assert_int_equal(cpu[REF]->Y, cpu[THR]->Y);
+	assert_int_equal(CPU_GetP(cpu[REF]), CPU_GetP(cpu[THR]));
+	assert_int_equal(cpu[REF]->SP, cpu[THR]->SP);
+	assert_int_equal(cpu[REF]->PC, cpu[THR]->PC);
+	assert_memory_equal(Mapper_Get(cpu[REF]->mapper, AS_CPU, 0x0000),
+			Mapper_Get(cpu[THR]->mapper, AS_CPU, 0x0000), 0x800);
+}
+
+static void test_Threaded_Opcodes(void **state) {
+	CPU **cpu = (CPU**) *state;
+	uint32_t seed = 0x1234567;
+	uint64_t clk[2];
+	uint8_t context[2], *mem, ram[0x800], prg[3], reg[5];
+	uint16_t op, ptr, n, i;
+	int c;
+
+#define RAND()	(seed = seed * 1103515245 + 12345, (seed >> 16) & 0xFF)
+
+	for (op = 0; op < 256; op++) {
+		Opcode info = Opcode_Get(op);
+		if (info.inst == NULL)
+			continue;
+		for (n = 0; n < 64; n++) {
+			/* Random registers, memory and arguments */
+			for (i = 0; i < 0x800; i++)
+				ram[i] = RAND();
+			for (i = 0; i < 5; i++)
+				reg[i] = RAND();
+			prg[0] = op;
+			prg[1] = RAND();
+			/* Keep every access in RAM */
+			prg[2] = RAND() & 0x07;
+			if ((info.addressingMode == INX) || (info.addressingMode == INY)) {
+				ptr = info.addressingMode == INX ? prg[1] + reg[1] : prg[1];
+				ram[(ptr + 1) & 0xFF] &= 0x07;
+			} else if (info.addressingMode == ABI) {
+				ptr = (prg[2] << 8) | prg[1];
+				ram[(ptr & 0x700) | ((ptr + 1) & 0xFF)] &= 0x07;
+			}
+
+			for (c = 0; c < 2; c++) {
+				memcpy(Mapper_Get(cpu[c]->mapper, AS_CPU, 0x0000), ram, 0x800);
+				mem = Mapper_Get(cpu[c]->mapper, AS_CPU, 0x8000);
+				memcpy(mem, prg, 3);
+				/* BRK vector */
+				*Mapper_Get(cpu[c]->mapper, AS_CPU, 0xFFFE) = 0x34;
+				*Mapper_Get(cpu[c]->mapper, AS_CPU, 0xFFFF) = 0x92;
+				ICache_Flush(cpu[c]->icache);
+				cpu[c]->A = reg[0];
+				cpu[c]->X = reg[1];
+				cpu[c]->Y = reg[2];
+				CPU_SetP(cpu[c], reg[3] | 0x20);
+				cpu[c]->SP = reg[4];
+				cpu[c]->PC = 0x8000;
+				cpu[c]->cntDMA = -1;
+				context[c] = 0;
+				clk[c] = 0;
+			}
+
+			assert_int_equal(CPU_Interpret(cpu[REF], &context[REF], &clk[REF]),
+					EXIT_SUCCESS);
+			assert_int_equal(Threaded_Execute(cpu[THR], &context[THR], &clk[THR]),
+					EXIT_SUCCESS);
+			assert_int_equal(clk[REF], clk[THR]);
+			assert_CPU_equal(cpu);
+		}
+	}
+
+	/* Undefined opcode is rejected by both cores */
+	for (c = 0; c < 2; c++) {
+		*Mapper_Get(cpu[c]->mapper, AS_CPU, 0x8000) = 0x02;
+		ICache_Flush(cpu[c]->icache);
+		cpu[c]->PC = 0x8000;
+	}
+	assert_int_equal(CPU_Interpret(cpu[REF], &context[REF], &clk[REF]),
+			EXIT_FAILURE);
+	assert_int_equal(Threaded_Execute(cpu[THR], &context[THR], &clk[THR]),
+			EXIT_FAILURE);
+	assert_int_equal(cpu[REF]->PC, cpu[THR]->PC);
+}
+
+static void test_Threaded_DMA(void **state) {
+	CPU **cpu = (CPU**) *state;
+	/* LDA #$02, STA $4014, then NOPs */
+	uint8_t prg[] = {0xA9, 0x02, 0x8D, 0x14, 0x40};
+	uint64_t clk[2] = {0, 0};
+	uint8_t context[2] = {0, 0};
+	int c, i;
+
+	for (c = 0; c < 2; c++) {
+		uint8_t *rom = Mapper_Get(cpu[c]->mapper, AS_CPU, 0x8000);
+		memset(rom, 0xEA, 0x400);
+		memcpy(rom, prg, sizeof(prg));
+		ICache_Flush(cpu[c]->icache);
+		/* Transfer is requested by the write to $4014 */
+		IOReg_SetHandler(IOReg_Extract(cpu[c]->mapper), 0x4014, NULL,
+				CPU_WriteOAMDMA, cpu[c]);
+		cpu[c]->PC = 0x8000;
+		cpu[c]->cntDMA = -1;
+		/* Odd cycle before transfer */
+		clk[c] = 1;
+	}
+
+	/* Transfer lasts 256 steps plus alignment */
+	for (i = 0; i < 300; i++) {
+		assert_int_equal(CPU_Interpret(cpu[REF], &context[REF], &clk[REF]),
+				EXIT_SUCCESS);
+		assert_int_equal(Threaded_Execute(cpu[THR], &context[THR], &clk[THR]),
+				EXIT_SUCCESS);
+		assert_int_equal(clk[REF], clk[THR]);
+		assert_int_equal(cpu[REF]->PC, cpu[THR]->PC);
+	}
+	/* 2 + 4 cycles, 2 alignment cycles, 512 cycles of DMA, then NOPs */
+	assert_int_equal(clk[THR], 1 + 6 + 2 + 512 + 2 * (300 - 2 - 256));
+}
+
+static void test_Threaded_nestest(void **state) {
+	CPU **cpu = (CPU**) *state;
+	uint64_t clk[2] = {0, 0};
+	uint8_t context[2] = {1, 1};
+	int c, i;
+
+	/* Replace reset vector 0xC000 to launch automate test */
+	for (c = 0; c < 2; c++)
+		*(Mapper_Get(cpu[c]->mapper, AS_CPU, 0xFFFC)) = 0x00;
+
+	/* Execute 5003 instructions (instruction before illegal opcode) */
+	for (i = 0; i < 5003; i++) {
+		assert_int_equal(CPU_Interpret(cpu[REF], &context[REF], &clk[REF]),
+				EXIT_SUCCESS);
+		assert_int_equal(Threaded_Execute(cpu[THR], &context[THR], &clk[THR]),
+				EXIT_SUCCESS);
+		assert_int_equal(clk[REF], clk[THR]);
+		assert_CPU_equal(cpu);
+	}
+}
+
+int run_UTthreaded(void) {
+	const struct CMUnitTest test_threaded[] = {
+		cmocka_unit_test(test_Threaded_Opcodes),
+		cmocka_unit_test(test_Threaded_DMA),
+	};
+	const struct CMUnitTest test_threaded_nestest[] = {
+		cmocka_unit_test(test_Threaded_nestest),
+	};
+	int out = 0;
+	out += cmocka_run_group_tests(test_threaded, setup_Threaded,
+			teardown_Threaded);
+	out += cmocka_run_group_tests(test_threaded_nestest, setup_Threaded_nestest,
+			teardown_Threaded);
+	return out;
+}
@@ -0,0 +1,140 @@
+#include "UTest.h"
+#include "../nes/timeline/timeline.h"
+#include "../nes/nes.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+static int setup_Timeline(void **state) {
+	*state = (void*) Timeline_Create(4);
+	if (*state == NULL)
+		return -1;
+	return 0;
+}
+
+static void test_Timeline_Record(void **state) {
+	Timeline *self = (Timeline*) *state;
+
+	assert_ptr_equal(Timeline_Create(0), NULL);
+
+	/* Without timeline, nothing is recorded */
+	Timeline_Begin(NULL, TIMELINE_APP, "frame");
+	Timeline_End(NULL, TIMELINE_APP, "frame");
+	Timeline_Instant(NULL, TIMELINE_PPU, "vblank", 1);
+
+	Timeline_Begin(self, TIMELINE_APP, "frame");
+	Timeline_Instant(self, TIMELINE_PPU, "scanline", -1);
+	Timeline_End(self, TIMELINE_APP, "frame");
+	assert_int_equal(self->count, 3);
+	assert_int_equal(self->event[0].phase, 'B');
+	assert_int_equal(self->event[1].phase, 'i');
+	assert_int_equal(self->event[1].track, TIMELINE_PPU);
+	assert_int_equal(self->event[1].value, -1);
+	assert_int_equal(self->event[2].phase, 'E');
+	assert_string_equal(self->event[2].name, "frame");
+	assert_true(self->event[0].ns <= self->event[2].ns);
+
+	/* Ring is never grown, oldest events are overwritten */
+	Timeline_Begin(self, TIMELINE_APP, "SDL_Flip");
+	Timeline_End(self, TIMELINE_APP, "SDL_Flip");
+	Timeline_Instant(self, TIMELINE_PPU, "vblank", 2);
+	assert_int_equal(self->count, 4);
+	assert_int_equal(self->dropped, 2);
+	assert_int_equal(self->first, 2);
+	assert_int_equal(self->event[2].phase, 'E');
+	assert_string_equal(self->event[2].name, "frame");
+	assert_int_equal(self->event[1].value, 2);
+}
+
+static void test_Timeline_Write(void **state) {
+	Timeline *self = (Timeline*) *state;
+	char line[256];
+	FILE *file;
+
+	self->first = self->count = self->dropped = 0;
+	Timeline_Begin(self, TIMELINE_APP, "frame");
+	Timeline_Instant(self, TIMELINE_PPU, "vblank", 3);
+	Timeline_End(self, TIMELINE_APP, "frame");
+	Timeline_Begin(self, TIMELINE_APP, "SDL_Flip");
+	Timeline_End(self, TIMELINE_APP, "SDL_Flip");
+	self->event[self->first].ns = 1234567;
+
+	assert_int_equal(Timeline_Write(self, "nowhere/test.json"), EXIT_FAILURE);
+	assert_int_equal(Timeline_Write(self, "test.json"), EXIT_SUCCESS);
+	assert_ptr_not_equal(file = fopen("test.json", "r"), NULL);
+	assert_ptr_not_equal(fgets(line, sizeof(line), file), NULL);
+	assert_string_equal(line, "{\"traceEvents\":[\n");
+	/* Tracks are named */
+	assert_ptr_not_equal(fgets(line, sizeof(line), file), NULL);
+	assert_ptr_not_equal(strstr(line, "\"args\":{\"name\":\"app\"}},"), NULL);
+	assert_ptr_not_equal(fgets(line, sizeof(line), file), NULL);
+	assert_ptr_not_equal(strstr(line, "\"args\":{\"name\":\"ppu\"}},"), NULL);
+	/* Timestamps in microseconds */
+	assert_ptr_not_equal(fgets(line, sizeof(line), file), NULL);
+	assert_string_equal(line, "{\"name\":\"vblank\",\"ph\":\"i\","
+			"\"ts\":1234.567,\"pid\":1,\"tid\":2,\"s\":\"t\","
+			"\"args\":{\"value\":3}},\n");
+	/* End of frame is left out, its begin was overwritten */
+	assert_ptr_not_equal(fgets(line, sizeof(line), file), NULL);
+	assert_ptr_not_equal(strstr(line, "\"name\":\"SDL_Flip\",\"ph\":\"B\""),
+			NULL);
+	assert_ptr_not_equal(fgets(line, sizeof(line), file), NULL);
+	assert_ptr_not_equal(strstr(line, "\"name\":\"SDL_Flip\",\"ph\":\"E\""),
+			NULL);
+	assert_ptr_equal(strstr(line, "},"), NULL);
+	assert_ptr_not_equal(fgets(line, sizeof(line), file), NULL);
+	assert_string_equal(line, "],\"displayTimeUnit\":\"ms\","
+			"\"otherData\":{\"dropped\":1}}\n");
+	assert_ptr_equal(fgets(line, sizeof(line), file), NULL);
+	fclose(file);
+	remove("test.json");
+}
+
+static void test_Timeline_PPU(void **state) {
+	Timeline *self = Timeline_Create(1024);
+	NES *nes = NES_Create("src/unit-test/roms/nestest.nes");
+	uint32_t i, scanline = 0, vblank = 0;
+	(void) state;
+	assert_ptr_not_equal(self, NULL);
+	assert_ptr_not_equal(nes, NULL);
+
+	/* Every scanline boundary and vertical blank of a frame */
+	PPU_SetTimeline(nes->ppu, self);
+	assert_int_equal(NES_NextFrame(nes, 0), EXIT_SUCCESS);
+	PPU_SetTimeline(nes->ppu, NULL);
+	assert_int_equal(NES_NextFrame(nes, 0), EXIT_SUCCESS);
+	assert_int_equal(self->first, 0);
+	for (i = 0; i < self->count; i++) {
+		assert_int_equal(self->event[i].track, TIMELINE_PPU);
+		if (strcmp(self->event[i].name, "scanline") == 0)
+			scanline++;
+		else if (strcmp(self->event[i].name, "vblank") == 0)
+			vblank++;
+	}
+	assert_int_equal(vblank, 1);
+	assert_true((scanline >= 240) && (scanline <= 262));
+	assert_int_equal(self->dropped, 0);
+
+	NES_Destroy(nes);
+	Timeline_Destroy(self);
+}
+
+static int teardown_Timeline(void **state) {
+	if (*state != NULL) {
+		Timeline_Destroy((Timeline*) *state);
+		return 0;
+	} else
+		return -1;
+}
+
+int run_UTtimeline(void) {
+	const struct CMUnitTest test_timeline[] = {
+		cmocka_unit_test(test_Timeline_Record),
+		cmocka_unit_test(test_Timeline_Write),
+		cmocka_unit_test(test_Timeline_PPU),
+	};
+	int out = 0;
+	out += cmocka_run_group_tests(test_timeline, setup_Timeline,
+			teardown_Timeline);
+	return out;
+}
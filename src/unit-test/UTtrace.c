@@ -0,0 +1,89 @@
+#include "UTest.h"
+#include "../nes/trace/trace.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+static void test_Trace_Print(void **state) {
+	(void) state;
+	TraceRecord record = {12345, 0xC000, 0xA9, {0x42, 0x00}, 1,
+		0x01, 0x02, 0x03, 0x24, 0xFD};
+	char readStr[256];
+	FILE *file = tmpfile();
+	assert_ptr_not_equal(file, NULL);
+
+	/* Instruction, then DMA step */
+	Trace_Print(&record, file);
+	record.nbArg = TRACE_DMA;
+	record.arg[0] = 0x34;
+	record.arg[1] = 0x12;
+	Trace_Print(&record, file);
+	rewind(file);
+	assert_ptr_not_equal(fgets(readStr, sizeof(readStr), file), NULL);
+	assert_string_equal(readStr,
+			"C000 A9 42       A:01 X:02 Y:03 P:24 SP:FD CYC:12345\n");
+	assert_ptr_not_equal(fgets(readStr, sizeof(readStr), file), NULL);
+	assert_string_equal(readStr,
+			"C000 DMA @1234   A:01 X:02 Y:03 P:24 SP:FD CYC:12345\n");
+	fclose(file);
+}
+
+static void test_Trace_Ring(void **state) {
+	(void) state;
+	char magic[sizeof(TRACE_MAGIC)];
+	TraceRecord *record, readRecord;
+	uint32_t i, count = 3 * TRACE_RING_CNT + 5;
+	FILE *file;
+
+	/* Ring wraps several times, every record is written in order */
+	Trace *trace = Trace_Create("test.trace");
+	assert_ptr_not_equal(trace, NULL);
+	for (i = 0; i < count; i++) {
+		record = Trace_Next(trace);
+		memset(record, 0, sizeof(TraceRecord));
+		record->cycle = i;
+		record->pc = i & 0xFFFF;
+		Trace_Commit(trace);
+	}
+	Trace_Destroy(trace);
+
+	assert_ptr_not_equal(file = fopen("test.trace", "rb"), NULL);
+	assert_int_equal(fread(magic, 1, strlen(TRACE_MAGIC), file),
+			strlen(TRACE_MAGIC));
+	assert_memory_equal(magic, TRACE_MAGIC, strlen(TRACE_MAGIC));
+	for (i = 0; i < count; i++) {
+		assert_int_equal(fread(&readRecord, sizeof(TraceRecord), 1, file), 1);
+		assert_true(readRecord.cycle == i);
+		assert_int_equal(readRecord.pc, i & 0xFFFF);
+	}
+	assert_int_equal(fread(&readRecord, sizeof(TraceRecord), 1, file), 0);
+	fclose(file);
+	remove("test.trace");
+}
+
+static void test_Trace_Render(void **state) {
+	(void) state;
+	FILE *file;
+
+	/* Missing file and file that is not a trace */
+	assert_int_equal(Trace_Render("nothing.trace", stdout), EXIT_FAILURE);
+	assert_ptr_not_equal(file = fopen("test.trace", "wb"), NULL);
+	fputs("not a trace", file);
+	fclose(file);
+	assert_int_equal(Trace_Render("test.trace", stdout), EXIT_FAILURE);
+	remove("test.trace");
+
+	/* Trace can't be created in a missing directory */
+	assert_ptr_equal(Trace_Create("nothing/test.trace"), NULL);
+}
+
+int run_UTtrace(void) {
+	const struct CMUnitTest test_trace[] = {
+		cmocka_unit_test(test_Trace_Print),
+		cmocka_unit_test(test_Trace_Ring),
+		cmocka_unit_test(test_Trace_Render),
+	};
+	int out = 0;
+	out += cmocka_run_group_tests(test_trace, NULL, NULL);
+	return out;
+}
@@ -0,0 +1,21 @@
+/*
+ * Mechgah, a precise NES emulator.
+ * Developped by Nicolas Chabanis, Nicolas Hily, Baptiste Mehat and
+ * Dylan Gageot, student at INSA Rennes.
+ *
+ * Print a binary trace file in the format of nestest.log.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include "src/nes/trace/trace.h"
+
+int main(int argc, char **argv) {
+	if (argc != 2) {
+		fprintf(stderr, "Usage: %s [TRACE]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	/* Print every record to stdout */
+	return Trace_Render(argv[1], stdout);
+}